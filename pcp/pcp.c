@@ -8,50 +8,17 @@
 #include <fcntl.h>
 #include <utime.h>
 #include "../include/common.h"
+#include "pcp.h"
+#include "pcp_copy.h"
 
-#define MAX_FILENAME 256
-#define MAX_FILES 1000
-#define BUFFER_SIZE 8192
+#define PROGRESS_INTERVAL_MS 100
 
-// 复制模式枚举
-typedef enum {
-    COPY_SIMPLE,        // 简单复制
-    COPY_RECURSIVE,     // 递归复制
-    COPY_PRESERVE,      // 保留属性
-    COPY_UPDATE         // 更新模式
-} CopyMode;
-
-// 复制配置结构
-typedef struct {
-    char **sources;
-    int source_count;
-    char destination[MAX_FILENAME];
-    CopyMode mode;
-    int verbose;
-    int force;
-    int preserve_attributes;
-    int update_only;
-    int interactive;
-    int show_progress;
-} CopyConfig;
-
-// 文件信息结构
+// 进度显示状态，按时间节流
 typedef struct {
-    char source[MAX_FILENAME];
-    char destination[MAX_FILENAME];
-    off_t size;
-    time_t mtime;
-    mode_t mode;
-    int is_directory;
-} FileInfo;
-
-// 统计信息结构
-typedef struct {
-    int files_copied;
-    int directories_created;
-    off_t bytes_copied;
-    int errors;
-} CopyStats;
+    const char *filename;
+    struct timespec last_update;
+    int drawn;
+} ProgressState;
 
 // 初始化统计信息
 void init_stats(CopyStats *stats) {
@@ -77,10 +44,29 @@ void show_progress(off_t current, off_t total, const char *filename) {
             printf(" ");
         }
     }
-    printf("] %d%% (%s/%s)", percent, format_size(current), format_size(total));
+    printf("] %d%% (%s/", percent, format_size(current));
+    printf("%s)", format_size(total));
     fflush(stdout);
 }
 
+// 复制引擎的进度回调：距上次刷新不足 PROGRESS_INTERVAL_MS 时跳过，完成时总是刷新
+void progress_callback(off_t copied, off_t total, void *ctx) {
+    ProgressState *state = (ProgressState *)ctx;
+    struct timespec now;
+    
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long elapsed_ms = (now.tv_sec - state->last_update.tv_sec) * 1000 +
+                      (now.tv_nsec - state->last_update.tv_nsec) / 1000000;
+    
+    if (state->drawn && copied < total && elapsed_ms < PROGRESS_INTERVAL_MS) {
+        return;
+    }
+    
+    state->last_update = now;
+    state->drawn = 1;
+    show_progress(copied, total, state->filename);
+}
+
 // 检查文件是否需要更新
 int needs_update(const char *source, const char *dest) {
     struct stat src_st, dest_st;
@@ -97,6 +83,42 @@ int needs_update(const char *source, const char *dest) {
     return (src_st.st_mtime > dest_st.st_mtime);
 }
 
+// 保留文件属性
+void preserve_attributes(const char *dest, const struct stat *src_st) {
+    struct utimbuf times;
+    times.actime = src_st->st_atime;
+    times.modtime = src_st->st_mtime;
+    utime(dest, &times);
+    chmod(dest, src_st->st_mode);
+}
+
+// 增量更新已存在的目标文件，返回 1 成功，0 失败，-1 不适用（需要完整复制）
+int delta_copy_file(int src_fd, const char *source, const char *dest, const CopyConfig *config) {
+    int dest_fd = open(dest, O_RDWR);
+    if (dest_fd == -1) {
+        return -1;
+    }
+    
+    struct stat dest_st;
+    if (fstat(dest_fd, &dest_st) != 0 || !S_ISREG(dest_st.st_mode)) {
+        close(dest_fd);
+        return -1;
+    }
+    
+    DeltaStats delta;
+    int result = delta_update(src_fd, dest_fd, &delta);
+    if (close(dest_fd) != 0 && result > 0) {
+        result = 0;
+    }
+    
+    if (result > 0 && config->verbose) {
+        printf("%s增量更新: %s 块大小 %zu, 未变化 %ld 块, 变化 %ld 块, 写入 %s%s\n",
+               COLOR_CYAN, source, delta.block_size, (long)delta.blocks_unchanged,
+               (long)delta.blocks_changed, format_size(delta.bytes_written), COLOR_RESET);
+    }
+    return result;
+}
+
 // 复制文件
 int copy_file(const char *source, const char *dest, const CopyConfig *config) {
     int src_fd = open(source, O_RDONLY);
@@ -105,6 +127,24 @@ int copy_file(const char *source, const char *dest, const CopyConfig *config) {
         return 0;
     }
     
+    if (config->delta) {
+        int result = delta_copy_file(src_fd, source, dest, config);
+        if (result >= 0) {
+            struct stat src_st;
+            fstat(src_fd, &src_st);
+            close(src_fd);
+            if (!result) {
+                print_error("增量更新失败");
+                return 0;
+            }
+            if (config->preserve_attributes) {
+                preserve_attributes(dest, &src_st);
+            }
+            return 1;
+        }
+        lseek(src_fd, 0, SEEK_SET);
+    }
+    
     int dest_fd = open(dest, O_WRONLY | O_CREAT | O_TRUNC, 0644);
     if (dest_fd == -1) {
         close(src_fd);
@@ -116,40 +156,36 @@ int copy_file(const char *source, const char *dest, const CopyConfig *config) {
     struct stat src_st;
     fstat(src_fd, &src_st);
     
-    char buffer[BUFFER_SIZE];
-    ssize_t bytes_read, bytes_written;
-    off_t total_copied = 0;
+    // 依次尝试 reflink、copy_file_range、sendfile 和 read/write
+    ProgressState progress = {0};
+    progress.filename = source;
+    CopyMethod method;
     
-    while ((bytes_read = read(src_fd, buffer, sizeof(buffer))) > 0) {
-        bytes_written = write(dest_fd, buffer, bytes_read);
-        if (bytes_written != bytes_read) {
-            close(src_fd);
-            close(dest_fd);
-            print_error("写入文件失败");
-            return 0;
-        }
-        
-        total_copied += bytes_written;
-        
-        if (config->show_progress) {
-            show_progress(total_copied, src_st.st_size, source);
-        }
-    }
+    int copied = copy_data(src_fd, dest_fd, src_st.st_size,
+                           config->show_progress ? progress_callback : NULL,
+                           &progress, &method);
     
     close(src_fd);
-    close(dest_fd);
+    if (close(dest_fd) != 0) {
+        copied = 0;
+    }
     
-    if (config->show_progress) {
+    if (config->show_progress && progress.drawn) {
         printf("\n");
     }
     
+    if (!copied) {
+        print_error("写入文件失败");
+        return 0;
+    }
+    
+    if (config->verbose) {
+        printf("%s复制方式: %s%s\n", COLOR_CYAN, copy_method_name(method), COLOR_RESET);
+    }
+    
     // 保留文件属性
     if (config->preserve_attributes) {
-        struct utimbuf times;
-        times.actime = src_st.st_atime;
-        times.modtime = src_st.st_mtime;
-        utime(dest, &times);
-        chmod(dest, src_st.st_mode);
+        preserve_attributes(dest, &src_st);
     }
     
     return 1;
@@ -168,8 +204,8 @@ int create_directory(const char *path, mode_t mode) {
     return 0;
 }
 
-// 递归复制目录
-int copy_directory(const char *source, const char *dest, const CopyConfig *config) {
+// 递归复制目录（逐个复制，用于交互模式）
+int copy_directory(const char *source, const char *dest, const CopyConfig *config, CopyStats *stats) {
     DIR *dir = opendir(source);
     if (!dir) {
         print_error("无法打开源目录");
@@ -203,11 +239,13 @@ int copy_directory(const char *source, const char *dest, const CopyConfig *confi
                 continue;
             }
             
+            stats->directories_created++;
+            
             if (config->verbose) {
                 printf("%s创建目录: %s%s\n", COLOR_GREEN, dest_path, COLOR_RESET);
             }
             
-            if (!copy_directory(src_path, dest_path, config)) {
+            if (!copy_directory(src_path, dest_path, config, stats)) {
                 success = 0;
             }
         } else {
@@ -228,6 +266,9 @@ int copy_directory(const char *source, const char *dest, const CopyConfig *confi
             }
             
             if (copy_file(src_path, dest_path, config)) {
+                stats->files_copied++;
+                stats->bytes_copied += st.st_size;
+                
                 if (config->verbose) {
                     printf("%s复制文件: %s -> %s%s\n", 
                            COLOR_GREEN, src_path, dest_path, COLOR_RESET);
@@ -278,7 +319,7 @@ int perform_copy(const CopyConfig *config, CopyStats *stats) {
         if (S_ISDIR(src_st.st_mode)) {
             // 复制目录
             if (config->mode == COPY_RECURSIVE || config->mode == COPY_PRESERVE) {
-                if (!create_directory(dest, src_st.st_mode)) {
+                if (!create_directory(dest, src_st.st_mode | S_IRWXU)) {
                     print_error("无法创建目标目录");
                     stats->errors++;
                     continue;
@@ -290,8 +331,15 @@ int perform_copy(const CopyConfig *config, CopyStats *stats) {
                 
                 stats->directories_created++;
                 
-                if (!copy_directory(source, dest, config)) {
-                    stats->errors++;
+                // 交互模式需要逐个确认，其余情况使用并行复制
+                if (config->interactive) {
+                    if (!copy_directory(source, dest, config, stats)) {
+                        stats->errors++;
+                    }
+                    chmod(dest, src_st.st_mode);
+                } else {
+                    // 出错时 parallel_copy_directory 已经计入 stats->errors
+                    parallel_copy_directory(source, dest, config, stats);
                 }
             } else {
                 print_warning("跳过目录（使用 -r 选项启用递归复制）");
@@ -355,6 +403,8 @@ void print_usage(const char *program_name) {
     printf("  -f, --force          强制覆盖\n");
     printf("  -v, --verbose        显示详细信息\n");
     printf("  --progress           显示进度条\n");
+    printf("  --delta              增量更新已存在的目标文件，只重写变化的块\n");
+    printf("  -j, --jobs N         递归复制的工作线程数（默认为 CPU 核数）\n");
     printf("  -h, --help           显示此帮助信息\n");
     printf("  -V, --version        显示版本信息\n");
     printf("\n示例:\n");
@@ -362,6 +412,7 @@ void print_usage(const char *program_name) {
     printf("  %s -r source/ dest/\n", program_name);
     printf("  %s -p -v file1 file2 backup/\n", program_name);
     printf("  %s -u --progress *.txt archive/\n", program_name);
+    printf("  %s -u --delta db.snapshot backup/\n", program_name);
 }
 
 int main(int argc, char *argv[]) {
@@ -373,7 +424,10 @@ int main(int argc, char *argv[]) {
     config.update_only = 0;
     config.interactive = 0;
     config.show_progress = 0;
-    config.sources = malloc(MAX_FILES * sizeof(char*));
+    config.jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (config.jobs < 1) config.jobs = 1;
+    if (config.jobs > MAX_JOBS) config.jobs = MAX_JOBS;
+    config.sources = malloc(argc * sizeof(char*));
     config.source_count = 0;
     
     // 解析命令行参数
@@ -393,6 +447,14 @@ int main(int argc, char *argv[]) {
             config.verbose = 1;
         } else if (strcmp(argv[i], "--progress") == 0) {
             config.show_progress = 1;
+        } else if (strcmp(argv[i], "--delta") == 0) {
+            config.delta = 1;
+        } else if (strcmp(argv[i], "-j") == 0 || strcmp(argv[i], "--jobs") == 0) {
+            if (i + 1 < argc) {
+                config.jobs = atoi(argv[++i]);
+                if (config.jobs < 1) config.jobs = 1;
+                if (config.jobs > MAX_JOBS) config.jobs = MAX_JOBS;
+            }
         } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
             print_usage(argv[0]);
             free(config.sources);
@@ -402,10 +464,8 @@ int main(int argc, char *argv[]) {
             free(config.sources);
             return 0;
         } else if (argv[i][0] != '-') {
-            if (config.source_count < MAX_FILES) {
-                config.sources[config.source_count] = argv[i];
-                config.source_count++;
-            }
+            config.sources[config.source_count] = argv[i];
+            config.source_count++;
         } else {
             printf("未知选项: %s\n", argv[i]);
             print_usage(argv[0]);
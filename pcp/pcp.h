@@ -0,0 +1,61 @@
+#ifndef PCP_H
+#define PCP_H
+
+#include <sys/types.h>
+#include <time.h>
+
+#define MAX_FILENAME 4096
+#define MAX_JOBS 64
+
+// 复制模式枚举
+typedef enum {
+    COPY_SIMPLE,        // 简单复制
+    COPY_RECURSIVE,     // 递归复制
+    COPY_PRESERVE,      // 保留属性
+    COPY_UPDATE         // 更新模式
+} CopyMode;
+
+// 复制配置结构
+typedef struct {
+    char **sources;
+    int source_count;
+    char destination[MAX_FILENAME];
+    CopyMode mode;
+    int verbose;
+    int force;
+    int preserve_attributes;
+    int update_only;
+    int interactive;
+    int show_progress;
+    int jobs;               // 递归复制的工作线程数
+    int delta;              // 对已存在的目标做增量更新
+} CopyConfig;
+
+// 文件信息结构
+typedef struct {
+    char source[MAX_FILENAME];
+    char destination[MAX_FILENAME];
+    off_t size;
+    time_t mtime;
+    mode_t mode;
+    int is_directory;
+} FileInfo;
+
+// 统计信息结构
+typedef struct {
+    int files_copied;
+    int directories_created;
+    off_t bytes_copied;
+    int errors;
+} CopyStats;
+
+void init_stats(CopyStats *stats);
+int needs_update(const char *source, const char *dest);
+int copy_file(const char *source, const char *dest, const CopyConfig *config);
+int create_directory(const char *path, mode_t mode);
+
+// 并行递归复制：枚举线程把文件批量放入有界队列，由 config->jobs 个工作线程复制
+int parallel_copy_directory(const char *source, const char *dest,
+                            const CopyConfig *config, CopyStats *stats);
+
+#endif // PCP_H
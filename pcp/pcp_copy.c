@@ -0,0 +1,209 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/sendfile.h>
+#include <linux/fs.h>
+#include "pcp_copy.h"
+
+// 一次复制过程的状态：当前层级在失败后只会向下回退，不会对每个区段重新尝试
+typedef struct {
+    CopyMethod method;
+    off_t done;             // 已处理的逻辑字节数，包括跳过的空洞
+    off_t total;
+    CopyProgressFn progress;
+    void *ctx;
+} CopyState;
+
+// 这些错误表示当前方式不可用，应回退到下一级
+static int is_fallback_error(int err) {
+    return err == ENOSYS || err == EXDEV || err == EINVAL ||
+           err == EOPNOTSUPP || err == ENOTTY || err == EBADF || err == EPERM;
+}
+
+static void report_progress(CopyState *state) {
+    if (state->progress) {
+        state->progress(state->done, state->total > state->done ? state->total : state->done,
+                        state->ctx);
+    }
+}
+
+// 第一级：reflink，只能整文件克隆
+static int try_reflink(int src_fd, int dest_fd) {
+#ifdef FICLONE
+    return ioctl(dest_fd, FICLONE, src_fd) == 0;
+#else
+    (void)src_fd;
+    (void)dest_fd;
+    return 0;
+#endif
+}
+
+// 第二级和第三级：内核内复制。返回 1 完成，0 需要回退，-1 出错
+static int copy_in_kernel(int src_fd, int dest_fd, off_t *remaining, CopyState *state) {
+    while (*remaining > 0) {
+        size_t chunk = *remaining > COPY_CHUNK_SIZE ? COPY_CHUNK_SIZE : (size_t)*remaining;
+        ssize_t n;
+
+        if (state->method == COPY_METHOD_COPY_RANGE) {
+            n = copy_file_range(src_fd, NULL, dest_fd, NULL, chunk, 0);
+        } else {
+            n = sendfile(dest_fd, src_fd, NULL, chunk);
+        }
+
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            // 已经复制了部分数据时文件位置仍然一致，可以从当前位置继续回退
+            return is_fallback_error(errno) ? 0 : -1;
+        }
+        if (n == 0) {
+            // 文件被截断或伪文件系统报告了错误的大小，交给 read/write 处理
+            return 0;
+        }
+
+        *remaining -= n;
+        state->done += n;
+        report_progress(state);
+    }
+    return 1;
+}
+
+// 最后一级：大缓冲区 read/write。remaining 为负数时读到 EOF 为止
+static int copy_read_write(int src_fd, int dest_fd, off_t remaining, CopyState *state) {
+    char *buffer = malloc(COPY_BUFFER_SIZE);
+    if (!buffer) return 0;
+
+    while (remaining != 0) {
+        size_t want = (remaining < 0 || remaining > COPY_BUFFER_SIZE) ? COPY_BUFFER_SIZE
+                                                                       : (size_t)remaining;
+        ssize_t bytes_read = read(src_fd, buffer, want);
+        if (bytes_read < 0) {
+            if (errno == EINTR) continue;
+            free(buffer);
+            return 0;
+        }
+        if (bytes_read == 0) break;
+
+        ssize_t offset = 0;
+        while (offset < bytes_read) {
+            ssize_t bytes_written = write(dest_fd, buffer + offset, bytes_read - offset);
+            if (bytes_written < 0) {
+                if (errno == EINTR) continue;
+                free(buffer);
+                return 0;
+            }
+            offset += bytes_written;
+        }
+
+        if (remaining > 0) remaining -= bytes_read;
+        state->done += bytes_read;
+        report_progress(state);
+    }
+
+    free(buffer);
+    return 1;
+}
+
+// 从两个文件的当前位置复制 length 字节，按层级依次回退
+static int copy_extent(int src_fd, int dest_fd, off_t length, CopyState *state) {
+    off_t remaining = length;
+
+    while (state->method != COPY_METHOD_READ_WRITE) {
+        int result = copy_in_kernel(src_fd, dest_fd, &remaining, state);
+        if (result > 0) return 1;
+        if (result < 0) return 0;
+        state->method++;
+    }
+    return copy_read_write(src_fd, dest_fd, remaining, state);
+}
+
+// 稀疏文件：用 SEEK_DATA/SEEK_HOLE 找出数据区段，只复制数据，空洞保持为空洞
+// 返回 1 成功，0 失败，-1 文件系统不支持空洞查询
+static int copy_sparse(int src_fd, int dest_fd, off_t size, CopyState *state) {
+    off_t data = 0;
+
+    while (data < size) {
+        data = lseek(src_fd, data, SEEK_DATA);
+        if (data < 0) {
+            if (errno == ENXIO) break;   // 剩余部分全是空洞
+            return state->done == 0 ? -1 : 0;
+        }
+
+        off_t hole = lseek(src_fd, data, SEEK_HOLE);
+        if (hole < 0) return 0;
+        if (hole > size) hole = size;
+
+        // 跳过的空洞计入进度
+        state->done = data;
+
+        if (lseek(src_fd, data, SEEK_SET) < 0 || lseek(dest_fd, data, SEEK_SET) < 0) {
+            return 0;
+        }
+
+        // 只为数据区段预分配，空洞部分不占用磁盘
+        fallocate(dest_fd, FALLOC_FL_KEEP_SIZE, data, hole - data);
+
+        if (!copy_extent(src_fd, dest_fd, hole - data, state)) {
+            return 0;
+        }
+        data = hole;
+    }
+
+    // 末尾的空洞通过设置文件大小保留
+    if (ftruncate(dest_fd, size) != 0) {
+        return 0;
+    }
+    state->done = size;
+    report_progress(state);
+    return 1;
+}
+
+int copy_data(int src_fd, int dest_fd, off_t size,
+              CopyProgressFn progress, void *ctx, CopyMethod *method) {
+    CopyState state = {COPY_METHOD_COPY_RANGE, 0, size, progress, ctx};
+    struct stat st;
+    int result;
+
+    if (size > 0 && try_reflink(src_fd, dest_fd)) {
+        if (method) *method = COPY_METHOD_REFLINK;
+        state.done = size;
+        report_progress(&state);
+        return 1;
+    }
+
+    // 分配的块少于文件大小说明存在空洞
+    if (size > 0 && fstat(src_fd, &st) == 0 && (off_t)st.st_blocks * 512 < size) {
+        result = copy_sparse(src_fd, dest_fd, size, &state);
+        if (result >= 0) {
+            if (method) *method = state.method;
+            return result;
+        }
+        lseek(src_fd, 0, SEEK_SET);
+        lseek(dest_fd, 0, SEEK_SET);
+    }
+
+    if (size > 0) {
+        // 预分配目标文件，减少碎片；KEEP_SIZE 保证复制中断时文件大小与内容一致
+        fallocate(dest_fd, FALLOC_FL_KEEP_SIZE, 0, size);
+        result = copy_extent(src_fd, dest_fd, size, &state);
+        if (method) *method = state.method;
+        return result;
+    }
+
+    // 大小为 0 的文件可能是 /proc 之类的伪文件，直接读到 EOF
+    if (method) *method = COPY_METHOD_READ_WRITE;
+    return copy_read_write(src_fd, dest_fd, -1, &state);
+}
+
+const char *copy_method_name(CopyMethod method) {
+    switch (method) {
+        case COPY_METHOD_REFLINK:    return "reflink";
+        case COPY_METHOD_COPY_RANGE: return "copy_file_range";
+        case COPY_METHOD_SENDFILE:   return "sendfile";
+        default:                     return "read/write";
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef PCP_COPY_H
+#define PCP_COPY_H
+
+#include <sys/types.h>
+
+#define COPY_BUFFER_SIZE (1024 * 1024)        // read/write 回退路径的缓冲区
+#define COPY_CHUNK_SIZE (64 * 1024 * 1024)    // 内核复制每次调用的最大字节数
+
+// 实际使用的复制方式，按尝试顺序排列
+typedef enum {
+    COPY_METHOD_REFLINK,      // FICLONE 共享数据块（btrfs/xfs）
+    COPY_METHOD_COPY_RANGE,   // copy_file_range 内核内复制
+    COPY_METHOD_SENDFILE,     // sendfile
+    COPY_METHOD_READ_WRITE    // 大缓冲区 read/write
+} CopyMethod;
+
+// 进度回调：已复制字节数和总字节数
+typedef void (*CopyProgressFn)(off_t copied, off_t total, void *ctx);
+
+// 从 src_fd 当前位置复制 size 字节到 dest_fd，成功返回 1
+// method 返回最终使用的复制方式，可以为 NULL
+int copy_data(int src_fd, int dest_fd, off_t size,
+              CopyProgressFn progress, void *ctx, CopyMethod *method);
+
+const char *copy_method_name(CopyMethod method);
+
+// 增量更新统计
+typedef struct {
+    size_t block_size;
+    off_t blocks_unchanged;     // 原位未变化、无需写入的块
+    off_t blocks_changed;       // 与目标同一偏移处不同的块
+    off_t bytes_written;
+} DeltaStats;
+
+// 原地增量更新：源和目标都用 mmap 映射，按块比较同一偏移处的内容，
+// 只重写不同的块。成功返回 1，失败返回 0，不适用（空文件或无法映射）返回 -1
+int delta_update(int src_fd, int dest_fd, DeltaStats *stats);
+
+#endif // PCP_COPY_H
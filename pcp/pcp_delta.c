@@ -0,0 +1,95 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <math.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "pcp_copy.h"
+
+#define DELTA_MIN_BLOCK 4096
+#define DELTA_MAX_BLOCK (128 * 1024)
+
+// 块大小取文件大小的平方根，按 1 KB 对齐
+static size_t choose_block_size(off_t size) {
+    size_t block = (size_t)sqrt((double)size);
+    block = (block + 1023) & ~(size_t)1023;
+    if (block < DELTA_MIN_BLOCK) block = DELTA_MIN_BLOCK;
+    if (block > DELTA_MAX_BLOCK) block = DELTA_MAX_BLOCK;
+    return block;
+}
+
+static int write_range(int fd, const unsigned char *data, off_t start, off_t end, DeltaStats *stats) {
+    while (start < end) {
+        ssize_t n = pwrite(fd, data + start, (size_t)(end - start), start);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        start += n;
+        stats->bytes_written += n;
+    }
+    return 1;
+}
+
+int delta_update(int src_fd, int dest_fd, DeltaStats *stats) {
+    struct stat src_st, dest_st;
+
+    memset(stats, 0, sizeof(*stats));
+    if (fstat(src_fd, &src_st) != 0 || fstat(dest_fd, &dest_st) != 0) {
+        return 0;
+    }
+
+    // 源和目标是同一个文件时无需任何操作
+    if (src_st.st_dev == dest_st.st_dev && src_st.st_ino == dest_st.st_ino) {
+        return 1;
+    }
+
+    off_t src_size = src_st.st_size;
+    off_t dest_size = dest_st.st_size;
+    if (src_size == 0 || dest_size == 0) {
+        return -1;
+    }
+
+    unsigned char *src = mmap(NULL, src_size, PROT_READ, MAP_PRIVATE, src_fd, 0);
+    if (src == MAP_FAILED) return -1;
+    unsigned char *dest = mmap(NULL, dest_size, PROT_READ, MAP_SHARED, dest_fd, 0);
+    if (dest == MAP_FAILED) {
+        munmap(src, src_size);
+        return -1;
+    }
+    madvise(src, src_size, MADV_SEQUENTIAL);
+    madvise(dest, dest_size, MADV_SEQUENTIAL);
+
+    // 原地更新只能复用同一偏移处的块（其他位置的旧数据可能已被覆盖），所以按固定
+    // 步长逐块 memcmp 比较源和目标，相邻的不同块合并为一次写入
+    size_t block_size = choose_block_size(dest_size);
+    off_t common = src_size < dest_size ? src_size : dest_size;
+    off_t literal_start = 0;
+    int ok = 1;
+    stats->block_size = block_size;
+
+    for (off_t pos = 0; ok && pos < src_size; pos += (off_t)block_size) {
+        size_t len = src_size - pos < (off_t)block_size ? (size_t)(src_size - pos) : block_size;
+        if (pos + (off_t)len <= common && memcmp(src + pos, dest + pos, len) == 0) {
+            ok = write_range(dest_fd, src, literal_start, pos, stats);
+            stats->blocks_unchanged++;
+            literal_start = pos + (off_t)len;
+        } else {
+            stats->blocks_changed++;
+        }
+    }
+    if (ok) {
+        ok = write_range(dest_fd, src, literal_start, src_size, stats);
+    }
+
+    if (ok && dest_size != src_size) {
+        ok = ftruncate(dest_fd, src_size) == 0;
+    }
+
+    munmap(src, src_size);
+    munmap(dest, dest_size);
+    return ok;
+}
@@ -0,0 +1,383 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include "../include/common.h"
+#include "pcp.h"
+
+#define QUEUE_CAPACITY 256                 // 队列中最多缓存的批次数
+#define BATCH_MAX_FILES 64                 // 每批最多文件数
+#define BATCH_MAX_BYTES (4 * 1024 * 1024)  // 每批小文件的总字节数上限
+
+// 单个文件复制任务
+typedef struct {
+    char *source;
+    char *dest;
+    off_t size;
+} CopyJob;
+
+// 一批文件：小文件合并成一批以减少队列同步开销，大文件单独成批
+typedef struct {
+    CopyJob jobs[BATCH_MAX_FILES];
+    int count;
+    off_t bytes;
+} CopyBatch;
+
+// 目录元数据，所有文件复制完成后统一应用
+typedef struct {
+    char *path;
+    mode_t mode;
+    struct timespec times[2];
+} DirMeta;
+
+// 有界批次队列
+typedef struct {
+    CopyBatch *slots[QUEUE_CAPACITY];
+    int head;
+    int tail;
+    int count;
+    int closed;
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+} BatchQueue;
+
+typedef struct {
+    CopyConfig config;          // 工作线程使用的配置（关闭逐文件进度条）
+    CopyStats *stats;
+    pthread_mutex_t stats_lock;
+    BatchQueue queue;
+    CopyBatch *pending;         // 枚举线程正在填充的批次
+    DirMeta *dirs;
+    size_t dir_count;
+    size_t dir_capacity;
+} ParallelCopy;
+
+static void queue_init(BatchQueue *queue) {
+    memset(queue, 0, sizeof(*queue));
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->not_empty, NULL);
+    pthread_cond_init(&queue->not_full, NULL);
+}
+
+static void queue_destroy(BatchQueue *queue) {
+    pthread_mutex_destroy(&queue->lock);
+    pthread_cond_destroy(&queue->not_empty);
+    pthread_cond_destroy(&queue->not_full);
+}
+
+static void queue_push(BatchQueue *queue, CopyBatch *batch) {
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count == QUEUE_CAPACITY) {
+        pthread_cond_wait(&queue->not_full, &queue->lock);
+    }
+    queue->slots[queue->tail] = batch;
+    queue->tail = (queue->tail + 1) % QUEUE_CAPACITY;
+    queue->count++;
+    pthread_cond_signal(&queue->not_empty);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+// 队列关闭且为空时返回 NULL
+static CopyBatch *queue_pop(BatchQueue *queue) {
+    CopyBatch *batch = NULL;
+
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count == 0 && !queue->closed) {
+        pthread_cond_wait(&queue->not_empty, &queue->lock);
+    }
+    if (queue->count > 0) {
+        batch = queue->slots[queue->head];
+        queue->head = (queue->head + 1) % QUEUE_CAPACITY;
+        queue->count--;
+        pthread_cond_signal(&queue->not_full);
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return batch;
+}
+
+static void queue_close(BatchQueue *queue) {
+    pthread_mutex_lock(&queue->lock);
+    queue->closed = 1;
+    pthread_cond_broadcast(&queue->not_empty);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+static char *join_path(const char *dir, const char *name) {
+    size_t dir_len = strlen(dir);
+    size_t name_len = strlen(name);
+    char *path = malloc(dir_len + name_len + 2);
+    if (!path) return NULL;
+
+    memcpy(path, dir, dir_len);
+    path[dir_len] = '/';
+    memcpy(path + dir_len + 1, name, name_len + 1);
+    return path;
+}
+
+static void flush_pending(ParallelCopy *pc) {
+    if (pc->pending && pc->pending->count > 0) {
+        queue_push(&pc->queue, pc->pending);
+        pc->pending = NULL;
+    }
+}
+
+static void add_job(ParallelCopy *pc, char *source, char *dest, off_t size) {
+    // 大文件单独成批，避免一个工作线程被一批大文件拖住
+    if (size >= BATCH_MAX_BYTES) {
+        CopyBatch *single = calloc(1, sizeof(CopyBatch));
+        if (!single) {
+            free(source);
+            free(dest);
+            return;
+        }
+        single->jobs[0] = (CopyJob){source, dest, size};
+        single->count = 1;
+        single->bytes = size;
+        queue_push(&pc->queue, single);
+        return;
+    }
+
+    if (!pc->pending) {
+        pc->pending = calloc(1, sizeof(CopyBatch));
+        if (!pc->pending) {
+            free(source);
+            free(dest);
+            return;
+        }
+    }
+
+    CopyBatch *batch = pc->pending;
+    batch->jobs[batch->count++] = (CopyJob){source, dest, size};
+    batch->bytes += size;
+
+    if (batch->count == BATCH_MAX_FILES || batch->bytes >= BATCH_MAX_BYTES) {
+        flush_pending(pc);
+    }
+}
+
+static void record_error(ParallelCopy *pc, const char *message) {
+    pthread_mutex_lock(&pc->stats_lock);
+    pc->stats->errors++;
+    print_error(message);
+    pthread_mutex_unlock(&pc->stats_lock);
+}
+
+static void add_dir_meta(ParallelCopy *pc, const char *path, const struct stat *st) {
+    if (pc->dir_count == pc->dir_capacity) {
+        size_t capacity = pc->dir_capacity ? pc->dir_capacity * 2 : 64;
+        DirMeta *dirs = realloc(pc->dirs, capacity * sizeof(DirMeta));
+        if (!dirs) return;
+        pc->dirs = dirs;
+        pc->dir_capacity = capacity;
+    }
+
+    DirMeta *meta = &pc->dirs[pc->dir_count++];
+    meta->path = strdup(path);
+    meta->mode = st->st_mode & 07777;
+    meta->times[0] = st->st_atim;
+    meta->times[1] = st->st_mtim;
+}
+
+// 符号链接按链接本身复制，已存在的同名文件先删除
+static void copy_symlink(ParallelCopy *pc, int dir_fd, const char *name, const char *dest_path,
+                         const struct stat *st) {
+    char target[MAX_FILENAME];
+    ssize_t len = readlinkat(dir_fd, name, target, sizeof(target) - 1);
+    if (len < 0) {
+        record_error(pc, "无法读取符号链接");
+        return;
+    }
+    target[len] = '\0';
+
+    if (symlink(target, dest_path) != 0 &&
+        (errno != EEXIST || unlink(dest_path) != 0 || symlink(target, dest_path) != 0)) {
+        record_error(pc, "无法创建符号链接");
+        return;
+    }
+    if (pc->config.preserve_attributes) {
+        struct timespec times[2] = {st->st_atim, st->st_mtim};
+        utimensat(AT_FDCWD, dest_path, times, AT_SYMLINK_NOFOLLOW);
+    }
+
+    pthread_mutex_lock(&pc->stats_lock);
+    pc->stats->files_copied++;
+    if (pc->config.verbose) {
+        printf("%s复制链接: %s -> %s%s\n", COLOR_GREEN, dest_path, target, COLOR_RESET);
+    }
+    pthread_mutex_unlock(&pc->stats_lock);
+}
+
+// 枚举源目录：先创建目标目录，再把文件放入队列
+static void enumerate_directory(ParallelCopy *pc, const char *source, const char *dest) {
+    DIR *dir = opendir(source);
+    if (!dir) {
+        record_error(pc, "无法打开源目录");
+        return;
+    }
+
+    int dir_fd = dirfd(dir);
+    struct dirent *entry;
+
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+
+        // 相对目录 fd 做 stat，避免每次都解析完整路径。不跟随符号链接：指向目录的
+        // 链接不会被递归进入，也就不会因为链接成环而无限复制
+        struct stat st;
+        if (fstatat(dir_fd, entry->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+            continue;
+        }
+
+        char *src_path = join_path(source, entry->d_name);
+        char *dest_path = join_path(dest, entry->d_name);
+        if (!src_path || !dest_path) {
+            free(src_path);
+            free(dest_path);
+            record_error(pc, "内存不足");
+            continue;
+        }
+
+        if (S_ISDIR(st.st_mode)) {
+            // 目录先以可写权限创建，真实权限在最后一遍应用
+            if (!create_directory(dest_path, st.st_mode | S_IRWXU)) {
+                record_error(pc, "无法创建目录");
+            } else {
+                add_dir_meta(pc, dest_path, &st);
+
+                pthread_mutex_lock(&pc->stats_lock);
+                pc->stats->directories_created++;
+                if (pc->config.verbose) {
+                    printf("%s创建目录: %s%s\n", COLOR_GREEN, dest_path, COLOR_RESET);
+                }
+                pthread_mutex_unlock(&pc->stats_lock);
+
+                enumerate_directory(pc, src_path, dest_path);
+            }
+            free(src_path);
+            free(dest_path);
+        } else if (S_ISLNK(st.st_mode)) {
+            copy_symlink(pc, dir_fd, entry->d_name, dest_path, &st);
+            free(src_path);
+            free(dest_path);
+        } else if (S_ISREG(st.st_mode)) {
+            add_job(pc, src_path, dest_path, st.st_size);
+        } else {
+            print_warning("跳过特殊文件");
+            free(src_path);
+            free(dest_path);
+        }
+    }
+
+    closedir(dir);
+}
+
+static void *copy_worker(void *arg) {
+    ParallelCopy *pc = (ParallelCopy *)arg;
+    CopyBatch *batch;
+
+    while ((batch = queue_pop(&pc->queue)) != NULL) {
+        for (int i = 0; i < batch->count; i++) {
+            CopyJob *job = &batch->jobs[i];
+
+            if (pc->config.update_only && !needs_update(job->source, job->dest)) {
+                if (pc->config.verbose) {
+                    pthread_mutex_lock(&pc->stats_lock);
+                    printf("%s跳过（已是最新）: %s%s\n", COLOR_YELLOW, job->source, COLOR_RESET);
+                    pthread_mutex_unlock(&pc->stats_lock);
+                }
+            } else if (copy_file(job->source, job->dest, &pc->config)) {
+                pthread_mutex_lock(&pc->stats_lock);
+                pc->stats->files_copied++;
+                pc->stats->bytes_copied += job->size;
+                if (pc->config.verbose) {
+                    printf("%s复制文件: %s -> %s%s\n",
+                           COLOR_GREEN, job->source, job->dest, COLOR_RESET);
+                }
+                pthread_mutex_unlock(&pc->stats_lock);
+            } else {
+                record_error(pc, "复制文件失败");
+            }
+
+            free(job->source);
+            free(job->dest);
+        }
+        free(batch);
+    }
+    return NULL;
+}
+
+// 按逆序应用目录元数据：子目录先于父目录，父目录的 mtime 不会被再次修改
+static void apply_dir_metadata(ParallelCopy *pc) {
+    for (size_t i = pc->dir_count; i > 0; i--) {
+        DirMeta *meta = &pc->dirs[i - 1];
+        if (meta->path) {
+            chmod(meta->path, meta->mode);
+            if (pc->config.preserve_attributes) {
+                utimensat(AT_FDCWD, meta->path, meta->times, 0);
+            }
+        }
+        free(meta->path);
+    }
+    free(pc->dirs);
+}
+
+int parallel_copy_directory(const char *source, const char *dest,
+                            const CopyConfig *config, CopyStats *stats) {
+    ParallelCopy pc;
+    int jobs = config->jobs > 0 ? config->jobs : 1;
+    pthread_t workers[MAX_JOBS];
+    int started = 0;
+    int errors_before = stats->errors;
+
+    memset(&pc, 0, sizeof(pc));
+    pc.config = *config;
+    pc.config.show_progress = 0;
+    pc.stats = stats;
+    pthread_mutex_init(&pc.stats_lock, NULL);
+    queue_init(&pc.queue);
+
+    if (jobs > MAX_JOBS) jobs = MAX_JOBS;
+    for (int i = 0; i < jobs; i++) {
+        if (pthread_create(&workers[started], NULL, copy_worker, &pc) == 0) {
+            started++;
+        }
+    }
+
+    // 至少需要一个工作线程才能消费队列
+    if (started == 0) {
+        queue_destroy(&pc.queue);
+        pthread_mutex_destroy(&pc.stats_lock);
+        print_error("无法创建工作线程");
+        stats->errors++;
+        return 0;
+    }
+
+    // 顶层目录同样在最后一遍恢复权限和时间
+    struct stat src_st;
+    if (stat(source, &src_st) == 0) {
+        add_dir_meta(&pc, dest, &src_st);
+    }
+
+    enumerate_directory(&pc, source, dest);
+    flush_pending(&pc);
+    queue_close(&pc.queue);
+
+    for (int i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+
+    apply_dir_metadata(&pc);
+
+    queue_destroy(&pc.queue);
+    pthread_mutex_destroy(&pc.stats_lock);
+    return stats->errors == errors_before;
+}
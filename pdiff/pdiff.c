@@ -5,54 +5,7 @@
 #include <sys/stat.h>
 #include <errno.h>
 #include "../include/common.h"
-
-#define MAX_LINE_LENGTH 1024
-#define MAX_LINES 1000
-#define CONTEXT_LINES 3
-
-// 差异类型枚举
-typedef enum {
-    DIFF_EQUAL,     // 相同
-    DIFF_ADD,       // 添加
-    DIFF_DELETE,    // 删除
-    DIFF_MODIFY     // 修改
-} DiffType;
-
-// 差异行结构
-typedef struct {
-    int line_num1;      // 文件1行号
-    int line_num2;      // 文件2行号
-    DiffType type;      // 差异类型
-    char content[MAX_LINE_LENGTH];  // 行内容
-} DiffLine;
-
-// 文件行结构
-typedef struct {
-    char content[MAX_LINE_LENGTH];
-    int line_num;
-} FileLine;
-
-// 比较配置结构
-typedef struct {
-    char file1[MAX_LINE_LENGTH];
-    char file2[MAX_LINE_LENGTH];
-    int context_lines;
-    int ignore_case;
-    int ignore_whitespace;
-    int show_line_numbers;
-    int unified_format;
-    int side_by_side;
-    int color_output;
-    int verbose;
-} DiffConfig;
-
-// 统计信息结构
-typedef struct {
-    int added_lines;
-    int deleted_lines;
-    int modified_lines;
-    int equal_lines;
-} DiffStats;
+#include "pdiff.h"
 
 // 初始化统计信息
 void init_stats(DiffStats *stats) {
@@ -62,310 +15,309 @@ void init_stats(DiffStats *stats) {
     stats->equal_lines = 0;
 }
 
-// 读取文件到行数组
-int read_file_lines(const char *filename, FileLine *lines, int max_lines) {
-    if (!filename || !lines || max_lines <= 0) {
-        return -1;
-    }
-    
-    FILE *file = fopen(filename, "r");
-    if (!file) {
+// 比较两个文件。大文件通常只有少数几处不同，先用 memcmp 去掉相同的开头和结尾，
+// 只有中间部分需要编号和运行差异算法
+int compute_diff(const FileLines *file1, const FileLines *file2, const DiffConfig *config, DiffResult *result) {
+    memset(result, 0, sizeof(*result));
+    result->count1 = file1->count;
+    result->count2 = file2->count;
+    result->changed1 = calloc((size_t)file1->count + 1, 1);
+    result->changed2 = calloc((size_t)file2->count + 1, 1);
+    if (!result->changed1 || !result->changed2) {
+        free_diff_result(result);
         return -1;
     }
     
-    int count = 0;
-    char buffer[MAX_LINE_LENGTH];
-    
-    while (fgets(buffer, sizeof(buffer), file) && count < max_lines) {
-        // 确保不会越界
-        if (count >= max_lines) {
-            break;
-        }
-        
-        strncpy(lines[count].content, buffer, MAX_LINE_LENGTH - 1);
-        lines[count].content[MAX_LINE_LENGTH - 1] = '\0';
-        lines[count].line_num = count + 1;
-        count++;
+    long prefix = 0;
+    while (prefix < file1->count && prefix < file2->count &&
+           lines_equal(&file1->lines[prefix], &file2->lines[prefix], config)) {
+        prefix++;
     }
-    
-    fclose(file);
-    return count;
-}
-
-// 比较两行是否相同
-int lines_equal(const char *line1, const char *line2, const DiffConfig *config) {
-    if (!line1 || !line2) {
-        return 0;
+    long end1 = file1->count, end2 = file2->count;
+    while (end1 > prefix && end2 > prefix && lines_equal(&file1->lines[end1 - 1], &file2->lines[end2 - 1], config)) {
+        end1--;
+        end2--;
     }
+    long count1 = end1 - prefix;
+    long count2 = end2 - prefix;
     
-    char *l1 = strdup(line1);
-    char *l2 = strdup(line2);
-    
-    if (!l1 || !l2) {
-        if (l1) free(l1);
-        if (l2) free(l2);
+    // 一边为空时不需要算法
+    if (count1 == 0 || count2 == 0) {
+        memset(result->changed1 + prefix, 1, (size_t)count1);
+        memset(result->changed2 + prefix, 1, (size_t)count2);
         return 0;
     }
     
-    if (config->ignore_whitespace) {
-        // 移除首尾空白字符
-        char *start1 = l1;
-        char *end1 = l1 + strlen(l1) - 1;
-        while (end1 > start1 && (*end1 == ' ' || *end1 == '\t' || *end1 == '\n' || *end1 == '\r')) {
-            end1--;
-        }
-        *(end1 + 1) = '\0';
-        
-        char *start2 = l2;
-        char *end2 = l2 + strlen(l2) - 1;
-        while (end2 > start2 && (*end2 == ' ' || *end2 == '\t' || *end2 == '\n' || *end2 == '\r')) {
-            end2--;
+    int *ids1 = malloc((size_t)count1 * sizeof(int));
+    int *ids2 = malloc((size_t)count2 * sizeof(int));
+    int distinct = 0;
+    int ret = -1;
+    if (ids1 && ids2 &&
+        intern_lines(file1->lines + prefix, count1, file2->lines + prefix, count2, config, ids1, ids2, &distinct) == 0) {
+        unsigned char *changed1 = result->changed1 + prefix;
+        unsigned char *changed2 = result->changed2 + prefix;
+        switch (config->algorithm) {
+            case ALGORITHM_PATIENCE:
+                ret = diff_patience(ids1, count1, ids2, count2, distinct, config, changed1, changed2);
+                break;
+            case ALGORITHM_HISTOGRAM:
+                ret = diff_histogram(ids1, count1, ids2, count2, distinct, config, changed1, changed2);
+                break;
+            default:
+                ret = diff_myers(ids1, count1, ids2, count2, config, changed1, changed2);
+                break;
         }
-        *(end2 + 1) = '\0';
     }
-    
-    int result;
-    if (config->ignore_case) {
-        result = (strcasecmp(l1, l2) == 0);
-    } else {
-        result = (strcmp(l1, l2) == 0);
+    free(ids1);
+    free(ids2);
+    if (ret != 0) {
+        free_diff_result(result);
     }
-    
-    free(l1);
-    free(l2);
-    return result;
+    return ret;
+}
+
+void free_diff_result(DiffResult *result) {
+    free(result->changed1);
+    free(result->changed2);
+    result->changed1 = NULL;
+    result->changed2 = NULL;
 }
 
-// 简单的LCS算法计算差异
-void compute_diff(FileLine *lines1, int count1, FileLine *lines2, int count2, 
-                  DiffLine *diffs, int *diff_count, const DiffConfig *config) {
-    if (!lines1 || !lines2 || !diffs || !diff_count || count1 < 0 || count2 < 0) {
-        if (diff_count) *diff_count = 0;
-        return;
+// 把标记数组整理成连续的修改块
+int collect_changes(const DiffResult *result, DiffChange **changes, long *change_count) {
+    long capacity = 64;
+    long count = 0;
+    DiffChange *list = malloc((size_t)capacity * sizeof(DiffChange));
+    if (!list) {
+        return -1;
     }
     
-    *diff_count = 0;
-    const int MAX_DIFFS = MAX_LINES; // 限制最大差异行数
-    
-    int i = 0, j = 0;
-    
-    while ((i < count1 || j < count2) && *diff_count < MAX_DIFFS) {
-        if (i >= count1) {
-            // 文件1结束，剩余都是添加
-            while (j < count2 && *diff_count < MAX_DIFFS) {
-                diffs[*diff_count].line_num1 = 0;
-                diffs[*diff_count].line_num2 = lines2[j].line_num;
-                diffs[*diff_count].type = DIFF_ADD;
-                strncpy(diffs[*diff_count].content, lines2[j].content, MAX_LINE_LENGTH - 1);
-                diffs[*diff_count].content[MAX_LINE_LENGTH - 1] = '\0';
-                (*diff_count)++;
-                j++;
-            }
-            break;
-        }
-        
-        if (j >= count2) {
-            // 文件2结束，剩余都是删除
-            while (i < count1 && *diff_count < MAX_DIFFS) {
-                diffs[*diff_count].line_num1 = lines1[i].line_num;
-                diffs[*diff_count].line_num2 = 0;
-                diffs[*diff_count].type = DIFF_DELETE;
-                strncpy(diffs[*diff_count].content, lines1[i].content, MAX_LINE_LENGTH - 1);
-                diffs[*diff_count].content[MAX_LINE_LENGTH - 1] = '\0';
-                (*diff_count)++;
-                i++;
-            }
-            break;
+    long i = 0, j = 0;
+    while (i < result->count1 || j < result->count2) {
+        if (i < result->count1 && j < result->count2 && !result->changed1[i] && !result->changed2[j]) {
+            i++;
+            j++;
+            continue;
         }
         
-        if (lines_equal(lines1[i].content, lines2[j].content, config)) {
-            // 行相同
-            diffs[*diff_count].line_num1 = lines1[i].line_num;
-            diffs[*diff_count].line_num2 = lines2[j].line_num;
-            diffs[*diff_count].type = DIFF_EQUAL;
-            strncpy(diffs[*diff_count].content, lines1[i].content, MAX_LINE_LENGTH - 1);
-            diffs[*diff_count].content[MAX_LINE_LENGTH - 1] = '\0';
-            (*diff_count)++;
+        DiffChange change = {i, j, 0, 0};
+        while (i < result->count1 && result->changed1[i]) {
             i++;
+            change.deleted++;
+        }
+        while (j < result->count2 && result->changed2[j]) {
             j++;
-        } else {
-            // 查找下一行匹配
-            int found = 0;
-            for (int k = j + 1; k < count2 && k < j + 10; k++) {
-                if (lines_equal(lines1[i].content, lines2[k].content, config)) {
-                    // 找到匹配，中间的行是添加
-                    while (j < k && *diff_count < MAX_DIFFS) {
-                        diffs[*diff_count].line_num1 = 0;
-                        diffs[*diff_count].line_num2 = lines2[j].line_num;
-                        diffs[*diff_count].type = DIFF_ADD;
-                        strncpy(diffs[*diff_count].content, lines2[j].content, MAX_LINE_LENGTH - 1);
-                        diffs[*diff_count].content[MAX_LINE_LENGTH - 1] = '\0';
-                        (*diff_count)++;
-                        j++;
-                    }
-                    found = 1;
-                    break;
-                }
-            }
-            
-            if (!found && *diff_count < MAX_DIFFS) {
-                // 没找到匹配，标记为删除
-                diffs[*diff_count].line_num1 = lines1[i].line_num;
-                diffs[*diff_count].line_num2 = 0;
-                diffs[*diff_count].type = DIFF_DELETE;
-                strncpy(diffs[*diff_count].content, lines1[i].content, MAX_LINE_LENGTH - 1);
-                diffs[*diff_count].content[MAX_LINE_LENGTH - 1] = '\0';
-                (*diff_count)++;
-                i++;
+            change.added++;
+        }
+        // 一侧已经结束时另一侧剩下的行都算修改
+        if (change.deleted == 0 && change.added == 0) {
+            change.deleted = result->count1 - i;
+            change.added = result->count2 - j;
+            i = result->count1;
+            j = result->count2;
+        }
+        
+        if (count == capacity) {
+            DiffChange *grown = realloc(list, (size_t)capacity * 2 * sizeof(DiffChange));
+            if (!grown) {
+                free(list);
+                return -1;
             }
+            list = grown;
+            capacity *= 2;
         }
+        list[count++] = change;
+    }
+    
+    *changes = list;
+    *change_count = count;
+    return 0;
+}
+
+static void print_line(const char *color, const char *prefix, const Line *line) {
+    printf("%s%s%.*s%s\n", color, prefix, (int)line->length, line->text, COLOR_RESET);
+    // 与 diff 相同的标记，patch 据此不在最后一行后面补换行符
+    if (line->no_newline) {
+        printf("\\ No newline at end of file\n");
     }
 }
 
-// 显示统一格式差异
-void show_unified_diff(const DiffLine *diffs, int diff_count, const DiffConfig *config) {
+// 显示统一格式差异，相距不超过两倍上下文的修改合并到同一块
+void show_unified_diff(const FileLines *file1, const FileLines *file2,
+                       const DiffChange *changes, long change_count, const DiffConfig *config) {
     printf("%s--- %s%s\n", COLOR_RED, config->file1, COLOR_RESET);
     printf("%s+++ %s%s\n", COLOR_GREEN, config->file2, COLOR_RESET);
     
-    int i = 0;
-    while (i < diff_count) {
-        // 查找下一个差异块
-        int block_start = i;
-        while (i < diff_count && diffs[i].type == DIFF_EQUAL) {
-            i++;
+    long context = config->context_lines < 0 ? 0 : config->context_lines;
+    long first = 0;
+    while (first < change_count) {
+        long last = first;
+        while (last + 1 < change_count &&
+               changes[last + 1].line1 - (changes[last].line1 + changes[last].deleted) <= 2 * context) {
+            last++;
         }
         
-        if (i >= diff_count) break;
-        
-        // 计算块范围
-        int block_end = i;
-        while (block_end < diff_count && diffs[block_end].type != DIFF_EQUAL) {
-            block_end++;
-        }
-        
-        // 显示块头
-        int start1 = diffs[block_start].line_num1;
-        int start2 = diffs[block_start].line_num2;
-        int count1 = 0, count2 = 0;
-        
-        for (int j = block_start; j < block_end; j++) {
-            if (diffs[j].type == DIFF_DELETE || diffs[j].type == DIFF_EQUAL) count1++;
-            if (diffs[j].type == DIFF_ADD || diffs[j].type == DIFF_EQUAL) count2++;
-        }
+        // 块的范围
+        long start1 = changes[first].line1 - context;
+        if (start1 < 0) start1 = 0;
+        long start2 = changes[first].line2 - (changes[first].line1 - start1);
+        long end1 = changes[last].line1 + changes[last].deleted + context;
+        if (end1 > file1->count) end1 = file1->count;
+        long end2 = changes[last].line2 + changes[last].added + (end1 - changes[last].line1 - changes[last].deleted);
         
-        printf("%s@@ -%d,%d +%d,%d @@%s\n", 
-               COLOR_CYAN, start1, count1, start2, count2, COLOR_RESET);
+        printf("%s@@ -%ld,%ld +%ld,%ld @@%s\n", COLOR_CYAN,
+               end1 > start1 ? start1 + 1 : start1, end1 - start1,
+               end2 > start2 ? start2 + 1 : start2, end2 - start2, COLOR_RESET);
         
         // 显示块内容
-        for (int j = block_start; j < block_end; j++) {
-            const char *prefix = " ";
-            const char *color = COLOR_RESET;
-            
-            switch (diffs[j].type) {
-                case DIFF_ADD:
-                    prefix = "+";
-                    color = COLOR_GREEN;
-                    break;
-                case DIFF_DELETE:
-                    prefix = "-";
-                    color = COLOR_RED;
-                    break;
-                case DIFF_EQUAL:
-                    prefix = " ";
-                    color = COLOR_RESET;
-                    break;
-                case DIFF_MODIFY:
-                    prefix = "~";
-                    color = COLOR_YELLOW;
-                    break;
+        long i = start1, j = start2;
+        for (long c = first; c <= last; c++) {
+            for (; i < changes[c].line1; i++, j++) {
+                print_line(COLOR_RESET, " ", &file1->lines[i]);
             }
-            
-            printf("%s%s%s%s", color, prefix, diffs[j].content, COLOR_RESET);
+            for (long k = 0; k < changes[c].deleted; k++, i++) {
+                print_line(COLOR_RED, "-", &file1->lines[i]);
+            }
+            for (long k = 0; k < changes[c].added; k++, j++) {
+                print_line(COLOR_GREEN, "+", &file2->lines[j]);
+            }
+        }
+        for (; i < end1; i++) {
+            print_line(COLOR_RESET, " ", &file1->lines[i]);
         }
         
-        i = block_end;
+        first = last + 1;
     }
 }
 
+static void print_side_line(const DiffConfig *config, long num1, long num2,
+                            const char *color, const char *symbol, const Line *line) {
+    if (config->show_line_numbers) {
+        printf("%s%4ld%s | %s%4ld%s | ", COLOR_CYAN, num1, COLOR_RESET, COLOR_CYAN, num2, COLOR_RESET);
+    }
+    print_line(color, symbol, line);
+}
+
 // 显示并排格式差异
-void show_side_by_side_diff(const DiffLine *diffs, int diff_count, const DiffConfig *config) {
+void show_side_by_side_diff(const FileLines *file1, const FileLines *file2,
+                            const DiffChange *changes, long change_count, const DiffConfig *config) {
     printf("%s文件比较: %s vs %s%s\n", COLOR_CYAN, config->file1, config->file2, COLOR_RESET);
-    printf("%s%s%s\n", COLOR_YELLOW, "=" + strlen(config->file1) + strlen(config->file2) + 10, COLOR_RESET);
+    printf("%s", COLOR_YELLOW);
+    for (size_t k = 0; k < strlen(config->file1) + strlen(config->file2) + 10; k++) putchar('=');
+    printf("%s\n", COLOR_RESET);
     
-    for (int i = 0; i < diff_count; i++) {
-        const char *color = COLOR_RESET;
-        const char *symbol = " ";
-        
-        switch (diffs[i].type) {
-            case DIFF_ADD:
-                color = COLOR_GREEN;
-                symbol = "+";
-                break;
-            case DIFF_DELETE:
-                color = COLOR_RED;
-                symbol = "-";
-                break;
-            case DIFF_EQUAL:
-                color = COLOR_RESET;
-                symbol = " ";
-                break;
-            case DIFF_MODIFY:
-                color = COLOR_YELLOW;
-                symbol = "~";
-                break;
+    long i = 0, j = 0;
+    for (long c = 0; c <= change_count; c++) {
+        long next1 = c < change_count ? changes[c].line1 : file1->count;
+        for (; i < next1; i++, j++) {
+            print_side_line(config, i + 1, j + 1, COLOR_RESET, " ", &file1->lines[i]);
         }
+        if (c == change_count) break;
         
-        if (config->show_line_numbers) {
-            printf("%s%4d%s | %s%4d%s | %s%s%s%s\n",
-                   COLOR_CYAN, diffs[i].line_num1, COLOR_RESET,
-                   COLOR_CYAN, diffs[i].line_num2, COLOR_RESET,
-                   color, symbol, diffs[i].content, COLOR_RESET);
-        } else {
-            printf("%s%s%s%s", color, symbol, diffs[i].content, COLOR_RESET);
+        for (long k = 0; k < changes[c].deleted; k++, i++) {
+            print_side_line(config, i + 1, 0, COLOR_RED, "-", &file1->lines[i]);
+        }
+        for (long k = 0; k < changes[c].added; k++, j++) {
+            print_side_line(config, 0, j + 1, COLOR_GREEN, "+", &file2->lines[j]);
         }
     }
 }
 
 // 计算统计信息
-void calculate_stats(const DiffLine *diffs, int diff_count, DiffStats *stats) {
+void calculate_stats(const FileLines *file1, const DiffChange *changes, long change_count, DiffStats *stats) {
     init_stats(stats);
     
-    for (int i = 0; i < diff_count; i++) {
-        switch (diffs[i].type) {
-            case DIFF_ADD:
-                stats->added_lines++;
-                break;
-            case DIFF_DELETE:
-                stats->deleted_lines++;
-                break;
-            case DIFF_MODIFY:
-                stats->modified_lines++;
-                break;
-            case DIFF_EQUAL:
-                stats->equal_lines++;
-                break;
-        }
+    for (long i = 0; i < change_count; i++) {
+        stats->added_lines += changes[i].added;
+        stats->deleted_lines += changes[i].deleted;
     }
+    stats->equal_lines = file1->count - stats->deleted_lines;
 }
 
 // 显示统计信息
 void show_stats(const DiffStats *stats) {
     printf("\n%s差异统计:%s\n", COLOR_CYAN, COLOR_RESET);
-    printf("%s添加: %d 行%s\n", COLOR_GREEN, stats->added_lines, COLOR_RESET);
-    printf("%s删除: %d 行%s\n", COLOR_RED, stats->deleted_lines, COLOR_RESET);
-    printf("%s修改: %d 行%s\n", COLOR_YELLOW, stats->modified_lines, COLOR_RESET);
-    printf("%s相同: %d 行%s\n", COLOR_WHITE, stats->equal_lines, COLOR_RESET);
+    printf("%s添加: %ld 行%s\n", COLOR_GREEN, stats->added_lines, COLOR_RESET);
+    printf("%s删除: %ld 行%s\n", COLOR_RED, stats->deleted_lines, COLOR_RESET);
+    printf("%s修改: %ld 行%s\n", COLOR_YELLOW, stats->modified_lines, COLOR_RESET);
+    printf("%s相同: %ld 行%s\n", COLOR_WHITE, stats->equal_lines, COLOR_RESET);
     
-    int total_changes = stats->added_lines + stats->deleted_lines + stats->modified_lines;
+    long total_changes = stats->added_lines + stats->deleted_lines + stats->modified_lines;
     if (total_changes == 0) {
         printf("%s文件完全相同！%s\n", COLOR_GREEN, COLOR_RESET);
     } else {
-        printf("%s总计变化: %d 行%s\n", COLOR_CYAN, total_changes, COLOR_RESET);
+        printf("%s总计变化: %ld 行%s\n", COLOR_CYAN, total_changes, COLOR_RESET);
     }
 }
 
+// 比较两个文件并显示差异。成功返回 0
+int diff_files(const DiffConfig *config, DiffStats *total) {
+    // 读取文件内容
+    FileLines file1, file2;
+    if (read_file_lines(config->file1, &file1) != 0) {
+        print_error("无法读取文件1");
+        return 1;
+    }
+    
+    if (read_file_lines(config->file2, &file2) != 0) {
+        print_error("无法读取文件2");
+        free_file_lines(&file1);
+        return 1;
+    }
+    
+    if (config->verbose) {
+        printf("%s文件1: %s (%ld 行)%s\n", COLOR_YELLOW, config->file1, file1.count, COLOR_RESET);
+        printf("%s文件2: %s (%ld 行)%s\n", COLOR_YELLOW, config->file2, file2.count, COLOR_RESET);
+        printf("\n");
+    }
+    
+    // 计算差异
+    DiffResult result;
+    DiffChange *changes = NULL;
+    long change_count = 0;
+    if (compute_diff(&file1, &file2, config, &result) != 0 ||
+        collect_changes(&result, &changes, &change_count) != 0) {
+        print_error("内存分配失败");
+        free_diff_result(&result);
+        free_file_lines(&file1);
+        free_file_lines(&file2);
+        return 1;
+    }
+    
+    // 显示差异
+    if (config->side_by_side) {
+        show_side_by_side_diff(&file1, &file2, changes, change_count, config);
+    } else if (config->unified_format) {
+        show_unified_diff(&file1, &file2, changes, change_count, config);
+    } else {
+        // 默认格式
+        show_side_by_side_diff(&file1, &file2, changes, change_count, config);
+    }
+    
+    // 显示统计信息，比较目录时只累计
+    DiffStats stats;
+    calculate_stats(&file1, changes, change_count, &stats);
+    if (total) {
+        total->added_lines += stats.added_lines;
+        total->deleted_lines += stats.deleted_lines;
+        total->modified_lines += stats.modified_lines;
+        total->equal_lines += stats.equal_lines;
+    } else {
+        show_stats(&stats);
+    }
+    
+    // 释放内存
+    free(changes);
+    free_diff_result(&result);
+    free_file_lines(&file1);
+    free_file_lines(&file2);
+    
+    return 0;
+}
+
 void print_usage(const char *program_name) {
     printf("用法: %s [选项] 文件1 文件2\n", program_name);
+    printf("      %s -r [选项] 目录1 目录2\n", program_name);
     printf("优化版的 diff 命令，提供彩色输出和多种显示格式\n\n");
     printf("选项:\n");
     printf("  -u, --unified        统一格式显示\n");
@@ -374,6 +326,11 @@ void print_usage(const char *program_name) {
     printf("  -i, --ignore-case    忽略大小写\n");
     printf("  -w, --ignore-space   忽略空白字符\n");
     printf("  -n, --line-numbers   显示行号\n");
+    printf("  -d, --minimal        总是计算最短差异（大文件可能较慢）\n");
+    printf("  --algorithm=ALG      差异算法: myers（默认）、patience、histogram\n");
+    printf("  -r, --recursive      递归比较两个目录，大小和修改时间相同的文件视为相同\n");
+    printf("  --content            目录比较时总是比较文件内容\n");
+    printf("  -j, --jobs N         比较内容的线程数 (默认: CPU 核数)\n");
     printf("  --no-color           禁用彩色输出\n");
     printf("  -v, --verbose        显示详细信息\n");
     printf("  -h, --help           显示此帮助信息\n");
@@ -383,6 +340,8 @@ void print_usage(const char *program_name) {
     printf("  %s -u -c 5 old.c new.c\n", program_name);
     printf("  %s -s -i config1.conf config2.conf\n", program_name);
     printf("  %s -w -n old.log new.log\n", program_name);
+    printf("  %s -u --algorithm=histogram old.c new.c\n", program_name);
+    printf("  %s -r --content -j 8 release-1.0 release-1.1\n", program_name);
 }
 
 int main(int argc, char *argv[]) {
@@ -395,6 +354,8 @@ int main(int argc, char *argv[]) {
     config.side_by_side = 0;
     config.color_output = 1;
     config.verbose = 0;
+    config.jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (config.jobs < 1) config.jobs = 1;
     
     // 解析命令行参数
     for (int i = 1; i < argc; i++) {
@@ -415,6 +376,31 @@ int main(int argc, char *argv[]) {
             config.ignore_whitespace = 1;
         } else if (strcmp(argv[i], "-n") == 0 || strcmp(argv[i], "--line-numbers") == 0) {
             config.show_line_numbers = 1;
+        } else if (strcmp(argv[i], "-d") == 0 || strcmp(argv[i], "--minimal") == 0) {
+            config.minimal = 1;
+        } else if (strcmp(argv[i], "-r") == 0 || strcmp(argv[i], "--recursive") == 0) {
+            config.recursive = 1;
+        } else if (strcmp(argv[i], "--content") == 0) {
+            config.compare_content = 1;
+        } else if (strcmp(argv[i], "-j") == 0 || strcmp(argv[i], "--jobs") == 0) {
+            if (i + 1 >= argc) {
+                print_error("-j 需要指定线程数");
+                return 1;
+            }
+            config.jobs = atoi(argv[++i]);
+            if (config.jobs < 1) config.jobs = 1;
+        } else if (strncmp(argv[i], "--algorithm=", 12) == 0) {
+            const char *name = argv[i] + 12;
+            if (strcmp(name, "myers") == 0) {
+                config.algorithm = ALGORITHM_MYERS;
+            } else if (strcmp(name, "patience") == 0) {
+                config.algorithm = ALGORITHM_PATIENCE;
+            } else if (strcmp(name, "histogram") == 0) {
+                config.algorithm = ALGORITHM_HISTOGRAM;
+            } else {
+                printf("未知算法: %s\n", name);
+                return 1;
+            }
         } else if (strcmp(argv[i], "--no-color") == 0) {
             config.color_output = 0;
         } else if (strcmp(argv[i], "-v") == 0 || strcmp(argv[i], "--verbose") == 0) {
@@ -427,9 +413,9 @@ int main(int argc, char *argv[]) {
             return 0;
         } else if (argv[i][0] != '-') {
             if (strlen(config.file1) == 0) {
-                strncpy(config.file1, argv[i], MAX_LINE_LENGTH - 1);
+                strncpy(config.file1, argv[i], MAX_PATH_LENGTH - 1);
             } else if (strlen(config.file2) == 0) {
-                strncpy(config.file2, argv[i], MAX_LINE_LENGTH - 1);
+                strncpy(config.file2, argv[i], MAX_PATH_LENGTH - 1);
             }
         } else {
             printf("未知选项: %s\n", argv[i]);
@@ -445,79 +431,11 @@ int main(int argc, char *argv[]) {
         return 1;
     }
     
-    // 检查文件是否存在
-    if (access(config.file1, R_OK) != 0) {
-        print_error("无法读取文件1");
-        return 1;
-    }
-    
-    if (access(config.file2, R_OK) != 0) {
-        print_error("无法读取文件2");
-        return 1;
-    }
-    
-    // 动态分配内存避免栈溢出
-    FileLine *lines1 = malloc(MAX_LINES * sizeof(FileLine));
-    FileLine *lines2 = malloc(MAX_LINES * sizeof(FileLine));
-    DiffLine *diffs = malloc(MAX_LINES * sizeof(DiffLine));
-    
-    if (!lines1 || !lines2 || !diffs) {
-        print_error("内存分配失败");
-        if (lines1) free(lines1);
-        if (lines2) free(lines2);
-        if (diffs) free(diffs);
-        return 1;
-    }
-    
-    // 读取文件内容
-    int count1 = read_file_lines(config.file1, lines1, MAX_LINES);
-    int count2 = read_file_lines(config.file2, lines2, MAX_LINES);
-    
-    if (count1 < 0) {
-        print_error("无法读取文件1");
-        free(lines1);
-        free(lines2);
-        free(diffs);
-        return 1;
+    if (config.recursive) {
+        // 目录中的文件默认用统一格式，并排格式会输出整个文件
+        if (!config.side_by_side) config.unified_format = 1;
+        return diff_directories(&config);
     }
     
-    if (count2 < 0) {
-        print_error("无法读取文件2");
-        free(lines1);
-        free(lines2);
-        free(diffs);
-        return 1;
-    }
-    
-    if (config.verbose) {
-        printf("%s文件1: %s (%d 行)%s\n", COLOR_YELLOW, config.file1, count1, COLOR_RESET);
-        printf("%s文件2: %s (%d 行)%s\n", COLOR_YELLOW, config.file2, count2, COLOR_RESET);
-        printf("\n");
-    }
-    
-    // 计算差异
-    int diff_count;
-    compute_diff(lines1, count1, lines2, count2, diffs, &diff_count, &config);
-    
-    // 显示差异
-    if (config.side_by_side) {
-        show_side_by_side_diff(diffs, diff_count, &config);
-    } else if (config.unified_format) {
-        show_unified_diff(diffs, diff_count, &config);
-    } else {
-        // 默认格式
-        show_side_by_side_diff(diffs, diff_count, &config);
-    }
-    
-    // 显示统计信息
-    DiffStats stats;
-    calculate_stats(diffs, diff_count, &stats);
-    show_stats(&stats);
-    
-    // 释放内存
-    free(lines1);
-    free(lines2);
-    free(diffs);
-    
-    return 0;
+    return diff_files(&config, NULL);
 }
@@ -0,0 +1,119 @@
+#ifndef PDIFF_H
+#define PDIFF_H
+
+#include <stddef.h>
+
+#define MAX_PATH_LENGTH 4096
+#define CONTEXT_LINES 3
+
+// 差异类型枚举
+typedef enum {
+    DIFF_EQUAL,     // 相同
+    DIFF_ADD,       // 添加
+    DIFF_DELETE,    // 删除
+    DIFF_MODIFY     // 修改
+} DiffType;
+
+// 差异算法
+typedef enum {
+    ALGORITHM_MYERS,        // 最短编辑脚本
+    ALGORITHM_PATIENCE,     // 以唯一行为锚点
+    ALGORITHM_HISTOGRAM     // 以最罕见的行为锚点
+} DiffAlgorithm;
+
+// 比较配置结构
+typedef struct {
+    char file1[MAX_PATH_LENGTH];
+    char file2[MAX_PATH_LENGTH];
+    int context_lines;
+    int ignore_case;
+    int ignore_whitespace;
+    int show_line_numbers;
+    int unified_format;
+    int side_by_side;
+    int color_output;
+    int verbose;
+    int minimal;            // 关闭代价上限，总是给出最短编辑脚本
+    DiffAlgorithm algorithm;
+    int recursive;          // 比较两个目录
+    int compare_content;    // 目录比较时不信任大小和修改时间，总是比较内容
+    int jobs;               // 比较内容的工作线程数
+} DiffConfig;
+
+// 文件中的一行，指向整个文件的缓冲区，不含换行符
+typedef struct {
+    const char *text;
+    size_t length;
+    int no_newline;         // 文件的最后一行，且末尾没有换行符
+} Line;
+
+// 读入内存的文件，行数不设上限
+typedef struct {
+    char *data;
+    size_t size;
+    int mapped;             // data 是 mmap 映射的
+    Line *lines;
+    long count;
+} FileLines;
+
+// 比较结果：每个文件一个标记数组，非零表示该行被删除（文件1）或添加（文件2）。
+// 未标记的行按顺序一一对应
+typedef struct {
+    unsigned char *changed1;
+    unsigned char *changed2;
+    long count1;
+    long count2;
+} DiffResult;
+
+// 一段连续的修改：从文件1第 line1 行起删除 deleted 行，从文件2第 line2 行起添加 added 行（从 0 开始）
+typedef struct {
+    long line1;
+    long line2;
+    long deleted;
+    long added;
+} DiffChange;
+
+// 统计信息结构
+typedef struct {
+    long added_lines;
+    long deleted_lines;
+    long modified_lines;
+    long equal_lines;
+} DiffStats;
+
+// 读取文件并按行切分。成功返回 0
+int read_file_lines(const char *filename, FileLines *file);
+void free_file_lines(FileLines *file);
+
+// 比较两行是否相同，按配置忽略大小写和行尾空白
+int lines_equal(const Line *line1, const Line *line2, const DiffConfig *config);
+
+// 给两组行分配编号：规范化后相同的行编号相同。distinct 可以为 NULL，否则返回不同行的个数。
+// 成功返回 0，内存不足返回 -1
+int intern_lines(const Line *lines1, long count1, const Line *lines2, long count2,
+                 const DiffConfig *config, int *ids1, int *ids2, int *distinct);
+
+// 比较两个文件：去掉相同的开头和结尾，中间部分编号后交给差异算法。成功返回 0，内存不足返回 -1
+int compute_diff(const FileLines *file1, const FileLines *file2, const DiffConfig *config, DiffResult *result);
+
+// Myers O(ND) 算法，线性空间的中间蛇分治。把被删除和添加的行在 changed1/changed2 中标记为 1。
+// 成功返回 0，内存不足返回 -1
+int diff_myers(const int *ids1, long count1, const int *ids2, long count2, const DiffConfig *config,
+               unsigned char *changed1, unsigned char *changed2);
+
+// Patience 和 histogram 算法。distinct 是编号的个数，没有锚点的区间交给 Myers。
+// 成功返回 0，内存不足返回 -1
+int diff_patience(const int *ids1, long count1, const int *ids2, long count2, int distinct,
+                  const DiffConfig *config, unsigned char *changed1, unsigned char *changed2);
+int diff_histogram(const int *ids1, long count1, const int *ids2, long count2, int distinct,
+                   const DiffConfig *config, unsigned char *changed1, unsigned char *changed2);
+
+void free_diff_result(DiffResult *result);
+
+// 比较两个文件并显示差异。total 不为 NULL 时把统计累加进去而不显示。成功返回 0
+int diff_files(const DiffConfig *config, DiffStats *total);
+
+// 递归比较 config->file1 和 config->file2 两个目录。成功返回 0
+int diff_directories(const DiffConfig *config);
+
+#endif // PDIFF_H
@@ -0,0 +1,473 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/stat.h>
+#include "../include/common.h"
+#include "pdiff.h"
+
+// 递归比较两个目录：先同步遍历两棵树，大小不同的文件直接判为不同，大小和修改时间都相同的
+// 判为相同，其余的文件按 64MB 分段交给线程池用 pread + memcmp 比较内容，遇到不同立即停止。
+// 最后按遍历顺序输出，只有确实不同的文本文件才做逐行比较
+
+#define COMPARE_SEGMENT (64L * 1024 * 1024)    // 内容比较的任务粒度
+#define COMPARE_BUFFER (1024 * 1024)            // 每次读取的大小
+#define BINARY_CHECK_SIZE 8192                  // 开头有 NUL 字节的文件按二进制文件处理
+#define MAX_DIFF_JOBS 64
+
+// 一对同名条目的比较结果
+typedef enum {
+    PAIR_SAME,
+    PAIR_DIFFERENT,
+    PAIR_ONLY1,             // 只在目录1中存在
+    PAIR_ONLY2,             // 只在目录2中存在
+    PAIR_TYPE_MISMATCH,     // 一边是目录一边是文件等
+    PAIR_ERROR
+} PairState;
+
+typedef struct {
+    char *name;             // 相对于两个根目录的路径
+    PairState state;
+    mode_t mode;            // 文件类型，只在一侧存在时取存在的一侧
+    off_t size;
+    int check_content;      // 大小相同但修改时间不同，或者指定了 --content
+} DirPair;
+
+// 内容比较任务：比较某对文件 [offset, offset + length) 的部分
+typedef struct {
+    size_t pair;
+    off_t offset;
+    off_t length;
+} CompareTask;
+
+typedef struct {
+    const DiffConfig *config;
+    DirPair *pairs;
+    size_t count;
+    size_t capacity;
+    CompareTask *tasks;
+    size_t task_count;
+    size_t next_task;
+    pthread_mutex_t lock;
+    long long bytes_compared;
+} DirDiffContext;
+
+static long elapsed_ms(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000 + (now.tv_nsec - start->tv_nsec) / 1000000;
+}
+
+static int build_path(char *buffer, const char *root, const char *name) {
+    int n = name[0] ? snprintf(buffer, MAX_PATH_LENGTH, "%s/%s", root, name)
+                    : snprintf(buffer, MAX_PATH_LENGTH, "%s", root);
+    return n >= 0 && n < MAX_PATH_LENGTH ? 0 : -1;
+}
+
+static DirPair *add_pair(DirDiffContext *ctx, const char *name, PairState state, mode_t mode) {
+    if (ctx->count == ctx->capacity) {
+        size_t capacity = ctx->capacity ? ctx->capacity * 2 : 256;
+        DirPair *grown = realloc(ctx->pairs, capacity * sizeof(DirPair));
+        if (!grown) return NULL;
+        ctx->pairs = grown;
+        ctx->capacity = capacity;
+    }
+    DirPair *pair = &ctx->pairs[ctx->count];
+    pair->name = strdup(name);
+    if (!pair->name) return NULL;
+    pair->state = state;
+    pair->mode = mode;
+    pair->size = 0;
+    pair->check_content = 0;
+    ctx->count++;
+    return pair;
+}
+
+static int compare_string(const void *a, const void *b) {
+    return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+// 读出目录中的名字并排序，两个目录的列表按顺序归并。目录无法读取时返回 -1
+static int read_names(const char *path, char ***names, size_t *count) {
+    *names = NULL;
+    *count = 0;
+    DIR *dir = opendir(path);
+    if (!dir) return -1;
+
+    size_t capacity = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+        if (*count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            char **grown = realloc(*names, capacity * sizeof(char *));
+            if (!grown) break;
+            *names = grown;
+        }
+        if (!((*names)[*count] = strdup(entry->d_name))) break;
+        (*count)++;
+    }
+    int failed = entry != NULL;
+    closedir(dir);
+    if (*count > 1) qsort(*names, *count, sizeof(char *), compare_string);
+    return failed ? -1 : 0;
+}
+
+static void free_names(char **names, size_t count) {
+    for (size_t i = 0; i < count; i++) free(names[i]);
+    free(names);
+}
+
+static int same_mtime(const struct stat *st1, const struct stat *st2) {
+    return st1->st_mtim.tv_sec == st2->st_mtim.tv_sec && st1->st_mtim.tv_nsec == st2->st_mtim.tv_nsec;
+}
+
+// 两边都存在的条目：只看元数据能判断的直接得出结果，目录继续递归
+static int walk_directory(DirDiffContext *ctx, const char *name);
+
+static int compare_entry(DirDiffContext *ctx, const char *name) {
+    char path1[MAX_PATH_LENGTH], path2[MAX_PATH_LENGTH];
+    struct stat st1, st2;
+    if (build_path(path1, ctx->config->file1, name) != 0 || build_path(path2, ctx->config->file2, name) != 0 ||
+        lstat(path1, &st1) != 0 || lstat(path2, &st2) != 0) {
+        return add_pair(ctx, name, PAIR_ERROR, 0) ? 0 : -1;
+    }
+
+    if ((st1.st_mode & S_IFMT) != (st2.st_mode & S_IFMT)) {
+        return add_pair(ctx, name, PAIR_TYPE_MISMATCH, st1.st_mode) ? 0 : -1;
+    }
+    if (S_ISDIR(st1.st_mode)) {
+        return walk_directory(ctx, name);
+    }
+
+    PairState state = PAIR_SAME;
+    if (S_ISLNK(st1.st_mode)) {
+        char target1[MAX_PATH_LENGTH], target2[MAX_PATH_LENGTH];
+        ssize_t len1 = readlink(path1, target1, sizeof(target1));
+        ssize_t len2 = readlink(path2, target2, sizeof(target2));
+        if (len1 < 0 || len2 < 0) {
+            state = PAIR_ERROR;
+        } else if (len1 != len2 || memcmp(target1, target2, (size_t)len1) != 0) {
+            state = PAIR_DIFFERENT;
+        }
+    } else if (S_ISREG(st1.st_mode) && st1.st_size != st2.st_size) {
+        state = PAIR_DIFFERENT;
+    }
+
+    DirPair *pair = add_pair(ctx, name, state, st1.st_mode);
+    if (!pair) return -1;
+    pair->size = st1.st_size;
+    if (S_ISREG(st1.st_mode) && state == PAIR_SAME) {
+        pair->check_content = ctx->config->compare_content || !same_mtime(&st1, &st2);
+    }
+    return 0;
+}
+
+static int walk_directory(DirDiffContext *ctx, const char *name) {
+    char path1[MAX_PATH_LENGTH], path2[MAX_PATH_LENGTH];
+    char **names1, **names2;
+    size_t count1, count2;
+    if (build_path(path1, ctx->config->file1, name) != 0 || build_path(path2, ctx->config->file2, name) != 0) {
+        return add_pair(ctx, name, PAIR_ERROR, S_IFDIR) ? 0 : -1;
+    }
+    int failed1 = read_names(path1, &names1, &count1);
+    int failed2 = read_names(path2, &names2, &count2);
+    int ret = 0;
+    if (failed1 || failed2) {
+        ret = add_pair(ctx, name, PAIR_ERROR, S_IFDIR) ? 0 : -1;
+    }
+
+    // 两个有序列表归并
+    size_t i = 0, j = 0;
+    char child[MAX_PATH_LENGTH];
+    while (ret == 0 && (i < count1 || j < count2)) {
+        int cmp = i == count1 ? 1 : j == count2 ? -1 : strcmp(names1[i], names2[j]);
+        const char *base = cmp <= 0 ? names1[i] : names2[j];
+        int n = name[0] ? snprintf(child, sizeof(child), "%s/%s", name, base)
+                        : snprintf(child, sizeof(child), "%s", base);
+        if (n < 0 || n >= (int)sizeof(child)) {
+            ret = add_pair(ctx, base, PAIR_ERROR, 0) ? 0 : -1;
+        } else if (cmp == 0) {
+            ret = compare_entry(ctx, child);
+        } else {
+            // 只在一侧存在：记录类型用于显示
+            struct stat st;
+            char path[MAX_PATH_LENGTH];
+            mode_t mode = 0;
+            if (build_path(path, cmp < 0 ? ctx->config->file1 : ctx->config->file2, child) == 0 &&
+                lstat(path, &st) == 0) {
+                mode = st.st_mode;
+            }
+            ret = add_pair(ctx, child, cmp < 0 ? PAIR_ONLY1 : PAIR_ONLY2, mode) ? 0 : -1;
+        }
+        if (cmp <= 0) i++;
+        if (cmp >= 0) j++;
+    }
+
+    free_names(names1, count1);
+    free_names(names2, count2);
+    return ret;
+}
+
+// ---- 内容比较 ----
+
+static int read_full(int fd, char *buffer, size_t length, off_t offset) {
+    size_t done = 0;
+    while (done < length) {
+        ssize_t n = pread(fd, buffer + done, length - done, offset + (off_t)done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;          // 文件在比较过程中被截短也算失败
+        done += (size_t)n;
+    }
+    return 0;
+}
+
+// 比较一段内容，返回 PAIR_SAME、PAIR_DIFFERENT 或 PAIR_ERROR
+static PairState compare_segment(DirDiffContext *ctx, const CompareTask *task, char *buffer1, char *buffer2) {
+    char path1[MAX_PATH_LENGTH], path2[MAX_PATH_LENGTH];
+    const char *name = ctx->pairs[task->pair].name;
+    if (build_path(path1, ctx->config->file1, name) != 0 || build_path(path2, ctx->config->file2, name) != 0) {
+        return PAIR_ERROR;
+    }
+    int fd1 = open(path1, O_RDONLY | O_CLOEXEC);
+    int fd2 = fd1 < 0 ? -1 : open(path2, O_RDONLY | O_CLOEXEC);
+    if (fd2 < 0) {
+        if (fd1 >= 0) close(fd1);
+        return PAIR_ERROR;
+    }
+    posix_fadvise(fd1, task->offset, task->length, POSIX_FADV_SEQUENTIAL);
+    posix_fadvise(fd2, task->offset, task->length, POSIX_FADV_SEQUENTIAL);
+
+    PairState state = PAIR_SAME;
+    for (off_t done = 0; done < task->length && state == PAIR_SAME; ) {
+        size_t n = task->length - done < COMPARE_BUFFER ? (size_t)(task->length - done) : COMPARE_BUFFER;
+        if (read_full(fd1, buffer1, n, task->offset + done) != 0 ||
+            read_full(fd2, buffer2, n, task->offset + done) != 0) {
+            state = PAIR_ERROR;
+        } else if (memcmp(buffer1, buffer2, n) != 0) {
+            state = PAIR_DIFFERENT;
+        }
+        done += (off_t)n;
+
+        // 别的线程已经发现这对文件不同时不必再读
+        pthread_mutex_lock(&ctx->lock);
+        if (ctx->pairs[task->pair].state != PAIR_SAME && state == PAIR_SAME) state = PAIR_DIFFERENT;
+        ctx->bytes_compared += (long long)n;
+        pthread_mutex_unlock(&ctx->lock);
+    }
+    close(fd1);
+    close(fd2);
+    return state;
+}
+
+static void *compare_worker(void *arg) {
+    DirDiffContext *ctx = (DirDiffContext *)arg;
+    char *buffer1 = malloc(COMPARE_BUFFER);
+    char *buffer2 = malloc(COMPARE_BUFFER);
+
+    for (;;) {
+        pthread_mutex_lock(&ctx->lock);
+        // 跳过已经确定不同的文件的剩余分段
+        while (ctx->next_task < ctx->task_count &&
+               ctx->pairs[ctx->tasks[ctx->next_task].pair].state != PAIR_SAME) {
+            ctx->next_task++;
+        }
+        if (ctx->next_task >= ctx->task_count) {
+            pthread_mutex_unlock(&ctx->lock);
+            break;
+        }
+        const CompareTask *task = &ctx->tasks[ctx->next_task++];
+        pthread_mutex_unlock(&ctx->lock);
+
+        PairState state = buffer1 && buffer2 ? compare_segment(ctx, task, buffer1, buffer2) : PAIR_ERROR;
+        if (state != PAIR_SAME) {
+            pthread_mutex_lock(&ctx->lock);
+            // 读取失败优先于内容不同
+            if (ctx->pairs[task->pair].state != PAIR_ERROR) ctx->pairs[task->pair].state = state;
+            pthread_mutex_unlock(&ctx->lock);
+        }
+    }
+
+    free(buffer1);
+    free(buffer2);
+    return NULL;
+}
+
+// 把需要比较内容的文件切成分段，在线程池上比较
+static int compare_contents(DirDiffContext *ctx) {
+    size_t capacity = 0;
+    for (size_t i = 0; i < ctx->count; i++) {
+        if (ctx->pairs[i].check_content) capacity += (size_t)(ctx->pairs[i].size / COMPARE_SEGMENT) + 1;
+    }
+    if (capacity == 0) return 0;
+    ctx->tasks = malloc(capacity * sizeof(CompareTask));
+    if (!ctx->tasks) return -1;
+
+    for (size_t i = 0; i < ctx->count; i++) {
+        if (!ctx->pairs[i].check_content || ctx->pairs[i].size == 0) continue;
+        for (off_t offset = 0; offset < ctx->pairs[i].size; offset += COMPARE_SEGMENT) {
+            CompareTask *task = &ctx->tasks[ctx->task_count++];
+            task->pair = i;
+            task->offset = offset;
+            task->length = ctx->pairs[i].size - offset < COMPARE_SEGMENT ? ctx->pairs[i].size - offset : COMPARE_SEGMENT;
+        }
+    }
+
+    int jobs = ctx->config->jobs;
+    if (jobs < 1) jobs = 1;
+    if (jobs > MAX_DIFF_JOBS) jobs = MAX_DIFF_JOBS;
+    if ((size_t)jobs > ctx->task_count) jobs = (int)ctx->task_count;
+
+    pthread_t workers[MAX_DIFF_JOBS];
+    int worker_count = 0;
+    for (int i = 1; i < jobs; i++) {
+        if (pthread_create(&workers[worker_count], NULL, compare_worker, ctx) == 0) worker_count++;
+    }
+    // 主线程也参与比较
+    compare_worker(ctx);
+    for (int i = 0; i < worker_count; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    return 0;
+}
+
+// ---- 输出 ----
+
+static int is_binary_file(const char *path) {
+    char buffer[BINARY_CHECK_SIZE];
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return 0;
+    ssize_t n = read(fd, buffer, sizeof(buffer));
+    close(fd);
+    return n > 0 && memchr(buffer, '\0', (size_t)n) != NULL;
+}
+
+static const char *type_name(mode_t mode) {
+    if (S_ISDIR(mode)) return "目录";
+    if (S_ISREG(mode)) return "普通文件";
+    if (S_ISLNK(mode)) return "符号链接";
+    return "特殊文件";
+}
+
+// 只在一侧存在的条目按 "只在 父目录 中存在: 名字" 显示
+static void print_only(const char *root, const DirPair *pair, const char *color) {
+    const char *slash = strrchr(pair->name, '/');
+    if (slash) {
+        printf("%s只在 %s/%.*s 中存在: %s%s%s\n", color, root, (int)(slash - pair->name), pair->name,
+               slash + 1, S_ISDIR(pair->mode) ? "/" : "", COLOR_RESET);
+    } else {
+        printf("%s只在 %s 中存在: %s%s%s\n", color, root, pair->name, S_ISDIR(pair->mode) ? "/" : "", COLOR_RESET);
+    }
+}
+
+int diff_directories(const DiffConfig *config) {
+    struct stat st1, st2;
+    if (stat(config->file1, &st1) != 0 || !S_ISDIR(st1.st_mode)) {
+        print_error("目录1不存在或不是目录");
+        return 1;
+    }
+    if (stat(config->file2, &st2) != 0 || !S_ISDIR(st2.st_mode)) {
+        print_error("目录2不存在或不是目录");
+        return 1;
+    }
+
+    DirDiffContext ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.config = config;
+    pthread_mutex_init(&ctx.lock, NULL);
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int ret = 0;
+    if (walk_directory(&ctx, "") != 0 || compare_contents(&ctx) != 0) {
+        print_error("内存分配失败");
+        ret = 1;
+    }
+    long compare_time = elapsed_ms(&start);
+
+    // 逐行比较用的配置：每对文件替换路径
+    DiffConfig file_config = *config;
+    file_config.recursive = 0;
+    DiffStats total;
+    memset(&total, 0, sizeof(total));
+    long files = 0, same = 0, different = 0, only = 0, errors = 0, by_content = 0;
+
+    for (size_t i = 0; ret == 0 && i < ctx.count; i++) {
+        const DirPair *pair = &ctx.pairs[i];
+        char path1[MAX_PATH_LENGTH], path2[MAX_PATH_LENGTH];
+        if (build_path(path1, config->file1, pair->name) != 0 || build_path(path2, config->file2, pair->name) != 0) {
+            // 遍历时已经把过长的路径记为无法比较
+            path1[0] = path2[0] = '\0';
+        }
+        if (!S_ISDIR(pair->mode) && pair->state != PAIR_ONLY1 && pair->state != PAIR_ONLY2) files++;
+        if (pair->check_content) by_content++;
+
+        switch (pair->state) {
+        case PAIR_SAME:
+            same++;
+            break;
+        case PAIR_ONLY1:
+            print_only(config->file1, pair, COLOR_RED);
+            only++;
+            break;
+        case PAIR_ONLY2:
+            print_only(config->file2, pair, COLOR_GREEN);
+            only++;
+            break;
+        case PAIR_TYPE_MISMATCH: {
+            struct stat st;
+            mode_t mode2 = lstat(path2, &st) == 0 ? st.st_mode : 0;
+            printf("%s%s 是%s而 %s 是%s%s\n", COLOR_YELLOW, path1, type_name(pair->mode),
+                   path2, type_name(mode2), COLOR_RESET);
+            different++;
+            break;
+        }
+        case PAIR_ERROR: {
+            char message[MAX_PATH_LENGTH + 64];
+            snprintf(message, sizeof(message), "无法比较: %s", pair->name);
+            print_warning(message);
+            errors++;
+            break;
+        }
+        case PAIR_DIFFERENT:
+            different++;
+            if (S_ISLNK(pair->mode)) {
+                printf("%s符号链接 %s 和 %s 不同%s\n", COLOR_YELLOW, path1, path2, COLOR_RESET);
+            } else if (is_binary_file(path1) || is_binary_file(path2)) {
+                printf("%s二进制文件 %s 和 %s 不同%s\n", COLOR_YELLOW, path1, path2, COLOR_RESET);
+            } else {
+                strcpy(file_config.file1, path1);
+                strcpy(file_config.file2, path2);
+                if (diff_files(&file_config, &total) != 0) errors++;
+            }
+            break;
+        }
+    }
+
+    if (ret == 0) {
+        printf("\n%s目录比较: %ld 个文件相同，%ld 个不同，%ld 个只在一侧存在%s\n",
+               COLOR_CYAN, same, different, only, COLOR_RESET);
+        if (total.added_lines + total.deleted_lines + total.modified_lines > 0) {
+            printf("%s文本差异: 添加 %ld 行，删除 %ld 行，修改 %ld 行%s\n", COLOR_CYAN,
+                   total.added_lines, total.deleted_lines, total.modified_lines, COLOR_RESET);
+        }
+        if (config->verbose) {
+            printf("%s共 %ld 个文件，%ld 个比较了内容（%s）%s\n", COLOR_YELLOW, files, by_content,
+                   format_size(ctx.bytes_compared), COLOR_RESET);
+            printf("%s遍历和比较耗时: %ld ms，线程数: %d%s\n", COLOR_YELLOW, compare_time,
+                   config->jobs, COLOR_RESET);
+        }
+        if (errors > 0) ret = 1;
+    }
+
+    for (size_t i = 0; i < ctx.count; i++) free(ctx.pairs[i].name);
+    free(ctx.pairs);
+    free(ctx.tasks);
+    pthread_mutex_destroy(&ctx.lock);
+    return ret;
+}
@@ -0,0 +1,155 @@
+#include <stdlib.h>
+#include <string.h>
+#include "pdiff.h"
+
+// Histogram 差异：patience 的推广。统计文件1区间中每个编号出现的次数，扫描文件2，
+// 以出现次数最少的公共行为起点向两边扩展出一段相同区域，取最长且最罕见的一段作为锚，
+// 再对锚两边递归。公共行都太常见时交给 Myers
+
+#define MAX_CHAIN_LENGTH 64     // 出现次数超过此值的行不作为起点
+
+typedef struct {
+    const int *ids1;
+    const int *ids2;
+    const DiffConfig *config;
+    unsigned char *changed1;
+    unsigned char *changed2;
+    int *count;                 // 每个编号在文件1当前区间中出现的次数
+    long *first;                // 编号在文件1当前区间中第一次出现的位置
+    long *next;                 // 同一编号在文件1中的下一次出现，按行号索引
+} HistogramContext;
+
+// 一段相同区域：文件1 [begin1, end1) 与文件2 [begin2, end2)
+typedef struct {
+    long begin1, end1;
+    long begin2, end2;
+    int rarity;                 // 区域中最小的出现次数
+} Region;
+
+static void build_histogram(HistogramContext *ctx, long l1, long h1) {
+    for (long i = l1; i < h1; i++) {
+        ctx->count[ctx->ids1[i]] = 0;
+        ctx->first[ctx->ids1[i]] = -1;
+    }
+    for (long i = h1 - 1; i >= l1; i--) {
+        int id = ctx->ids1[i];
+        ctx->next[i] = ctx->first[id];
+        ctx->first[id] = i;
+        ctx->count[id]++;
+    }
+}
+
+// 找最长且最罕见的相同区域。没有可用的起点时返回 0，has_common 表示区间中是否有公共行
+static int find_region(HistogramContext *ctx, long l1, long h1, long l2, long h2, Region *best, int *has_common) {
+    const int *ids1 = ctx->ids1;
+    const int *ids2 = ctx->ids2;
+    int found = 0;
+    best->rarity = MAX_CHAIN_LENGTH;
+    *has_common = 0;
+
+    for (long b = l2; b < h2; ) {
+        int id = ids2[b];
+        long b_next = b + 1;
+        // ids2 中的编号不一定出现在文件1区间里，用 first 是否落在区间内判断
+        long a = ctx->first[id];
+        if (a < l1 || a >= h1 || ids1[a] != id) {
+            b = b_next;
+            continue;
+        }
+        *has_common = 1;
+        if (ctx->count[id] > best->rarity) {
+            b = b_next;
+            continue;
+        }
+
+        for (; a >= 0; a = ctx->next[a]) {
+            long as = a, bs = b, ae = a + 1, be = b + 1;
+            int rarity = ctx->count[id];
+            while (as > l1 && bs > l2 && ids1[as - 1] == ids2[bs - 1]) {
+                as--;
+                bs--;
+                if (rarity > 1 && ctx->count[ids1[as]] < rarity) rarity = ctx->count[ids1[as]];
+            }
+            while (ae < h1 && be < h2 && ids1[ae] == ids2[be]) {
+                if (rarity > 1 && ctx->count[ids1[ae]] < rarity) rarity = ctx->count[ids1[ae]];
+                ae++;
+                be++;
+            }
+            if (b_next < be) b_next = be;
+            long length = ae - as, best_length = best->end1 - best->begin1;
+            // 长度和罕见程度都相同时取离区间中点最近的一段，避免等长区域总是取最左边导致递归退化成线性
+            int closer = length == best_length && rarity == best->rarity &&
+                         labs((as + ae) - (l1 + h1)) < labs((best->begin1 + best->end1) - (l1 + h1));
+            if (best_length < length || rarity < best->rarity || closer) {
+                best->begin1 = as;
+                best->end1 = ae;
+                best->begin2 = bs;
+                best->end2 = be;
+                best->rarity = rarity;
+                found = 1;
+            }
+        }
+        b = b_next;
+    }
+    return found;
+}
+
+static int diff_range(HistogramContext *ctx, long l1, long h1, long l2, long h2) {
+    for (;;) {
+        while (l1 < h1 && l2 < h2 && ctx->ids1[l1] == ctx->ids2[l2]) {
+            l1++;
+            l2++;
+        }
+        while (h1 > l1 && h2 > l2 && ctx->ids1[h1 - 1] == ctx->ids2[h2 - 1]) {
+            h1--;
+            h2--;
+        }
+        if (l1 == h1 || l2 == h2) {
+            memset(ctx->changed1 + l1, 1, (size_t)(h1 - l1));
+            memset(ctx->changed2 + l2, 1, (size_t)(h2 - l2));
+            return 0;
+        }
+
+        build_histogram(ctx, l1, h1);
+        Region region = {0, 0, 0, 0, 0};
+        int has_common;
+        if (!find_region(ctx, l1, h1, l2, h2, &region, &has_common)) {
+            if (has_common) {
+                return diff_myers(ctx->ids1 + l1, h1 - l1, ctx->ids2 + l2, h2 - l2, ctx->config,
+                                  ctx->changed1 + l1, ctx->changed2 + l2);
+            }
+            memset(ctx->changed1 + l1, 1, (size_t)(h1 - l1));
+            memset(ctx->changed2 + l2, 1, (size_t)(h2 - l2));
+            return 0;
+        }
+
+        // 左边递归，右边继续循环
+        if (diff_range(ctx, l1, region.begin1, l2, region.begin2) != 0) return -1;
+        l1 = region.end1;
+        l2 = region.end2;
+    }
+}
+
+int diff_histogram(const int *ids1, long count1, const int *ids2, long count2, int distinct,
+                   const DiffConfig *config, unsigned char *changed1, unsigned char *changed2) {
+    HistogramContext ctx;
+    ctx.ids1 = ids1;
+    ctx.ids2 = ids2;
+    ctx.config = config;
+    ctx.changed1 = changed1;
+    ctx.changed2 = changed2;
+    ctx.count = malloc((size_t)distinct * sizeof(int));
+    ctx.first = malloc((size_t)distinct * sizeof(long));
+    ctx.next = malloc((size_t)(count1 + 1) * sizeof(long));
+
+    int ret = -1;
+    if (ctx.count && ctx.first && ctx.next) {
+        // 没有出现在文件1中的编号，first 必须是无效位置
+        for (int id = 0; id < distinct; id++) ctx.first[id] = -1;
+        ret = diff_range(&ctx, 0, count1, 0, count2);
+    }
+    free(ctx.count);
+    free(ctx.first);
+    free(ctx.next);
+    return ret;
+}
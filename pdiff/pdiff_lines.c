@@ -0,0 +1,260 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <ctype.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "pdiff.h"
+
+// 输入文件的读取和行的规范化：普通文件用 mmap 映射，行直接指向映射区；
+// 比较前每个不同的行（按 -i/-w 规范化后）只哈希一次，得到一个整数编号，算法只比较编号
+
+// 管道等无法映射的输入整个读入内存
+static int read_into_buffer(int fd, FileLines *file) {
+    size_t capacity = 64 * 1024;
+    file->data = malloc(capacity);
+    while (file->data) {
+        if (file->size == capacity) {
+            char *grown = realloc(file->data, capacity * 2);
+            if (!grown) break;
+            file->data = grown;
+            capacity *= 2;
+        }
+        ssize_t n = read(fd, file->data + file->size, capacity - file->size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n == 0) return 0;
+        if (n < 0) break;
+        file->size += (size_t)n;
+    }
+    free(file->data);
+    file->data = NULL;
+    return -1;
+}
+
+static int split_lines(FileLines *file) {
+    // 先估计行数，避免大文件反复扩容
+    long capacity = file->size / 32 + 16;
+    file->lines = malloc((size_t)capacity * sizeof(Line));
+    if (!file->lines) return -1;
+
+    const char *p = file->data;
+    const char *end = file->data + file->size;
+    while (p < end) {
+        if (file->count == capacity) {
+            Line *grown = realloc(file->lines, (size_t)capacity * 2 * sizeof(Line));
+            if (!grown) return -1;
+            file->lines = grown;
+            capacity *= 2;
+        }
+        const char *newline = memchr(p, '\n', (size_t)(end - p));
+        const char *line_end = newline ? newline : end;
+        file->lines[file->count].text = p;
+        file->lines[file->count].length = (size_t)(line_end - p);
+        file->lines[file->count].no_newline = newline == NULL;
+        file->count++;
+        p = newline ? newline + 1 : end;
+    }
+    return 0;
+}
+
+// 读取文件并按行切分，行数和行长都不设上限
+int read_file_lines(const char *filename, FileLines *file) {
+    memset(file, 0, sizeof(*file));
+
+    int fd = open(filename, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    int ok = 0;
+    if (S_ISREG(st.st_mode) && st.st_size > 0) {
+        void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+            file->data = map;
+            file->size = (size_t)st.st_size;
+            file->mapped = 1;
+        } else {
+            ok = read_into_buffer(fd, file);
+        }
+    } else {
+        ok = read_into_buffer(fd, file);
+    }
+    close(fd);
+
+    if (ok != 0 || split_lines(file) != 0) {
+        free_file_lines(file);
+        return -1;
+    }
+    return 0;
+}
+
+void free_file_lines(FileLines *file) {
+    if (file->mapped) {
+        munmap(file->data, file->size);
+    } else {
+        free(file->data);
+    }
+    free(file->lines);
+    memset(file, 0, sizeof(*file));
+}
+
+// 去掉行尾的空白字符后的长度
+static size_t trimmed_length(const Line *line) {
+    size_t len = line->length;
+    while (len > 0 && (line->text[len - 1] == ' ' || line->text[len - 1] == '\t' || line->text[len - 1] == '\r')) {
+        len--;
+    }
+    return len;
+}
+
+// 比较两行是否相同
+int lines_equal(const Line *line1, const Line *line2, const DiffConfig *config) {
+    size_t len1 = line1->length;
+    size_t len2 = line2->length;
+
+    // 有无结尾换行符不同的两行视为不同，否则仅差最后一个换行符的文件会被认为相同
+    if (line1->no_newline != line2->no_newline) {
+        return 0;
+    }
+    if (config->ignore_whitespace) {
+        len1 = trimmed_length(line1);
+        len2 = trimmed_length(line2);
+    }
+    if (len1 != len2) {
+        return 0;
+    }
+
+    if (config->ignore_case) {
+        for (size_t i = 0; i < len1; i++) {
+            if (tolower((unsigned char)line1->text[i]) != tolower((unsigned char)line2->text[i])) {
+                return 0;
+            }
+        }
+        return 1;
+    }
+    return memcmp(line1->text, line2->text, len1) == 0;
+}
+
+// ---- 行编号 ----
+
+#define HASH_MULTIPLIER 0x9e3779b97f4a7c15ULL
+
+static uint64_t mix_hash(uint64_t h) {
+    h ^= h >> 32;
+    h *= HASH_MULTIPLIER;
+    h ^= h >> 29;
+    return h;
+}
+
+// 规范化后的行的哈希，每次处理 8 字节
+static uint64_t line_hash(const Line *line, const DiffConfig *config) {
+    size_t len = config->ignore_whitespace ? trimmed_length(line) : line->length;
+    const unsigned char *p = (const unsigned char *)line->text;
+    uint64_t h = (len * 2 + (uint64_t)line->no_newline) * HASH_MULTIPLIER;
+
+    if (config->ignore_case) {
+        for (size_t i = 0; i < len; i++) {
+            h = (h ^ (uint64_t)tolower(p[i])) * HASH_MULTIPLIER;
+        }
+        return mix_hash(h);
+    }
+
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word;
+        memcpy(&word, p + i, 8);
+        h = (h ^ word) * HASH_MULTIPLIER;
+        h ^= h >> 31;
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, p + i, len - i);
+    h = (h ^ tail) * HASH_MULTIPLIER;
+    return mix_hash(h);
+}
+
+#define INTERN_BATCH 16      // 先算一批行的哈希并预取槽位，让内存访问重叠
+
+// 槽位只存哈希的高 32 位和编号，编号对应的第一行放在 first_line 中
+typedef struct {
+    uint32_t hash;
+    int id;                 // -1 表示空槽
+} InternSlot;
+
+typedef struct {
+    InternSlot *slots;
+    size_t mask;
+    const Line **first_line;
+    int next_id;
+    const DiffConfig *config;
+} InternTable;
+
+static int intern_line(InternTable *table, const Line *line, uint64_t hash) {
+    uint32_t tag = (uint32_t)(hash >> 32);
+    size_t pos = (size_t)hash & table->mask;
+    for (;;) {
+        InternSlot *slot = &table->slots[pos];
+        if (slot->id < 0) {
+            slot->hash = tag;
+            slot->id = table->next_id;
+            table->first_line[table->next_id] = line;
+            return table->next_id++;
+        }
+        if (slot->hash == tag && lines_equal(table->first_line[slot->id], line, table->config)) {
+            return slot->id;
+        }
+        pos = (pos + 1) & table->mask;
+    }
+}
+
+static void intern_range(InternTable *table, const Line *lines, long count, int *ids) {
+    uint64_t hashes[INTERN_BATCH];
+    for (long base = 0; base < count; base += INTERN_BATCH) {
+        long n = count - base < INTERN_BATCH ? count - base : INTERN_BATCH;
+        for (long i = 0; i < n; i++) {
+            hashes[i] = line_hash(&lines[base + i], table->config);
+            __builtin_prefetch(&table->slots[(size_t)hashes[i] & table->mask]);
+        }
+        for (long i = 0; i < n; i++) {
+            ids[base + i] = intern_line(table, &lines[base + i], hashes[i]);
+        }
+    }
+}
+
+int intern_lines(const Line *lines1, long count1, const Line *lines2, long count2,
+                 const DiffConfig *config, int *ids1, int *ids2, int *distinct) {
+    // 负载因子不超过 1/2
+    size_t capacity = 16;
+    while (capacity < (size_t)(count1 + count2) * 2) capacity <<= 1;
+
+    InternTable table;
+    table.slots = malloc(capacity * sizeof(InternSlot));
+    table.first_line = malloc((size_t)(count1 + count2 + 1) * sizeof(const Line *));
+    if (!table.slots || !table.first_line) {
+        free(table.slots);
+        free(table.first_line);
+        return -1;
+    }
+    memset(table.slots, 0xff, capacity * sizeof(InternSlot));
+    table.mask = capacity - 1;
+    table.next_id = 0;
+    table.config = config;
+
+    intern_range(&table, lines1, count1, ids1);
+    intern_range(&table, lines2, count2, ids2);
+
+    if (distinct) *distinct = table.next_id;
+    free(table.slots);
+    free(table.first_line);
+    return 0;
+}
@@ -0,0 +1,175 @@
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "pdiff.h"
+
+// Myers 的 O(ND) 差异算法（"An O(ND) Difference Algorithm and Its Variations"）。
+// 从两端同时搜索，找到最短编辑路径的中间蛇后对两半分别递归，只需要 O(N+M) 的对角线数组。
+// 编辑距离很大时按代价上限提前切分，结果仍然正确但不保证最短；--minimal 关闭这个上限
+
+typedef struct {
+    const int *ids1;
+    const int *ids2;
+    const DiffConfig *config;
+    unsigned char *changed1;
+    unsigned char *changed2;
+    long *fdiag;            // 正向搜索每条对角线到达的最远 x
+    long *bdiag;            // 反向搜索每条对角线到达的最近 x
+    long too_expensive;
+} MyersContext;
+
+// 切分点：两半各自的编辑路径经过 (xmid, ymid)
+typedef struct {
+    long xmid;
+    long ymid;
+} Partition;
+
+static inline int equal_at(const MyersContext *ctx, long x, long y) {
+    return ctx->ids1[x] == ctx->ids2[y];
+}
+
+// 在 [xoff, xlim) x [yoff, ylim) 中找中间蛇。调用前首尾相同的行已经去掉，两边都不为空
+static void find_middle_snake(MyersContext *ctx, long xoff, long xlim, long yoff, long ylim, Partition *part) {
+    long *const fd = ctx->fdiag;
+    long *const bd = ctx->bdiag;
+    const long dmin = xoff - ylim;          // 最小对角线
+    const long dmax = xlim - yoff;          // 最大对角线
+    const long fmid = xoff - yoff;          // 正向搜索的起点对角线
+    const long bmid = xlim - ylim;          // 反向搜索的起点对角线
+    long fmin = fmid, fmax = fmid;
+    long bmin = bmid, bmax = bmid;
+    const int odd = (fmid - bmid) & 1;      // 总编辑距离为奇数时在正向搜索中相遇
+
+    fd[fmid] = xoff;
+    bd[bmid] = xlim;
+
+    for (long c = 1;; c++) {
+        // 正向扩展一步
+        if (fmin > dmin) fd[--fmin - 1] = -1; else ++fmin;
+        if (fmax < dmax) fd[++fmax + 1] = -1; else --fmax;
+        for (long d = fmax; d >= fmin; d -= 2) {
+            long tlo = fd[d - 1], thi = fd[d + 1];
+            long x = tlo >= thi ? tlo + 1 : thi;
+            long y = x - d;
+            while (x < xlim && y < ylim && equal_at(ctx, x, y)) {
+                x++;
+                y++;
+            }
+            fd[d] = x;
+            if (odd && bmin <= d && d <= bmax && bd[d] <= x) {
+                part->xmid = x;
+                part->ymid = y;
+                return;
+            }
+        }
+
+        // 反向扩展一步
+        if (bmin > dmin) bd[--bmin - 1] = LONG_MAX; else ++bmin;
+        if (bmax < dmax) bd[++bmax + 1] = LONG_MAX; else --bmax;
+        for (long d = bmax; d >= bmin; d -= 2) {
+            long tlo = bd[d - 1], thi = bd[d + 1];
+            long x = tlo < thi ? tlo : thi - 1;
+            long y = x - d;
+            while (x > xoff && y > yoff && equal_at(ctx, x - 1, y - 1)) {
+                x--;
+                y--;
+            }
+            bd[d] = x;
+            if (!odd && fmin <= d && d <= fmax && x <= fd[d]) {
+                part->xmid = x;
+                part->ymid = y;
+                return;
+            }
+        }
+
+        if (ctx->config->minimal || c < ctx->too_expensive) continue;
+
+        // 代价太高：取正向或反向走得最远的点作为切分点
+        long fxybest = -1, fxbest = xoff;
+        for (long d = fmax; d >= fmin; d -= 2) {
+            long x = fd[d] < xlim ? fd[d] : xlim;
+            long y = x - d;
+            if (y > ylim) {
+                x = ylim + d;
+                y = ylim;
+            }
+            if (fxybest < x + y) {
+                fxybest = x + y;
+                fxbest = x;
+            }
+        }
+        long bxybest = LONG_MAX, bxbest = xlim;
+        for (long d = bmax; d >= bmin; d -= 2) {
+            long x = bd[d] > xoff ? bd[d] : xoff;
+            long y = x - d;
+            if (y < yoff) {
+                x = yoff + d;
+                y = yoff;
+            }
+            if (x + y < bxybest) {
+                bxybest = x + y;
+                bxbest = x;
+            }
+        }
+        if ((xlim + ylim) - bxybest < fxybest - (xoff + yoff)) {
+            part->xmid = fxbest;
+            part->ymid = fxybest - fxbest;
+        } else {
+            part->xmid = bxbest;
+            part->ymid = bxybest - bxbest;
+        }
+        return;
+    }
+}
+
+static void compare_range(MyersContext *ctx, long xoff, long xlim, long yoff, long ylim) {
+    // 相同的开头和结尾不参与搜索
+    while (xoff < xlim && yoff < ylim && equal_at(ctx, xoff, yoff)) {
+        xoff++;
+        yoff++;
+    }
+    while (xlim > xoff && ylim > yoff && equal_at(ctx, xlim - 1, ylim - 1)) {
+        xlim--;
+        ylim--;
+    }
+
+    if (xoff == xlim) {
+        memset(ctx->changed2 + yoff, 1, (size_t)(ylim - yoff));
+    } else if (yoff == ylim) {
+        memset(ctx->changed1 + xoff, 1, (size_t)(xlim - xoff));
+    } else {
+        Partition part;
+        find_middle_snake(ctx, xoff, xlim, yoff, ylim, &part);
+        compare_range(ctx, xoff, part.xmid, yoff, part.ymid);
+        compare_range(ctx, part.xmid, xlim, part.ymid, ylim);
+    }
+}
+
+int diff_myers(const int *ids1, long count1, const int *ids2, long count2, const DiffConfig *config,
+               unsigned char *changed1, unsigned char *changed2) {
+    // 对角线编号范围是 [-M, N]，两端再各留一个哨兵
+    long diags = count1 + count2 + 3;
+    long *fdiag = malloc((size_t)diags * 2 * sizeof(long));
+    if (!fdiag) {
+        return -1;
+    }
+
+    MyersContext ctx;
+    ctx.ids1 = ids1;
+    ctx.ids2 = ids2;
+    ctx.config = config;
+    ctx.changed1 = changed1;
+    ctx.changed2 = changed2;
+    ctx.fdiag = fdiag + count2 + 1;
+    ctx.bdiag = ctx.fdiag + diags;
+
+    // 代价上限约为对角线数的平方根，至少 4096
+    ctx.too_expensive = 1;
+    for (long d = diags; d != 0; d >>= 2) ctx.too_expensive <<= 1;
+    if (ctx.too_expensive < 4096) ctx.too_expensive = 4096;
+
+    compare_range(&ctx, 0, count1, 0, count2);
+
+    free(fdiag);
+    return 0;
+}
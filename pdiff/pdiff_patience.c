@@ -0,0 +1,153 @@
+#include <stdlib.h>
+#include <string.h>
+#include "pdiff.h"
+
+// Patience 差异：只把在两边各出现一次的行当作锚点，取锚点在两边顺序一致的最长子序列
+// （耐心排序求最长递增子序列），然后在相邻锚点之间递归。没有唯一行的区间交给 Myers
+
+typedef struct {
+    const int *ids1;
+    const int *ids2;
+    const DiffConfig *config;
+    unsigned char *changed1;
+    unsigned char *changed2;
+    unsigned char *count1;      // 每个编号在当前区间中出现的次数，到 2 为止
+    unsigned char *count2;
+    long *pos2;                 // 编号在文件2当前区间中的位置
+} PatienceContext;
+
+// 一个锚点：文件1的第 line1 行和文件2的第 line2 行是同一个唯一行
+typedef struct {
+    long line1;
+    long line2;
+    long prev;                  // 最长递增子序列中的前一个锚点
+} Anchor;
+
+static int diff_range(PatienceContext *ctx, long l1, long h1, long l2, long h2);
+
+// 在 [l1, h1) x [l2, h2) 中找出唯一行并按文件1的顺序返回。返回锚点个数，内存不足返回 -1
+static long find_unique_lines(PatienceContext *ctx, long l1, long h1, long l2, long h2, Anchor **anchors) {
+    for (long i = l1; i < h1; i++) ctx->count1[ctx->ids1[i]] = ctx->count2[ctx->ids1[i]] = 0;
+    for (long j = l2; j < h2; j++) ctx->count1[ctx->ids2[j]] = ctx->count2[ctx->ids2[j]] = 0;
+    for (long i = l1; i < h1; i++) {
+        if (ctx->count1[ctx->ids1[i]] < 2) ctx->count1[ctx->ids1[i]]++;
+    }
+    for (long j = l2; j < h2; j++) {
+        if (ctx->count2[ctx->ids2[j]] < 2) ctx->count2[ctx->ids2[j]]++;
+        ctx->pos2[ctx->ids2[j]] = j;
+    }
+
+    long count = 0;
+    for (long i = l1; i < h1; i++) {
+        int id = ctx->ids1[i];
+        if (ctx->count1[id] == 1 && ctx->count2[id] == 1) count++;
+    }
+    if (count == 0) {
+        *anchors = NULL;
+        return 0;
+    }
+
+    Anchor *list = malloc((size_t)count * sizeof(Anchor));
+    if (!list) return -1;
+    long n = 0;
+    for (long i = l1; i < h1; i++) {
+        int id = ctx->ids1[i];
+        if (ctx->count1[id] == 1 && ctx->count2[id] == 1) {
+            list[n].line1 = i;
+            list[n].line2 = ctx->pos2[id];
+            list[n].prev = -1;
+            n++;
+        }
+    }
+    *anchors = list;
+    return count;
+}
+
+// 按 line2 求最长递增子序列，结果按顺序放回 anchors 开头。返回长度，内存不足返回 -1
+static long longest_increasing(Anchor *anchors, long count) {
+    long *tails = malloc((size_t)count * sizeof(long));    // 每个长度的最小结尾所在的锚点
+    if (!tails) return -1;
+
+    long length = 0;
+    for (long k = 0; k < count; k++) {
+        long lo = 0, hi = length;
+        while (lo < hi) {
+            long mid = (lo + hi) / 2;
+            if (anchors[tails[mid]].line2 < anchors[k].line2) lo = mid + 1; else hi = mid;
+        }
+        anchors[k].prev = lo > 0 ? tails[lo - 1] : -1;
+        tails[lo] = k;
+        if (lo == length) length++;
+    }
+
+    // 从最后一个锚点往回走，倒序写到 tails 中再按顺序拷回
+    long k = tails[length - 1];
+    for (long n = length - 1; n >= 0; n--) {
+        tails[n] = k;
+        k = anchors[k].prev;
+    }
+    for (long n = 0; n < length; n++) {
+        anchors[n] = anchors[tails[n]];
+    }
+    free(tails);
+    return length;
+}
+
+static int diff_range(PatienceContext *ctx, long l1, long h1, long l2, long h2) {
+    while (l1 < h1 && l2 < h2 && ctx->ids1[l1] == ctx->ids2[l2]) {
+        l1++;
+        l2++;
+    }
+    while (h1 > l1 && h2 > l2 && ctx->ids1[h1 - 1] == ctx->ids2[h2 - 1]) {
+        h1--;
+        h2--;
+    }
+    if (l1 == h1 || l2 == h2) {
+        memset(ctx->changed1 + l1, 1, (size_t)(h1 - l1));
+        memset(ctx->changed2 + l2, 1, (size_t)(h2 - l2));
+        return 0;
+    }
+
+    Anchor *anchors;
+    long count = find_unique_lines(ctx, l1, h1, l2, h2, &anchors);
+    if (count < 0) return -1;
+    if (count == 0) {
+        return diff_myers(ctx->ids1 + l1, h1 - l1, ctx->ids2 + l2, h2 - l2, ctx->config,
+                          ctx->changed1 + l1, ctx->changed2 + l2);
+    }
+
+    count = longest_increasing(anchors, count);
+    int ret = count < 0 ? -1 : 0;
+    long prev1 = l1, prev2 = l2;
+    for (long k = 0; ret == 0 && k <= count; k++) {
+        long next1 = k < count ? anchors[k].line1 : h1;
+        long next2 = k < count ? anchors[k].line2 : h2;
+        ret = diff_range(ctx, prev1, next1, prev2, next2);
+        prev1 = next1 + 1;
+        prev2 = next2 + 1;
+    }
+    free(anchors);
+    return ret;
+}
+
+int diff_patience(const int *ids1, long count1, const int *ids2, long count2, int distinct,
+                  const DiffConfig *config, unsigned char *changed1, unsigned char *changed2) {
+    PatienceContext ctx;
+    ctx.ids1 = ids1;
+    ctx.ids2 = ids2;
+    ctx.config = config;
+    ctx.changed1 = changed1;
+    ctx.changed2 = changed2;
+    ctx.count1 = malloc((size_t)distinct);
+    ctx.count2 = malloc((size_t)distinct);
+    ctx.pos2 = malloc((size_t)distinct * sizeof(long));
+
+    int ret = -1;
+    if (ctx.count1 && ctx.count2 && ctx.pos2) {
+        ret = diff_range(&ctx, 0, count1, 0, count2);
+    }
+    free(ctx.count1);
+    free(ctx.count2);
+    free(ctx.pos2);
+    return ret;
+}
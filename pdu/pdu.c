@@ -9,6 +9,7 @@
 #include <pwd.h>
 #include <grp.h>
 #include "../include/common.h"
+#include "pdu_snapshot.h"
 
 #define MAX_ENTRIES 1000
 #define MAX_PATH_LENGTH 1024
@@ -33,6 +34,10 @@ typedef struct {
     int show_graph;
     int sort_by_size;
     int show_hidden;
+    const char *snapshot_file;
+    int incremental;
+    const char *diff_old;
+    const char *diff_new;
 } du_options_t;
 
 // 获取目录大小
@@ -141,6 +146,91 @@ int scan_directory(const char *path, du_options_t *options, int level) {
     return count;
 }
 
+// 将快照目录树转换为显示条目
+void collect_tree_entries(const dir_node_t *node, const char *path, du_options_t *options, int level) {
+    for (uint32_t i = 0; i < node->child_count && options->entry_count < MAX_ENTRIES; i++) {
+        const dir_node_t *child = node->children[i];
+        char full_path[MAX_PATH_LENGTH];
+
+        if (!options->show_hidden && child->name[0] == '.') {
+            continue;
+        }
+
+        snprintf(full_path, sizeof(full_path), "%s/%s", path, child->name);
+
+        du_entry_t *entry = &options->entries[options->entry_count++];
+        snprintf(entry->path, sizeof(entry->path), "%s", full_path);
+        entry->level = level;
+        entry->is_directory = 1;
+        entry->size = child->total_bytes;
+        entry->mtime = child->mtime_sec;
+
+        if (level < options->max_depth) {
+            collect_tree_entries(child, full_path, options, level + 1);
+        }
+    }
+}
+
+// 快照模式扫描：全量扫描或基于旧快照的增量扫描，然后保存新快照
+int scan_with_snapshot(const char *path, du_options_t *options) {
+    du_snapshot_t old_snap = {0};
+    du_snapshot_t new_snap = {0};
+    scan_stats_t stats = {0};
+
+    if (options->incremental) {
+        if (snapshot_load(options->snapshot_file, &old_snap) != 0) {
+            print_warning("无法读取快照，执行全量扫描");
+        } else if (strcmp(old_snap.root->name, path) != 0) {
+            print_warning("快照根目录不匹配，执行全量扫描");
+            snapshot_free_tree(old_snap.root);
+            old_snap.root = NULL;
+        }
+    }
+
+    new_snap.root = snapshot_scan(path, old_snap.root, &stats);
+    new_snap.created = time(NULL);
+    snapshot_free_tree(old_snap.root);
+
+    if (!new_snap.root) {
+        print_error("无法扫描目录");
+        return 1;
+    }
+
+    if (snapshot_save(options->snapshot_file, &new_snap) != 0) {
+        print_error("无法保存快照");
+    }
+
+    printf("%s重新枚举目录: %lu, 复用目录: %lu, 文件: %lu%s\n", COLOR_CYAN,
+           (unsigned long)stats.dirs_rescanned, (unsigned long)stats.dirs_reused,
+           (unsigned long)stats.files_seen, COLOR_RESET);
+
+    collect_tree_entries(new_snap.root, path, options, 0);
+    snapshot_free_tree(new_snap.root);
+    return 0;
+}
+
+// 比较两个快照文件
+int diff_snapshots(du_options_t *options) {
+    du_snapshot_t old_snap = {0};
+    du_snapshot_t new_snap = {0};
+
+    if (snapshot_load(options->diff_old, &old_snap) != 0) {
+        print_error("无法读取旧快照");
+        return 1;
+    }
+    if (snapshot_load(options->diff_new, &new_snap) != 0) {
+        print_error("无法读取新快照");
+        snapshot_free_tree(old_snap.root);
+        return 1;
+    }
+
+    snapshot_diff(&old_snap, &new_snap, options->max_depth);
+
+    snapshot_free_tree(old_snap.root);
+    snapshot_free_tree(new_snap.root);
+    return 0;
+}
+
 // 比较函数用于排序
 int compare_entries(const void *a, const void *b) {
     const du_entry_t *entry_a = (const du_entry_t *)a;
@@ -271,6 +361,9 @@ void print_usage(const char *program_name) {
     printf("  -g, --graph           显示图形化进度条\n");
     printf("  -S, --sort            按大小排序\n");
     printf("  -H, --hidden          显示隐藏文件\n");
+    printf("  --snapshot 文件       扫描后将目录树保存为二进制快照\n");
+    printf("  --incremental         基于快照增量扫描，只重新枚举 mtime/ctime 变化的目录\n");
+    printf("  --diff 旧快照 新快照  显示增长最快的子树\n");
     printf("  --help                显示此帮助信息\n");
     printf("  --version             显示版本信息\n");
     printf("\n示例:\n");
@@ -278,6 +371,9 @@ void print_usage(const char *program_name) {
     printf("  %s -h /home            # 分析/home目录\n", program_name);
     printf("  %s -d 2 -g             # 限制深度并显示图形\n", program_name);
     printf("  %s -a -o               # 显示所有文件和所有者\n", program_name);
+    printf("  %s --snapshot du.snap --incremental /data\n", program_name);
+    printf("  %s --diff old.snap new.snap\n", program_name);
+    printf("\n注意: 增量扫描只检测目录条目的增删，原地追加写入的文件大小变化需要全量扫描\n");
 }
 
 int main(int argc, char *argv[]) {
@@ -311,6 +407,20 @@ int main(int argc, char *argv[]) {
             options.sort_by_size = 1;
         } else if (strcmp(argv[i], "-H") == 0 || strcmp(argv[i], "--hidden") == 0) {
             options.show_hidden = 1;
+        } else if (strcmp(argv[i], "--snapshot") == 0) {
+            if (i + 1 < argc) {
+                options.snapshot_file = argv[++i];
+            }
+        } else if (strcmp(argv[i], "--incremental") == 0) {
+            options.incremental = 1;
+        } else if (strcmp(argv[i], "--diff") == 0) {
+            if (i + 2 < argc) {
+                options.diff_old = argv[++i];
+                options.diff_new = argv[++i];
+            } else {
+                print_error("--diff 需要两个快照文件");
+                return 1;
+            }
         } else if (strcmp(argv[i], "--help") == 0) {
             print_usage(argv[0]);
             return 0;
@@ -322,11 +432,33 @@ int main(int argc, char *argv[]) {
         }
     }
     
+    if (options.diff_old) {
+        return diff_snapshots(&options);
+    }
+    
     // 如果没有指定目录，使用当前目录
     if (dir_count == 0) {
         target_dirs[dir_count++] = ".";
     }
     
+    if (options.incremental && !options.snapshot_file) {
+        print_error("--incremental 需要配合 --snapshot 使用");
+        return 1;
+    }
+    
+    if (options.snapshot_file) {
+        if (dir_count > 1) {
+            print_error("快照模式只支持一个目录");
+            return 1;
+        }
+        printf("%s分析目录: %s%s\n", COLOR_CYAN, target_dirs[0], COLOR_RESET);
+        if (scan_with_snapshot(target_dirs[0], &options) != 0) {
+            return 1;
+        }
+        display_results(&options);
+        return 0;
+    }
+    
     // 扫描每个目录
     for (int i = 0; i < dir_count; i++) {
         printf("%s分析目录: %s%s\n", COLOR_CYAN, target_dirs[i], COLOR_RESET);
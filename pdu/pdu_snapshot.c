@@ -0,0 +1,430 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "../include/common.h"
+#include "pdu_snapshot.h"
+
+#define SNAPSHOT_IO_BUFFER (1 << 20)
+
+// 拼接路径，返回的字符串需要调用者释放
+static char *path_join(const char *dir, const char *name) {
+    size_t dir_len = strlen(dir);
+    size_t name_len = strlen(name);
+    char *path = malloc(dir_len + name_len + 2);
+    if (!path) return NULL;
+
+    memcpy(path, dir, dir_len);
+    if (dir_len > 0 && dir[dir_len - 1] != '/') {
+        path[dir_len++] = '/';
+    }
+    memcpy(path + dir_len, name, name_len + 1);
+    return path;
+}
+
+static dir_node_t *node_new(const char *name, const struct stat *st) {
+    dir_node_t *node = calloc(1, sizeof(dir_node_t));
+    if (!node) return NULL;
+
+    node->name = strdup(name);
+    node->dev = st->st_dev;
+    node->ino = st->st_ino;
+    node->mtime_sec = st->st_mtim.tv_sec;
+    node->mtime_nsec = st->st_mtim.tv_nsec;
+    node->ctime_sec = st->st_ctim.tv_sec;
+    node->ctime_nsec = st->st_ctim.tv_nsec;
+    return node;
+}
+
+static int node_add_child(dir_node_t *parent, dir_node_t *child) {
+    if (parent->child_count == parent->child_capacity) {
+        uint32_t capacity = parent->child_capacity ? parent->child_capacity * 2 : 4;
+        dir_node_t **children = realloc(parent->children, capacity * sizeof(dir_node_t *));
+        if (!children) return -1;
+        parent->children = children;
+        parent->child_capacity = capacity;
+    }
+    parent->children[parent->child_count++] = child;
+    return 0;
+}
+
+static int compare_nodes(const void *a, const void *b) {
+    const dir_node_t *node_a = *(const dir_node_t * const *)a;
+    const dir_node_t *node_b = *(const dir_node_t * const *)b;
+    return strcmp(node_a->name, node_b->name);
+}
+
+// 在旧节点的子目录中按名称二分查找
+static const dir_node_t *find_child(const dir_node_t *old, const char *name) {
+    if (!old || old->child_count == 0) return NULL;
+
+    uint32_t lo = 0, hi = old->child_count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        int cmp = strcmp(old->children[mid]->name, name);
+        if (cmp == 0) return old->children[mid];
+        if (cmp < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return NULL;
+}
+
+// 目录的 mtime/ctime 未变化说明其中的条目没有增删
+static int node_unchanged(const dir_node_t *old, const struct stat *st) {
+    return old &&
+           old->dev == (uint64_t)st->st_dev &&
+           old->ino == (uint64_t)st->st_ino &&
+           old->mtime_sec == st->st_mtim.tv_sec &&
+           old->mtime_nsec == st->st_mtim.tv_nsec &&
+           old->ctime_sec == st->st_ctim.tv_sec &&
+           old->ctime_nsec == st->st_ctim.tv_nsec;
+}
+
+static dir_node_t *scan_node(const char *path, const char *name, const struct stat *st,
+                             const dir_node_t *old, scan_stats_t *stats) {
+    dir_node_t *node = node_new(name, st);
+    if (!node) return NULL;
+
+    if (node_unchanged(old, st)) {
+        // 复用文件汇总，只需检查子目录
+        stats->dirs_reused++;
+        node->file_bytes = old->file_bytes;
+        node->file_count = old->file_count;
+
+        for (uint32_t i = 0; i < old->child_count; i++) {
+            const dir_node_t *old_child = old->children[i];
+            char *child_path = path_join(path, old_child->name);
+            struct stat child_st;
+
+            if (child_path && lstat(child_path, &child_st) == 0 && S_ISDIR(child_st.st_mode)) {
+                dir_node_t *child = scan_node(child_path, old_child->name, &child_st,
+                                              old_child, stats);
+                if (child) node_add_child(node, child);
+            }
+            free(child_path);
+        }
+    } else {
+        DIR *dir = opendir(path);
+        struct dirent *entry;
+
+        stats->dirs_rescanned++;
+        if (dir) {
+            while ((entry = readdir(dir)) != NULL) {
+                if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+                    continue;
+                }
+
+                char *child_path = path_join(path, entry->d_name);
+                struct stat child_st;
+
+                if (!child_path || lstat(child_path, &child_st) != 0) {
+                    free(child_path);
+                    continue;
+                }
+
+                if (S_ISDIR(child_st.st_mode)) {
+                    dir_node_t *child = scan_node(child_path, entry->d_name, &child_st,
+                                                  find_child(old, entry->d_name), stats);
+                    if (child) node_add_child(node, child);
+                } else {
+                    node->file_bytes += child_st.st_size;
+                    node->file_count++;
+                    stats->files_seen++;
+                }
+                free(child_path);
+            }
+            closedir(dir);
+        }
+
+        // 保持子目录有序，下次增量扫描可以二分查找
+        if (node->child_count > 1) {
+            qsort(node->children, node->child_count, sizeof(dir_node_t *), compare_nodes);
+        }
+    }
+
+    node->total_bytes = node->file_bytes;
+    for (uint32_t i = 0; i < node->child_count; i++) {
+        node->total_bytes += node->children[i]->total_bytes;
+    }
+    return node;
+}
+
+dir_node_t *snapshot_scan(const char *path, const dir_node_t *old, scan_stats_t *stats) {
+    struct stat st;
+
+    if (lstat(path, &st) != 0 || !S_ISDIR(st.st_mode)) {
+        return NULL;
+    }
+    return scan_node(path, path, &st, old, stats);
+}
+
+void snapshot_free_tree(dir_node_t *node) {
+    if (!node) return;
+
+    for (uint32_t i = 0; i < node->child_count; i++) {
+        snapshot_free_tree(node->children[i]);
+    }
+    free(node->children);
+    free(node->name);
+    free(node);
+}
+
+// ---- 二进制格式：LEB128 变长整数 ----
+
+static void write_varint(FILE *fp, uint64_t value) {
+    while (value >= 0x80) {
+        fputc((int)(value & 0x7f) | 0x80, fp);
+        value >>= 7;
+    }
+    fputc((int)value, fp);
+}
+
+static int read_varint(FILE *fp, uint64_t *value) {
+    uint64_t result = 0;
+    int shift = 0;
+    int c;
+
+    while ((c = fgetc(fp)) != EOF) {
+        if (shift > 63) return -1;
+        result |= (uint64_t)(c & 0x7f) << shift;
+        if (!(c & 0x80)) {
+            *value = result;
+            return 0;
+        }
+        shift += 7;
+    }
+    return -1;
+}
+
+// 有符号数使用 zigzag 编码
+static void write_svarint(FILE *fp, int64_t value) {
+    write_varint(fp, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+static int read_svarint(FILE *fp, int64_t *value) {
+    uint64_t raw;
+    if (read_varint(fp, &raw) != 0) return -1;
+    *value = (int64_t)(raw >> 1) ^ -(int64_t)(raw & 1);
+    return 0;
+}
+
+static void write_node(FILE *fp, const dir_node_t *node) {
+    size_t name_len = strlen(node->name);
+
+    write_varint(fp, name_len);
+    fwrite(node->name, 1, name_len, fp);
+    write_varint(fp, node->dev);
+    write_varint(fp, node->ino);
+    write_svarint(fp, node->mtime_sec);
+    write_varint(fp, (uint64_t)node->mtime_nsec);
+    write_svarint(fp, node->ctime_sec);
+    write_varint(fp, (uint64_t)node->ctime_nsec);
+    write_varint(fp, node->file_bytes);
+    write_varint(fp, node->file_count);
+    write_varint(fp, node->child_count);
+
+    for (uint32_t i = 0; i < node->child_count; i++) {
+        write_node(fp, node->children[i]);
+    }
+}
+
+static dir_node_t *read_node(FILE *fp) {
+    uint64_t name_len, child_count, value;
+    dir_node_t *node = calloc(1, sizeof(dir_node_t));
+    if (!node) return NULL;
+
+    if (read_varint(fp, &name_len) != 0 || name_len > 4096) goto fail;
+    node->name = malloc(name_len + 1);
+    if (!node->name || fread(node->name, 1, name_len, fp) != name_len) goto fail;
+    node->name[name_len] = '\0';
+
+    if (read_varint(fp, &node->dev) != 0 ||
+        read_varint(fp, &node->ino) != 0 ||
+        read_svarint(fp, &node->mtime_sec) != 0 ||
+        read_varint(fp, &value) != 0) goto fail;
+    node->mtime_nsec = (int64_t)value;
+    if (read_svarint(fp, &node->ctime_sec) != 0 ||
+        read_varint(fp, &value) != 0) goto fail;
+    node->ctime_nsec = (int64_t)value;
+    if (read_varint(fp, &node->file_bytes) != 0 ||
+        read_varint(fp, &node->file_count) != 0 ||
+        read_varint(fp, &child_count) != 0 || child_count > UINT32_MAX) goto fail;
+
+    node->total_bytes = node->file_bytes;
+    if (child_count > 0) {
+        node->children = malloc(child_count * sizeof(dir_node_t *));
+        if (!node->children) goto fail;
+        node->child_capacity = (uint32_t)child_count;
+    }
+    for (uint64_t i = 0; i < child_count; i++) {
+        dir_node_t *child = read_node(fp);
+        if (!child) goto fail;
+        node->children[node->child_count++] = child;
+        node->total_bytes += child->total_bytes;
+    }
+    return node;
+
+fail:
+    snapshot_free_tree(node);
+    return NULL;
+}
+
+int snapshot_save(const char *filename, const du_snapshot_t *snapshot) {
+    char *tmp_name = malloc(strlen(filename) + 5);
+    if (!tmp_name) return -1;
+    sprintf(tmp_name, "%s.tmp", filename);
+
+    // 先写临时文件再 rename，避免中断时留下损坏的快照
+    FILE *fp = fopen(tmp_name, "wb");
+    if (!fp) {
+        free(tmp_name);
+        return -1;
+    }
+    setvbuf(fp, NULL, _IOFBF, SNAPSHOT_IO_BUFFER);
+
+    fwrite(SNAPSHOT_MAGIC, 1, 8, fp);
+    write_varint(fp, SNAPSHOT_VERSION);
+    write_svarint(fp, snapshot->created);
+    write_node(fp, snapshot->root);
+
+    int failed = ferror(fp);
+    if (fclose(fp) != 0) failed = 1;
+    if (failed || rename(tmp_name, filename) != 0) {
+        unlink(tmp_name);
+        free(tmp_name);
+        return -1;
+    }
+    free(tmp_name);
+    return 0;
+}
+
+int snapshot_load(const char *filename, du_snapshot_t *snapshot) {
+    char magic[8];
+    uint64_t version;
+
+    FILE *fp = fopen(filename, "rb");
+    if (!fp) return -1;
+    setvbuf(fp, NULL, _IOFBF, SNAPSHOT_IO_BUFFER);
+
+    if (fread(magic, 1, 8, fp) != 8 || memcmp(magic, SNAPSHOT_MAGIC, 8) != 0 ||
+        read_varint(fp, &version) != 0 || version != SNAPSHOT_VERSION ||
+        read_svarint(fp, &snapshot->created) != 0) {
+        fclose(fp);
+        return -1;
+    }
+
+    snapshot->root = read_node(fp);
+    fclose(fp);
+    return snapshot->root ? 0 : -1;
+}
+
+// ---- 快照比较 ----
+
+typedef struct {
+    char *path;         // 相对于根目录的路径
+    int depth;
+    uint64_t total_bytes;
+    int64_t growth;
+} flat_entry_t;
+
+typedef struct {
+    flat_entry_t *items;
+    size_t count;
+    size_t capacity;
+} flat_list_t;
+
+static void flatten(const dir_node_t *node, const char *rel, int depth, flat_list_t *list) {
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 256;
+        flat_entry_t *items = realloc(list->items, capacity * sizeof(flat_entry_t));
+        if (!items) return;
+        list->items = items;
+        list->capacity = capacity;
+    }
+
+    flat_entry_t *item = &list->items[list->count++];
+    item->path = strdup(rel);
+    item->depth = depth;
+    item->total_bytes = node->total_bytes;
+    item->growth = 0;
+
+    for (uint32_t i = 0; i < node->child_count; i++) {
+        char *child_rel = rel[0] ? path_join(rel, node->children[i]->name)
+                                 : strdup(node->children[i]->name);
+        if (child_rel) {
+            flatten(node->children[i], child_rel, depth + 1, list);
+            free(child_rel);
+        }
+    }
+}
+
+static int compare_flat_path(const void *a, const void *b) {
+    return strcmp(((const flat_entry_t *)a)->path, ((const flat_entry_t *)b)->path);
+}
+
+static int compare_flat_growth(const void *a, const void *b) {
+    const flat_entry_t *entry_a = (const flat_entry_t *)a;
+    const flat_entry_t *entry_b = (const flat_entry_t *)b;
+    if (entry_a->growth > entry_b->growth) return -1;
+    if (entry_a->growth < entry_b->growth) return 1;
+    return strcmp(entry_a->path, entry_b->path);
+}
+
+static void free_flat_list(flat_list_t *list) {
+    for (size_t i = 0; i < list->count; i++) {
+        free(list->items[i].path);
+    }
+    free(list->items);
+}
+
+int snapshot_diff(const du_snapshot_t *old_snap, const du_snapshot_t *new_snap, int max_depth) {
+    flat_list_t old_list = {0}, new_list = {0};
+
+    flatten(old_snap->root, "", 0, &old_list);
+    flatten(new_snap->root, "", 0, &new_list);
+    qsort(old_list.items, old_list.count, sizeof(flat_entry_t), compare_flat_path);
+
+    for (size_t i = 0; i < new_list.count; i++) {
+        flat_entry_t *item = &new_list.items[i];
+        flat_entry_t *prev = bsearch(item, old_list.items, old_list.count,
+                                     sizeof(flat_entry_t), compare_flat_path);
+        item->growth = (int64_t)item->total_bytes - (prev ? (int64_t)prev->total_bytes : 0);
+    }
+    qsort(new_list.items, new_list.count, sizeof(flat_entry_t), compare_flat_growth);
+
+    int64_t elapsed = new_snap->created - old_snap->created;
+    int64_t total_growth = (int64_t)new_snap->root->total_bytes - (int64_t)old_snap->root->total_bytes;
+
+    printf("%s快照对比: %s%s\n", COLOR_CYAN, new_snap->root->name, COLOR_RESET);
+    printf("%s%s%s\n", COLOR_YELLOW, "================================================", COLOR_RESET);
+    printf("%s时间间隔: %ld 秒%s\n", COLOR_CYAN, (long)elapsed, COLOR_RESET);
+    printf("%s总大小变化: %s%s%s\n", COLOR_CYAN, total_growth < 0 ? "-" : "+",
+           format_size(total_growth < 0 ? -total_growth : total_growth), COLOR_RESET);
+    printf("%s增长最快的子树:%s\n", COLOR_CYAN, COLOR_RESET);
+
+    int shown = 0;
+    for (size_t i = 0; i < new_list.count && shown < DIFF_TOP_COUNT; i++) {
+        const flat_entry_t *item = &new_list.items[i];
+        if (item->growth <= 0) break;
+        if (item->depth > max_depth) continue;
+
+        printf("  %s %s%s%s%s%s", ICON_DIRECTORY, COLOR_BLUE, new_snap->root->name,
+               item->path[0] ? "/" : "", item->path, COLOR_RESET);
+        printf(" %s+%s%s", COLOR_RED, format_size(item->growth), COLOR_RESET);
+        if (elapsed > 0) {
+            printf(" %s(%s/小时)%s", COLOR_YELLOW,
+                   format_size((off_t)((double)item->growth * 3600 / elapsed)), COLOR_RESET);
+        }
+        printf("\n");
+        shown++;
+    }
+    if (shown == 0) {
+        printf("  %s没有增长的目录%s\n", COLOR_GREEN, COLOR_RESET);
+    }
+
+    free_flat_list(&old_list);
+    free_flat_list(&new_list);
+    return 0;
+}
@@ -0,0 +1,54 @@
+#ifndef PDU_SNAPSHOT_H
+#define PDU_SNAPSHOT_H
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <time.h>
+
+#define SNAPSHOT_MAGIC "PDUSNAP1"
+#define SNAPSHOT_VERSION 1
+#define DIFF_TOP_COUNT 20
+
+// 目录树节点：只保存目录，文件大小汇总到所在目录
+typedef struct dir_node {
+    char *name;                 // 目录名（根节点为扫描路径）
+    uint64_t dev;
+    uint64_t ino;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    int64_t ctime_sec;
+    int64_t ctime_nsec;
+    uint64_t file_bytes;        // 本目录下直接文件的大小总和
+    uint64_t file_count;        // 本目录下直接文件的数量
+    uint64_t total_bytes;       // 整个子树的大小
+    struct dir_node **children; // 子目录，按名称排序
+    uint32_t child_count;
+    uint32_t child_capacity;
+} dir_node_t;
+
+// 快照：目录树加上扫描时间
+typedef struct {
+    dir_node_t *root;
+    int64_t created;
+} du_snapshot_t;
+
+// 扫描统计
+typedef struct {
+    uint64_t dirs_rescanned;    // 重新枚举的目录
+    uint64_t dirs_reused;       // 直接复用快照的目录
+    uint64_t files_seen;        // 重新枚举时 stat 的文件数
+} scan_stats_t;
+
+// 扫描目录树；old 不为空时只重新枚举 mtime/ctime 变化的目录
+dir_node_t *snapshot_scan(const char *path, const dir_node_t *old, scan_stats_t *stats);
+
+// 快照读写，成功返回 0
+int snapshot_save(const char *filename, const du_snapshot_t *snapshot);
+int snapshot_load(const char *filename, du_snapshot_t *snapshot);
+
+void snapshot_free_tree(dir_node_t *node);
+
+// 比较两个快照，输出增长最快的子树
+int snapshot_diff(const du_snapshot_t *old_snap, const du_snapshot_t *new_snap, int max_depth);
+
+#endif // PDU_SNAPSHOT_H
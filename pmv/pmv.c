@@ -8,38 +8,7 @@
 #include <fcntl.h>
 #include <utime.h>
 #include "../include/common.h"
-
-#define MAX_FILENAME 256
-#define MAX_FILES 1000
-
-// 移动模式枚举
-typedef enum {
-    MOVE_SIMPLE,        // 简单移动
-    MOVE_RECURSIVE,     // 递归移动
-    MOVE_PRESERVE,      // 保留属性
-    MOVE_BACKUP         // 备份模式
-} MoveMode;
-
-// 移动配置结构
-typedef struct {
-    char **sources;
-    int source_count;
-    char destination[MAX_FILENAME];
-    MoveMode mode;
-    int verbose;
-    int force;
-    int interactive;
-    int backup;
-    int preserve_attributes;
-} MoveConfig;
-
-// 统计信息结构
-typedef struct {
-    int files_moved;
-    int directories_moved;
-    off_t bytes_moved;
-    int errors;
-} MoveStats;
+#include "pmv.h"
 
 // 初始化统计信息
 void init_stats(MoveStats *stats) {
@@ -109,50 +78,10 @@ int move_file(const char *source, const char *dest, const MoveConfig *config) {
     
     // 重命名失败，可能是跨文件系统，需要复制后删除
     if (errno == EXDEV) {
-        // 复制文件
-        int src_fd = open(source, O_RDONLY);
-        if (src_fd == -1) {
-            print_error("无法打开源文件");
-            return 0;
-        }
-        
-        int dest_fd = open(dest, O_WRONLY | O_CREAT | O_TRUNC, src_st.st_mode);
-        if (dest_fd == -1) {
-            close(src_fd);
-            print_error("无法创建目标文件");
+        if (!xdev_move_file(source, dest, config, file_exists(dest))) {
             return 0;
         }
         
-        char buffer[8192];
-        ssize_t bytes_read, bytes_written;
-        
-        while ((bytes_read = read(src_fd, buffer, sizeof(buffer))) > 0) {
-            bytes_written = write(dest_fd, buffer, bytes_read);
-            if (bytes_written != bytes_read) {
-                close(src_fd);
-                close(dest_fd);
-                print_error("写入文件失败");
-                return 0;
-            }
-        }
-        
-        close(src_fd);
-        close(dest_fd);
-        
-        // 保留文件属性
-        if (config->preserve_attributes) {
-            struct utimbuf times;
-            times.actime = src_st.st_atime;
-            times.modtime = src_st.st_mtime;
-            utime(dest, &times);
-            chmod(dest, src_st.st_mode);
-        }
-        
-        // 删除源文件
-        if (unlink(source) != 0) {
-            print_warning("无法删除源文件");
-        }
-        
         if (config->verbose) {
             printf("%s移动文件: %s -> %s (跨文件系统)%s\n", 
                    COLOR_GREEN, source, dest, COLOR_RESET);
@@ -166,7 +95,7 @@ int move_file(const char *source, const char *dest, const MoveConfig *config) {
 }
 
 // 移动目录
-int move_directory(const char *source, const char *dest, const MoveConfig *config) {
+int move_directory(const char *source, const char *dest, const MoveConfig *config, MoveStats *stats) {
     // 检查目标目录是否存在
     if (file_exists(dest)) {
         if (config->interactive) {
@@ -177,8 +106,8 @@ int move_directory(const char *source, const char *dest, const MoveConfig *confi
                 printf("跳过: %s\n", source);
                 return 1;
             }
-        } else if (!config->force) {
-            print_error("目标目录已存在，使用 -f 强制覆盖");
+        } else if (!config->force && !config->resume) {
+            print_error("目标目录已存在，使用 -f 强制覆盖或 --resume 继续");
             return 0;
         }
     }
@@ -192,70 +121,18 @@ int move_directory(const char *source, const char *dest, const MoveConfig *confi
         return 1;
     }
     
-    // 重命名失败，需要递归移动
-    if (errno == EXDEV) {
-        // 创建目标目录
-        struct stat src_st;
-        if (stat(source, &src_st) != 0) {
-            print_error("无法获取源目录信息");
-            return 0;
-        }
-        
-        if (mkdir(dest, src_st.st_mode) != 0 && errno != EEXIST) {
-            print_error("无法创建目标目录");
+    // 重命名失败，跨文件系统时由并行移动引擎复制整个目录树
+    if (errno == EXDEV || (config->resume && (errno == ENOTEMPTY || errno == EEXIST))) {
+        if (!xdev_move_directory(source, dest, config, stats)) {
             return 0;
         }
         
-        // 递归移动目录内容
-        DIR *dir = opendir(source);
-        if (!dir) {
-            print_error("无法打开源目录");
-            return 0;
-        }
-        
-        struct dirent *entry;
-        int success = 1;
-        
-        while ((entry = readdir(dir)) != NULL) {
-            if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
-                continue;
-            }
-            
-            char src_path[MAX_FILENAME];
-            char dest_path[MAX_FILENAME];
-            
-            snprintf(src_path, sizeof(src_path), "%s/%s", source, entry->d_name);
-            snprintf(dest_path, sizeof(dest_path), "%s/%s", dest, entry->d_name);
-            
-            struct stat st;
-            if (stat(src_path, &st) != 0) {
-                continue;
-            }
-            
-            if (S_ISDIR(st.st_mode)) {
-                if (!move_directory(src_path, dest_path, config)) {
-                    success = 0;
-                }
-            } else {
-                if (!move_file(src_path, dest_path, config)) {
-                    success = 0;
-                }
-            }
-        }
-        
-        closedir(dir);
-        
-        // 删除空源目录
-        if (success && rmdir(source) != 0) {
-            print_warning("无法删除源目录");
-        }
-        
         if (config->verbose) {
             printf("%s移动目录: %s -> %s (跨文件系统)%s\n", 
                    COLOR_GREEN, source, dest, COLOR_RESET);
         }
         
-        return success;
+        return 1;
     }
     
     print_error("移动目录失败");
@@ -297,7 +174,7 @@ int perform_move(const MoveConfig *config, MoveStats *stats) {
         if (S_ISDIR(src_st.st_mode)) {
             // 移动目录
             if (config->mode == MOVE_RECURSIVE || config->mode == MOVE_PRESERVE) {
-                if (move_directory(source, dest, config)) {
+                if (move_directory(source, dest, config, stats)) {
                     stats->directories_moved++;
                     stats->bytes_moved += src_st.st_size;
                 } else {
@@ -352,6 +229,8 @@ void print_usage(const char *program_name) {
     printf("  -i, --interactive    交互式确认\n");
     printf("  -f, --force          强制覆盖\n");
     printf("  -v, --verbose        显示详细信息\n");
+    printf("  -j, --jobs N         跨文件系统移动的工作线程数（默认为 CPU 核数）\n");
+    printf("  --resume             继续被中断的跨文件系统移动\n");
     printf("  -h, --help           显示此帮助信息\n");
     printf("  -V, --version        显示版本信息\n");
     printf("\n示例:\n");
@@ -369,7 +248,10 @@ int main(int argc, char *argv[]) {
     config.interactive = 0;
     config.backup = 0;
     config.preserve_attributes = 0;
-    config.sources = malloc(MAX_FILES * sizeof(char*));
+    config.jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (config.jobs < 1) config.jobs = 1;
+    if (config.jobs > MAX_JOBS) config.jobs = MAX_JOBS;
+    config.sources = malloc(argc * sizeof(char*));
     config.source_count = 0;
     
     // 解析命令行参数
@@ -387,6 +269,14 @@ int main(int argc, char *argv[]) {
             config.force = 1;
         } else if (strcmp(argv[i], "-v") == 0 || strcmp(argv[i], "--verbose") == 0) {
             config.verbose = 1;
+        } else if (strcmp(argv[i], "-j") == 0 || strcmp(argv[i], "--jobs") == 0) {
+            if (i + 1 < argc) {
+                config.jobs = atoi(argv[++i]);
+                if (config.jobs < 1) config.jobs = 1;
+                if (config.jobs > MAX_JOBS) config.jobs = MAX_JOBS;
+            }
+        } else if (strcmp(argv[i], "--resume") == 0) {
+            config.resume = 1;
         } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
             print_usage(argv[0]);
             free(config.sources);
@@ -396,10 +286,8 @@ int main(int argc, char *argv[]) {
             free(config.sources);
             return 0;
         } else if (argv[i][0] != '-') {
-            if (config.source_count < MAX_FILES) {
-                config.sources[config.source_count] = argv[i];
-                config.source_count++;
-            }
+            config.sources[config.source_count] = argv[i];
+            config.source_count++;
         } else {
             printf("未知选项: %s\n", argv[i]);
             print_usage(argv[0]);
@@ -0,0 +1,47 @@
+#ifndef PMV_H
+#define PMV_H
+
+#include <sys/types.h>
+
+#define MAX_FILENAME 4096
+#define MAX_JOBS 64
+
+// 移动模式枚举
+typedef enum {
+    MOVE_SIMPLE,        // 简单移动
+    MOVE_RECURSIVE,     // 递归移动
+    MOVE_PRESERVE,      // 保留属性
+    MOVE_BACKUP         // 备份模式
+} MoveMode;
+
+// 移动配置结构
+typedef struct {
+    char **sources;
+    int source_count;
+    char destination[MAX_FILENAME];
+    MoveMode mode;
+    int verbose;
+    int force;
+    int interactive;
+    int backup;
+    int preserve_attributes;
+    int jobs;               // 跨文件系统移动的工作线程数
+    int resume;             // 继续被中断的跨文件系统移动
+} MoveConfig;
+
+// 统计信息结构
+typedef struct {
+    int files_moved;
+    int directories_moved;
+    off_t bytes_moved;
+    int errors;
+} MoveStats;
+
+// 跨文件系统移动单个文件：复制到临时文件、fsync、原子提交，最后删除源文件
+int xdev_move_file(const char *source, const char *dest, const MoveConfig *config, int overwrite);
+
+// 跨文件系统移动目录树：工作线程并行复制，全部持久化后才删除源文件
+int xdev_move_directory(const char *source, const char *dest,
+                        const MoveConfig *config, MoveStats *stats);
+
+#endif // PMV_H
@@ -0,0 +1,554 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/sendfile.h>
+#include "../include/common.h"
+#include "pmv.h"
+
+#define QUEUE_CAPACITY 1024
+#define COPY_CHUNK_SIZE (64 * 1024 * 1024)
+#define COPY_BUFFER_SIZE (1024 * 1024)
+#define PART_PREFIX ".pmv-part."
+
+// 提交结果
+typedef enum {
+    COMMIT_FAILED = 0,
+    COMMIT_DONE,            // 本次复制并提交
+    COMMIT_EXISTING         // 续传时目标已是完整文件
+} CommitResult;
+
+// 单个文件任务
+typedef struct {
+    char *source;
+    char *dest;
+    struct stat st;
+} XdevJob;
+
+// 目录记录：最后统一应用元数据并删除源目录
+typedef struct {
+    char *source;
+    char *dest;
+    struct stat st;
+} XdevDir;
+
+typedef struct {
+    const MoveConfig *config;
+    MoveStats *stats;
+    pthread_mutex_t lock;               // 保护统计、输出和已提交列表
+
+    XdevJob *slots[QUEUE_CAPACITY];     // 有界任务队列
+    int head;
+    int tail;
+    int count;
+    int closed;
+    pthread_mutex_t queue_lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+
+    char **committed;                   // 已提交、待删除的源文件
+    size_t committed_count;
+    size_t committed_capacity;
+
+    XdevDir *dirs;
+    size_t dir_count;
+    size_t dir_capacity;
+} XdevMove;
+
+static char *join_path(const char *dir, const char *name) {
+    size_t dir_len = strlen(dir);
+    size_t name_len = strlen(name);
+    char *path = malloc(dir_len + name_len + 2);
+    if (!path) return NULL;
+
+    memcpy(path, dir, dir_len);
+    path[dir_len] = '/';
+    memcpy(path + dir_len + 1, name, name_len + 1);
+    return path;
+}
+
+// 临时文件与目标放在同一目录，保证 rename 提交是原子的
+static char *part_path(const char *dest) {
+    const char *slash = strrchr(dest, '/');
+    size_t dir_len = slash ? (size_t)(slash - dest + 1) : 0;
+    const char *name = dest + dir_len;
+    char *path = malloc(strlen(dest) + sizeof(PART_PREFIX));
+    if (!path) return NULL;
+
+    memcpy(path, dest, dir_len);
+    strcpy(path + dir_len, PART_PREFIX);
+    strcat(path, name);
+    return path;
+}
+
+// 依次尝试 copy_file_range、sendfile 和 read/write，回退时从当前文件位置继续
+static int copy_contents(int src_fd, int dest_fd, off_t size) {
+    off_t copied = 0;
+    int use_sendfile = 0;
+
+    while (copied < size) {
+        size_t chunk = (size - copied) > COPY_CHUNK_SIZE ? COPY_CHUNK_SIZE : (size_t)(size - copied);
+        ssize_t n = use_sendfile ? sendfile(dest_fd, src_fd, NULL, chunk)
+                                 : copy_file_range(src_fd, NULL, dest_fd, NULL, chunk, 0);
+        if (n > 0) {
+            copied += n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EIO || errno == ENOSPC || errno == EDQUOT)) return 0;
+
+        // 不支持（跨文件系统的 copy_file_range 常见 EXDEV）或提前遇到 EOF
+        if (use_sendfile) break;
+        use_sendfile = 1;
+    }
+
+    // 剩余部分（或不支持内核复制时的全部内容）用 read/write 读到 EOF
+    char *buffer = malloc(COPY_BUFFER_SIZE);
+    if (!buffer) return 0;
+
+    for (;;) {
+        ssize_t bytes_read = read(src_fd, buffer, COPY_BUFFER_SIZE);
+        if (bytes_read < 0 && errno == EINTR) continue;
+        if (bytes_read <= 0) {
+            free(buffer);
+            return bytes_read == 0;
+        }
+
+        ssize_t offset = 0;
+        while (offset < bytes_read) {
+            ssize_t bytes_written = write(dest_fd, buffer + offset, bytes_read - offset);
+            if (bytes_written < 0) {
+                if (errno == EINTR) continue;
+                free(buffer);
+                return 0;
+            }
+            offset += bytes_written;
+        }
+    }
+}
+
+// 原子提交：目标不存在时用 RENAME_NOREPLACE，确认覆盖时才替换已有文件
+static int commit_part(const char *part, const char *dest, int overwrite) {
+    if (overwrite) {
+        return rename(part, dest) == 0;
+    }
+
+#ifdef RENAME_NOREPLACE
+    if (renameat2(AT_FDCWD, part, AT_FDCWD, dest, RENAME_NOREPLACE) == 0) {
+        return 1;
+    }
+    if (errno != ENOSYS && errno != EINVAL) {
+        return 0;
+    }
+#endif
+
+    // 不支持 renameat2 的文件系统：link 在目标存在时同样会失败
+    if (link(part, dest) == 0) {
+        unlink(part);
+        return 1;
+    }
+    return 0;
+}
+
+// 续传时判断目标是否已经是上次提交的完整文件
+static int already_committed(const char *dest, const struct stat *st) {
+    struct stat dest_st;
+    return lstat(dest, &dest_st) == 0 && S_ISREG(dest_st.st_mode) &&
+           dest_st.st_size == st->st_size &&
+           dest_st.st_mtim.tv_sec == st->st_mtim.tv_sec &&
+           dest_st.st_mtim.tv_nsec == st->st_mtim.tv_nsec;
+}
+
+// 复制一个普通文件并保留元数据；sync 为真时提交前 fsync 文件
+static CommitResult copy_and_commit(const char *source, const char *dest, const struct stat *st,
+                                    int overwrite, int resume, int sync) {
+    if (resume && already_committed(dest, st)) {
+        return COMMIT_EXISTING;
+    }
+
+    char *part = part_path(dest);
+    if (!part) return COMMIT_FAILED;
+
+    int src_fd = open(source, O_RDONLY);
+    if (src_fd == -1) {
+        free(part);
+        return COMMIT_FAILED;
+    }
+
+    // 上次中断留下的临时文件直接截断重写
+    int dest_fd = open(part, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (dest_fd == -1) {
+        close(src_fd);
+        free(part);
+        return COMMIT_FAILED;
+    }
+
+    int ok = copy_contents(src_fd, dest_fd, st->st_size);
+    close(src_fd);
+
+    if (ok) {
+        struct timespec times[2] = {st->st_atim, st->st_mtim};
+        if (fchown(dest_fd, st->st_uid, st->st_gid) != 0) {
+            // 非 root 用户无法修改属主，忽略
+        }
+        fchmod(dest_fd, st->st_mode & 07777);
+        futimens(dest_fd, times);
+        if (sync && fsync(dest_fd) != 0) ok = 0;
+    }
+    if (close(dest_fd) != 0) ok = 0;
+
+    if (ok) ok = commit_part(part, dest, overwrite);
+    if (!ok) unlink(part);
+
+    free(part);
+    return ok ? COMMIT_DONE : COMMIT_FAILED;
+}
+
+static void sync_parent_dir(const char *path) {
+    const char *slash = strrchr(path, '/');
+    char *dir = slash ? strndup(path, slash == path ? 1 : (size_t)(slash - path)) : strdup(".");
+    if (!dir) return;
+
+    int fd = open(dir, O_RDONLY | O_DIRECTORY);
+    if (fd != -1) {
+        fsync(fd);
+        close(fd);
+    }
+    free(dir);
+}
+
+int xdev_move_file(const char *source, const char *dest, const MoveConfig *config, int overwrite) {
+    struct stat st;
+    if (lstat(source, &st) != 0) {
+        print_error("无法获取源文件信息");
+        return 0;
+    }
+
+    if (!S_ISREG(st.st_mode)) {
+        print_error("跨文件系统只能移动普通文件和目录");
+        return 0;
+    }
+
+    CommitResult result = copy_and_commit(source, dest, &st, overwrite, config->resume, 1);
+    if (result == COMMIT_FAILED) {
+        print_error("跨文件系统复制失败");
+        return 0;
+    }
+
+    // 目录项持久化之后才删除源文件
+    sync_parent_dir(dest);
+    if (unlink(source) != 0) {
+        print_warning("无法删除源文件");
+    }
+    return 1;
+}
+
+// ---- 目录树移动 ----
+
+static void queue_push(XdevMove *mv, XdevJob *job) {
+    pthread_mutex_lock(&mv->queue_lock);
+    while (mv->count == QUEUE_CAPACITY) {
+        pthread_cond_wait(&mv->not_full, &mv->queue_lock);
+    }
+    mv->slots[mv->tail] = job;
+    mv->tail = (mv->tail + 1) % QUEUE_CAPACITY;
+    mv->count++;
+    pthread_cond_signal(&mv->not_empty);
+    pthread_mutex_unlock(&mv->queue_lock);
+}
+
+static XdevJob *queue_pop(XdevMove *mv) {
+    XdevJob *job = NULL;
+
+    pthread_mutex_lock(&mv->queue_lock);
+    while (mv->count == 0 && !mv->closed) {
+        pthread_cond_wait(&mv->not_empty, &mv->queue_lock);
+    }
+    if (mv->count > 0) {
+        job = mv->slots[mv->head];
+        mv->head = (mv->head + 1) % QUEUE_CAPACITY;
+        mv->count--;
+        pthread_cond_signal(&mv->not_full);
+    }
+    pthread_mutex_unlock(&mv->queue_lock);
+    return job;
+}
+
+static void queue_close(XdevMove *mv) {
+    pthread_mutex_lock(&mv->queue_lock);
+    mv->closed = 1;
+    pthread_cond_broadcast(&mv->not_empty);
+    pthread_mutex_unlock(&mv->queue_lock);
+}
+
+static void record_error(XdevMove *mv, const char *message) {
+    pthread_mutex_lock(&mv->lock);
+    mv->stats->errors++;
+    print_error(message);
+    pthread_mutex_unlock(&mv->lock);
+}
+
+// 记录已提交的源文件，调用者持有 mv->lock；取得 source 的所有权
+static void add_committed(XdevMove *mv, char *source) {
+    if (mv->committed_count == mv->committed_capacity) {
+        size_t capacity = mv->committed_capacity ? mv->committed_capacity * 2 : 256;
+        char **committed = realloc(mv->committed, capacity * sizeof(char *));
+        if (!committed) {
+            // 无法记录时保留源文件，宁可多留一份也不丢数据
+            free(source);
+            return;
+        }
+        mv->committed = committed;
+        mv->committed_capacity = capacity;
+    }
+    mv->committed[mv->committed_count++] = source;
+}
+
+static void add_dir(XdevMove *mv, char *source, char *dest, const struct stat *st) {
+    if (mv->dir_count == mv->dir_capacity) {
+        size_t capacity = mv->dir_capacity ? mv->dir_capacity * 2 : 64;
+        XdevDir *dirs = realloc(mv->dirs, capacity * sizeof(XdevDir));
+        if (!dirs) {
+            free(source);
+            free(dest);
+            return;
+        }
+        mv->dirs = dirs;
+        mv->dir_capacity = capacity;
+    }
+    mv->dirs[mv->dir_count++] = (XdevDir){source, dest, *st};
+}
+
+static void *move_worker(void *arg) {
+    XdevMove *mv = (XdevMove *)arg;
+    XdevJob *job;
+
+    while ((job = queue_pop(mv)) != NULL) {
+        // 目录模式下统一在最后 syncfs，不逐个 fsync
+        CommitResult result = copy_and_commit(job->source, job->dest, &job->st,
+                                              mv->config->force, mv->config->resume, 0);
+
+        pthread_mutex_lock(&mv->lock);
+        if (result == COMMIT_FAILED) {
+            mv->stats->errors++;
+            printf("%s[错误]%s 无法移动: %s\n", COLOR_RED, COLOR_RESET, job->source);
+            free(job->source);
+        } else {
+            mv->stats->files_moved++;
+            mv->stats->bytes_moved += job->st.st_size;
+            if (mv->config->verbose) {
+                printf("%s%s: %s -> %s%s\n", COLOR_GREEN,
+                       result == COMMIT_EXISTING ? "已存在（续传跳过）" : "移动文件",
+                       job->source, job->dest, COLOR_RESET);
+            }
+            add_committed(mv, job->source);
+        }
+        pthread_mutex_unlock(&mv->lock);
+
+        free(job->dest);
+        free(job);
+    }
+    return NULL;
+}
+
+// 符号链接和特殊文件直接在枚举线程中重建
+static int recreate_special(const char *source, const char *dest, const struct stat *st, int resume) {
+    if (S_ISLNK(st->st_mode)) {
+        char target[MAX_FILENAME];
+        ssize_t len = readlink(source, target, sizeof(target) - 1);
+        if (len < 0) return 0;
+        target[len] = '\0';
+
+        if (symlink(target, dest) != 0) {
+            char existing[MAX_FILENAME];
+            ssize_t existing_len;
+            if (!(resume && errno == EEXIST &&
+                  (existing_len = readlink(dest, existing, sizeof(existing) - 1)) == len &&
+                  memcmp(existing, target, len) == 0)) {
+                return 0;
+            }
+        }
+        if (lchown(dest, st->st_uid, st->st_gid) != 0) {
+            // 忽略属主错误
+        }
+    } else if (mknod(dest, st->st_mode, st->st_rdev) != 0 && !(resume && errno == EEXIST)) {
+        return 0;
+    }
+
+    struct timespec times[2] = {st->st_atim, st->st_mtim};
+    utimensat(AT_FDCWD, dest, times, AT_SYMLINK_NOFOLLOW);
+    return 1;
+}
+
+// 枚举源目录：先创建目标目录，再把文件交给工作线程
+static void enumerate_tree(XdevMove *mv, const char *source, const char *dest) {
+    DIR *dir = opendir(source);
+    if (!dir) {
+        record_error(mv, "无法打开源目录");
+        return;
+    }
+
+    int dir_fd = dirfd(dir);
+    struct dirent *entry;
+
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        // 上次中断留下的临时文件不属于源数据
+        if (strncmp(entry->d_name, PART_PREFIX, sizeof(PART_PREFIX) - 1) == 0) {
+            continue;
+        }
+
+        struct stat st;
+        if (fstatat(dir_fd, entry->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+            continue;
+        }
+
+        char *src_path = join_path(source, entry->d_name);
+        char *dest_path = join_path(dest, entry->d_name);
+        if (!src_path || !dest_path) {
+            free(src_path);
+            free(dest_path);
+            record_error(mv, "内存不足");
+            continue;
+        }
+
+        if (S_ISDIR(st.st_mode)) {
+            if (mkdir(dest_path, (st.st_mode & 07777) | S_IRWXU) != 0 && errno != EEXIST) {
+                record_error(mv, "无法创建目标目录");
+                free(src_path);
+                free(dest_path);
+                continue;
+            }
+            enumerate_tree(mv, src_path, dest_path);
+            add_dir(mv, src_path, dest_path, &st);
+        } else if (S_ISREG(st.st_mode)) {
+            XdevJob *job = malloc(sizeof(XdevJob));
+            if (!job) {
+                free(src_path);
+                free(dest_path);
+                record_error(mv, "内存不足");
+                continue;
+            }
+            *job = (XdevJob){src_path, dest_path, st};
+            queue_push(mv, job);
+        } else {
+            int ok = recreate_special(src_path, dest_path, &st, mv->config->resume);
+            pthread_mutex_lock(&mv->lock);
+            if (ok) {
+                add_committed(mv, src_path);
+            } else {
+                mv->stats->errors++;
+                print_error("无法重建特殊文件");
+                free(src_path);
+            }
+            pthread_mutex_unlock(&mv->lock);
+            free(dest_path);
+        }
+    }
+
+    closedir(dir);
+}
+
+int xdev_move_directory(const char *source, const char *dest,
+                        const MoveConfig *config, MoveStats *stats) {
+    XdevMove mv;
+    pthread_t workers[MAX_JOBS];
+    int jobs = config->jobs > 0 ? config->jobs : 1;
+    int started = 0;
+    int errors_before = stats->errors;
+    struct stat root_st;
+
+    if (lstat(source, &root_st) != 0) {
+        print_error("无法获取源目录信息");
+        return 0;
+    }
+    if (mkdir(dest, (root_st.st_mode & 07777) | S_IRWXU) != 0 && errno != EEXIST) {
+        print_error("无法创建目标目录");
+        return 0;
+    }
+
+    memset(&mv, 0, sizeof(mv));
+    mv.config = config;
+    mv.stats = stats;
+    pthread_mutex_init(&mv.lock, NULL);
+    pthread_mutex_init(&mv.queue_lock, NULL);
+    pthread_cond_init(&mv.not_empty, NULL);
+    pthread_cond_init(&mv.not_full, NULL);
+
+    if (jobs > MAX_JOBS) jobs = MAX_JOBS;
+    for (int i = 0; i < jobs; i++) {
+        if (pthread_create(&workers[started], NULL, move_worker, &mv) == 0) {
+            started++;
+        }
+    }
+
+    if (started > 0) {
+        enumerate_tree(&mv, source, dest);
+    } else {
+        record_error(&mv, "无法创建工作线程");
+    }
+    queue_close(&mv);
+    for (int i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+
+    add_dir(&mv, strdup(source), strdup(dest), &root_st);
+
+    // 目录按后序记录，顺序应用元数据即可保证子目录先于父目录
+    for (size_t i = 0; i < mv.dir_count; i++) {
+        XdevDir *d = &mv.dirs[i];
+        struct timespec times[2] = {d->st.st_atim, d->st.st_mtim};
+        if (!d->dest) continue;
+        if (chown(d->dest, d->st.st_uid, d->st.st_gid) != 0) {
+            // 忽略属主错误
+        }
+        chmod(d->dest, d->st.st_mode & 07777);
+        utimensat(AT_FDCWD, d->dest, times, 0);
+    }
+
+    // 所有数据和目录项落盘之后才删除源文件
+    int durable = 0;
+    int root_fd = open(dest, O_RDONLY | O_DIRECTORY);
+    if (root_fd != -1) {
+        durable = syncfs(root_fd) == 0;
+        close(root_fd);
+    }
+
+    if (!durable) {
+        record_error(&mv, "无法确认目标数据已落盘，保留源文件");
+    } else {
+        for (size_t i = 0; i < mv.committed_count; i++) {
+            if (unlink(mv.committed[i]) != 0 && errno != ENOENT) {
+                print_warning("无法删除源文件");
+            }
+        }
+        // 有文件失败时对应的源目录不为空，rmdir 会失败并保留它们，之后可以用 --resume 继续
+        for (size_t i = 0; i < mv.dir_count; i++) {
+            if (mv.dirs[i].source) rmdir(mv.dirs[i].source);
+        }
+    }
+
+    for (size_t i = 0; i < mv.committed_count; i++) {
+        free(mv.committed[i]);
+    }
+    free(mv.committed);
+    for (size_t i = 0; i < mv.dir_count; i++) {
+        free(mv.dirs[i].source);
+        free(mv.dirs[i].dest);
+    }
+    free(mv.dirs);
+
+    pthread_mutex_destroy(&mv.lock);
+    pthread_mutex_destroy(&mv.queue_lock);
+    pthread_cond_destroy(&mv.not_empty);
+    pthread_cond_destroy(&mv.not_full);
+    return stats->errors == errors_before;
+}
@@ -10,6 +10,8 @@
 #include <time.h>
 #include <pwd.h>
 #include <grp.h>
+#include "prm_delete.h"
+#include "prm_trash.h"
 
 // 颜色定义
 #define COLOR_RED     "\033[31m"
@@ -23,7 +25,6 @@
 #define COLOR_BOLD    "\033[1m"
 
 #define MAX_PATH_LENGTH 4096
-#define TRASH_DIR "/tmp/trash"
 
 // 全局选项
 struct options {
@@ -38,9 +39,14 @@ struct options {
     int restore;
     int list_trash;
     int empty_trash;
+    int purge;
+    time_t older_than;
+    off_t max_size;
+    int background;
     char *separator;
     int confirm_all;
     int confirm_none;
+    int jobs;
 };
 
 // 初始化选项
@@ -56,9 +62,16 @@ void init_options(struct options *opts) {
     opts->restore = 0;
     opts->list_trash = 0;
     opts->empty_trash = 0;
+    opts->purge = 0;
+    opts->older_than = 0;
+    opts->max_size = -1;
+    opts->background = 0;
     opts->separator = "==>";
     opts->confirm_all = 0;
     opts->confirm_none = 0;
+    opts->jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (opts->jobs < 1) opts->jobs = 1;
+    if (opts->jobs > MAX_JOBS) opts->jobs = MAX_JOBS;
 }
 
 // 打印帮助信息
@@ -72,14 +85,19 @@ void print_help() {
     printf("  -i, --interactive       交互式删除\n");
     printf("  -v, --verbose           详细输出\n");
     printf("  -t, --trash             移动到回收站\n");
-    printf("  --restore               从回收站恢复\n");
+    printf("  --restore               从回收站恢复到原位置\n");
     printf("  --list-trash            列出回收站内容\n");
     printf("  --empty-trash           清空回收站\n");
+    printf("  --purge                 按时间和大小清理回收站\n");
+    printf("  --older-than=TIME       清理早于 TIME 的条目 (如 30d, 12h)\n");
+    printf("  --max-size=SIZE         清理最旧的条目直到不超过 SIZE (如 10G)\n");
+    printf("  --background            在后台执行清理\n");
     printf("  --color                 启用彩色输出 (默认)\n");
     printf("  --no-color              禁用彩色输出\n");
     printf("  --progress              显示进度条\n");
     printf("  --dry-run               模拟运行，不实际删除\n");
     printf("  --separator=STR         设置文件分隔符 (默认: '==>')\n");
+    printf("  -j, --jobs=N            递归删除的工作线程数 (默认: CPU 核数)\n");
     printf("  -h, --help              显示此帮助信息\n");
     printf("  -V, --version           显示版本信息\n\n");
     printf("示例:\n");
@@ -89,6 +107,9 @@ void print_help() {
     printf("  prm -t file.txt                 # 移动到回收站\n");
     printf("  prm --restore file.txt          # 从回收站恢复\n");
     printf("  prm --list-trash                # 列出回收站内容\n");
+    printf("  prm --purge --older-than=30d    # 清理 30 天前的条目\n\n");
+    printf("设置环境变量 %s 后，移动到回收站时超出该大小会在后台自动清理\n", TRASH_QUOTA_ENV);
+    printf("环境变量 %s（绝对路径）替代默认的回收站目录 %s\n", TRASH_DIR_ENV, TRASH_DIR);
 }
 
 // 打印版本信息
@@ -117,42 +138,6 @@ void show_progress(int current, int total) {
     fflush(stdout);
 }
 
-// 创建回收站目录
-int create_trash_dir() {
-    struct stat st;
-    if (stat(TRASH_DIR, &st) != 0) {
-        if (mkdir(TRASH_DIR, 0755) != 0) {
-            fprintf(stderr, "%s错误: 无法创建回收站目录 '%s': %s%s\n", 
-                    COLOR_RED, TRASH_DIR, strerror(errno), COLOR_RESET);
-            return 1;
-        }
-    }
-    return 0;
-}
-
-// 生成回收站中的文件名
-void generate_trash_name(const char *original_path, char *trash_path, size_t size) {
-    time_t now = time(NULL);
-    char *basename = strrchr(original_path, '/');
-    basename = basename ? basename + 1 : (char*)original_path;
-    
-    snprintf(trash_path, size, "%s/%ld_%s", TRASH_DIR, now, basename);
-}
-
-// 移动到回收站
-int move_to_trash(const char *path) {
-    char trash_path[MAX_PATH_LENGTH];
-    generate_trash_name(path, trash_path, sizeof(trash_path));
-    
-    if (rename(path, trash_path) != 0) {
-        fprintf(stderr, "%s错误: 无法移动到回收站 '%s': %s%s\n", 
-                COLOR_RED, path, strerror(errno), COLOR_RESET);
-        return 1;
-    }
-    
-    return 0;
-}
-
 // 确认删除
 int confirm_delete(const char *path, const struct options *opts) {
     if (opts->confirm_all) return 1;
@@ -202,7 +187,7 @@ int remove_file(const char *path, const struct options *opts) {
     // 移动到回收站或直接删除
     int result;
     if (opts->trash) {
-        result = move_to_trash(path);
+        result = trash_move(path);
         if (result == 0 && opts->verbose) {
             printf("%s%s %s%s %s\n", COLOR_GREEN, opts->separator, path, "已移动到回收站", COLOR_RESET);
         }
@@ -259,7 +244,7 @@ int remove_directory_recursive(const char *path, const struct options *opts) {
     // 删除空目录
     if (result == 0) {
         if (opts->trash) {
-            result = move_to_trash(path);
+            result = trash_move(path);
         } else {
             result = rmdir(path);
             if (result != 0) {
@@ -281,7 +266,8 @@ int remove_directory_recursive(const char *path, const struct options *opts) {
 int process_path(const char *path, const struct options *opts) {
     struct stat st;
     
-    if (stat(path, &st) != 0) {
+    // 不跟随符号链接：指向目录的链接只删除链接本身
+    if (lstat(path, &st) != 0) {
         if (opts->force) {
             return 0; // 忽略不存在的文件
         }
@@ -292,6 +278,24 @@ int process_path(const char *path, const struct options *opts) {
     
     if (S_ISDIR(st.st_mode)) {
         if (opts->recursive) {
+            // 整个目录一次移动到回收站
+            if (opts->trash && !opts->interactive && !opts->dry_run) {
+                int result = trash_move(path);
+                if (result == 0 && opts->verbose) {
+                    printf("%s%s %s%s %s\n", COLOR_GREEN, opts->separator, path, "已移动到回收站", COLOR_RESET);
+                }
+                return result;
+            }
+            // 交互和模拟模式需要逐个处理，其余情况使用并行删除引擎
+            if (!opts->trash && !opts->interactive && !opts->dry_run) {
+                struct delete_stats stats;
+                int result = parallel_remove_tree(path, opts->jobs, opts->verbose, opts->force, &stats);
+                if (opts->verbose) {
+                    printf("%s删除了 %ld 个文件, %ld 个目录%s\n", COLOR_CYAN,
+                           stats.files_removed, stats.dirs_removed, COLOR_RESET);
+                }
+                return result;
+            }
             return remove_directory_recursive(path, opts);
         } else {
             fprintf(stderr, "%s错误: '%s' 是目录，使用 -r 选项递归删除%s\n", 
@@ -303,90 +307,6 @@ int process_path(const char *path, const struct options *opts) {
     }
 }
 
-// 列出回收站内容
-int list_trash() {
-    DIR *dir;
-    struct dirent *entry;
-    struct stat st;
-    char full_path[MAX_PATH_LENGTH];
-    
-    if (create_trash_dir() != 0) {
-        return 1;
-    }
-    
-    dir = opendir(TRASH_DIR);
-    if (!dir) {
-        fprintf(stderr, "%s错误: 无法打开回收站目录%s\n", COLOR_RED, COLOR_RESET);
-        return 1;
-    }
-    
-    printf("%s回收站内容:%s\n", COLOR_CYAN, COLOR_RESET);
-    
-    while ((entry = readdir(dir)) != NULL) {
-        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
-            continue;
-        }
-        
-        snprintf(full_path, sizeof(full_path), "%s/%s", TRASH_DIR, entry->d_name);
-        
-        if (stat(full_path, &st) == 0) {
-            printf("  %s%s%s\n", COLOR_WHITE, entry->d_name, COLOR_RESET);
-        }
-    }
-    
-    closedir(dir);
-    return 0;
-}
-
-// 清空回收站
-int empty_trash(const struct options *opts) {
-    DIR *dir;
-    struct dirent *entry;
-    char full_path[MAX_PATH_LENGTH];
-    int result = 0;
-    
-    if (create_trash_dir() != 0) {
-        return 1;
-    }
-    
-    dir = opendir(TRASH_DIR);
-    if (!dir) {
-        fprintf(stderr, "%s错误: 无法打开回收站目录%s\n", COLOR_RED, COLOR_RESET);
-        return 1;
-    }
-    
-    while ((entry = readdir(dir)) != NULL) {
-        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
-            continue;
-        }
-        
-        snprintf(full_path, sizeof(full_path), "%s/%s", TRASH_DIR, entry->d_name);
-        
-        struct stat st;
-        if (stat(full_path, &st) == 0) {
-            if (S_ISDIR(st.st_mode)) {
-                if (remove_directory_recursive(full_path, opts) != 0) {
-                    result = 1;
-                }
-            } else {
-                if (unlink(full_path) != 0) {
-                    fprintf(stderr, "%s错误: 无法删除 '%s': %s%s\n", 
-                            COLOR_RED, full_path, strerror(errno), COLOR_RESET);
-                    result = 1;
-                }
-            }
-        }
-    }
-    
-    closedir(dir);
-    
-    if (result == 0) {
-        printf("%s回收站已清空%s\n", COLOR_GREEN, COLOR_RESET);
-    }
-    
-    return result;
-}
-
 int main(int argc, char *argv[]) {
     struct options opts;
     int result = 0;
@@ -408,6 +328,11 @@ int main(int argc, char *argv[]) {
         {"progress", no_argument, 0, 6},
         {"dry-run", no_argument, 0, 7},
         {"separator", required_argument, 0, 8},
+        {"purge", no_argument, 0, 9},
+        {"older-than", required_argument, 0, 10},
+        {"max-size", required_argument, 0, 11},
+        {"background", no_argument, 0, 12},
+        {"jobs", required_argument, 0, 'j'},
         {"help", no_argument, 0, 'h'},
         {"version", no_argument, 0, 'V'},
         {0, 0, 0, 0}
@@ -416,7 +341,7 @@ int main(int argc, char *argv[]) {
     int opt;
     int option_index = 0;
     
-    while ((opt = getopt_long(argc, argv, "rfivthV", long_options, &option_index)) != -1) {
+    while ((opt = getopt_long(argc, argv, "rRfivthVj:", long_options, &option_index)) != -1) {
         switch (opt) {
             case 'r':
             case 'R':
@@ -458,6 +383,29 @@ int main(int argc, char *argv[]) {
             case 8: // --separator
                 opts.separator = optarg;
                 break;
+            case 9: // --purge
+                opts.purge = 1;
+                break;
+            case 10: // --older-than
+                if (parse_duration(optarg, &opts.older_than) != 0) {
+                    fprintf(stderr, "%s错误: 无效的时长 '%s'%s\n", COLOR_RED, optarg, COLOR_RESET);
+                    return 1;
+                }
+                break;
+            case 11: // --max-size
+                if (parse_size(optarg, &opts.max_size) != 0) {
+                    fprintf(stderr, "%s错误: 无效的大小 '%s'%s\n", COLOR_RED, optarg, COLOR_RESET);
+                    return 1;
+                }
+                break;
+            case 12: // --background
+                opts.background = 1;
+                break;
+            case 'j':
+                opts.jobs = atoi(optarg);
+                if (opts.jobs < 1) opts.jobs = 1;
+                if (opts.jobs > MAX_JOBS) opts.jobs = MAX_JOBS;
+                break;
             case 'h':
                 print_help();
                 return 0;
@@ -474,11 +422,31 @@ int main(int argc, char *argv[]) {
     
     // 处理特殊选项
     if (opts.list_trash) {
-        return list_trash();
+        return trash_list();
     }
     
     if (opts.empty_trash) {
-        return empty_trash(&opts);
+        return trash_empty(opts.jobs);
+    }
+    
+    if (opts.purge) {
+        if (opts.older_than == 0 && opts.max_size < 0) {
+            fprintf(stderr, "%s错误: --purge 需要 --older-than 或 --max-size%s\n", COLOR_RED, COLOR_RESET);
+            return 1;
+        }
+        if (opts.background) {
+            pid_t pid = fork();
+            if (pid < 0) {
+                fprintf(stderr, "%s错误: 无法创建后台进程: %s%s\n", COLOR_RED, strerror(errno), COLOR_RESET);
+                return 1;
+            }
+            if (pid > 0) {
+                printf("%s后台清理进程: %d%s\n", COLOR_CYAN, (int)pid, COLOR_RESET);
+                return 0;
+            }
+            setsid();
+        }
+        return trash_purge(opts.older_than, opts.max_size, opts.jobs, opts.verbose);
     }
     
     // 检查参数
@@ -490,6 +458,15 @@ int main(int argc, char *argv[]) {
     
     path_count = argc - optind;
     
+    if (opts.restore) {
+        for (int i = optind; i < argc; i++) {
+            if (trash_restore(argv[i], opts.verbose) != 0) {
+                result = 1;
+            }
+        }
+        return result;
+    }
+    
     // 处理文件/目录
     for (int i = optind; i < argc; i++) {
         if (opts.show_progress) {
@@ -505,5 +482,9 @@ int main(int argc, char *argv[]) {
         printf("\n");
     }
     
+    if (opts.trash && !opts.dry_run) {
+        trash_auto_purge(opts.jobs);
+    }
+    
     return result;
 }
@@ -0,0 +1,297 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/resource.h>
+#include "prm_delete.h"
+
+#define COLOR_RED     "\033[31m"
+#define COLOR_GREEN   "\033[32m"
+#define COLOR_RESET   "\033[0m"
+
+#define DENTS_BUFFER_SIZE (64 * 1024)
+
+// getdents64 返回的目录项
+struct linux_dirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+// 待删除的目录。pending 为 1（自身的枚举）加上尚未删除的子目录数，
+// 归零时从父目录中删除自己，并释放对父目录的引用
+struct del_node {
+    struct del_node *parent;
+    char *name;                 // 在父目录中的名字；根节点为完整路径
+    int fd;                     // 枚举和删除子项时使用，子目录全部删除后关闭
+    int pending;
+};
+
+struct delete_ctx {
+    pthread_mutex_t lock;       // 保护栈、pending 计数、统计和输出
+    pthread_cond_t cond;
+    struct del_node **stack;    // 后进先出，深度优先可以限制同时打开的目录 fd
+    size_t stack_count;
+    size_t stack_capacity;
+    int done;
+    int verbose;
+    int force;
+    struct delete_stats *stats;
+};
+
+// 拼出节点的完整路径，只在输出信息时使用
+static void node_path(const struct del_node *node, const char *name, char *buf, size_t size) {
+    const struct del_node *chain[256];
+    int depth = 0;
+    size_t len = 0;
+
+    for (const struct del_node *n = node; n && depth < 256; n = n->parent) {
+        chain[depth++] = n;
+    }
+
+    buf[0] = '\0';
+    for (int i = depth - 1; i >= 0 && len < size; i--) {
+        len += snprintf(buf + len, size - len, "%s%s", i == depth - 1 ? "" : "/", chain[i]->name);
+    }
+    if (name && len < size) {
+        snprintf(buf + len, size - len, "/%s", name);
+    }
+}
+
+static void report_error(struct delete_ctx *ctx, const struct del_node *node,
+                         const char *name, const char *action, int err) {
+    char path[4096];
+
+    node_path(node, name, path, sizeof(path));
+    pthread_mutex_lock(&ctx->lock);
+    ctx->stats->errors++;
+    fprintf(stderr, "%s错误: %s '%s': %s%s\n", COLOR_RED, action, path, strerror(err), COLOR_RESET);
+    pthread_mutex_unlock(&ctx->lock);
+}
+
+static void report_removed(struct delete_ctx *ctx, const struct del_node *node, const char *name) {
+    char path[4096];
+
+    node_path(node, name, path, sizeof(path));
+    pthread_mutex_lock(&ctx->lock);
+    printf("%s==> %s 已删除%s\n", COLOR_GREEN, path, COLOR_RESET);
+    pthread_mutex_unlock(&ctx->lock);
+}
+
+// 调用者持有 ctx->lock
+static int push_node(struct delete_ctx *ctx, struct del_node *node) {
+    if (ctx->stack_count == ctx->stack_capacity) {
+        size_t capacity = ctx->stack_capacity ? ctx->stack_capacity * 2 : 256;
+        struct del_node **stack = realloc(ctx->stack, capacity * sizeof(*stack));
+        if (!stack) return 0;
+        ctx->stack = stack;
+        ctx->stack_capacity = capacity;
+    }
+    ctx->stack[ctx->stack_count++] = node;
+    pthread_cond_signal(&ctx->cond);
+    return 1;
+}
+
+// 释放一个引用；最后一个引用释放时删除目录本身，并沿父链继续释放
+static void release_node(struct delete_ctx *ctx, struct del_node *node) {
+    while (node) {
+        pthread_mutex_lock(&ctx->lock);
+        int remaining = --node->pending;
+        pthread_mutex_unlock(&ctx->lock);
+        if (remaining > 0) return;
+
+        struct del_node *parent = node->parent;
+        int parent_fd = parent ? parent->fd : AT_FDCWD;
+
+        if (node->fd >= 0) close(node->fd);
+        if (unlinkat(parent_fd, node->name, AT_REMOVEDIR) != 0) {
+            if (!(ctx->force && errno == ENOENT)) {
+                report_error(ctx, parent, node->name, "无法删除目录", errno);
+            }
+        } else {
+            pthread_mutex_lock(&ctx->lock);
+            ctx->stats->dirs_removed++;
+            pthread_mutex_unlock(&ctx->lock);
+            if (ctx->verbose) report_removed(ctx, parent, node->name);
+        }
+
+        if (!parent) {
+            pthread_mutex_lock(&ctx->lock);
+            ctx->done = 1;
+            pthread_cond_broadcast(&ctx->cond);
+            pthread_mutex_unlock(&ctx->lock);
+        }
+
+        free(node->name);
+        free(node);
+        node = parent;
+    }
+}
+
+// 枚举一个目录：文件直接 unlinkat，子目录作为新任务入栈
+static void process_node(struct delete_ctx *ctx, struct del_node *node, char *buf) {
+    int parent_fd = node->parent ? node->parent->fd : AT_FDCWD;
+
+    node->fd = openat(parent_fd, node->name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (node->fd < 0) {
+        report_error(ctx, node->parent, node->name, "无法打开目录", errno);
+        // 打开失败的目录不可能删除，释放时 unlinkat 会报告 ENOTEMPTY
+        release_node(ctx, node);
+        return;
+    }
+
+    for (;;) {
+        long nread = syscall(SYS_getdents64, node->fd, buf, DENTS_BUFFER_SIZE);
+        if (nread < 0) {
+            report_error(ctx, node, NULL, "无法读取目录", errno);
+            break;
+        }
+        if (nread == 0) break;
+
+        for (long pos = 0; pos < nread;) {
+            struct linux_dirent64 *d = (struct linux_dirent64 *)(buf + pos);
+            const char *name = d->d_name;
+            unsigned char type = d->d_type;
+            pos += d->d_reclen;
+
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+                continue;
+            }
+
+            // 只有文件系统不提供类型时才需要 stat
+            if (type == DT_UNKNOWN) {
+                struct stat st;
+                if (fstatat(node->fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+                    report_error(ctx, node, name, "无法访问", errno);
+                    continue;
+                }
+                type = S_ISDIR(st.st_mode) ? DT_DIR : DT_REG;
+            }
+
+            if (type == DT_DIR) {
+                struct del_node *child = calloc(1, sizeof(*child));
+                if (!child || !(child->name = strdup(name))) {
+                    free(child);
+                    report_error(ctx, node, name, "内存不足", ENOMEM);
+                    continue;
+                }
+                child->parent = node;
+                child->fd = -1;
+                child->pending = 1;
+
+                pthread_mutex_lock(&ctx->lock);
+                node->pending++;
+                int pushed = push_node(ctx, child);
+                if (!pushed) node->pending--;
+                pthread_mutex_unlock(&ctx->lock);
+                if (!pushed) {
+                    free(child->name);
+                    free(child);
+                    report_error(ctx, node, name, "内存不足", ENOMEM);
+                }
+            } else if (unlinkat(node->fd, name, 0) != 0) {
+                if (!(ctx->force && errno == ENOENT)) {
+                    report_error(ctx, node, name, "无法删除文件", errno);
+                }
+            } else {
+                pthread_mutex_lock(&ctx->lock);
+                ctx->stats->files_removed++;
+                pthread_mutex_unlock(&ctx->lock);
+                if (ctx->verbose) report_removed(ctx, node, name);
+            }
+        }
+    }
+
+    // 释放自身枚举的引用，子目录全部完成后才会真正删除
+    release_node(ctx, node);
+}
+
+static void *delete_worker(void *arg) {
+    struct delete_ctx *ctx = (struct delete_ctx *)arg;
+    char *buf = malloc(DENTS_BUFFER_SIZE);
+    if (!buf) return NULL;
+
+    for (;;) {
+        pthread_mutex_lock(&ctx->lock);
+        while (ctx->stack_count == 0 && !ctx->done) {
+            pthread_cond_wait(&ctx->cond, &ctx->lock);
+        }
+        if (ctx->stack_count == 0) {
+            pthread_mutex_unlock(&ctx->lock);
+            break;
+        }
+        struct del_node *node = ctx->stack[--ctx->stack_count];
+        pthread_mutex_unlock(&ctx->lock);
+
+        process_node(ctx, node, buf);
+    }
+
+    free(buf);
+    return NULL;
+}
+
+// 每个进行中的目录都占用一个 fd，尽量提高软限制
+static void raise_fd_limit(void) {
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+int parallel_remove_tree(const char *path, int jobs, int verbose, int force,
+                         struct delete_stats *stats) {
+    struct delete_ctx ctx;
+    pthread_t workers[MAX_JOBS];
+    int started = 0;
+
+    memset(&ctx, 0, sizeof(ctx));
+    memset(stats, 0, sizeof(*stats));
+    pthread_mutex_init(&ctx.lock, NULL);
+    pthread_cond_init(&ctx.cond, NULL);
+    ctx.verbose = verbose;
+    ctx.force = force;
+    ctx.stats = stats;
+
+    raise_fd_limit();
+
+    struct del_node *root = calloc(1, sizeof(*root));
+    if (!root || !(root->name = strdup(path))) {
+        free(root);
+        return 1;
+    }
+    root->fd = -1;
+    root->pending = 1;
+    push_node(&ctx, root);
+
+    if (jobs < 1) jobs = 1;
+    if (jobs > MAX_JOBS) jobs = MAX_JOBS;
+    for (int i = 0; i < jobs; i++) {
+        if (pthread_create(&workers[started], NULL, delete_worker, &ctx) == 0) {
+            started++;
+        }
+    }
+
+    // 无法创建线程时在当前线程完成删除
+    if (started == 0) {
+        delete_worker(&ctx);
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+
+    free(ctx.stack);
+    pthread_mutex_destroy(&ctx.lock);
+    pthread_cond_destroy(&ctx.cond);
+    return stats->errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,18 @@
+#ifndef PRM_DELETE_H
+#define PRM_DELETE_H
+
+#define MAX_JOBS 64
+
+// 删除统计
+struct delete_stats {
+    long files_removed;
+    long dirs_removed;
+    long errors;
+};
+
+// 并行删除目录树：基于目录 fd 的 openat/unlinkat，getdents64 的 d_type 省去 stat，
+// 兄弟子树由 jobs 个工作线程并行删除。成功返回 0
+int parallel_remove_tree(const char *path, int jobs, int verbose, int force,
+                         struct delete_stats *stats);
+
+#endif // PRM_DELETE_H
@@ -0,0 +1,919 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <limits.h>
+#include <dirent.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include "../include/common.h"
+#include "prm_delete.h"
+#include "prm_trash.h"
+
+#define INDEX_LOCK_RETRIES 100     // 索引被并发替换时重新打开的次数上限
+#define SIZE_UNKNOWN ((off_t)-1)    // 目录移入回收站时不计算大小，第一次需要时再计算
+
+// 索引中的一条记录
+typedef struct {
+    char *trash_dir;
+    char *name;             // 在回收站目录中的名字
+    char *original;         // 原始绝对路径
+    time_t deleted;
+    off_t size;             // 目录为 SIZE_UNKNOWN，直到计算后追加 S 记录
+    int live;
+} trash_item;
+
+typedef struct {
+    trash_item *items;
+    size_t count;
+    size_t capacity;
+} trash_items;
+
+// ---- 路径工具 ----
+
+// 把路径拆成父目录的绝对路径和最后一级名字，不跟随最后一级的符号链接
+static int split_absolute(const char *path, char **parent_abs, char **base) {
+    char *copy = strdup(path);
+    if (!copy) return -1;
+
+    size_t len = strlen(copy);
+    while (len > 1 && copy[len - 1] == '/') copy[--len] = '\0';
+
+    char *slash = strrchr(copy, '/');
+    const char *parent = ".";
+    const char *name = copy;
+    if (slash == copy) {
+        parent = "/";
+        name = copy + 1;
+    } else if (slash) {
+        *slash = '\0';
+        parent = copy;
+        name = slash + 1;
+    }
+
+    char resolved[PATH_MAX];
+    if (name[0] == '\0' || !realpath(parent, resolved)) {
+        free(copy);
+        return -1;
+    }
+
+    *parent_abs = strdup(resolved);
+    *base = strdup(name);
+    free(copy);
+    return (*parent_abs && *base) ? 0 : -1;
+}
+
+// 从目录向上查找，直到设备号变化，得到挂载点
+static void find_mount_root(const char *dir, dev_t dev, char *root, size_t size) {
+    snprintf(root, size, "%s", dir);
+
+    while (strcmp(root, "/") != 0) {
+        char parent[PATH_MAX];
+        struct stat st;
+        char *slash;
+
+        snprintf(parent, sizeof(parent), "%s", root);
+        slash = strrchr(parent, '/');
+        if (slash == parent) parent[1] = '\0';
+        else if (slash) *slash = '\0';
+
+        if (stat(parent, &st) != 0 || st.st_dev != dev) break;
+        snprintf(root, size, "%s", parent);
+    }
+}
+
+// 主回收站目录，PRM_TRASH_DIR 可以把它（连同登记表）换到别处
+static const char *main_trash_dir(void) {
+    const char *dir = getenv(TRASH_DIR_ENV);
+    return dir && dir[0] == '/' ? dir : TRASH_DIR;
+}
+
+static int registry_path(char *out, size_t size) {
+    int len = snprintf(out, size, "%s/%s", main_trash_dir(), TRASH_REGISTRY_NAME);
+    return len < 0 || (size_t)len >= size ? -1 : 0;
+}
+
+static int ensure_dir(const char *path, mode_t mode) {
+    if (mkdir(path, mode) == 0 || errno == EEXIST) return 0;
+    return -1;
+}
+
+// 选择与 parent_dev 同一文件系统的回收站目录，使移动始终是一次 rename
+static int trash_dir_for(const char *parent_abs, dev_t parent_dev, char *out, size_t size) {
+    const char *main_dir = main_trash_dir();
+    struct stat st;
+
+    if (ensure_dir(main_dir, 0755) == 0 && stat(main_dir, &st) == 0 && st.st_dev == parent_dev) {
+        snprintf(out, size, "%s", main_dir);
+        return 0;
+    }
+
+    char root[PATH_MAX];
+    find_mount_root(parent_abs, parent_dev, root, sizeof(root));
+    int len = snprintf(out, size, "%s%s%s%u", root, strcmp(root, "/") == 0 ? "" : "/",
+                       TRASH_MOUNT_PREFIX, (unsigned)getuid());
+
+    if (len < 0 || (size_t)len >= size || ensure_dir(out, 0700) != 0 || stat(out, &st) != 0 || st.st_dev != parent_dev) {
+        // 无法在挂载点下创建回收站（如普通用户对挂载点根目录没有写权限）时退回主回收站，
+        // 之后由 trash_move 跨文件系统复制
+        if (ensure_dir(main_dir, 0755) != 0) return -1;
+        snprintf(out, size, "%s", main_dir);
+    }
+    return 0;
+}
+
+// 目录大小：基于目录 fd 遍历子树，只读取元数据
+static off_t tree_size(int parent_fd, const char *name) {
+    int fd = openat(parent_fd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0) return 0;
+
+    DIR *dir = fdopendir(fd);
+    if (!dir) {
+        close(fd);
+        return 0;
+    }
+
+    off_t total = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        struct stat st;
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+        if (fstatat(fd, entry->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0) continue;
+        total += S_ISDIR(st.st_mode) ? tree_size(fd, entry->d_name) : st.st_size;
+    }
+    closedir(dir);
+    return total;
+}
+
+// 跨文件系统移动时复制目录树：普通文件、目录、符号链接和其他特殊文件，保留权限和
+// 修改时间。目标已存在时失败（errno 为 EEXIST）。成功返回 0
+static int copy_tree(int src_dir, const char *src_name, int dst_dir, const char *dst_name) {
+    struct stat st;
+    if (fstatat(src_dir, src_name, &st, AT_SYMLINK_NOFOLLOW) != 0) return -1;
+
+    int result = 0;
+    if (S_ISLNK(st.st_mode)) {
+        char target[PATH_MAX];
+        ssize_t len = readlinkat(src_dir, src_name, target, sizeof(target) - 1);
+        if (len < 0) return -1;
+        target[len] = '\0';
+        return symlinkat(target, dst_dir, dst_name);
+    } else if (S_ISDIR(st.st_mode)) {
+        if (mkdirat(dst_dir, dst_name, 0700) != 0) return -1;
+        int in_fd = openat(src_dir, src_name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        int out_fd = openat(dst_dir, dst_name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        DIR *dir = in_fd >= 0 ? fdopendir(in_fd) : NULL;
+        if (!dir || out_fd < 0) {
+            if (dir) closedir(dir);
+            else if (in_fd >= 0) close(in_fd);
+            if (out_fd >= 0) close(out_fd);
+            return -1;
+        }
+        struct dirent *entry;
+        while (result == 0 && (entry = readdir(dir)) != NULL) {
+            if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+            result = copy_tree(in_fd, entry->d_name, out_fd, entry->d_name);
+        }
+        closedir(dir);
+        close(out_fd);
+    } else if (S_ISREG(st.st_mode)) {
+        int in_fd = openat(src_dir, src_name, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+        if (in_fd < 0) return -1;
+        int out_fd = openat(dst_dir, dst_name, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+        if (out_fd < 0) {
+            close(in_fd);
+            return -1;
+        }
+        char buffer[65536];
+        ssize_t n;
+        while ((n = read(in_fd, buffer, sizeof(buffer))) > 0 || (n < 0 && errno == EINTR)) {
+            for (ssize_t done = 0; n > 0 && done < n;) {
+                ssize_t written = write(out_fd, buffer + done, (size_t)(n - done));
+                if (written < 0 && errno == EINTR) continue;
+                if (written < 0) {
+                    n = -1;
+                    break;
+                }
+                done += written;
+            }
+            if (n < 0) break;
+        }
+        if (n < 0) result = -1;
+        close(in_fd);
+        if (close(out_fd) != 0) result = -1;
+    } else if (mknodat(dst_dir, dst_name, st.st_mode, st.st_rdev) != 0) {
+        return -1;
+    }
+
+    fchmodat(dst_dir, dst_name, st.st_mode & 07777, 0);
+    struct timespec times[2] = {st.st_atim, st.st_mtim};
+    utimensat(dst_dir, dst_name, times, AT_SYMLINK_NOFOLLOW);
+    return result;
+}
+
+// rename 遇到 EXDEV 时复制后删除源。复制失败时清除不完整的目标，errno 为复制的错误
+static int move_across(const char *source, const char *target) {
+    struct stat st;
+    struct delete_stats stats;
+    if (copy_tree(AT_FDCWD, source, AT_FDCWD, target) != 0) {
+        int saved = errno;
+        if (saved != EEXIST && lstat(target, &st) == 0) {
+            if (S_ISDIR(st.st_mode)) parallel_remove_tree(target, 1, 0, 1, &stats);
+            else unlink(target);
+        }
+        errno = saved;
+        return -1;
+    }
+    if (lstat(source, &st) != 0) return -1;
+    if (S_ISDIR(st.st_mode)) return parallel_remove_tree(source, 1, 0, 1, &stats) == 0 ? 0 : -1;
+    return unlink(source);
+}
+
+// ---- 索引读写 ----
+
+// 路径中的 %、制表符和换行需要转义，保证一条记录占一行
+static void write_escaped(FILE *fp, const char *text) {
+    for (; *text; text++) {
+        if (*text == '%' || *text == '\t' || *text == '\n') {
+            fprintf(fp, "%%%02X", (unsigned char)*text);
+        } else {
+            fputc(*text, fp);
+        }
+    }
+}
+
+static char *unescape(const char *text) {
+    char *out = malloc(strlen(text) + 1);
+    char *p = out;
+    if (!out) return NULL;
+
+    while (*text) {
+        unsigned int value;
+        if (text[0] == '%' && text[1] && text[2] && sscanf(text + 1, "%2x", &value) == 1) {
+            *p++ = (char)value;
+            text += 3;
+        } else {
+            *p++ = *text++;
+        }
+    }
+    *p = '\0';
+    return out;
+}
+
+// 打开并独占锁定索引。压缩索引会替换文件，所以加锁后确认锁住的仍是当前文件，
+// 不是时重新打开（有次数上限）。flock 被信号打断时重试，其他错误（如 NFS 上的
+// ENOLCK）直接返回 -1
+static int open_index_locked(const char *trash_dir) {
+    char path[PATH_MAX];
+    int len = snprintf(path, sizeof(path), "%s/%s", trash_dir, TRASH_INDEX);
+    if (len < 0 || (size_t)len >= sizeof(path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+
+    for (int attempt = 0; attempt < INDEX_LOCK_RETRIES; attempt++) {
+        struct stat fd_st, path_st;
+        int fd = open(path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0600);
+        if (fd < 0) return -1;
+
+        int ret;
+        while ((ret = flock(fd, LOCK_EX)) != 0 && errno == EINTR) {
+        }
+        if (ret != 0 || fstat(fd, &fd_st) != 0) {
+            int saved = errno;
+            close(fd);
+            errno = saved;
+            return -1;
+        }
+        int stat_ret = stat(path, &path_st);
+        if (stat_ret == 0 && fd_st.st_dev == path_st.st_dev && fd_st.st_ino == path_st.st_ino) {
+            return fd;
+        }
+
+        // 索引在加锁期间被替换或删除时重试，其他错误直接返回
+        int saved = errno;
+        close(fd);
+        if (stat_ret != 0 && saved != ENOENT) {
+            errno = saved;
+            return -1;
+        }
+    }
+    errno = EAGAIN;
+    return -1;
+}
+
+static int append_add_record(const char *trash_dir, const trash_item *item) {
+    int fd = open_index_locked(trash_dir);
+    if (fd < 0) return -1;
+
+    FILE *fp = fdopen(fd, "a");
+    if (!fp) {
+        close(fd);
+        return -1;
+    }
+    fprintf(fp, "A\t%ld\t%lld\t", (long)item->deleted, (long long)item->size);
+    write_escaped(fp, item->name);
+    fputc('\t', fp);
+    write_escaped(fp, item->original);
+    fputc('\n', fp);
+    return fclose(fp) == 0 ? 0 : -1;
+}
+
+static int append_remove_record(const char *trash_dir, const char *name) {
+    int fd = open_index_locked(trash_dir);
+    if (fd < 0) return -1;
+
+    FILE *fp = fdopen(fd, "a");
+    if (!fp) {
+        close(fd);
+        return -1;
+    }
+    fputs("D\t", fp);
+    write_escaped(fp, name);
+    fputc('\n', fp);
+    return fclose(fp) == 0 ? 0 : -1;
+}
+
+static int append_size_record(const char *trash_dir, const char *name, off_t size) {
+    int fd = open_index_locked(trash_dir);
+    if (fd < 0) return -1;
+
+    FILE *fp = fdopen(fd, "a");
+    if (!fp) {
+        close(fd);
+        return -1;
+    }
+    fprintf(fp, "S\t%lld\t", (long long)size);
+    write_escaped(fp, name);
+    fputc('\n', fp);
+    return fclose(fp) == 0 ? 0 : -1;
+}
+
+static trash_item *items_add(trash_items *list) {
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 64;
+        trash_item *items = realloc(list->items, capacity * sizeof(trash_item));
+        if (!items) return NULL;
+        list->items = items;
+        list->capacity = capacity;
+    }
+    trash_item *item = &list->items[list->count++];
+    memset(item, 0, sizeof(*item));
+    return item;
+}
+
+static void items_free(trash_items *list) {
+    for (size_t i = 0; i < list->count; i++) {
+        free(list->items[i].trash_dir);
+        free(list->items[i].name);
+        free(list->items[i].original);
+    }
+    free(list->items);
+    list->items = NULL;
+    list->count = list->capacity = 0;
+}
+
+// 从后往前找最近一条同名的存活条目
+static trash_item *find_live(trash_items *list, size_t first, const char *name) {
+    for (size_t i = list->count; i > first; i--) {
+        trash_item *item = &list->items[i - 1];
+        if (item->live && strcmp(item->name, name) == 0) return item;
+    }
+    return NULL;
+}
+
+// 读取一个回收站目录的索引，D 记录把同名的 A 记录标记为已删除，S 记录补上大小
+static void load_index(const char *trash_dir, trash_items *list) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", trash_dir, TRASH_INDEX);
+
+    FILE *fp = fopen(path, "r");
+    if (!fp) return;
+
+    size_t first = list->count;
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t len;
+
+    while ((len = getline(&line, &cap, fp)) > 0) {
+        if (line[len - 1] == '\n') line[--len] = '\0';
+
+        if (line[0] == 'A' && line[1] == '\t') {
+            char *fields[5];
+            char *save = NULL;
+            int n = 0;
+            for (char *tok = strtok_r(line, "\t", &save); tok && n < 5; tok = strtok_r(NULL, "\t", &save)) {
+                fields[n++] = tok;
+            }
+            if (n != 5) continue;
+
+            trash_item *item = items_add(list);
+            if (!item) break;
+            item->trash_dir = strdup(trash_dir);
+            item->deleted = (time_t)atol(fields[1]);
+            item->size = (off_t)atoll(fields[2]);
+            item->name = unescape(fields[3]);
+            item->original = unescape(fields[4]);
+            item->live = 1;
+        } else if (line[0] == 'D' && line[1] == '\t') {
+            char *name = unescape(line + 2);
+            if (!name) continue;
+            // 同名条目只会在旧条目删除后重新出现，所以从后往前匹配最近的一条
+            trash_item *item = find_live(list, first, name);
+            if (item) item->live = 0;
+            free(name);
+        } else if (line[0] == 'S' && line[1] == '\t') {
+            char *tab = strchr(line + 2, '\t');
+            char *name = tab ? unescape(tab + 1) : NULL;
+            if (!name) continue;
+            trash_item *item = find_live(list, first, name);
+            if (item) item->size = (off_t)atoll(line + 2);
+            free(name);
+        }
+    }
+    free(line);
+    fclose(fp);
+}
+
+// 读取登记的全部回收站目录
+static size_t load_trash_dirs(char ***dirs_out) {
+    char **dirs = NULL;
+    size_t count = 0;
+    char registry[PATH_MAX];
+    FILE *fp = registry_path(registry, sizeof(registry)) == 0 ? fopen(registry, "r") : NULL;
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t len;
+
+    dirs = malloc(sizeof(char *));
+    if (!dirs) {
+        if (fp) fclose(fp);
+        *dirs_out = NULL;
+        return 0;
+    }
+    dirs[count++] = strdup(main_trash_dir());
+
+    while (fp && (len = getline(&line, &cap, fp)) > 0) {
+        if (line[len - 1] == '\n') line[--len] = '\0';
+        if (len == 0) continue;
+
+        int seen = 0;
+        for (size_t i = 0; i < count && !seen; i++) {
+            seen = strcmp(dirs[i], line) == 0;
+        }
+        if (seen) continue;
+
+        char **grown = realloc(dirs, (count + 1) * sizeof(char *));
+        if (!grown) break;
+        dirs = grown;
+        dirs[count++] = strdup(line);
+    }
+
+    free(line);
+    if (fp) fclose(fp);
+    *dirs_out = dirs;
+    return count;
+}
+
+static void free_trash_dirs(char **dirs, size_t count) {
+    for (size_t i = 0; i < count; i++) free(dirs[i]);
+    free(dirs);
+}
+
+static void register_trash_dir(const char *trash_dir) {
+    char **dirs;
+    size_t count = load_trash_dirs(&dirs);
+    int seen = 0;
+
+    for (size_t i = 0; i < count && !seen; i++) {
+        seen = strcmp(dirs[i], trash_dir) == 0;
+    }
+    free_trash_dirs(dirs, count);
+    if (seen) return;
+
+    char registry[PATH_MAX];
+    if (registry_path(registry, sizeof(registry)) != 0) return;
+    int fd = open(registry, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) return;
+    flock(fd, LOCK_EX);
+    dprintf(fd, "%s\n", trash_dir);
+    close(fd);
+}
+
+static void load_all(trash_items *list) {
+    char **dirs;
+    size_t count = load_trash_dirs(&dirs);
+
+    for (size_t i = 0; i < count; i++) {
+        if (dirs[i]) load_index(dirs[i], list);
+    }
+    free_trash_dirs(dirs, count);
+}
+
+// 压缩索引：在锁内重新读取，只保留仍然存在的条目，写入临时文件后替换
+static int compact_index(const char *trash_dir) {
+    int lock_fd = open_index_locked(trash_dir);
+    if (lock_fd < 0) return -1;
+
+    trash_items list = {0};
+    load_index(trash_dir, &list);
+
+    char path[PATH_MAX], tmp[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", trash_dir, TRASH_INDEX);
+    snprintf(tmp, sizeof(tmp), "%s/%s.tmp", trash_dir, TRASH_INDEX);
+
+    int result = -1;
+    FILE *fp = fopen(tmp, "w");
+    if (fp) {
+        for (size_t i = 0; i < list.count; i++) {
+            const trash_item *item = &list.items[i];
+            if (!item->live) continue;
+            fprintf(fp, "A\t%ld\t%lld\t", (long)item->deleted, (long long)item->size);
+            write_escaped(fp, item->name);
+            fputc('\t', fp);
+            write_escaped(fp, item->original);
+            fputc('\n', fp);
+        }
+        if (fclose(fp) == 0 && rename(tmp, path) == 0) result = 0;
+        else unlink(tmp);
+    }
+
+    items_free(&list);
+    close(lock_fd);
+    return result;
+}
+
+// 条目的大小，未知时遍历计算并追加 S 记录，之后的读取直接得到结果
+static off_t resolve_size(trash_item *item) {
+    if (item->size != SIZE_UNKNOWN) return item->size;
+
+    char path[PATH_MAX];
+    struct stat st;
+    int len = snprintf(path, sizeof(path), "%s/%s", item->trash_dir, item->name);
+    if (len < 0 || (size_t)len >= sizeof(path) || lstat(path, &st) != 0) {
+        return 0;
+    }
+    item->size = S_ISDIR(st.st_mode) ? tree_size(AT_FDCWD, path) : st.st_size;
+    append_size_record(item->trash_dir, item->name, item->size);
+    return item->size;
+}
+
+// 从回收站中彻底删除一个条目
+static int remove_item(const trash_item *item, int jobs) {
+    char path[PATH_MAX];
+    struct stat st;
+
+    snprintf(path, sizeof(path), "%s/%s", item->trash_dir, item->name);
+    if (lstat(path, &st) != 0) {
+        return errno == ENOENT ? 0 : -1;
+    }
+
+    if (S_ISDIR(st.st_mode)) {
+        struct delete_stats stats;
+        return parallel_remove_tree(path, jobs, 0, 1, &stats) == 0 ? 0 : -1;
+    }
+    return unlink(path) == 0 ? 0 : -1;
+}
+
+// ---- 对外接口 ----
+
+int trash_move(const char *path) {
+    struct stat st, parent_st;
+    char *parent_abs = NULL, *base = NULL;
+    char trash_dir[PATH_MAX];
+    int result = 1;
+
+    if (lstat(path, &st) != 0) {
+        fprintf(stderr, "%s错误: 无法访问 '%s': %s%s\n", COLOR_RED, path, strerror(errno), COLOR_RESET);
+        return 1;
+    }
+    if (split_absolute(path, &parent_abs, &base) != 0 || stat(parent_abs, &parent_st) != 0) {
+        fprintf(stderr, "%s错误: 无法解析路径 '%s'%s\n", COLOR_RED, path, COLOR_RESET);
+        goto out;
+    }
+    if (trash_dir_for(parent_abs, parent_st.st_dev, trash_dir, sizeof(trash_dir)) != 0) {
+        fprintf(stderr, "%s错误: 无法在 '%s' 所在文件系统上创建回收站%s\n", COLOR_RED, path, COLOR_RESET);
+        goto out;
+    }
+
+    trash_item item = {0};
+    char original[PATH_MAX];
+    char name[NAME_MAX + 1];
+    snprintf(original, sizeof(original), "%s%s%s", parent_abs,
+             strcmp(parent_abs, "/") == 0 ? "" : "/", base);
+    item.original = original;
+    item.deleted = time(NULL);
+    item.size = S_ISDIR(st.st_mode) ? SIZE_UNKNOWN : st.st_size;
+
+    // 名字带时间和进程号，冲突时递增序号；RENAME_NOREPLACE 保证不会覆盖已有条目
+    int moved = 0;
+    for (int seq = 0; seq < 1000 && !moved; seq++) {
+        char target[PATH_MAX];
+        snprintf(name, sizeof(name), "%ld_%d_%d_%.200s", (long)item.deleted, (int)getpid(), seq, base);
+        int len = snprintf(target, sizeof(target), "%s/%s", trash_dir, name);
+        if (len < 0 || (size_t)len >= sizeof(target)) {
+            errno = ENAMETOOLONG;
+            break;
+        }
+
+        int ret;
+#ifdef RENAME_NOREPLACE
+        ret = renameat2(AT_FDCWD, path, AT_FDCWD, target, RENAME_NOREPLACE);
+        if (ret != 0 && (errno == ENOSYS || errno == EINVAL))
+#endif
+        {
+            struct stat existing;
+            if (lstat(target, &existing) == 0) continue;
+            ret = rename(path, target);
+        }
+        // 退回主回收站时跨文件系统，复制后删除
+        if (ret != 0 && errno == EXDEV) ret = move_across(path, target);
+        if (ret == 0) moved = 1;
+        else if (errno != EEXIST) break;
+    }
+
+    if (!moved) {
+        fprintf(stderr, "%s错误: 无法移动到回收站 '%s': %s%s\n", COLOR_RED, path, strerror(errno), COLOR_RESET);
+        goto out;
+    }
+
+    item.name = name;
+    register_trash_dir(trash_dir);
+    if (append_add_record(trash_dir, &item) != 0) {
+        fprintf(stderr, "%s警告: 无法写入回收站索引 '%s'%s\n", COLOR_YELLOW, trash_dir, COLOR_RESET);
+    }
+    result = 0;
+
+out:
+    free(parent_abs);
+    free(base);
+    return result;
+}
+
+static int compare_by_time(const void *a, const void *b) {
+    const trash_item *item_a = (const trash_item *)a;
+    const trash_item *item_b = (const trash_item *)b;
+    if (item_a->deleted != item_b->deleted) return item_a->deleted < item_b->deleted ? -1 : 1;
+    return strcmp(item_a->name, item_b->name);
+}
+
+int trash_list(void) {
+    trash_items list = {0};
+    off_t total = 0;
+    size_t live = 0;
+
+    load_all(&list);
+    qsort(list.items, list.count, sizeof(trash_item), compare_by_time);
+
+    printf("%s回收站内容:%s\n", COLOR_CYAN, COLOR_RESET);
+    for (size_t i = 0; i < list.count; i++) {
+        const trash_item *item = &list.items[i];
+        if (!item->live) continue;
+
+        printf("  %s%s%s", COLOR_WHITE, item->original, COLOR_RESET);
+        printf("  %s%s%s", COLOR_YELLOW, format_time(item->deleted), COLOR_RESET);
+        off_t size = resolve_size(&list.items[i]);
+        printf("  %s%s%s\n", COLOR_MAGENTA, format_size(size), COLOR_RESET);
+        total += size;
+        live++;
+    }
+    printf("%s共 %zu 项, %s%s\n", COLOR_CYAN, live, format_size(total), COLOR_RESET);
+
+    items_free(&list);
+    return 0;
+}
+
+// 清空一个回收站目录：从读取索引到截断索引一直持有锁，期间追加的记录不会丢失。
+// legacy 时同时清除旧版本直接放入目录而没有索引的条目。成功返回 0
+static int empty_trash_dir(const char *trash_dir, int legacy, int jobs) {
+    int fd = open_index_locked(trash_dir);
+    if (fd < 0) return errno == ENOENT ? 0 : -1;
+
+    trash_items list = {0};
+    int result = 0;
+    load_index(trash_dir, &list);
+    for (size_t i = 0; i < list.count; i++) {
+        if (list.items[i].live && remove_item(&list.items[i], jobs) != 0) {
+            fprintf(stderr, "%s错误: 无法删除 '%s/%s'%s\n", COLOR_RED,
+                    list.items[i].trash_dir, list.items[i].name, COLOR_RESET);
+            result = -1;
+        }
+    }
+    items_free(&list);
+
+    DIR *dir = legacy ? opendir(trash_dir) : NULL;
+    if (dir) {
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != NULL) {
+            const char *name = entry->d_name;
+            if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0 ||
+                strcmp(name, TRASH_INDEX) == 0 || strcmp(name, TRASH_REGISTRY_NAME) == 0) {
+                continue;
+            }
+            trash_item stale = {0};
+            stale.trash_dir = (char *)trash_dir;
+            stale.name = (char *)name;
+            if (remove_item(&stale, jobs) != 0) result = -1;
+        }
+        closedir(dir);
+    }
+
+    if (ftruncate(fd, 0) != 0) result = -1;
+    close(fd);
+    return result;
+}
+
+int trash_empty(int jobs) {
+    int result = 0;
+    char **dirs;
+    size_t count = load_trash_dirs(&dirs);
+
+    for (size_t i = 0; i < count; i++) {
+        if (dirs[i] && empty_trash_dir(dirs[i], strcmp(dirs[i], main_trash_dir()) == 0, jobs) != 0) {
+            result = 1;
+        }
+    }
+    free_trash_dirs(dirs, count);
+
+    if (result == 0) {
+        printf("%s回收站已清空%s\n", COLOR_GREEN, COLOR_RESET);
+    }
+    return result;
+}
+
+int trash_restore(const char *path, int verbose) {
+    trash_items list = {0};
+    char *parent_abs = NULL, *base = NULL;
+    char original[PATH_MAX] = "";
+    const trash_item *found = NULL;
+    int result = 1;
+
+    if (split_absolute(path, &parent_abs, &base) == 0) {
+        snprintf(original, sizeof(original), "%s%s%s", parent_abs,
+                 strcmp(parent_abs, "/") == 0 ? "" : "/", base);
+    }
+
+    // 优先按原始路径匹配最近删除的条目，其次按回收站中的名字匹配
+    load_all(&list);
+    for (size_t i = 0; i < list.count; i++) {
+        const trash_item *item = &list.items[i];
+        if (!item->live) continue;
+        if ((original[0] && strcmp(item->original, original) == 0) || strcmp(item->name, path) == 0) {
+            if (!found || item->deleted >= found->deleted) found = item;
+        }
+    }
+
+    if (!found) {
+        fprintf(stderr, "%s错误: 回收站中没有 '%s'%s\n", COLOR_RED, path, COLOR_RESET);
+        goto out;
+    }
+
+    char source[PATH_MAX];
+    struct stat st;
+    snprintf(source, sizeof(source), "%s/%s", found->trash_dir, found->name);
+    if (lstat(found->original, &st) == 0) {
+        fprintf(stderr, "%s错误: '%s' 已存在%s\n", COLOR_RED, found->original, COLOR_RESET);
+        goto out;
+    }
+    if (rename(source, found->original) != 0 && (errno != EXDEV || move_across(source, found->original) != 0)) {
+        fprintf(stderr, "%s错误: 无法恢复 '%s': %s%s\n", COLOR_RED, found->original, strerror(errno), COLOR_RESET);
+        goto out;
+    }
+
+    append_remove_record(found->trash_dir, found->name);
+    if (verbose) {
+        printf("%s==> %s 已恢复%s\n", COLOR_GREEN, found->original, COLOR_RESET);
+    }
+    result = 0;
+
+out:
+    free(parent_abs);
+    free(base);
+    items_free(&list);
+    return result;
+}
+
+int trash_purge(time_t older_than, off_t max_size, int jobs, int verbose) {
+    trash_items list = {0};
+    time_t cutoff = older_than > 0 ? time(NULL) - older_than : 0;
+    off_t total = 0, freed = 0;
+    size_t purged = 0;
+    int result = 0;
+
+    load_all(&list);
+    qsort(list.items, list.count, sizeof(trash_item), compare_by_time);
+
+    for (size_t i = 0; i < list.count; i++) {
+        if (list.items[i].live) total += resolve_size(&list.items[i]);
+    }
+
+    // 从最旧的条目开始：超过时限的全部删除，然后删除到总大小不超过配额为止
+    for (size_t i = 0; i < list.count; i++) {
+        trash_item *item = &list.items[i];
+        if (!item->live) continue;
+
+        int expired = older_than > 0 && item->deleted < cutoff;
+        int over_quota = max_size >= 0 && total > max_size;
+        if (!expired && !over_quota) {
+            if (older_than > 0 || max_size >= 0) continue;
+            break;
+        }
+
+        if (remove_item(item, jobs) != 0) {
+            fprintf(stderr, "%s错误: 无法删除 '%s/%s'%s\n", COLOR_RED, item->trash_dir, item->name, COLOR_RESET);
+            result = 1;
+            continue;
+        }
+        append_remove_record(item->trash_dir, item->name);
+        item->live = 0;
+        total -= item->size;
+        freed += item->size;
+        purged++;
+
+        if (verbose) {
+            printf("%s==> %s 已清理%s\n", COLOR_GREEN, item->original, COLOR_RESET);
+        }
+    }
+
+    // 清理后压缩涉及的索引
+    char **dirs;
+    size_t count = load_trash_dirs(&dirs);
+    for (size_t i = 0; i < count; i++) {
+        if (dirs[i]) compact_index(dirs[i]);
+    }
+    free_trash_dirs(dirs, count);
+
+    printf("%s清理了 %zu 项, 释放 %s%s\n", COLOR_CYAN, purged, format_size(freed), COLOR_RESET);
+    items_free(&list);
+    return result;
+}
+
+void trash_auto_purge(int jobs) {
+    const char *quota_text = getenv(TRASH_QUOTA_ENV);
+    off_t quota;
+
+    if (!quota_text || parse_size(quota_text, &quota) != 0) return;
+
+    // 大小未知的条目交给后台进程计算，这里不遍历目录
+    trash_items list = {0};
+    off_t total = 0;
+    int unknown = 0;
+    load_all(&list);
+    for (size_t i = 0; i < list.count; i++) {
+        if (!list.items[i].live) continue;
+        if (list.items[i].size == SIZE_UNKNOWN) unknown = 1;
+        else total += list.items[i].size;
+    }
+    items_free(&list);
+    if (total <= quota && !unknown) return;
+
+    // 在脱离终端的子进程中清理，不阻塞当前的删除操作
+    pid_t pid = fork();
+    if (pid == 0) {
+        setsid();
+        int null_fd = open("/dev/null", O_RDWR);
+        if (null_fd >= 0) {
+            dup2(null_fd, STDOUT_FILENO);
+            dup2(null_fd, STDERR_FILENO);
+            close(null_fd);
+        }
+        _exit(trash_purge(0, quota, jobs, 0));
+    }
+}
+
+int parse_duration(const char *text, time_t *seconds) {
+    char *end;
+    long value = strtol(text, &end, 10);
+    if (end == text || value < 0) return -1;
+
+    switch (*end) {
+        case '\0':
+        case 'd': *seconds = value * 86400L; break;
+        case 'h': *seconds = value * 3600L; break;
+        case 'm': *seconds = value * 60L; break;
+        case 's': *seconds = value; break;
+        case 'w': *seconds = value * 7 * 86400L; break;
+        default: return -1;
+    }
+    return (*end && end[1]) ? -1 : 0;
+}
+
+int parse_size(const char *text, off_t *bytes) {
+    char *end;
+    long long value = strtoll(text, &end, 10);
+    if (end == text || value < 0) return -1;
+
+    switch (*end) {
+        case '\0': break;
+        case 'k': case 'K': value <<= 10; break;
+        case 'm': case 'M': value <<= 20; break;
+        case 'g': case 'G': value <<= 30; break;
+        case 't': case 'T': value <<= 40; break;
+        default: return -1;
+    }
+    *bytes = (off_t)value;
+    return (*end && end[1] && !((end[1] == 'B' || end[1] == 'b') && !end[2])) ? -1 : 0;
+}
@@ -0,0 +1,34 @@
+#ifndef PRM_TRASH_H
+#define PRM_TRASH_H
+
+#include <sys/types.h>
+#include <time.h>
+
+#define TRASH_DIR "/tmp/trash"              // 主回收站
+#define TRASH_DIR_ENV "PRM_TRASH_DIR"       // 设置为绝对路径时替代 TRASH_DIR
+#define TRASH_INDEX "index"                 // 每个回收站目录下的追加式索引
+#define TRASH_REGISTRY_NAME "trashdirs"     // 主回收站下所有回收站目录的登记表
+#define TRASH_MOUNT_PREFIX ".prm-trash-"    // 其他文件系统上的回收站：<挂载点>/.prm-trash-<uid>
+#define TRASH_QUOTA_ENV "PRM_TRASH_MAX_SIZE"
+
+// 移动到所在文件系统的回收站（同一文件系统内 rename），并追加索引记录。
+// 目录的大小记为未知，不在移动前遍历。成功返回 0
+int trash_move(const char *path);
+
+// 以下操作只读取索引，不扫描回收站内容；大小未知的目录在第一次需要时计算一次并记入索引
+int trash_list(void);
+int trash_empty(int jobs);
+int trash_restore(const char *path, int verbose);
+
+// 删除早于 older_than 秒的条目，再按从旧到新删除直到总大小不超过 max_size。
+// older_than 为 0、max_size 为负数表示不限制
+int trash_purge(time_t older_than, off_t max_size, int jobs, int verbose);
+
+// 设置了 PRM_TRASH_MAX_SIZE 且回收站超出配额（或有大小未知的条目）时，在后台启动清理进程
+void trash_auto_purge(int jobs);
+
+// 解析 30d/12h/45m/10s 形式的时长（无单位按天）和 10G/500M/4K 形式的大小
+int parse_duration(const char *text, time_t *seconds);
+int parse_size(const char *text, off_t *bytes);
+
+#endif // PRM_TRASH_H
@@ -7,43 +7,13 @@
 #include <dirent.h>
 #include <errno.h>
 #include <time.h>
-#include <pwd.h>
-#include <grp.h>
+#include <fcntl.h>
 #include "../include/common.h"
-
-#define MAX_PATH_LENGTH 1024
-#define MAX_ENTRIES 10000
-#define TAR_BLOCK_SIZE 512
-
-// tar文件头结构 - 使用packed确保结构体对齐
-typedef struct __attribute__((packed)) {
-    char name[100];         // 文件名
-    char mode[8];           // 文件权限
-    char uid[8];            // 用户ID
-    char gid[8];            // 组ID
-    char size[12];          // 文件大小
-    char mtime[12];         // 修改时间
-    char chksum[8];         // 校验和
-    char typeflag;          // 文件类型
-    char linkname[100];     // 链接目标
-    char magic[6];          // 魔数
-    char version[2];        // 版本
-    char uname[32];         // 用户名
-    char gname[32];         // 组名
-    char devmajor[8];       // 主设备号
-    char devminor[8];       // 次设备号
-    char prefix[155];       // 路径前缀
-    char padding[12];       // 填充
-} TarHeader;
-
-// 文件条目结构
-typedef struct {
-    char path[MAX_PATH_LENGTH];
-    char name[256];
-    struct stat st;
-    int is_dir;
-    int is_symlink;
-} TarEntry;
+#include "ptar_stream.h"
+#include "ptar_format.h"
+#include "ptar_index.h"
+#include "ptar_extract.h"
+#include "ptar_snapshot.h"
 
 // tar操作类型
 typedef enum {
@@ -51,13 +21,14 @@ typedef enum {
     TAR_EXTRACT,    // 提取归档
     TAR_LIST,       // 列出内容
     TAR_APPEND,     // 追加文件
-    TAR_UPDATE      // 更新文件
+    TAR_UPDATE,     // 更新文件
+    TAR_INDEX       // 为已有归档生成索引
 } TarOperation;
 
 // tar配置结构
 typedef struct {
-    char archive_path[MAX_PATH_LENGTH];
-    char *files[MAX_ENTRIES];
+    const char *archive_path;
+    char **files;
     int file_count;
     TarOperation operation;
     int verbose;
@@ -65,7 +36,10 @@ typedef struct {
     int follow_symlinks;
     int exclude_hidden;
     int compression;
+    int jobs;
     int progress;
+    int index;                  // 创建归档时同时生成索引
+    const char *snapshot_path;  // --listed-incremental 的快照文件
 } TarConfig;
 
 // 初始化tar配置
@@ -77,414 +51,531 @@ void init_tar_config(TarConfig *config) {
     config->follow_symlinks = 0;
     config->exclude_hidden = 0;
     config->compression = 0;
+    config->jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (config->jobs < 1) config->jobs = 1;
+    if (config->jobs > MAX_JOBS) config->jobs = MAX_JOBS;
     config->progress = 0;
+    config->index = 0;
+    config->snapshot_path = NULL;
 }
 
-// 将数字转换为八进制字符串
-void oct_to_string(char *str, int len, unsigned long num) {
-    snprintf(str, len, "%07o", (unsigned int)num);
+static int write_zeros(TarWriter *archive, uint64_t count) {
+    static const char zeros[64 * 1024];
+    while (count > 0) {
+        size_t chunk = count > sizeof(zeros) ? sizeof(zeros) : (size_t)count;
+        if (!tar_writer_write(archive, zeros, chunk)) return 0;
+        count -= chunk;
+    }
+    return 1;
 }
 
-// 将八进制字符串转换为数字
-unsigned long string_to_oct(const char *str, int len) {
-    (void)len; // 避免未使用参数警告
-    char *end;
-    return strtoul(str, &end, 8);
+// 归档中的成员名：去掉开头的 '/'，以及最后一个 ".." 及其之前的部分（与 GNU tar 相同），
+// 否则提取时会被当作不安全的路径拒绝
+static const char *member_name(const char *path) {
+    const char *start = path;
+    for (const char *p = path; *p;) {
+        const char *end = strchr(p, '/');
+        size_t len = end ? (size_t)(end - p) : strlen(p);
+        if (len == 2 && p[0] == '.' && p[1] == '.') start = p + len;
+        p += len;
+        while (*p == '/') p++;
+    }
+    while (*start == '/') start++;
+    return *start ? start : ".";
 }
 
-// 计算tar头校验和
-unsigned long calculate_checksum(const TarHeader *header) {
-    unsigned long sum = 0;
-    const char *p = (const char *)header;
-    
-    // 计算除校验和字段外的所有字节
-    for (int i = 0; i < 148; i++) {
-        sum += (unsigned char)p[i];
+// 拼接子路径，结果需要 free
+static char *join_path(const char *dir, const char *name) {
+    size_t dir_len = strlen(dir);
+    size_t len = dir_len + strlen(name) + 2;
+    char *path = malloc(len);
+    if (path) {
+        snprintf(path, len, "%s%s%s", dir, (dir_len > 0 && dir[dir_len - 1] == '/') ? "" : "/", name);
     }
-    for (int i = 156; i < 512; i++) {
-        sum += (unsigned char)p[i];
-    }
-    
-    return sum;
+    return path;
 }
 
-// 创建tar文件头
-void create_tar_header(TarHeader *header, const TarEntry *entry) {
-    memset(header, 0, sizeof(TarHeader));
-    
-    // 设置文件名 - 只使用文件名部分，不包含路径
-    const char *filename = strrchr(entry->name, '/');
-    if (filename) {
-        filename++; // 跳过 '/'
-    } else {
-        filename = entry->name;
-    }
-    strncpy(header->name, filename, sizeof(header->name) - 1);
-    
-    // 设置文件权限
-    oct_to_string(header->mode, sizeof(header->mode), entry->st.st_mode & 0777);
-    
-    // 设置用户ID和组ID
-    oct_to_string(header->uid, sizeof(header->uid), entry->st.st_uid);
-    oct_to_string(header->gid, sizeof(header->gid), entry->st.st_gid);
-    
-    // 设置文件大小
-    oct_to_string(header->size, sizeof(header->size), entry->st.st_size);
-    
-    // 设置修改时间
-    oct_to_string(header->mtime, sizeof(header->mtime), entry->st.st_mtime);
-    
-    // 设置文件类型
-    if (S_ISREG(entry->st.st_mode)) {
-        header->typeflag = '0';
-    } else if (S_ISDIR(entry->st.st_mode)) {
-        header->typeflag = '5';
-    } else if (S_ISLNK(entry->st.st_mode)) {
-        header->typeflag = '2';
-    } else {
-        header->typeflag = '0';
-    }
-    
-    // 设置魔数和版本
-    strcpy(header->magic, "ustar");
-    strncpy(header->version, "00", sizeof(header->version) - 1);
-    
-    // 设置用户名和组名
-    struct passwd *pw = getpwuid(entry->st.st_uid);
-    if (pw) {
-        strncpy(header->uname, pw->pw_name, sizeof(header->uname) - 1);
-    }
-    
-    struct group *gr = getgrgid(entry->st.st_gid);
-    if (gr) {
-        strncpy(header->gname, gr->gr_name, sizeof(header->gname) - 1);
+// 创建归档时的状态
+typedef struct {
+    TarWriter *archive;
+    TarIndexWriter *index;      // 未使用 --index 时为 NULL
+    Snapshot *snapshot;         // 上次的快照，增量模式下使用
+    SnapshotWriter *snapshot_out;  // 本次的快照，不为 NULL 表示增量模式
+    const TarConfig *config;
+    int skipped;                // 无法读取而跳过的文件和目录
+} CreateContext;
+
+// 写入成员头，同时记录到索引
+static int emit_member(CreateContext *ctx, const TarMember *member) {
+    int ok = write_member_header(ctx->archive, member);
+    if (ok && ctx->index && !index_writer_add(ctx->index, member, tar_writer_offset(ctx->archive))) {
+        print_warning("写入索引失败，不再生成索引");
+        index_writer_abort(ctx->index);
+        ctx->index = NULL;
     }
-    
-    // 计算并设置校验和
-    unsigned long checksum = calculate_checksum(header);
-    oct_to_string(header->chksum, sizeof(header->chksum), checksum);
+    return ok;
 }
 
-// 写入tar文件头
-int write_tar_header(FILE *file, const TarHeader *header) {
-    return fwrite(header, 1, sizeof(TarHeader), file) == sizeof(TarHeader);
-}
+static int write_entry_header(CreateContext *ctx, const char *path, const struct stat *st, const char *linkname) {
+    TarMember member;
+    if (!member_from_stat(&member, member_name(path), st, linkname)) return 0;
 
-// 读取tar文件头
-int read_tar_header(FILE *file, TarHeader *header) {
-    size_t bytes_read = fread(header, 1, sizeof(TarHeader), file);
-    if (bytes_read != sizeof(TarHeader)) {
-        return 0;
-    }
-    
-    // 检查是否为空块（tar文件结束标志）
-    int is_empty = 1;
-    for (size_t i = 0; i < sizeof(TarHeader); i++) {
-        if (((char *)header)[i] != 0) {
-            is_empty = 0;
-            break;
-        }
-    }
-    
-    if (is_empty) {
-        return 0;
-    }
-    
-    // 确保字符串正确终止
-    header->name[sizeof(header->name) - 1] = '\0';
-    header->linkname[sizeof(header->linkname) - 1] = '\0';
-    header->uname[sizeof(header->uname) - 1] = '\0';
-    header->gname[sizeof(header->gname) - 1] = '\0';
-    header->prefix[sizeof(header->prefix) - 1] = '\0';
-    
-    return 1;
+    int ok = emit_member(ctx, &member);
+    free_member(&member);
+    return ok;
 }
 
 // 添加文件到归档
-int add_file_to_archive(FILE *archive, const char *filepath, const TarConfig *config) {
-    struct stat st;
-    if (lstat(filepath, &st) != 0) {
-        print_error("无法获取文件信息");
-        return 0;
+int add_file_to_archive(CreateContext *ctx, const char *filepath, const struct stat *st) {
+    TarWriter *archive = ctx->archive;
+    char *linkname = NULL;
+    int fd = -1;
+
+    if (S_ISLNK(st->st_mode)) {
+        size_t capacity = (size_t)st->st_size + 1;
+        if (capacity < 256) capacity = 256;
+        linkname = malloc(capacity);
+        ssize_t len = linkname ? readlink(filepath, linkname, capacity - 1) : -1;
+        if (len < 0) {
+            print_error("无法读取符号链接，已跳过");
+            free(linkname);
+            ctx->skipped++;
+            return 1;
+        }
+        linkname[len] = '\0';
+    } else if (S_ISREG(st->st_mode)) {
+        fd = open(filepath, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            print_error("无法打开文件，已跳过");
+            ctx->skipped++;
+            return 1;
+        }
     }
-    
-    TarEntry entry;
-    strncpy(entry.path, filepath, sizeof(entry.path) - 1);
-    strncpy(entry.name, filepath, sizeof(entry.name) - 1);
-    entry.st = st;
-    entry.is_dir = S_ISDIR(st.st_mode);
-    entry.is_symlink = S_ISLNK(st.st_mode);
-    
-    // 创建tar头
-    TarHeader header;
-    create_tar_header(&header, &entry);
-    
-    // 写入头
-    if (!write_tar_header(archive, &header)) {
+
+    int ok = write_entry_header(ctx, filepath, st, linkname);
+    free(linkname);
+    if (!ok) {
         print_error("写入tar头失败");
+        if (fd >= 0) close(fd);
         return 0;
     }
-    
+
     // 如果是普通文件，写入内容
-    if (S_ISREG(st.st_mode)) {
-        FILE *file = fopen(filepath, "rb");
-        if (!file) {
-            print_error("无法打开文件");
+    if (fd >= 0) {
+        uint64_t size = (uint64_t)st->st_size;
+        uint64_t copied = tar_writer_copy_fd(archive, fd, size);
+        close(fd);
+
+        if (!tar_writer_ok(archive)) {
+            print_error("写入文件内容失败");
             return 0;
         }
-        
-        char buffer[TAR_BLOCK_SIZE];
-        size_t bytes_read;
-        size_t total_written = 0;
-        
-        while ((bytes_read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
-            if (fwrite(buffer, 1, bytes_read, archive) != bytes_read) {
-                print_error("写入文件内容失败");
-                fclose(file);
-                return 0;
-            }
-            total_written += bytes_read;
-        }
-        
-        fclose(file);
-        
-        // 填充到块边界
-        size_t padding = TAR_BLOCK_SIZE - (total_written % TAR_BLOCK_SIZE);
-        if (padding < TAR_BLOCK_SIZE) {
-            memset(buffer, 0, padding);
-            fwrite(buffer, 1, padding, archive);
+        // 头中的大小已经写出，文件在归档过程中变短时用零补齐
+        if (copied < size) {
+            print_warning("文件在归档过程中变短，已用零填充");
+            if (!write_zeros(archive, size - copied)) return 0;
         }
+        if (!write_zeros(archive, tar_padding(size))) return 0;
     }
-    
-    if (config->verbose) {
+
+    if (ctx->config->verbose) {
         printf("%s添加: %s%s\n", COLOR_GREEN, filepath, COLOR_RESET);
     }
-    
+
     return 1;
 }
 
-// 递归添加目录
-int add_directory_to_archive(FILE *archive, const char *dirpath, const TarConfig *config) {
+// 递归添加目录：先写目录自身的条目，再写其中的内容
+int add_directory_to_archive(CreateContext *ctx, const char *dirpath, const struct stat *st) {
+    if (!write_entry_header(ctx, dirpath, st, NULL)) {
+        print_error("写入tar头失败");
+        return 0;
+    }
+    if (ctx->config->verbose) {
+        printf("%s添加: %s/%s\n", COLOR_GREEN, dirpath, COLOR_RESET);
+    }
+
     DIR *dir = opendir(dirpath);
     if (!dir) {
-        print_error("无法打开目录");
-        return 0;
+        print_error("无法打开目录，已跳过其中的内容");
+        ctx->skipped++;
+        return 1;
     }
-    
+
     struct dirent *entry;
     while ((entry = readdir(dir)) != NULL) {
         // 跳过隐藏文件
-        if (config->exclude_hidden && entry->d_name[0] == '.') {
+        if (ctx->config->exclude_hidden && entry->d_name[0] == '.') {
             continue;
         }
-        
+
         // 跳过当前目录和父目录
         if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
             continue;
         }
-        
-        char full_path[MAX_PATH_LENGTH];
-        snprintf(full_path, sizeof(full_path), "%s/%s", dirpath, entry->d_name);
-        
-        struct stat st;
-        if (lstat(full_path, &st) != 0) {
+
+        struct stat child_st;
+        if (fstatat(dirfd(dir), entry->d_name, &child_st, AT_SYMLINK_NOFOLLOW) != 0) {
             continue;
         }
-        
-        if (S_ISDIR(st.st_mode)) {
-            // 递归处理子目录
-            if (!add_directory_to_archive(archive, full_path, config)) {
-                closedir(dir);
-                return 0;
-            }
-        } else {
-            // 添加文件
-            if (!add_file_to_archive(archive, full_path, config)) {
-                closedir(dir);
-                return 0;
-            }
+
+        char *full_path = join_path(dirpath, entry->d_name);
+        if (!full_path) {
+            closedir(dir);
+            return 0;
+        }
+
+        int ok = S_ISDIR(child_st.st_mode)
+                     ? add_directory_to_archive(ctx, full_path, &child_st)
+                     : add_file_to_archive(ctx, full_path, &child_st);
+        free(full_path);
+        if (!ok) {
+            closedir(dir);
+            return 0;
         }
     }
-    
+
     closedir(dir);
     return 1;
 }
 
+// 增量模式下目录中的一项
+typedef struct {
+    char *path;
+    const char *name;           // 指向 path 中的最后一段
+    struct stat st;
+    char kind;                  // 'Y' 本次写入，'N' 未变化，'D' 子目录
+} DirChild;
+
+static int compare_children(const void *a, const void *b) {
+    return strcmp(((const DirChild *)a)->name, ((const DirChild *)b)->name);
+}
+
+// 增量模式下记录非目录文件的状态，返回是否需要写入归档
+static int record_incremental(CreateContext *ctx, const char *path, const struct stat *st) {
+    const char *name = member_name(path);
+    int changed = snapshot_changed(ctx->snapshot, name, st);
+    if (!snapshot_writer_add(ctx->snapshot_out, name, st)) {
+        print_warning("写入快照失败");
+    }
+    return changed;
+}
+
+// 增量模式下添加目录：写一个 GNU dumpdir 条目（typeflag 'D'），数据中列出目录现有的
+// 全部名字，每个前面加上状态字母。恢复时目录里不在列表中的条目会被删除，
+// 因此这个列表同时也是删除记录。之后只写入发生变化的文件，子目录总是递归处理
+int add_incremental_directory(CreateContext *ctx, const char *dirpath, const struct stat *st) {
+    DIR *dir = opendir(dirpath);
+    if (!dir) {
+        print_error("无法打开目录，已跳过");
+        ctx->skipped++;
+        return 1;
+    }
+
+    DirChild *children = NULL;
+    size_t count = 0;
+    size_t capacity = 0;
+    int ok = 1;
+    struct dirent *entry;
+    while (ok && (entry = readdir(dir)) != NULL) {
+        if (ctx->config->exclude_hidden && entry->d_name[0] == '.') continue;
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+
+        struct stat child_st;
+        if (fstatat(dirfd(dir), entry->d_name, &child_st, AT_SYMLINK_NOFOLLOW) != 0) continue;
+
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            DirChild *grown = realloc(children, capacity * sizeof(DirChild));
+            if (!grown) {
+                ok = 0;
+                break;
+            }
+            children = grown;
+        }
+        DirChild *child = &children[count];
+        if (!(child->path = join_path(dirpath, entry->d_name))) {
+            ok = 0;
+            break;
+        }
+        child->name = child->path + strlen(child->path) - strlen(entry->d_name);
+        child->st = child_st;
+        count++;
+    }
+    closedir(dir);
+
+    // 名字排序后输出，相同的目录内容总是得到相同的归档
+    size_t dump_len = 1;
+    if (count > 0) qsort(children, count, sizeof(DirChild), compare_children);
+    for (size_t i = 0; i < count; i++) {
+        DirChild *child = &children[i];
+        child->kind = S_ISDIR(child->st.st_mode) ? 'D'
+                      : record_incremental(ctx, child->path, &child->st) ? 'Y' : 'N';
+        dump_len += strlen(child->name) + 2;
+    }
+
+    char *dump = ok ? malloc(dump_len) : NULL;
+    TarMember member;
+    if (dump && member_from_stat(&member, member_name(dirpath), st, NULL)) {
+        char *p = dump;
+        for (size_t i = 0; i < count; i++) {
+            size_t len = strlen(children[i].name) + 1;
+            *p++ = children[i].kind;
+            memcpy(p, children[i].name, len);
+            p += len;
+        }
+        *p = '\0';
+
+        member.typeflag = 'D';
+        member.size = dump_len;
+        ok = emit_member(ctx, &member) && tar_writer_write(ctx->archive, dump, dump_len) &&
+             write_zeros(ctx->archive, tar_padding(dump_len));
+        free_member(&member);
+        if (!ok) print_error("写入tar头失败");
+    } else {
+        ok = 0;
+    }
+    free(dump);
+
+    if (ok && ctx->config->verbose) {
+        printf("%s添加: %s/%s\n", COLOR_GREEN, dirpath, COLOR_RESET);
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        DirChild *child = &children[i];
+        if (ok && child->kind == 'D') {
+            ok = add_incremental_directory(ctx, child->path, &child->st);
+        } else if (ok && child->kind == 'Y') {
+            ok = add_file_to_archive(ctx, child->path, &child->st);
+        }
+        free(child->path);
+    }
+    free(children);
+    return ok;
+}
+
 // 创建tar归档
 int create_archive(const TarConfig *config) {
-    FILE *archive = fopen(config->archive_path, "wb");
-    if (!archive) {
+    CreateContext ctx;
+    BlockTable blocks = {NULL, 0};
+
+    ctx.config = config;
+    ctx.index = NULL;
+    ctx.snapshot = NULL;
+    ctx.snapshot_out = NULL;
+    ctx.skipped = 0;
+
+    // 增量模式：读入上次的快照，本次的快照在归档成功后替换它
+    if (config->snapshot_path) {
+        if (!(ctx.snapshot = snapshot_load(config->snapshot_path))) {
+            print_error("无法读取快照文件");
+            return 0;
+        }
+        if (!(ctx.snapshot_out = snapshot_writer_open(config->snapshot_path))) {
+            print_error("无法创建快照文件");
+            snapshot_free(ctx.snapshot);
+            return 0;
+        }
+    }
+
+    ctx.archive = tar_writer_open(config->archive_path, config->compression, config->jobs);
+    if (!ctx.archive) {
         print_error("无法创建归档文件");
+        if (ctx.snapshot_out) snapshot_writer_abort(ctx.snapshot_out);
+        snapshot_free(ctx.snapshot);
         return 0;
     }
-    
+    if (config->index && !(ctx.index = index_writer_open(config->archive_path, config->compression))) {
+        print_warning("无法创建索引文件");
+    }
+
     printf("%s创建归档: %s%s\n", COLOR_CYAN, config->archive_path, COLOR_RESET);
-    
+
+    // 无法读取的文件只跳过（与 tar 相同），最后返回失败；写归档出错才中止
     int success = 1;
     for (int i = 0; i < config->file_count && success; i++) {
         struct stat st;
         if (lstat(config->files[i], &st) != 0) {
             print_error("文件不存在");
+            ctx.skipped++;
             continue;
         }
-        
+
         if (S_ISDIR(st.st_mode)) {
-            success = add_directory_to_archive(archive, config->files[i], config);
-        } else {
-            success = add_file_to_archive(archive, config->files[i], config);
+            success = ctx.snapshot_out ? add_incremental_directory(&ctx, config->files[i], &st)
+                                       : add_directory_to_archive(&ctx, config->files[i], &st);
+        } else if (!ctx.snapshot_out || record_incremental(&ctx, config->files[i], &st)) {
+            success = add_file_to_archive(&ctx, config->files[i], &st);
         }
     }
-    
+
     // 写入两个空块表示结束
-    char empty_block[TAR_BLOCK_SIZE * 2];
-    memset(empty_block, 0, sizeof(empty_block));
-    fwrite(empty_block, 1, sizeof(empty_block), archive);
-    
-    fclose(archive);
-    
-    if (success) {
+    write_zeros(ctx.archive, TAR_BLOCK_SIZE * 2);
+
+    if (!tar_writer_close(ctx.archive, &blocks)) {
+        print_error("写入归档文件失败");
+        success = 0;
+    }
+
+    // 索引在归档关闭后写入，记录最终的大小和修改时间
+    if (ctx.index) {
+        if (!success) {
+            index_writer_abort(ctx.index);
+        } else if (!index_writer_close(ctx.index, &blocks)) {
+            print_warning("写入索引失败");
+        }
+    }
+    free(blocks.offsets);
+
+    // 归档失败或有文件被跳过时保留旧快照，下次仍以它为基准，被跳过的文件不会遗漏
+    if (ctx.snapshot_out) {
+        if (!success || ctx.skipped > 0) {
+            snapshot_writer_abort(ctx.snapshot_out);
+        } else if (!snapshot_writer_close(ctx.snapshot_out)) {
+            print_warning("写入快照失败，下次备份仍以旧快照为基准");
+        }
+    }
+    snapshot_free(ctx.snapshot);
+
+    if (success && ctx.skipped > 0) {
+        char message[96];
+        snprintf(message, sizeof(message), "归档已创建，但有 %d 个文件或目录无法读取而被跳过", ctx.skipped);
+        print_warning(message);
+        success = 0;
+    } else if (success) {
         print_success("归档创建完成");
     }
-    
+
     return success;
 }
 
-// 列出tar归档内容
-int list_archive(const TarConfig *config) {
-    FILE *archive = fopen(config->archive_path, "rb");
+// 为已有归档生成索引。外部工具生成的 gzip 归档没有块表，提取单个成员时仍需从头解压
+int index_archive(const TarConfig *config) {
+    TarReader *archive = tar_reader_open(config->archive_path, config->compression);
     if (!archive) {
         print_error("无法打开归档文件");
         return 0;
     }
-    
-    printf("%s归档内容: %s%s\n", COLOR_CYAN, config->archive_path, COLOR_RESET);
+    TarIndexWriter *index = index_writer_open(config->archive_path, tar_reader_compressed(archive));
+    if (!index) {
+        print_error("无法创建索引文件");
+        tar_reader_close(archive);
+        return 0;
+    }
+
+    TarMember member;
+    int count = 0;
+    int status;
+    while ((status = read_member_header(archive, &member)) == 1) {
+        int ok = index_writer_add(index, &member, tar_reader_offset(archive)) &&
+                 tar_reader_skip(archive, member.size + tar_padding(member.size));
+        free_member(&member);
+        if (!ok) {
+            status = -1;
+            break;
+        }
+        count++;
+    }
+    tar_reader_close(archive);
+
+    if (status < 0) {
+        index_writer_abort(index);
+        print_error("归档文件已损坏");
+        return 0;
+    }
+    if (!index_writer_close(index, NULL)) {
+        print_error("写入索引失败");
+        return 0;
+    }
+    printf("%s索引完成: %d 个条目%s\n", COLOR_GREEN, count, COLOR_RESET);
+    return 1;
+}
+
+// 显示一个成员的信息
+static void print_member(const TarMember *member) {
+    // 格式化时间
+    char time_str[64];
+    struct tm *tm_info = localtime(&member->mtime);
+    strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M", tm_info);
+
+    // 格式化权限
+    mode_t mode = member->mode;
+    char perm_str[10];
+    snprintf(perm_str, sizeof(perm_str), "%c%c%c%c%c%c%c%c%c",
+            (mode & 0400) ? 'r' : '-',
+            (mode & 0200) ? 'w' : '-',
+            (mode & 0100) ? 'x' : '-',
+            (mode & 0040) ? 'r' : '-',
+            (mode & 0020) ? 'w' : '-',
+            (mode & 0010) ? 'x' : '-',
+            (mode & 0004) ? 'r' : '-',
+            (mode & 0002) ? 'w' : '-',
+            (mode & 0001) ? 'x' : '-');
+
+    // 显示文件信息
+    printf("%s%s%s %s%8llu%s %s%s%s %s%s%s\n",
+           COLOR_GREEN, perm_str, COLOR_RESET,
+           COLOR_CYAN, (unsigned long long)member->size, COLOR_RESET,
+           COLOR_YELLOW, time_str, COLOR_RESET,
+           COLOR_WHITE, member->name, COLOR_RESET);
+}
+
+// 列出tar归档内容。有最新的索引时只读索引，不需要扫描（或解压）整个归档
+int list_archive(const TarConfig *config) {
+    TarIndexReader *index = index_open(config->archive_path);
+    TarReader *archive = NULL;
+
+    if (!index && !(archive = tar_reader_open(config->archive_path, config->compression))) {
+        print_error("无法打开归档文件");
+        return 0;
+    }
+
+    printf("%s归档内容: %s%s%s\n", COLOR_CYAN, config->archive_path, index ? " (索引)" : "", COLOR_RESET);
     printf("%s%s%s\n", COLOR_YELLOW, "====================================", COLOR_RESET);
-    
-    TarHeader header;
+
+    TarMember member;
+    uint64_t data_offset;
     int entry_count = 0;
-    
-    while (read_tar_header(archive, &header)) {
+    int status;
+
+    while ((status = index ? index_next(index, &member, &data_offset)
+                           : read_member_header(archive, &member)) == 1) {
         entry_count++;
-        
-        // 解析文件信息
-        unsigned long size = string_to_oct(header.size, sizeof(header.size));
-        unsigned long mode = string_to_oct(header.mode, sizeof(header.mode));
-        unsigned long mtime = string_to_oct(header.mtime, sizeof(header.mtime));
-        
-        // 格式化时间
-        char time_str[64];
-        struct tm *tm_info = localtime((time_t *)&mtime);
-        strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M", tm_info);
-        
-        // 格式化权限
-        char perm_str[10];
-        snprintf(perm_str, sizeof(perm_str), "%c%c%c%c%c%c%c%c%c",
-                (mode & 0400) ? 'r' : '-',
-                (mode & 0200) ? 'w' : '-',
-                (mode & 0100) ? 'x' : '-',
-                (mode & 0040) ? 'r' : '-',
-                (mode & 0020) ? 'w' : '-',
-                (mode & 0010) ? 'x' : '-',
-                (mode & 0004) ? 'r' : '-',
-                (mode & 0002) ? 'w' : '-',
-                (mode & 0001) ? 'x' : '-');
-        
-        // 显示文件信息
-        printf("%s%s%s %s%8lu%s %s%s%s %s%s%s\n",
-               COLOR_GREEN, perm_str, COLOR_RESET,
-               COLOR_CYAN, size, COLOR_RESET,
-               COLOR_YELLOW, time_str, COLOR_RESET,
-               COLOR_WHITE, header.name, COLOR_RESET);
-        
+        print_member(&member);
+
         // 跳过文件内容
-        if (header.typeflag == '0' || header.typeflag == '\0') {
-            size_t blocks = (size + TAR_BLOCK_SIZE - 1) / TAR_BLOCK_SIZE;
-            fseek(archive, blocks * TAR_BLOCK_SIZE, SEEK_CUR);
+        int skipped = index || tar_reader_skip(archive, member.size + tar_padding(member.size));
+        free_member(&member);
+        if (!skipped) {
+            status = -1;
+            break;
         }
     }
-    
+
     printf("\n%s总计: %d 个条目%s\n", COLOR_CYAN, entry_count, COLOR_RESET);
-    
-    fclose(archive);
+
+    if (index) index_close(index);
+    if (archive) tar_reader_close(archive);
+    if (status < 0) {
+        print_error(index ? "索引文件已损坏" : "归档文件已损坏");
+        return 0;
+    }
     return 1;
 }
 
 // 提取tar归档
 int extract_archive(const TarConfig *config) {
-    FILE *archive = fopen(config->archive_path, "rb");
-    if (!archive) {
-        print_error("无法打开归档文件");
-        return 0;
-    }
-    
-    printf("%s提取归档: %s%s\n", COLOR_CYAN, config->archive_path, COLOR_RESET);
-    
-    TarHeader header;
-    int extracted_count = 0;
-    
-    while (read_tar_header(archive, &header)) {
-        unsigned long size = string_to_oct(header.size, sizeof(header.size));
-        unsigned long mode = string_to_oct(header.mode, sizeof(header.mode));
-        
-        if (config->verbose) {
-            printf("%s提取: '%s' (长度: %zu, 大小: %lu)%s\n", COLOR_GREEN, header.name, strlen(header.name), size, COLOR_RESET);
-        }
-        
-        // 跳过空文件名
-        if (strlen(header.name) == 0) {
-            continue;
-        }
-        
-        if (header.typeflag == '0' || header.typeflag == '\0') {
-            // 普通文件
-            FILE *file = fopen(header.name, "wb");
-            if (file) {
-                char buffer[TAR_BLOCK_SIZE];
-                size_t bytes_to_read = size;
-                
-                while (bytes_to_read > 0) {
-                    size_t chunk = (bytes_to_read > sizeof(buffer)) ? sizeof(buffer) : bytes_to_read;
-                    size_t bytes_read = fread(buffer, 1, chunk, archive);
-                    if (bytes_read > 0) {
-                        fwrite(buffer, 1, bytes_read, file);
-                        bytes_to_read -= bytes_read;
-                    } else {
-                        break;
-                    }
-                }
-                
-                fclose(file);
-                
-                // 设置文件权限
-                if (config->preserve_permissions) {
-                    chmod(header.name, mode);
-                }
-                
-                extracted_count++;
-                
-                // 跳过文件内容的填充部分
-                size_t blocks = (size + TAR_BLOCK_SIZE - 1) / TAR_BLOCK_SIZE;
-                size_t total_read = blocks * TAR_BLOCK_SIZE;
-                size_t remaining = total_read - size;
-                if (remaining > 0) {
-                    fseek(archive, remaining, SEEK_CUR);
-                }
-            } else {
-                // 如果无法创建文件，仍然需要跳过文件内容
-                size_t blocks = (size + TAR_BLOCK_SIZE - 1) / TAR_BLOCK_SIZE;
-                fseek(archive, blocks * TAR_BLOCK_SIZE, SEEK_CUR);
-            }
-        } else if (header.typeflag == '5') {
-            // 目录
-            mkdir(header.name, mode);
-            extracted_count++;
-        }
-    }
-    
-    printf("%s提取完成: %d 个文件%s\n", COLOR_GREEN, extracted_count, COLOR_RESET);
-    
-    fclose(archive);
-    return 1;
+    ExtractOptions options = {
+        .archive_path = config->archive_path,
+        .members = config->files,
+        .member_count = config->file_count,
+        .compression = config->compression,
+        .verbose = config->verbose,
+        .preserve_permissions = config->preserve_permissions,
+        .jobs = config->jobs,
+        .incremental = config->snapshot_path != NULL,
+    };
+    return extract_members(&options);
 }
 
 void print_usage(const char *program_name) {
@@ -500,12 +591,23 @@ void print_usage(const char *program_name) {
     printf("  -v, --verbose       详细输出\n");
     printf("  -f, --file FILE     指定归档文件名\n");
     printf("  -p, --preserve      保留文件权限\n");
+    printf("  -z, --gzip          gzip 压缩/解压（提取时也会自动识别）\n");
+    printf("  --jobs N            并行压缩/提取线程数 (默认: CPU 核数)\n");
+    printf("  --index             生成索引文件 (归档名%s)，加速列出和提取单个成员；\n", INDEX_SUFFIX);
+    printf("                      不带 -c 和文件时为已有归档生成索引\n");
+    printf("  --listed-incremental SNAPSHOT\n");
+    printf("                      增量备份：只归档快照之后新增或变化的文件，并记录删除；\n");
+    printf("                      提取时给出任意值（如 /dev/null）即按增量归档恢复\n");
     printf("  -h, --help          显示此帮助信息\n");
     printf("  -V, --version       显示版本信息\n\n");
     printf("示例:\n");
     printf("  %s -cf archive.tar file1 file2\n", program_name);
     printf("  %s -tf archive.tar\n", program_name);
     printf("  %s -xf archive.tar\n", program_name);
+    printf("  %s -czf archive.tar.gz dir\n", program_name);
+    printf("  %s -cf archive.tar --index dir\n", program_name);
+    printf("  %s -xf archive.tar dir/file\n", program_name);
+    printf("  %s -cf backup-1.tar --listed-incremental backup.snar dir\n", program_name);
     printf("  %s -rf archive.tar newfile\n", program_name);
 }
 
@@ -513,6 +615,12 @@ int main(int argc, char *argv[]) {
     TarConfig config;
     init_tar_config(&config);
     
+    config.files = malloc((size_t)argc * sizeof(char *));
+    if (!config.files) {
+        print_error("内存不足");
+        return 1;
+    }
+    
     // 解析命令行参数
     for (int i = 1; i < argc; i++) {
         if (argv[i][0] == '-' && argv[i][1] != '-') {
@@ -540,7 +648,7 @@ int main(int argc, char *argv[]) {
                         break;
                     case 'f':
                         if (i + 1 < argc) {
-                            strncpy(config.archive_path, argv[++i], sizeof(config.archive_path) - 1);
+                            config.archive_path = argv[++i];
                         } else {
                             print_error("缺少文件名参数");
                             return 1;
@@ -549,6 +657,9 @@ int main(int argc, char *argv[]) {
                     case 'p':
                         config.preserve_permissions = 1;
                         break;
+                    case 'z':
+                        config.compression = 1;
+                        break;
                     default:
                         printf("未知选项: -%c\n", options[j]);
                         print_usage(argv[0]);
@@ -569,13 +680,33 @@ int main(int argc, char *argv[]) {
             config.verbose = 1;
         } else if (strcmp(argv[i], "--file") == 0) {
             if (i + 1 < argc) {
-                strncpy(config.archive_path, argv[++i], sizeof(config.archive_path) - 1);
+                config.archive_path = argv[++i];
             } else {
                 print_error("缺少文件名参数");
                 return 1;
             }
         } else if (strcmp(argv[i], "--preserve") == 0) {
             config.preserve_permissions = 1;
+        } else if (strcmp(argv[i], "--gzip") == 0) {
+            config.compression = 1;
+        } else if (strcmp(argv[i], "--jobs") == 0) {
+            if (i + 1 < argc) {
+                config.jobs = atoi(argv[++i]);
+                if (config.jobs < 1) config.jobs = 1;
+                if (config.jobs > MAX_JOBS) config.jobs = MAX_JOBS;
+            } else {
+                print_error("缺少线程数参数");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--index") == 0) {
+            config.index = 1;
+        } else if (strcmp(argv[i], "--listed-incremental") == 0) {
+            if (i + 1 < argc) {
+                config.snapshot_path = argv[++i];
+            } else {
+                print_error("缺少快照文件参数");
+                return 1;
+            }
         } else if (strcmp(argv[i], "--help") == 0) {
             print_usage(argv[0]);
             return 0;
@@ -583,8 +714,8 @@ int main(int argc, char *argv[]) {
             printf("ptar - 优化版 tar 命令 v1.0\n");
             return 0;
         } else if (argv[i][0] != '-') {
-            if (strlen(config.archive_path) == 0) {
-                strncpy(config.archive_path, argv[i], sizeof(config.archive_path) - 1);
+            if (!config.archive_path) {
+                config.archive_path = argv[i];
             } else {
                 config.files[config.file_count] = argv[i];
                 config.file_count++;
@@ -597,12 +728,17 @@ int main(int argc, char *argv[]) {
     }
     
     // 检查必需参数
-    if (strlen(config.archive_path) == 0) {
+    if (!config.archive_path) {
         print_error("请指定归档文件名");
         print_usage(argv[0]);
         return 1;
     }
     
+    // 只给出 --index 和归档名时，为已有归档生成索引
+    if (config.index && config.operation == TAR_CREATE && config.file_count == 0) {
+        config.operation = TAR_INDEX;
+    }
+
     if (config.operation == TAR_CREATE && config.file_count == 0) {
         print_error("创建归档时需要指定文件");
         print_usage(argv[0]);
@@ -621,6 +757,9 @@ int main(int argc, char *argv[]) {
         case TAR_LIST:
             success = list_archive(&config);
             break;
+        case TAR_INDEX:
+            success = index_archive(&config);
+            break;
         case TAR_APPEND:
             print_warning("追加功能暂未实现");
             break;
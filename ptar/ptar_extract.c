@@ -0,0 +1,907 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "../include/common.h"
+#include "ptar_extract.h"
+#include "ptar_format.h"
+#include "ptar_index.h"
+#include "ptar_stream.h"
+
+// 正在写出的文件。小文件只有一个数据块，由工作线程创建；大文件由读线程创建并
+// fallocate，各数据块并行 pwrite，最后一个写完的线程设置元数据并关闭
+typedef struct OutputFile {
+    struct OutputFile *next_active;
+    char *path;
+    int fd;
+    int refs;                   // 未写完的数据块数，读线程分发期间再加 1
+    int failed;
+    mode_t mode;
+    uid_t uid;
+    gid_t gid;
+    time_t mtime;
+} OutputFile;
+
+#define ACTIVE_BUCKETS 1024
+
+typedef struct ExtractJob {
+    struct ExtractJob *next;
+    OutputFile *file;
+    unsigned char *data;
+    size_t len;
+    uint64_t offset;
+} ExtractJob;
+
+// 最后统一处理的目录、符号链接和硬链接
+typedef struct {
+    char *path;
+    char *linkname;             // 硬链接的目标，其他为 NULL
+    mode_t mode;
+    uid_t uid;
+    gid_t gid;
+    time_t mtime;
+    char typeflag;
+} DeferredEntry;
+
+typedef struct {
+    const ExtractOptions *options;
+    int restore_owner;          // 只有 root 才恢复属主
+    int root_fd;                // 提取目录，所有成员都在它下面按不跟随符号链接的方式打开
+
+    pthread_mutex_t lock;
+    pthread_cond_t job_ready;
+    pthread_cond_t space_ready;
+    ExtractJob *head;
+    ExtractJob *tail;
+    size_t queued_jobs;
+    size_t queued_bytes;
+    int shutdown;
+
+    // 正在写出的文件，按路径散列。同名成员要等前一个写完再处理，保证最后一个生效
+    OutputFile *active[ACTIVE_BUCKETS];
+    pthread_cond_t file_done;
+
+    DeferredEntry *deferred;
+    size_t deferred_count;
+    size_t deferred_capacity;
+    int extracted_count;
+    int failed_count;           // 创建或写入失败的成员
+} ExtractContext;
+
+static int write_all_at(int fd, const void *data, size_t len, uint64_t offset) {
+    const char *p = (const char *)data;
+    while (len > 0) {
+        ssize_t n = pwrite(fd, p, len, (off_t)offset);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        p += n;
+        len -= (size_t)n;
+        offset += (uint64_t)n;
+    }
+    return 1;
+}
+
+// 提取时的安全路径：去掉开头的 '/'，拒绝包含 ".." 的路径
+static const char *safe_member_path(const char *name) {
+    while (*name == '/') name++;
+
+    for (const char *p = name; *p;) {
+        if (p[0] == '.' && p[1] == '.' && (p[2] == '/' || p[2] == '\0')) return NULL;
+        const char *slash = strchr(p, '/');
+        if (!slash) break;
+        p = slash + 1;
+    }
+    return *name ? name : NULL;
+}
+
+// 是否为命令行指定要提取的成员：名字相同，或位于指定的目录之下。未指定时提取全部
+static int member_selected(const ExtractOptions *options, const char *name) {
+    if (options->member_count == 0) return 1;
+
+    while (*name == '/') name++;
+    for (int i = 0; i < options->member_count; i++) {
+        const char *want = options->members[i];
+        while (*want == '/') want++;
+        size_t len = strlen(want);
+        while (len > 0 && want[len - 1] == '/') len--;
+
+        if (strncmp(name, want, len) == 0 && (name[len] == '\0' || name[len] == '/')) return 1;
+    }
+    return 0;
+}
+
+static int is_regular_member(const TarMember *member) {
+    return member->typeflag == '0' || member->typeflag == '\0' || member->typeflag == '7';
+}
+
+// 'D' 是增量归档中带有内容列表的目录（GNU dumpdir）
+static int is_directory_member(const TarMember *member) {
+    return member->typeflag == '5' || member->typeflag == 'D';
+}
+
+// 在提取目录 root_fd 下逐级打开 path 的父目录。每一级都用 O_NOFOLLOW 打开，归档中的
+// 符号链接（或提取目录中已有的符号链接）不会把后续成员引到提取目录之外；create 时
+// 创建缺少的目录。成功返回父目录的描述符，最后一级的名字（去掉末尾的 '/'）放在 leaf 中；
+// 失败返回 -1
+static int open_parent_dir(int root_fd, const char *path, char leaf[NAME_MAX + 1], int create) {
+    int dir_fd = fcntl(root_fd, F_DUPFD_CLOEXEC, 0);
+    const char *p = path;
+
+    while (dir_fd >= 0) {
+        while (*p == '/') p++;
+        size_t len = strcspn(p, "/");
+        const char *next = p + len;
+        while (*next == '/') next++;
+        if (len > NAME_MAX) {
+            close(dir_fd);
+            errno = ENAMETOOLONG;
+            return -1;
+        }
+        memcpy(leaf, p, len);
+        leaf[len] = '\0';
+        if (*next == '\0') break;
+        p = next;
+        if (strcmp(leaf, ".") == 0) continue;
+
+        int child = openat(dir_fd, leaf, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        if (child < 0 && errno == ENOENT && create) {
+            mkdirat(dir_fd, leaf, 0755);
+            child = openat(dir_fd, leaf, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        }
+        close(dir_fd);
+        dir_fd = child;
+    }
+    return dir_fd;
+}
+
+// 创建输出文件，父目录不存在时先创建。最后一级是符号链接时先删除它，而不是写到链接的目标
+static int open_output_file(const ExtractContext *ctx, const char *path) {
+    char leaf[NAME_MAX + 1];
+    int dir_fd = open_parent_dir(ctx->root_fd, path, leaf, 1);
+    if (dir_fd < 0) return -1;
+
+    int fd = openat(dir_fd, leaf, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC, 0666);
+    if (fd < 0 && errno == ELOOP && unlinkat(dir_fd, leaf, 0) == 0) {
+        fd = openat(dir_fd, leaf, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC, 0666);
+    }
+    close(dir_fd);
+    return fd;
+}
+
+// 通过文件描述符设置属主、权限和修改时间。chown 会清除 setuid 位，所以放在 chmod 之前
+static void apply_file_metadata(const ExtractContext *ctx, int fd, const OutputFile *file) {
+    if (ctx->restore_owner) {
+        fchown(fd, file->uid, file->gid);
+    }
+    if (ctx->options->preserve_permissions) {
+        fchmod(fd, file->mode);
+    }
+    struct timespec times[2] = {{file->mtime, 0}, {file->mtime, 0}};
+    futimens(fd, times);
+}
+
+static void free_output_file(OutputFile *file) {
+    free(file->path);
+    free(file);
+}
+
+static void count_failure(ExtractContext *ctx) {
+    pthread_mutex_lock(&ctx->lock);
+    ctx->failed_count++;
+    pthread_mutex_unlock(&ctx->lock);
+}
+
+static unsigned int path_bucket(const char *path) {
+    unsigned int h = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *)path; *p; p++) {
+        h = (h ^ *p) * 16777619u;
+    }
+    return h % ACTIVE_BUCKETS;
+}
+
+// 登记正在写出的文件，调用者持有锁
+static void add_active_file(ExtractContext *ctx, OutputFile *file) {
+    OutputFile **bucket = &ctx->active[path_bucket(file->path)];
+    file->next_active = *bucket;
+    *bucket = file;
+}
+
+// 等待同名文件写完。读线程在处理每个成员之前调用
+static void wait_for_path(ExtractContext *ctx, const char *path) {
+    pthread_mutex_lock(&ctx->lock);
+    for (;;) {
+        OutputFile *file = ctx->active[path_bucket(path)];
+        while (file && strcmp(file->path, path) != 0) file = file->next_active;
+        if (!file) break;
+        pthread_cond_wait(&ctx->file_done, &ctx->lock);
+    }
+    pthread_mutex_unlock(&ctx->lock);
+}
+
+// 文件的最后一个数据块写完后调用
+static void finish_output_file(ExtractContext *ctx, OutputFile *file) {
+    if (file->fd >= 0) {
+        if (!file->failed) apply_file_metadata(ctx, file->fd, file);
+        close(file->fd);
+    }
+
+    pthread_mutex_lock(&ctx->lock);
+    for (OutputFile **p = &ctx->active[path_bucket(file->path)]; *p; p = &(*p)->next_active) {
+        if (*p == file) {
+            *p = file->next_active;
+            pthread_cond_broadcast(&ctx->file_done);
+            break;
+        }
+    }
+    if (file->failed) ctx->failed_count++;
+    pthread_mutex_unlock(&ctx->lock);
+    free_output_file(file);
+}
+
+// ---- 工作线程 ----
+
+static void run_job(ExtractContext *ctx, ExtractJob *job) {
+    OutputFile *file = job->file;
+
+    // 小文件由工作线程自己创建，这样 open/close 也能并行
+    if (file->fd < 0 && !file->failed) {
+        file->fd = open_output_file(ctx, file->path);
+        if (file->fd < 0) {
+            print_error("无法创建文件");
+            file->failed = 1;
+        }
+    }
+    if (!file->failed && job->len > 0 && !write_all_at(file->fd, job->data, job->len, job->offset)) {
+        print_error("写入文件失败");
+        file->failed = 1;
+    }
+
+    pthread_mutex_lock(&ctx->lock);
+    int last = --file->refs == 0;
+    ctx->queued_jobs--;
+    ctx->queued_bytes -= job->len;
+    pthread_cond_signal(&ctx->space_ready);
+    pthread_mutex_unlock(&ctx->lock);
+
+    if (last) finish_output_file(ctx, file);
+    free(job->data);
+    free(job);
+}
+
+static void *extract_worker(void *arg) {
+    ExtractContext *ctx = (ExtractContext *)arg;
+
+    for (;;) {
+        pthread_mutex_lock(&ctx->lock);
+        while (!ctx->head && !ctx->shutdown) {
+            pthread_cond_wait(&ctx->job_ready, &ctx->lock);
+        }
+        ExtractJob *job = ctx->head;
+        if (job) {
+            ctx->head = job->next;
+            if (!ctx->head) ctx->tail = NULL;
+        }
+        pthread_mutex_unlock(&ctx->lock);
+
+        if (!job) break;
+        run_job(ctx, job);
+    }
+    return NULL;
+}
+
+// 把数据块放入队列。队列中的数据超过上限时等待工作线程消化
+static void submit_job(ExtractContext *ctx, ExtractJob *job) {
+    pthread_mutex_lock(&ctx->lock);
+    while (ctx->queued_jobs > 0 &&
+           (ctx->queued_jobs >= EXTRACT_QUEUE_JOBS || ctx->queued_bytes + job->len > EXTRACT_QUEUE_BYTES)) {
+        pthread_cond_wait(&ctx->space_ready, &ctx->lock);
+    }
+    job->next = NULL;
+    if (ctx->tail) {
+        ctx->tail->next = job;
+    } else {
+        ctx->head = job;
+    }
+    ctx->tail = job;
+    ctx->queued_jobs++;
+    ctx->queued_bytes += job->len;
+    pthread_cond_signal(&ctx->job_ready);
+    pthread_mutex_unlock(&ctx->lock);
+}
+
+// 释放读线程对文件的引用
+static void release_output_file(ExtractContext *ctx, OutputFile *file) {
+    pthread_mutex_lock(&ctx->lock);
+    int last = --file->refs == 0;
+    pthread_mutex_unlock(&ctx->lock);
+    if (last) finish_output_file(ctx, file);
+}
+
+static OutputFile *new_output_file(const char *path, const TarMember *member) {
+    OutputFile *file = calloc(1, sizeof(OutputFile));
+    if (!file || !(file->path = strdup(path))) {
+        free(file);
+        return NULL;
+    }
+    file->fd = -1;
+    file->refs = 1;
+    file->mode = member->mode;
+    file->uid = member->uid;
+    file->gid = member->gid;
+    file->mtime = member->mtime;
+    return file;
+}
+
+// 读取文件数据并分发给工作线程。只有归档本身出错时返回 0
+static int dispatch_file(ExtractContext *ctx, TarReader *archive, const char *path, const TarMember *member) {
+    OutputFile *file = new_output_file(path, member);
+    if (!file) return 0;
+
+    // 大文件由读线程创建并预分配，之后各块可以乱序写入
+    if (member->size > STREAM_BUFFER_SIZE) {
+        file->fd = open_output_file(ctx, path);
+        if (file->fd < 0) {
+            print_error("无法创建文件");
+            free_output_file(file);
+            count_failure(ctx);
+            return tar_reader_skip(archive, member->size + tar_padding(member->size));
+        }
+        fallocate(file->fd, 0, 0, (off_t)member->size);
+    }
+
+    pthread_mutex_lock(&ctx->lock);
+    add_active_file(ctx, file);
+    pthread_mutex_unlock(&ctx->lock);
+
+    uint64_t offset = 0;
+    int ok = 1;
+    do {
+        uint64_t remaining = member->size - offset;
+        size_t chunk = remaining > STREAM_BUFFER_SIZE ? STREAM_BUFFER_SIZE : (size_t)remaining;
+        ExtractJob *job = malloc(sizeof(ExtractJob));
+        unsigned char *data = chunk > 0 ? malloc(chunk) : NULL;
+        if (!job || (chunk > 0 && !data) ||
+            (chunk > 0 && tar_reader_read(archive, data, chunk) != (ssize_t)chunk)) {
+            free(job);
+            free(data);
+            ok = 0;
+            break;
+        }
+
+        job->file = file;
+        job->data = data;
+        job->len = chunk;
+        job->offset = offset;
+        pthread_mutex_lock(&ctx->lock);
+        file->refs++;
+        pthread_mutex_unlock(&ctx->lock);
+        submit_job(ctx, job);
+        offset += chunk;
+    } while (offset < member->size);
+
+    if (!ok) file->failed = 1;
+    release_output_file(ctx, file);
+
+    // 跳过文件内容的填充部分
+    return ok && tar_reader_skip(archive, tar_padding(member->size));
+}
+
+// ---- 目录、链接和延后的元数据 ----
+
+static int defer_entry(ExtractContext *ctx, const char *path, const TarMember *member) {
+    if (ctx->deferred_count == ctx->deferred_capacity) {
+        size_t capacity = ctx->deferred_capacity ? ctx->deferred_capacity * 2 : 256;
+        DeferredEntry *entries = realloc(ctx->deferred, capacity * sizeof(DeferredEntry));
+        if (!entries) return 0;
+        ctx->deferred = entries;
+        ctx->deferred_capacity = capacity;
+    }
+
+    DeferredEntry *entry = &ctx->deferred[ctx->deferred_count];
+    entry->path = strdup(path);
+    entry->linkname = member->typeflag == '1' ? strdup(member->linkname) : NULL;
+    if (!entry->path || (member->typeflag == '1' && !entry->linkname)) {
+        free(entry->path);
+        free(entry->linkname);
+        return 0;
+    }
+    entry->mode = member->mode;
+    entry->uid = member->uid;
+    entry->gid = member->gid;
+    entry->mtime = member->mtime;
+    entry->typeflag = is_directory_member(member) ? '5' : member->typeflag;
+    ctx->deferred_count++;
+    return 1;
+}
+
+// 创建目录和符号链接，硬链接等数据写完后再创建。成功返回 1，失败返回 0，
+// 不支持的类型（设备文件等）返回 -1
+static int extract_special(ExtractContext *ctx, const char *path, const TarMember *member) {
+    if (member->typeflag == '1') {
+        return defer_entry(ctx, path, member);
+    }
+    if (!is_directory_member(member) && member->typeflag != '2') {
+        return -1;
+    }
+
+    char leaf[NAME_MAX + 1];
+    int dir_fd = open_parent_dir(ctx->root_fd, path, leaf, 1);
+    int ok;
+    if (is_directory_member(member)) {
+        // 目录：保留属主的写权限，否则无法在其中创建文件；最终权限在最后设置
+        ok = dir_fd >= 0 && (mkdirat(dir_fd, leaf, 0700) == 0 || errno == EEXIST);
+        if (!ok) print_error("无法创建目录");
+    } else {
+        // 符号链接，已存在的同名文件先删除
+        ok = dir_fd >= 0 && (unlinkat(dir_fd, leaf, 0) == 0 || errno == ENOENT) &&
+             symlinkat(member->linkname, dir_fd, leaf) == 0;
+        if (!ok) print_error("无法创建链接");
+    }
+    if (dir_fd >= 0) close(dir_fd);
+    return ok && defer_entry(ctx, path, member);
+}
+
+// 在提取目录下创建硬链接，链接和目标的路径都不跟随符号链接
+static int create_hard_link(const ExtractContext *ctx, const DeferredEntry *entry) {
+    const char *target = safe_member_path(entry->linkname);
+    if (!target) return 0;
+
+    char target_leaf[NAME_MAX + 1], leaf[NAME_MAX + 1];
+    int target_fd = open_parent_dir(ctx->root_fd, target, target_leaf, 0);
+    int dir_fd = open_parent_dir(ctx->root_fd, entry->path, leaf, 1);
+    int ok = target_fd >= 0 && dir_fd >= 0 &&
+             (unlinkat(dir_fd, leaf, 0) == 0 || errno == ENOENT) &&
+             linkat(target_fd, target_leaf, dir_fd, leaf, 0) == 0;
+    if (target_fd >= 0) close(target_fd);
+    if (dir_fd >= 0) close(dir_fd);
+    return ok;
+}
+
+// 设置目录或符号链接的属主、权限和修改时间。目录通过不跟随符号链接打开的描述符设置
+static void apply_deferred_metadata(const ExtractContext *ctx, const DeferredEntry *entry) {
+    char leaf[NAME_MAX + 1];
+    int dir_fd = open_parent_dir(ctx->root_fd, entry->path, leaf, 0);
+    if (dir_fd < 0) return;
+
+    struct timespec times[2] = {{entry->mtime, 0}, {entry->mtime, 0}};
+    if (entry->typeflag == '5') {
+        int fd = openat(dir_fd, leaf, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        if (fd >= 0) {
+            if (ctx->restore_owner) {
+                fchown(fd, entry->uid, entry->gid);
+            }
+            fchmod(fd, ctx->options->preserve_permissions ? entry->mode : (entry->mode | S_IRWXU));
+            futimens(fd, times);
+            close(fd);
+        }
+    } else {
+        if (ctx->restore_owner) {
+            fchownat(dir_fd, leaf, entry->uid, entry->gid, AT_SYMLINK_NOFOLLOW);
+        }
+        utimensat(dir_fd, leaf, times, AT_SYMLINK_NOFOLLOW);
+    }
+    close(dir_fd);
+}
+
+// 所有文件写完之后：先创建硬链接，再倒序（子项先于父目录）设置元数据，
+// 这样设置好的目录修改时间不会再被改变
+static void finish_deferred(ExtractContext *ctx) {
+    for (size_t i = 0; i < ctx->deferred_count; i++) {
+        DeferredEntry *entry = &ctx->deferred[i];
+        if (entry->typeflag == '1' && !create_hard_link(ctx, entry)) {
+            print_error("无法创建链接");
+            count_failure(ctx);
+        }
+    }
+
+    for (size_t i = ctx->deferred_count; i-- > 0;) {
+        DeferredEntry *entry = &ctx->deferred[i];
+        if (entry->typeflag != '1') apply_deferred_metadata(ctx, entry);
+        free(entry->path);
+        free(entry->linkname);
+    }
+    free(ctx->deferred);
+    ctx->deferred = NULL;
+    ctx->deferred_count = ctx->deferred_capacity = 0;
+}
+
+static void count_special(ExtractContext *ctx, int result) {
+    if (result < 0) return;
+    ctx->extracted_count++;
+    if (result == 0) count_failure(ctx);
+}
+
+// ---- 增量恢复 ----
+
+// 删除 dirfd 下的 name，目录连同其中的内容一起删除
+static void remove_tree(int parent_fd, const char *name) {
+    if (unlinkat(parent_fd, name, 0) == 0 || (errno != EISDIR && errno != EPERM)) return;
+
+    int fd = openat(parent_fd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0) return;
+    fchmod(fd, S_IRWXU);
+    DIR *dir = fdopendir(fd);
+    if (!dir) {
+        close(fd);
+        return;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+        remove_tree(dirfd(dir), entry->d_name);
+    }
+    closedir(dir);
+    if (unlinkat(parent_fd, name, AT_REMOVEDIR) != 0) {
+        print_error("无法删除已不存在于备份中的目录");
+    }
+}
+
+static int compare_names(const void *a, const void *b) {
+    return strcmp(*(const char *const *)a + 1, *(const char *const *)b + 1);
+}
+
+// 按 dumpdir 整理已存在的目录：删除列表中没有的条目（删除记录），以及将被本归档
+// 重新写入或类型已经改变的条目，这样后续成员总是写到干净的位置上。
+// 通过 dir_fd 读取和删除，dir_fd 由本函数关闭
+static void purge_directory(int dir_fd, const char *dump, size_t len) {
+    DIR *dir = fdopendir(dir_fd);
+    if (!dir) {
+        close(dir_fd);
+        return;
+    }
+
+    // 每项是状态字母加名字，以 '\0' 分隔，空项表示结束
+    size_t count = 0;
+    for (size_t i = 0; i < len && dump[i]; i += strlen(dump + i) + 1) count++;
+    const char **names = malloc((count ? count : 1) * sizeof(char *));
+    if (!names) {
+        closedir(dir);
+        return;
+    }
+    count = 0;
+    for (size_t i = 0; i < len && dump[i]; i += strlen(dump + i) + 1) names[count++] = dump + i;
+    qsort(names, count, sizeof(char *), compare_names);
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+
+        // bsearch 的键与元素格式相同：第一个字符被比较函数跳过
+        char key_buf[sizeof(entry->d_name) + 1];
+        const char *key = key_buf;
+        key_buf[0] = 'N';
+        memcpy(key_buf + 1, entry->d_name, strlen(entry->d_name) + 1);
+        const char **found = bsearch(&key, names, count, sizeof(char *), compare_names);
+
+        struct stat st;
+        int is_dir = fstatat(dirfd(dir), entry->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR(st.st_mode);
+        char kind = found ? (*found)[0] : 0;
+        if (!found || kind == 'Y' || (kind == 'D') != is_dir) {
+            remove_tree(dirfd(dir), entry->d_name);
+        }
+    }
+    closedir(dir);
+    free(names);
+}
+
+// 增量归档中的目录：创建目录，读取内容列表并据此清理已有内容。只有归档本身出错时返回 0
+static int extract_dumpdir(ExtractContext *ctx, TarReader *archive, const char *path, const TarMember *member) {
+    if (member->size > DUMPDIR_MAX_SIZE) {
+        print_warning("目录列表过大，跳过删除记录");
+        if (extract_special(ctx, path, member) == 0) count_failure(ctx);
+        return tar_reader_skip(archive, member->size + tar_padding(member->size));
+    }
+
+    char *dump = malloc(member->size + 1);
+    if (!dump || tar_reader_read(archive, dump, member->size) != (ssize_t)member->size) {
+        free(dump);
+        return 0;
+    }
+    dump[member->size] = '\0';
+
+    // 在提取目录下不跟随符号链接地打开目录，原来的位置上是其他类型的文件（包括
+    // 符号链接）时先删除
+    char leaf[NAME_MAX + 1];
+    int parent_fd = open_parent_dir(ctx->root_fd, path, leaf, 1);
+    if (parent_fd >= 0) {
+        struct stat st;
+        if (fstatat(parent_fd, leaf, &st, AT_SYMLINK_NOFOLLOW) == 0 && !S_ISDIR(st.st_mode)) {
+            unlinkat(parent_fd, leaf, 0);
+        }
+        int dir_fd = openat(parent_fd, leaf, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        if (dir_fd >= 0) purge_directory(dir_fd, dump, member->size);
+        close(parent_fd);
+    }
+    free(dump);
+
+    if (extract_special(ctx, path, member) == 0) count_failure(ctx);
+    return tar_reader_skip(archive, tar_padding(member->size));
+}
+
+// ---- 借助索引提取部分成员 ----
+
+// 从 archive 中顺序读取文件数据并写出。只有归档本身出错时返回 0
+static int extract_file(ExtractContext *ctx, TarReader *archive, const char *path,
+                        const TarMember *member, unsigned char *buffer) {
+    OutputFile *file = new_output_file(path, member);
+    if (!file) return 0;
+    file->fd = open_output_file(ctx, path);
+    if (file->fd < 0) {
+        // 如果无法创建文件，仍然需要跳过文件内容
+        print_error("无法创建文件");
+        free_output_file(file);
+        count_failure(ctx);
+        return tar_reader_skip(archive, member->size + tar_padding(member->size));
+    }
+
+    uint64_t done = 0;
+    int ok = 1;
+    while (done < member->size) {
+        size_t chunk = member->size - done > STREAM_BUFFER_SIZE ? STREAM_BUFFER_SIZE : (size_t)(member->size - done);
+        if (tar_reader_read(archive, buffer, chunk) != (ssize_t)chunk) {
+            ok = 0;
+            break;
+        }
+        if (!file->failed && !write_all_at(file->fd, buffer, chunk, done)) {
+            print_error("写入文件失败");
+            file->failed = 1;
+        }
+        done += chunk;
+    }
+
+    if (!ok) file->failed = 1;
+    finish_output_file(ctx, file);
+    return ok && tar_reader_skip(archive, tar_padding(member->size));
+}
+
+// 按索引中的偏移用 pread 直接读取未压缩归档中的文件数据
+static int extract_file_at(ExtractContext *ctx, int archive_fd, const char *path, const TarMember *member,
+                           uint64_t data_offset, unsigned char *buffer) {
+    OutputFile *file = new_output_file(path, member);
+    if (!file) return 0;
+    file->fd = open_output_file(ctx, path);
+    if (file->fd < 0) {
+        print_error("无法创建文件");
+        free_output_file(file);
+        count_failure(ctx);
+        return 1;
+    }
+
+    uint64_t done = 0;
+    int ok = 1;
+    while (done < member->size) {
+        size_t chunk = member->size - done > STREAM_BUFFER_SIZE ? STREAM_BUFFER_SIZE : (size_t)(member->size - done);
+        ssize_t n = pread(archive_fd, buffer, chunk, (off_t)(data_offset + done));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            ok = 0;
+            break;
+        }
+        if (!write_all_at(file->fd, buffer, (size_t)n, done)) {
+            print_error("写入文件失败");
+            file->failed = 1;
+            break;
+        }
+        done += (uint64_t)n;
+    }
+
+    if (!ok) file->failed = 1;
+    finish_output_file(ctx, file);
+    return ok;
+}
+
+// 借助索引提取指定的成员，不读取其他成员。未压缩归档直接 pread；
+// 压缩归档从成员所在的压缩块开始解压，没有块表时从头顺序解压并跳过无关数据
+static int extract_indexed(ExtractContext *ctx, TarIndexReader *index, unsigned char *buffer) {
+    const ExtractOptions *options = ctx->options;
+    int compressed = index_compressed(index);
+    int archive_fd = -1;
+    TarReader *stream = NULL;
+    uint64_t stream_base = 0;      // stream 打开位置对应的未压缩偏移
+
+    if (!compressed && (archive_fd = open(options->archive_path, O_RDONLY | O_CLOEXEC)) < 0) {
+        print_error("无法打开归档文件");
+        return 0;
+    }
+
+    TarMember member;
+    uint64_t data_offset;
+    int status;
+    int ok = 1;
+
+    while (ok && (status = index_next(index, &member, &data_offset)) == 1) {
+        const char *path = safe_member_path(member.name);
+
+        if (!member_selected(options, member.name)) {
+            free_member(&member);
+            continue;
+        }
+        if (options->verbose) {
+            printf("%s提取: '%s' (大小: %llu)%s\n", COLOR_GREEN, member.name,
+                   (unsigned long long)member.size, COLOR_RESET);
+        }
+
+        if (!path) {
+            print_warning("跳过不安全的路径");
+        } else if (is_regular_member(&member) && !compressed) {
+            ok = extract_file_at(ctx, archive_fd, path, &member, data_offset, buffer);
+            ctx->extracted_count++;
+        } else if (is_regular_member(&member)) {
+            uint64_t position = stream ? stream_base + tar_reader_offset(stream) : 0;
+            uint64_t block_offset = 0, block_start = 0;
+            int seekable = index_find_block(index, data_offset, &block_offset, &block_start);
+
+            // 目标在当前位置之前，或者跳到它所在的块比继续解压更快时重新打开
+            if (!stream || position > data_offset || (seekable && block_start > position)) {
+                if (stream) tar_reader_close(stream);
+                stream = seekable ? tar_reader_open_at(options->archive_path, 1, block_offset)
+                                  : tar_reader_open(options->archive_path, 1);
+                stream_base = seekable ? block_start : 0;
+                position = stream_base;
+            }
+            ok = stream && tar_reader_skip(stream, data_offset - position) &&
+                 extract_file(ctx, stream, path, &member, buffer);
+            ctx->extracted_count++;
+        } else {
+            count_special(ctx, extract_special(ctx, path, &member));
+        }
+        free_member(&member);
+    }
+
+    if (stream) tar_reader_close(stream);
+    if (archive_fd >= 0) close(archive_fd);
+    if (!ok || status < 0) {
+        print_error(ok ? "索引文件已损坏" : "归档文件已损坏");
+        return 0;
+    }
+    return 1;
+}
+
+// ---- 流水线提取 ----
+
+static int extract_pipelined(ExtractContext *ctx) {
+    const ExtractOptions *options = ctx->options;
+    TarReader *archive = tar_reader_open(options->archive_path, options->compression);
+    if (!archive) {
+        print_error("无法打开归档文件");
+        return 0;
+    }
+
+    pthread_t workers[MAX_JOBS];
+    int worker_count = 0;
+    int jobs = options->jobs < 1 ? 1 : (options->jobs > MAX_JOBS ? MAX_JOBS : options->jobs);
+    for (int i = 0; i < jobs; i++) {
+        if (pthread_create(&workers[worker_count], NULL, extract_worker, ctx) == 0) worker_count++;
+    }
+    if (worker_count == 0) {
+        print_error("无法创建工作线程");
+        tar_reader_close(archive);
+        return 0;
+    }
+
+    TarMember member;
+    int status;
+
+    while ((status = read_member_header(archive, &member)) == 1) {
+        const char *path = safe_member_path(member.name);
+        int consumed = 0;
+
+        if (!member_selected(options, member.name)) {
+            path = NULL;
+        } else {
+            if (options->verbose) {
+                printf("%s提取: '%s' (大小: %llu)%s\n", COLOR_GREEN, member.name,
+                       (unsigned long long)member.size, COLOR_RESET);
+            }
+            if (!path) print_warning("跳过不安全的路径");
+        }
+
+        if (path) wait_for_path(ctx, path);
+
+        if (!path) {
+            // 跳过
+        } else if (member.typeflag == 'D' && options->incremental) {
+            if (!extract_dumpdir(ctx, archive, path, &member)) {
+                free_member(&member);
+                status = -1;
+                break;
+            }
+            consumed = 1;
+            ctx->extracted_count++;
+        } else if (is_regular_member(&member)) {
+            // 普通文件
+            if (!dispatch_file(ctx, archive, path, &member)) {
+                free_member(&member);
+                status = -1;
+                break;
+            }
+            consumed = 1;
+            ctx->extracted_count++;
+        } else {
+            count_special(ctx, extract_special(ctx, path, &member));
+        }
+
+        if (!consumed && !tar_reader_skip(archive, member.size + tar_padding(member.size))) {
+            free_member(&member);
+            status = -1;
+            break;
+        }
+        free_member(&member);
+    }
+
+    // 等待队列中的数据全部写完
+    pthread_mutex_lock(&ctx->lock);
+    ctx->shutdown = 1;
+    pthread_cond_broadcast(&ctx->job_ready);
+    pthread_mutex_unlock(&ctx->lock);
+    for (int i = 0; i < worker_count; i++) {
+        pthread_join(workers[i], NULL);
+    }
+
+    tar_reader_close(archive);
+    if (status < 0) {
+        print_error("归档文件已损坏");
+        return 0;
+    }
+    return 1;
+}
+
+int extract_members(const ExtractOptions *options) {
+    ExtractContext ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.options = options;
+    ctx.restore_owner = geteuid() == 0;
+
+    printf("%s提取归档: %s%s\n", COLOR_CYAN, options->archive_path, COLOR_RESET);
+
+    ctx.root_fd = open(".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (ctx.root_fd < 0) {
+        print_error("无法打开当前目录");
+        return 0;
+    }
+    pthread_mutex_init(&ctx.lock, NULL);
+    pthread_cond_init(&ctx.job_ready, NULL);
+    pthread_cond_init(&ctx.space_ready, NULL);
+    pthread_cond_init(&ctx.file_done, NULL);
+
+    // 只提取部分成员时，有索引就直接定位，不必读取整个归档
+    TarIndexReader *index = options->member_count > 0 ? index_open(options->archive_path) : NULL;
+    int ok;
+    if (index) {
+        unsigned char *buffer = malloc(STREAM_BUFFER_SIZE);
+        ok = buffer && extract_indexed(&ctx, index, buffer);
+        free(buffer);
+        index_close(index);
+    } else {
+        ok = extract_pipelined(&ctx);
+    }
+
+    // 即使归档损坏，也为已经提取的目录设置元数据
+    finish_deferred(&ctx);
+    close(ctx.root_fd);
+
+    pthread_cond_destroy(&ctx.file_done);
+    pthread_cond_destroy(&ctx.space_ready);
+    pthread_cond_destroy(&ctx.job_ready);
+    pthread_mutex_destroy(&ctx.lock);
+
+    if (ok) {
+        printf("%s提取完成: %d 个文件%s\n", COLOR_GREEN, ctx.extracted_count - ctx.failed_count, COLOR_RESET);
+    }
+    if (ctx.failed_count > 0) {
+        char message[64];
+        snprintf(message, sizeof(message), "%d 个成员提取失败", ctx.failed_count);
+        print_error(message);
+        ok = 0;
+    }
+    return ok;
+}
@@ -0,0 +1,25 @@
+#ifndef PTAR_EXTRACT_H
+#define PTAR_EXTRACT_H
+
+#define EXTRACT_QUEUE_BYTES (64 * 1024 * 1024)  // 读线程领先工作线程的数据上限
+#define EXTRACT_QUEUE_JOBS 8192                 // 队列中的任务数上限
+#define DUMPDIR_MAX_SIZE (256 * 1024 * 1024)    // 增量归档中目录列表的上限
+
+typedef struct {
+    const char *archive_path;
+    char **members;             // 只提取这些成员及其下的内容，member_count 为 0 时提取全部
+    int member_count;
+    int compression;
+    int verbose;
+    int preserve_permissions;
+    int jobs;                   // 写文件的工作线程数
+    int incremental;            // 按增量归档恢复：删除 dumpdir 中没有列出的条目
+} ExtractOptions;
+
+// 提取归档。读线程顺序解析成员头：目录立即创建，文件数据交给工作线程用 pwrite 写出
+// （大文件先 fallocate，再分块并行写入）；硬链接在数据写完后创建，目录和符号链接的
+// 权限、修改时间和属主最后统一设置。只提取部分成员且有索引时直接定位，不读整个归档。
+// 成功返回 1
+int extract_members(const ExtractOptions *options);
+
+#endif // PTAR_EXTRACT_H
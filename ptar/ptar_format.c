@@ -0,0 +1,440 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pwd.h>
+#include <grp.h>
+#include "ptar_format.h"
+
+uint64_t tar_padding(uint64_t size) {
+    return (TAR_BLOCK_SIZE - size % TAR_BLOCK_SIZE) % TAR_BLOCK_SIZE;
+}
+
+// 数字字段：能放下时使用以 NUL 结尾的八进制，否则使用 GNU 的 base-256 编码
+static void encode_number(char *field, size_t width, uint64_t value) {
+    int octal_digits = (int)(width - 1);
+    if (octal_digits >= 22 || value < (1ULL << (3 * octal_digits))) {
+        field[octal_digits] = '\0';
+        for (int i = octal_digits; i-- > 0;) {
+            field[i] = (char)('0' + (value & 7));
+            value >>= 3;
+        }
+        return;
+    }
+    field[0] = (char)0x80;
+    for (size_t i = width - 1; i > 0; i--) {
+        field[i] = (char)(value & 0xff);
+        value >>= 8;
+    }
+}
+
+static int number_fits(size_t width, uint64_t value) {
+    return value < (1ULL << (3 * (width - 1)));
+}
+
+static uint64_t decode_number(const char *field, size_t width) {
+    uint64_t value = 0;
+
+    if ((unsigned char)field[0] & 0x80) {
+        value = (unsigned char)field[0] & 0x7f;
+        for (size_t i = 1; i < width; i++) {
+            value = (value << 8) | (unsigned char)field[i];
+        }
+        return value;
+    }
+
+    size_t i = 0;
+    while (i < width && field[i] == ' ') i++;
+    for (; i < width && field[i] >= '0' && field[i] <= '7'; i++) {
+        value = (value << 3) | (uint64_t)(field[i] - '0');
+    }
+    return value;
+}
+
+// 校验和按校验和字段为 8 个空格计算
+static unsigned long header_checksum(const TarHeader *header) {
+    const unsigned char *p = (const unsigned char *)header;
+    unsigned long sum = 8 * ' ';
+
+    for (int i = 0; i < 148; i++) sum += p[i];
+    for (int i = 156; i < TAR_BLOCK_SIZE; i++) sum += p[i];
+    return sum;
+}
+
+static void finish_header(TarHeader *header) {
+    memcpy(header->magic, "ustar", 6);
+    memcpy(header->version, "00", 2);
+    snprintf(header->chksum, sizeof(header->chksum), "%06lo", header_checksum(header));
+    header->chksum[7] = ' ';
+}
+
+static void copy_field(char *field, size_t width, const char *value) {
+    size_t len = strlen(value);
+    memcpy(field, value, len < width ? len : width);
+}
+
+// 用户名和组名通常大量重复，缓存最近一次查询
+static void fill_owner_names(TarHeader *header, uid_t uid, gid_t gid) {
+    static uid_t cached_uid = (uid_t)-1;
+    static gid_t cached_gid = (gid_t)-1;
+    static char uname[32], gname[32];
+
+    if (uid != cached_uid) {
+        struct passwd *pw = getpwuid(uid);
+        snprintf(uname, sizeof(uname), "%s", pw ? pw->pw_name : "");
+        cached_uid = uid;
+    }
+    if (gid != cached_gid) {
+        struct group *gr = getgrgid(gid);
+        snprintf(gname, sizeof(gname), "%s", gr ? gr->gr_name : "");
+        cached_gid = gid;
+    }
+    copy_field(header->uname, sizeof(header->uname), uname);
+    copy_field(header->gname, sizeof(header->gname), gname);
+}
+
+// 名字放不进 name 字段时尝试在 '/' 处拆分到 prefix 字段。目录名末尾的 '/' 不作为
+// 拆分点，留在 name 字段中
+static int split_ustar_name(TarHeader *header, const char *name) {
+    size_t len = strlen(name);
+    if (len <= sizeof(header->name)) {
+        memcpy(header->name, name, len);
+        return 1;
+    }
+    if (len > sizeof(header->prefix) + 1 + sizeof(header->name)) return 0;
+
+    for (size_t i = name[len - 1] == '/' ? len - 2 : len - 1; i > 0; i--) {
+        if (name[i] != '/') continue;
+        if (i > sizeof(header->prefix)) continue;
+        if (len - i - 1 > sizeof(header->name) || len - i - 1 == 0) return 0;
+        memcpy(header->prefix, name, i);
+        memcpy(header->name, name + i + 1, len - i - 1);
+        return 1;
+    }
+    return 0;
+}
+
+// PAX 记录格式为 "<长度> <键>=<值>\n"，长度包括长度字段本身
+static int pax_append(char **buf, size_t *len, size_t *capacity, const char *key, const char *value) {
+    size_t payload = strlen(key) + strlen(value) + 3;
+    size_t record = payload + 1;
+    for (int digits = 1;; digits++) {
+        char tmp[24];
+        record = payload + (size_t)digits;
+        if ((int)snprintf(tmp, sizeof(tmp), "%zu", record) == digits) break;
+    }
+
+    if (*len + record + 1 > *capacity) {
+        size_t new_capacity = (*len + record + 1) * 2;
+        char *grown = realloc(*buf, new_capacity);
+        if (!grown) return 0;
+        *buf = grown;
+        *capacity = new_capacity;
+    }
+    *len += (size_t)snprintf(*buf + *len, *capacity - *len, "%zu %s=%s\n", record, key, value);
+    return 1;
+}
+
+static int write_padded(TarWriter *archive, const void *data, uint64_t size) {
+    static const char zeros[TAR_BLOCK_SIZE];
+    if (!tar_writer_write(archive, data, size)) return 0;
+    return tar_writer_write(archive, zeros, tar_padding(size));
+}
+
+int member_from_stat(TarMember *member, const char *name, const struct stat *st, const char *linkname) {
+    memset(member, 0, sizeof(*member));
+
+    // 目录名以 '/' 结尾
+    size_t name_len = strlen(name);
+    int add_slash = S_ISDIR(st->st_mode) && name_len > 0 && name[name_len - 1] != '/';
+    member->name = malloc(name_len + 2);
+    member->linkname = strdup(linkname ? linkname : "");
+    if (!member->name || !member->linkname) {
+        free_member(member);
+        return 0;
+    }
+    memcpy(member->name, name, name_len);
+    if (add_slash) member->name[name_len++] = '/';
+    member->name[name_len] = '\0';
+
+    if (S_ISDIR(st->st_mode)) {
+        member->typeflag = '5';
+    } else if (S_ISLNK(st->st_mode)) {
+        member->typeflag = '2';
+    } else {
+        member->typeflag = '0';
+    }
+    member->size = S_ISREG(st->st_mode) ? (uint64_t)st->st_size : 0;
+    member->mode = st->st_mode & 07777;
+    member->uid = st->st_uid;
+    member->gid = st->st_gid;
+    member->mtime = st->st_mtime;
+    return 1;
+}
+
+int write_member_header(TarWriter *archive, const TarMember *member) {
+    TarHeader header;
+    char *pax = NULL;
+    size_t pax_len = 0, pax_capacity = 0;
+    char number[32];
+    int ok = 1;
+    uint64_t mtime = member->mtime > 0 ? (uint64_t)member->mtime : 0;
+
+    memset(&header, 0, sizeof(header));
+
+    if (!split_ustar_name(&header, member->name)) {
+        ok &= pax_append(&pax, &pax_len, &pax_capacity, "path", member->name);
+        copy_field(header.name, sizeof(header.name), member->name);
+    }
+    if (member->linkname && member->linkname[0]) {
+        if (strlen(member->linkname) > sizeof(header.linkname)) {
+            ok &= pax_append(&pax, &pax_len, &pax_capacity, "linkpath", member->linkname);
+        }
+        copy_field(header.linkname, sizeof(header.linkname), member->linkname);
+    }
+
+    if (!number_fits(sizeof(header.size), member->size)) {
+        snprintf(number, sizeof(number), "%llu", (unsigned long long)member->size);
+        ok &= pax_append(&pax, &pax_len, &pax_capacity, "size", number);
+    }
+    if (!number_fits(sizeof(header.uid), member->uid)) {
+        snprintf(number, sizeof(number), "%lu", (unsigned long)member->uid);
+        ok &= pax_append(&pax, &pax_len, &pax_capacity, "uid", number);
+    }
+    if (!number_fits(sizeof(header.gid), member->gid)) {
+        snprintf(number, sizeof(number), "%lu", (unsigned long)member->gid);
+        ok &= pax_append(&pax, &pax_len, &pax_capacity, "gid", number);
+    }
+
+    encode_number(header.mode, sizeof(header.mode), member->mode & 07777);
+    encode_number(header.uid, sizeof(header.uid), member->uid);
+    encode_number(header.gid, sizeof(header.gid), member->gid);
+    encode_number(header.size, sizeof(header.size), member->size);
+    encode_number(header.mtime, sizeof(header.mtime), mtime);
+    header.typeflag = member->typeflag;
+    fill_owner_names(&header, member->uid, member->gid);
+    finish_header(&header);
+
+    if (ok && pax_len > 0) {
+        TarHeader pax_header;
+        const char *base = strrchr(member->name, '/');
+        char pax_name[100];
+
+        // 扩展头的名字只是占位，取成员名的最后一段
+        base = (base && base[1]) ? base + 1 : member->name;
+        snprintf(pax_name, sizeof(pax_name), "PaxHeaders/%.80s", base);
+
+        memset(&pax_header, 0, sizeof(pax_header));
+        copy_field(pax_header.name, sizeof(pax_header.name), pax_name);
+        encode_number(pax_header.mode, sizeof(pax_header.mode), 0644);
+        encode_number(pax_header.uid, sizeof(pax_header.uid), 0);
+        encode_number(pax_header.gid, sizeof(pax_header.gid), 0);
+        encode_number(pax_header.size, sizeof(pax_header.size), pax_len);
+        encode_number(pax_header.mtime, sizeof(pax_header.mtime), mtime);
+        pax_header.typeflag = 'x';
+        finish_header(&pax_header);
+
+        ok = tar_writer_write(archive, &pax_header, sizeof(pax_header)) && write_padded(archive, pax, pax_len);
+    }
+
+    if (ok) ok = tar_writer_write(archive, &header, sizeof(header));
+
+    free(pax);
+    return ok;
+}
+
+// 读取扩展头的数据部分（含填充）
+static char *read_extension_data(TarReader *archive, uint64_t size) {
+    if (size > PAX_MAX_SIZE) return NULL;
+
+    char *data = malloc(size + 1);
+    if (!data) return NULL;
+    if (tar_reader_read(archive, data, size) != (ssize_t)size || !tar_reader_skip(archive, tar_padding(size))) {
+        free(data);
+        return NULL;
+    }
+    data[size] = '\0';
+    return data;
+}
+
+static void replace_string(char **target, const char *value, size_t len) {
+    char *copy = malloc(len + 1);
+    if (!copy) return;
+    memcpy(copy, value, len);
+    copy[len] = '\0';
+    free(*target);
+    *target = copy;
+}
+
+// 解析 PAX 记录，只关心会影响提取结果的键
+typedef struct {
+    char *path;
+    char *linkpath;
+    int has_size, has_uid, has_gid, has_mtime;
+    uint64_t size;
+    uint64_t uid, gid;
+    time_t mtime;
+} PaxValues;
+
+static int parse_pax(const char *data, size_t size, PaxValues *values) {
+    size_t pos = 0;
+
+    while (pos < size) {
+        char *end;
+        unsigned long long record = strtoull(data + pos, &end, 10);
+        if (end == data + pos || *end != ' ' || record == 0 || pos + record > size) return 0;
+
+        const char *key = end + 1;
+        const char *eq = memchr(key, '=', (size_t)(data + pos + record - key));
+        const char *value_end = data + pos + record - 1;   // 记录末尾的换行
+        if (!eq || *value_end != '\n') return 0;
+
+        size_t key_len = (size_t)(eq - key);
+        const char *value = eq + 1;
+        size_t value_len = (size_t)(value_end - value);
+
+        if (key_len == 4 && memcmp(key, "path", 4) == 0) {
+            replace_string(&values->path, value, value_len);
+        } else if (key_len == 8 && memcmp(key, "linkpath", 8) == 0) {
+            replace_string(&values->linkpath, value, value_len);
+        } else if (key_len == 4 && memcmp(key, "size", 4) == 0) {
+            values->size = strtoull(value, NULL, 10);
+            values->has_size = 1;
+        } else if (key_len == 3 && memcmp(key, "uid", 3) == 0) {
+            values->uid = strtoull(value, NULL, 10);
+            values->has_uid = 1;
+        } else if (key_len == 3 && memcmp(key, "gid", 3) == 0) {
+            values->gid = strtoull(value, NULL, 10);
+            values->has_gid = 1;
+        } else if (key_len == 5 && memcmp(key, "mtime", 5) == 0) {
+            values->mtime = (time_t)strtoll(value, NULL, 10);
+            values->has_mtime = 1;
+        }
+        pos += record;
+    }
+    return 1;
+}
+
+static int is_zero_block(const TarHeader *header) {
+    const unsigned char *p = (const unsigned char *)header;
+    for (size_t i = 0; i < sizeof(TarHeader); i++) {
+        if (p[i] != 0) return 0;
+    }
+    return 1;
+}
+
+static int checksum_valid(const TarHeader *header) {
+    unsigned long stored = (unsigned long)decode_number(header->chksum, sizeof(header->chksum));
+    unsigned long sum = header_checksum(header);
+    // 旧版 ptar 计算校验和时没有把校验和字段当作空格
+    return stored == sum || stored == sum - 8 * ' ';
+}
+
+int read_member_header(TarReader *archive, TarMember *member) {
+    PaxValues pax;
+    char *long_name = NULL, *long_link = NULL;
+    int result = -1;
+
+    memset(&pax, 0, sizeof(pax));
+    memset(member, 0, sizeof(*member));
+
+    for (;;) {
+        TarHeader header;
+        ssize_t n = tar_reader_read(archive, &header, sizeof(header));
+        if (n == 0 || (n == (ssize_t)sizeof(header) && is_zero_block(&header))) {
+            result = 0;
+            break;
+        }
+        if (n != (ssize_t)sizeof(header) || !checksum_valid(&header)) break;
+
+        uint64_t size = decode_number(header.size, sizeof(header.size));
+
+        // 扩展头作用于紧随其后的成员
+        if (header.typeflag == 'x' || header.typeflag == 'L' || header.typeflag == 'K') {
+            char *data = read_extension_data(archive, size);
+            if (!data) break;
+            if (header.typeflag == 'x') {
+                int parsed = parse_pax(data, size, &pax);
+                free(data);
+                if (!parsed) break;
+            } else if (header.typeflag == 'L') {
+                free(long_name);
+                long_name = data;
+            } else {
+                free(long_link);
+                long_link = data;
+            }
+            continue;
+        }
+        if (header.typeflag == 'g') {
+            if (!tar_reader_skip(archive, size + tar_padding(size))) break;
+            continue;
+        }
+
+        if (pax.path) {
+            member->name = pax.path;
+            pax.path = NULL;
+        } else if (long_name) {
+            member->name = long_name;
+            long_name = NULL;
+        } else {
+            size_t prefix_len = strnlen(header.prefix, sizeof(header.prefix));
+            size_t name_len = strnlen(header.name, sizeof(header.name));
+            int ustar = memcmp(header.magic, "ustar", 5) == 0;
+            if (!ustar) prefix_len = 0;
+
+            member->name = malloc(prefix_len + name_len + 2);
+            if (!member->name) break;
+            if (prefix_len > 0) {
+                memcpy(member->name, header.prefix, prefix_len);
+                member->name[prefix_len] = '/';
+                memcpy(member->name + prefix_len + 1, header.name, name_len);
+                member->name[prefix_len + 1 + name_len] = '\0';
+            } else {
+                memcpy(member->name, header.name, name_len);
+                member->name[name_len] = '\0';
+            }
+        }
+
+        if (pax.linkpath) {
+            member->linkname = pax.linkpath;
+            pax.linkpath = NULL;
+        } else if (long_link) {
+            member->linkname = long_link;
+            long_link = NULL;
+        } else {
+            size_t link_len = strnlen(header.linkname, sizeof(header.linkname));
+            member->linkname = malloc(link_len + 1);
+            if (!member->linkname) break;
+            memcpy(member->linkname, header.linkname, link_len);
+            member->linkname[link_len] = '\0';
+        }
+
+        member->typeflag = header.typeflag;
+        member->mode = (mode_t)(decode_number(header.mode, sizeof(header.mode)) & 07777);
+        member->size = pax.has_size ? pax.size : size;
+        member->uid = (uid_t)(pax.has_uid ? pax.uid : decode_number(header.uid, sizeof(header.uid)));
+        member->gid = (gid_t)(pax.has_gid ? pax.gid : decode_number(header.gid, sizeof(header.gid)));
+        member->mtime = pax.has_mtime ? pax.mtime : (time_t)decode_number(header.mtime, sizeof(header.mtime));
+
+        // 链接、设备、目录和 FIFO 没有数据（旧版 ptar 会把链接长度写进 size 字段）
+        if (member->typeflag >= '1' && member->typeflag <= '6') {
+            member->size = 0;
+        }
+        result = 1;
+        break;
+    }
+
+    free(pax.path);
+    free(pax.linkpath);
+    free(long_name);
+    free(long_link);
+    if (result != 1) free_member(member);
+    return result;
+}
+
+void free_member(TarMember *member) {
+    free(member->name);
+    free(member->linkname);
+    member->name = NULL;
+    member->linkname = NULL;
+}
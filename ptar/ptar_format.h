@@ -0,0 +1,59 @@
+#ifndef PTAR_FORMAT_H
+#define PTAR_FORMAT_H
+
+#include <stdint.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "ptar_stream.h"
+
+#define TAR_BLOCK_SIZE 512
+#define PAX_MAX_SIZE (16 * 1024 * 1024)   // 扩展头数据的上限
+
+// tar文件头结构 - 使用packed确保结构体对齐
+typedef struct __attribute__((packed)) {
+    char name[100];         // 文件名
+    char mode[8];           // 文件权限
+    char uid[8];            // 用户ID
+    char gid[8];            // 组ID
+    char size[12];          // 文件大小
+    char mtime[12];         // 修改时间
+    char chksum[8];         // 校验和
+    char typeflag;          // 文件类型
+    char linkname[100];     // 链接目标
+    char magic[6];          // 魔数
+    char version[2];        // 版本
+    char uname[32];         // 用户名
+    char gname[32];         // 组名
+    char devmajor[8];       // 主设备号
+    char devminor[8];       // 次设备号
+    char prefix[155];       // 路径前缀
+    char padding[12];       // 填充
+} TarHeader;
+
+// 解析后的归档成员，PAX 和 GNU 长名扩展头已经合并
+typedef struct {
+    char *name;
+    char *linkname;
+    uint64_t size;
+    mode_t mode;
+    uid_t uid;
+    gid_t gid;
+    time_t mtime;
+    char typeflag;
+} TarMember;
+
+// 数据之后补齐到块边界所需的字节数
+uint64_t tar_padding(uint64_t size);
+
+// 根据 lstat 结果填写成员（目录名补上 '/'），成功返回 1，之后需要 free_member
+int member_from_stat(TarMember *member, const char *name, const struct stat *st, const char *linkname);
+
+// 写入成员头。名字超过 ustar 字段、大小超过 8 GB 或 ID 超出范围时，
+// 先写一个 PAX 扩展头（typeflag 'x'）。成功返回 1
+int write_member_header(TarWriter *archive, const TarMember *member);
+
+// 读取下一个成员头。返回 1 表示读到成员，0 表示归档结束，-1 表示格式错误
+int read_member_header(TarReader *archive, TarMember *member);
+void free_member(TarMember *member);
+
+#endif // PTAR_FORMAT_H
@@ -0,0 +1,286 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "ptar_index.h"
+
+#define INDEX_MAGIC "PTARIDX1"
+#define INDEX_FOOTER_SIZE 32
+#define INDEX_MAX_NAME (1024 * 1024)
+
+// 索引格式：魔数、压缩标志，然后每个成员一条记录（名字长度加一，0 表示结束），
+// 之后是块表，最后是固定长度的尾部：块表偏移、归档大小、归档修改时间（纳秒）、魔数
+struct TarIndexWriter {
+    FILE *fp;
+    char *path;
+    char *tmp_path;
+    char *archive_path;
+};
+
+struct TarIndexReader {
+    FILE *fp;
+    int compressed;
+    uint64_t *blocks;
+    size_t block_count;
+};
+
+// ---- LEB128 变长整数 ----
+
+static void write_varint(FILE *fp, uint64_t value) {
+    while (value >= 0x80) {
+        fputc((int)(value & 0x7f) | 0x80, fp);
+        value >>= 7;
+    }
+    fputc((int)value, fp);
+}
+
+static int read_varint(FILE *fp, uint64_t *value) {
+    uint64_t result = 0;
+    int shift = 0;
+    int c;
+
+    while ((c = fgetc(fp)) != EOF) {
+        if (shift > 63) return -1;
+        result |= (uint64_t)(c & 0x7f) << shift;
+        if (!(c & 0x80)) {
+            *value = result;
+            return 0;
+        }
+        shift += 7;
+    }
+    return -1;
+}
+
+static void write_u64(unsigned char *p, uint64_t value) {
+    for (int i = 0; i < 8; i++) p[i] = (unsigned char)(value >> (8 * i));
+}
+
+static uint64_t read_u64(const unsigned char *p) {
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; i--) value = (value << 8) | p[i];
+    return value;
+}
+
+static char *path_with_suffix(const char *path, const char *suffix) {
+    size_t len = strlen(path) + strlen(suffix) + 1;
+    char *result = malloc(len);
+    if (result) snprintf(result, len, "%s%s", path, suffix);
+    return result;
+}
+
+static uint64_t mtime_ns(const struct stat *st) {
+    return (uint64_t)st->st_mtim.tv_sec * 1000000000ULL + (uint64_t)st->st_mtim.tv_nsec;
+}
+
+// ---- 写入 ----
+
+TarIndexWriter *index_writer_open(const char *archive_path, int compressed) {
+    TarIndexWriter *index = calloc(1, sizeof(TarIndexWriter));
+    if (!index) return NULL;
+
+    index->archive_path = strdup(archive_path);
+    index->path = path_with_suffix(archive_path, INDEX_SUFFIX);
+    index->tmp_path = path_with_suffix(archive_path, INDEX_SUFFIX ".tmp");
+    if (!index->archive_path || !index->path || !index->tmp_path ||
+        !(index->fp = fopen(index->tmp_path, "wb"))) {
+        free(index->archive_path);
+        free(index->path);
+        free(index->tmp_path);
+        free(index);
+        return NULL;
+    }
+    setvbuf(index->fp, NULL, _IOFBF, 1024 * 1024);
+
+    fwrite(INDEX_MAGIC, 1, 8, index->fp);
+    write_varint(index->fp, compressed ? 1 : 0);
+    return index;
+}
+
+int index_writer_add(TarIndexWriter *index, const TarMember *member, uint64_t data_offset) {
+    size_t name_len = strlen(member->name);
+    size_t link_len = member->linkname ? strlen(member->linkname) : 0;
+
+    write_varint(index->fp, name_len + 1);
+    fwrite(member->name, 1, name_len, index->fp);
+    fputc(member->typeflag, index->fp);
+    write_varint(index->fp, member->mode);
+    write_varint(index->fp, member->uid);
+    write_varint(index->fp, member->gid);
+    write_varint(index->fp, member->mtime > 0 ? (uint64_t)member->mtime : 0);
+    write_varint(index->fp, member->size);
+    write_varint(index->fp, data_offset);
+    write_varint(index->fp, link_len);
+    if (link_len > 0) fwrite(member->linkname, 1, link_len, index->fp);
+    return !ferror(index->fp);
+}
+
+static void free_writer(TarIndexWriter *index) {
+    free(index->archive_path);
+    free(index->path);
+    free(index->tmp_path);
+    free(index);
+}
+
+int index_writer_close(TarIndexWriter *index, const BlockTable *blocks) {
+    struct stat st;
+    int ok = 1;
+
+    write_varint(index->fp, 0);
+    uint64_t blocks_offset = (uint64_t)ftello(index->fp);
+
+    size_t count = blocks ? blocks->count : 0;
+    write_varint(index->fp, count);
+    for (size_t i = 0; i < count; i++) {
+        write_varint(index->fp, blocks->offsets[i] - (i > 0 ? blocks->offsets[i - 1] : 0));
+    }
+
+    // 记录归档的大小和修改时间，归档被改动后索引自动失效
+    unsigned char footer[INDEX_FOOTER_SIZE];
+    if (stat(index->archive_path, &st) != 0) ok = 0;
+    write_u64(footer, blocks_offset);
+    write_u64(footer + 8, ok ? (uint64_t)st.st_size : 0);
+    write_u64(footer + 16, ok ? mtime_ns(&st) : 0);
+    memcpy(footer + 24, INDEX_MAGIC, 8);
+    fwrite(footer, 1, sizeof(footer), index->fp);
+
+    if (ferror(index->fp)) ok = 0;
+    if (fclose(index->fp) != 0) ok = 0;
+    if (ok && rename(index->tmp_path, index->path) != 0) ok = 0;
+    if (!ok) unlink(index->tmp_path);
+
+    free_writer(index);
+    return ok;
+}
+
+void index_writer_abort(TarIndexWriter *index) {
+    fclose(index->fp);
+    unlink(index->tmp_path);
+    free_writer(index);
+}
+
+// ---- 读取 ----
+
+TarIndexReader *index_open(const char *archive_path) {
+    struct stat st;
+    unsigned char footer[INDEX_FOOTER_SIZE];
+    char magic[8];
+    uint64_t value;
+
+    char *path = path_with_suffix(archive_path, INDEX_SUFFIX);
+    if (!path) return NULL;
+    FILE *fp = fopen(path, "rb");
+    free(path);
+    if (!fp) return NULL;
+
+    TarIndexReader *index = calloc(1, sizeof(TarIndexReader));
+    if (!index) {
+        fclose(fp);
+        return NULL;
+    }
+    index->fp = fp;
+    setvbuf(fp, NULL, _IOFBF, 1024 * 1024);
+
+    if (stat(archive_path, &st) != 0 ||
+        fseeko(fp, -INDEX_FOOTER_SIZE, SEEK_END) != 0 ||
+        fread(footer, 1, sizeof(footer), fp) != sizeof(footer) ||
+        memcmp(footer + 24, INDEX_MAGIC, 8) != 0 ||
+        read_u64(footer + 8) != (uint64_t)st.st_size ||
+        read_u64(footer + 16) != mtime_ns(&st)) {
+        goto fail;
+    }
+
+    // 先读块表，再回到开头准备逐条读取成员
+    if (fseeko(fp, (off_t)read_u64(footer), SEEK_SET) != 0 || read_varint(fp, &value) != 0 ||
+        value > (uint64_t)st.st_size) {
+        goto fail;
+    }
+    index->block_count = (size_t)value;
+    if (index->block_count > 0) {
+        index->blocks = malloc(index->block_count * sizeof(uint64_t));
+        if (!index->blocks) goto fail;
+    }
+    uint64_t offset = 0;
+    for (size_t i = 0; i < index->block_count; i++) {
+        if (read_varint(fp, &value) != 0) goto fail;
+        offset += value;
+        index->blocks[i] = offset;
+    }
+
+    if (fseeko(fp, 0, SEEK_SET) != 0 || fread(magic, 1, 8, fp) != 8 ||
+        memcmp(magic, INDEX_MAGIC, 8) != 0 || read_varint(fp, &value) != 0) {
+        goto fail;
+    }
+    index->compressed = value != 0;
+    return index;
+
+fail:
+    index_close(index);
+    return NULL;
+}
+
+int index_compressed(const TarIndexReader *index) {
+    return index->compressed;
+}
+
+static char *read_string(FILE *fp, uint64_t len) {
+    if (len > INDEX_MAX_NAME) return NULL;
+    char *s = malloc(len + 1);
+    if (!s) return NULL;
+    if (fread(s, 1, len, fp) != len) {
+        free(s);
+        return NULL;
+    }
+    s[len] = '\0';
+    return s;
+}
+
+int index_next(TarIndexReader *index, TarMember *member, uint64_t *data_offset) {
+    uint64_t name_len, mode, uid, gid, mtime, size, link_len;
+    int typeflag;
+
+    memset(member, 0, sizeof(*member));
+    if (read_varint(index->fp, &name_len) != 0) return -1;
+    if (name_len == 0) return 0;
+
+    member->name = read_string(index->fp, name_len - 1);
+    if (!member->name) return -1;
+
+    if ((typeflag = fgetc(index->fp)) == EOF ||
+        read_varint(index->fp, &mode) != 0 ||
+        read_varint(index->fp, &uid) != 0 ||
+        read_varint(index->fp, &gid) != 0 ||
+        read_varint(index->fp, &mtime) != 0 ||
+        read_varint(index->fp, &size) != 0 ||
+        read_varint(index->fp, data_offset) != 0 ||
+        read_varint(index->fp, &link_len) != 0 ||
+        !(member->linkname = read_string(index->fp, link_len))) {
+        free_member(member);
+        return -1;
+    }
+
+    member->typeflag = (char)typeflag;
+    member->mode = (mode_t)mode;
+    member->uid = (uid_t)uid;
+    member->gid = (gid_t)gid;
+    member->mtime = (time_t)mtime;
+    member->size = size;
+    return 1;
+}
+
+int index_find_block(const TarIndexReader *index, uint64_t offset,
+                     uint64_t *compressed_offset, uint64_t *block_start) {
+    if (index->block_count == 0) return 0;
+
+    size_t block = (size_t)(offset / GZIP_BLOCK_SIZE);
+    if (block >= index->block_count) block = index->block_count - 1;
+    *compressed_offset = index->blocks[block];
+    *block_start = (uint64_t)block * GZIP_BLOCK_SIZE;
+    return 1;
+}
+
+void index_close(TarIndexReader *index) {
+    if (index->fp) fclose(index->fp);
+    free(index->blocks);
+    free(index);
+}
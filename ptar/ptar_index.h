@@ -0,0 +1,31 @@
+#ifndef PTAR_INDEX_H
+#define PTAR_INDEX_H
+
+#include <stdint.h>
+#include "ptar_format.h"
+#include "ptar_stream.h"
+
+#define INDEX_SUFFIX ".idx"     // 索引文件与归档同名，加上此后缀
+
+// 索引记录每个成员的元数据和数据在（未压缩）归档中的偏移；压缩归档还记录块表，
+// 因此列出内容只需读取索引，提取单个成员时可以直接定位到它所在的块
+typedef struct TarIndexWriter TarIndexWriter;
+typedef struct TarIndexReader TarIndexReader;
+
+TarIndexWriter *index_writer_open(const char *archive_path, int compressed);
+int index_writer_add(TarIndexWriter *index, const TarMember *member, uint64_t data_offset);
+// 归档关闭后调用：写入块表和归档的大小、修改时间，然后原子替换旧索引。成功返回 1
+int index_writer_close(TarIndexWriter *index, const BlockTable *blocks);
+void index_writer_abort(TarIndexWriter *index);
+
+// 索引不存在或与归档不匹配（归档已被修改）时返回 NULL
+TarIndexReader *index_open(const char *archive_path);
+int index_compressed(const TarIndexReader *index);
+// 依次读取成员。返回 1 表示读到成员，0 表示结束，-1 表示索引损坏
+int index_next(TarIndexReader *index, TarMember *member, uint64_t *data_offset);
+// 找到包含 offset 的压缩块。块表为空（例如为其他工具生成的 gzip 建立的索引）时返回 0
+int index_find_block(const TarIndexReader *index, uint64_t offset,
+                     uint64_t *compressed_offset, uint64_t *block_start);
+void index_close(TarIndexReader *index);
+
+#endif // PTAR_INDEX_H
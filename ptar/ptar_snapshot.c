@@ -0,0 +1,215 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include "ptar_snapshot.h"
+
+#define SNAPSHOT_MAGIC "PTARSNAP1\n"
+#define SNAPSHOT_TMP_SUFFIX ".tmp"
+
+// 快照格式：魔数行，然后每个文件一条以 '\0' 结尾的记录：
+// "设备号 inode 修改时间(ns) 状态改变时间(ns) 大小 路径"
+typedef struct {
+    const char *name;           // 指向 data 中的路径
+    uint64_t dev;
+    uint64_t ino;
+    uint64_t mtime;
+    uint64_t ctime;
+    uint64_t size;
+} SnapshotEntry;
+
+struct Snapshot {
+    char *data;                 // 整个快照文件的内容
+    SnapshotEntry *slots;       // 开放寻址哈希表，name 为 NULL 表示空位
+    size_t slot_count;          // 2 的幂
+};
+
+struct SnapshotWriter {
+    FILE *fp;
+    char *path;
+    char *tmp_path;
+};
+
+static uint64_t hash_name(const char *name) {
+    uint64_t hash = 14695981039346656037ULL;       // FNV-1a
+    for (const unsigned char *p = (const unsigned char *)name; *p; p++) {
+        hash ^= *p;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static uint64_t time_ns(const struct timespec *ts) {
+    return (uint64_t)ts->tv_sec * 1000000000ULL + (uint64_t)ts->tv_nsec;
+}
+
+static char *read_whole_file(const char *path, size_t *size) {
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return NULL;
+
+    size_t capacity = 64 * 1024;
+    size_t len = 0;
+    char *data = malloc(capacity + 1);
+    while (data) {
+        len += fread(data + len, 1, capacity - len, fp);
+        if (len < capacity) break;
+        capacity *= 2;
+        char *grown = realloc(data, capacity + 1);
+        if (!grown) {
+            free(data);
+            data = NULL;
+        } else {
+            data = grown;
+        }
+    }
+    if (data && ferror(fp)) {
+        free(data);
+        data = NULL;
+    }
+    fclose(fp);
+
+    if (data) {
+        data[len] = '\0';
+        *size = len;
+    }
+    return data;
+}
+
+// ---- 读取 ----
+
+Snapshot *snapshot_load(const char *path) {
+    Snapshot *snapshot = calloc(1, sizeof(Snapshot));
+    if (!snapshot) return NULL;
+
+    size_t size;
+    snapshot->data = read_whole_file(path, &size);
+    if (!snapshot->data) {
+        if (errno == ENOENT) return snapshot;
+        free(snapshot);
+        return NULL;
+    }
+
+    size_t magic_len = strlen(SNAPSHOT_MAGIC);
+    if (size < magic_len || memcmp(snapshot->data, SNAPSHOT_MAGIC, magic_len) != 0) {
+        snapshot_free(snapshot);
+        return NULL;
+    }
+
+    // 记录数不超过 '\0' 的个数，哈希表保持一半以下的装载率
+    size_t records = 0;
+    for (size_t i = magic_len; i < size; i++) {
+        if (snapshot->data[i] == '\0') records++;
+    }
+    snapshot->slot_count = 16;
+    while (snapshot->slot_count < records * 2) snapshot->slot_count *= 2;
+    snapshot->slots = calloc(snapshot->slot_count, sizeof(SnapshotEntry));
+    if (!snapshot->slots) {
+        snapshot_free(snapshot);
+        return NULL;
+    }
+
+    char *p = snapshot->data + magic_len;
+    char *end = snapshot->data + size;
+    while (p < end) {
+        SnapshotEntry entry;
+        char *record_end = p + strlen(p);
+        if (record_end >= end) break;      // 最后一条记录不完整
+
+        char *q = p;
+        entry.dev = strtoull(q, &q, 10);
+        entry.ino = strtoull(q, &q, 10);
+        entry.mtime = strtoull(q, &q, 10);
+        entry.ctime = strtoull(q, &q, 10);
+        entry.size = strtoull(q, &q, 10);
+        if (*q != ' ' || q + 1 >= record_end) {
+            snapshot_free(snapshot);
+            return NULL;
+        }
+        entry.name = q + 1;
+
+        size_t mask = snapshot->slot_count - 1;
+        size_t slot = (size_t)hash_name(entry.name) & mask;
+        while (snapshot->slots[slot].name && strcmp(snapshot->slots[slot].name, entry.name) != 0) {
+            slot = (slot + 1) & mask;
+        }
+        snapshot->slots[slot] = entry;
+        p = record_end + 1;
+    }
+    return snapshot;
+}
+
+int snapshot_changed(const Snapshot *snapshot, const char *name, const struct stat *st) {
+    if (!snapshot || snapshot->slot_count == 0) return 1;
+
+    size_t mask = snapshot->slot_count - 1;
+    for (size_t slot = (size_t)hash_name(name) & mask; snapshot->slots[slot].name; slot = (slot + 1) & mask) {
+        const SnapshotEntry *entry = &snapshot->slots[slot];
+        if (strcmp(entry->name, name) != 0) continue;
+
+        return entry->dev != (uint64_t)st->st_dev || entry->ino != (uint64_t)st->st_ino ||
+               entry->mtime != time_ns(&st->st_mtim) || entry->ctime != time_ns(&st->st_ctim) ||
+               entry->size != (uint64_t)st->st_size;
+    }
+    return 1;
+}
+
+void snapshot_free(Snapshot *snapshot) {
+    if (!snapshot) return;
+    free(snapshot->slots);
+    free(snapshot->data);
+    free(snapshot);
+}
+
+// ---- 写入 ----
+
+SnapshotWriter *snapshot_writer_open(const char *path) {
+    SnapshotWriter *writer = calloc(1, sizeof(SnapshotWriter));
+    if (!writer) return NULL;
+
+    size_t len = strlen(path) + sizeof(SNAPSHOT_TMP_SUFFIX);
+    writer->path = strdup(path);
+    writer->tmp_path = malloc(len);
+    if (writer->tmp_path) snprintf(writer->tmp_path, len, "%s%s", path, SNAPSHOT_TMP_SUFFIX);
+    if (!writer->path || !writer->tmp_path || !(writer->fp = fopen(writer->tmp_path, "wb"))) {
+        free(writer->path);
+        free(writer->tmp_path);
+        free(writer);
+        return NULL;
+    }
+    setvbuf(writer->fp, NULL, _IOFBF, 1024 * 1024);
+    fputs(SNAPSHOT_MAGIC, writer->fp);
+    return writer;
+}
+
+int snapshot_writer_add(SnapshotWriter *writer, const char *name, const struct stat *st) {
+    fprintf(writer->fp, "%llu %llu %llu %llu %llu %s",
+            (unsigned long long)st->st_dev, (unsigned long long)st->st_ino,
+            (unsigned long long)time_ns(&st->st_mtim), (unsigned long long)time_ns(&st->st_ctim),
+            (unsigned long long)st->st_size, name);
+    fputc('\0', writer->fp);
+    return !ferror(writer->fp);
+}
+
+static void free_writer(SnapshotWriter *writer) {
+    free(writer->path);
+    free(writer->tmp_path);
+    free(writer);
+}
+
+int snapshot_writer_close(SnapshotWriter *writer) {
+    int ok = !ferror(writer->fp);
+    if (fflush(writer->fp) != 0 || fsync(fileno(writer->fp)) != 0) ok = 0;
+    if (fclose(writer->fp) != 0) ok = 0;
+    if (ok && rename(writer->tmp_path, writer->path) != 0) ok = 0;
+    if (!ok) unlink(writer->tmp_path);
+    free_writer(writer);
+    return ok;
+}
+
+void snapshot_writer_abort(SnapshotWriter *writer) {
+    fclose(writer->fp);
+    unlink(writer->tmp_path);
+    free_writer(writer);
+}
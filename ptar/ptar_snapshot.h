@@ -0,0 +1,23 @@
+#ifndef PTAR_SNAPSHOT_H
+#define PTAR_SNAPSHOT_H
+
+#include <sys/stat.h>
+
+// 增量备份的快照文件：记录上次归档时每个文件的设备号、inode、修改时间、
+// 状态改变时间和大小。下次归档时只有新增或任一字段变化的文件需要写入
+typedef struct Snapshot Snapshot;
+typedef struct SnapshotWriter SnapshotWriter;
+
+// 快照文件不存在时返回空快照（第一次为完整备份），格式错误或读取失败返回 NULL
+Snapshot *snapshot_load(const char *path);
+// 文件是新增的或自上次快照以来发生了变化时返回 1
+int snapshot_changed(const Snapshot *snapshot, const char *name, const struct stat *st);
+void snapshot_free(Snapshot *snapshot);
+
+// 新快照先写入临时文件，归档成功后再替换旧快照
+SnapshotWriter *snapshot_writer_open(const char *path);
+int snapshot_writer_add(SnapshotWriter *writer, const char *name, const struct stat *st);
+int snapshot_writer_close(SnapshotWriter *writer);
+void snapshot_writer_abort(SnapshotWriter *writer);
+
+#endif // PTAR_SNAPSHOT_H
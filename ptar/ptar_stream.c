@@ -0,0 +1,634 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/sendfile.h>
+#include <zlib.h>
+#include "ptar_stream.h"
+
+#define IO_ALIGNMENT 4096
+
+typedef enum {
+    SLOT_FREE,      // 可以填充
+    SLOT_FILLED,    // 等待压缩
+    SLOT_DONE       // 压缩完成，等待按顺序写出
+} SlotState;
+
+// 一个独立压缩的块
+typedef struct {
+    unsigned char *in;
+    size_t in_len;
+    unsigned char *out;
+    size_t out_len;
+    size_t out_capacity;
+    uLong crc;
+    int last;           // 最后一块以 Z_FINISH 结束，其余块以 Z_SYNC_FLUSH 按字节对齐
+    int failed;
+    SlotState state;
+} GzipSlot;
+
+struct TarWriter {
+    int fd;
+    int compress;
+    unsigned char *buffer;      // 未压缩模式的输出缓冲区
+    size_t buffer_len;
+
+    // 压缩模式：slot_count 个块组成环形队列，序号对 slot_count 取模得到位置
+    GzipSlot *slots;
+    int slot_count;
+    GzipSlot *current;          // 正在填充的块
+    uint64_t filled_seq;        // 已提交的块数
+    uint64_t compress_seq;      // 已被工作线程领取的块数
+    uint64_t write_seq;         // 已写出的块数
+    uLong crc;
+    uint64_t total_in;
+    uint64_t offset;            // 已接收的未压缩字节数
+    uint64_t compressed_offset; // 已写出的压缩字节数
+    BlockTable blocks;
+    size_t blocks_capacity;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_t workers[MAX_JOBS];
+    int worker_count;
+    int shutdown;
+    int error;
+};
+
+struct TarReader {
+    int fd;
+    int gzip;
+    unsigned char *in;
+    size_t in_len;
+    size_t in_pos;              // 未压缩模式下缓冲区的读取位置
+    z_stream zs;
+    int member_open;            // 当前 gzip 成员尚未结束
+    int raw;                    // 从块起点开始的原始 deflate 数据，没有 gzip 头
+    int finished;
+    uint64_t offset;
+    int error;
+};
+
+static int write_all(int fd, const void *data, size_t len) {
+    const char *p = (const char *)data;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 1;
+}
+
+static void *aligned_buffer(size_t size) {
+    void *p = NULL;
+    return posix_memalign(&p, IO_ALIGNMENT, size) == 0 ? p : NULL;
+}
+
+// ---- 并行压缩 ----
+
+static void compress_block(GzipSlot *slot) {
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+
+    slot->crc = crc32(0L, slot->in, (uInt)slot->in_len);
+    slot->failed = 1;
+    slot->out_len = 0;
+
+    // 原始 deflate（无 zlib/gzip 头），块之间互不依赖
+    if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return;
+    }
+    zs.next_in = slot->in;
+    zs.avail_in = (uInt)slot->in_len;
+    zs.next_out = slot->out;
+    zs.avail_out = (uInt)slot->out_capacity;
+
+    int ret = deflate(&zs, slot->last ? Z_FINISH : Z_SYNC_FLUSH);
+    if ((slot->last && ret == Z_STREAM_END) || (!slot->last && ret == Z_OK && zs.avail_in == 0 && zs.avail_out > 0)) {
+        slot->out_len = slot->out_capacity - zs.avail_out;
+        slot->failed = 0;
+    }
+    deflateEnd(&zs);
+}
+
+static void *compress_worker(void *arg) {
+    TarWriter *writer = (TarWriter *)arg;
+
+    pthread_mutex_lock(&writer->lock);
+    for (;;) {
+        while (writer->compress_seq == writer->filled_seq && !writer->shutdown) {
+            pthread_cond_wait(&writer->cond, &writer->lock);
+        }
+        if (writer->compress_seq == writer->filled_seq) break;
+
+        GzipSlot *slot = &writer->slots[writer->compress_seq % writer->slot_count];
+        writer->compress_seq++;
+        pthread_mutex_unlock(&writer->lock);
+
+        compress_block(slot);
+
+        pthread_mutex_lock(&writer->lock);
+        slot->state = SLOT_DONE;
+        pthread_cond_broadcast(&writer->cond);
+    }
+    pthread_mutex_unlock(&writer->lock);
+    return NULL;
+}
+
+// 按顺序写出已压缩的块。调用者持有锁，写文件时临时释放；只有主线程写文件
+static void flush_done_blocks(TarWriter *writer) {
+    for (;;) {
+        GzipSlot *slot = &writer->slots[writer->write_seq % writer->slot_count];
+        if (writer->write_seq == writer->filled_seq || slot->state != SLOT_DONE) return;
+        pthread_mutex_unlock(&writer->lock);
+
+        // 记录块在压缩文件中的起点
+        if (writer->blocks.count == writer->blocks_capacity) {
+            size_t capacity = writer->blocks_capacity ? writer->blocks_capacity * 2 : 1024;
+            uint64_t *offsets = realloc(writer->blocks.offsets, capacity * sizeof(uint64_t));
+            if (offsets) {
+                writer->blocks.offsets = offsets;
+                writer->blocks_capacity = capacity;
+            }
+        }
+        if (writer->blocks.count < writer->blocks_capacity) {
+            writer->blocks.offsets[writer->blocks.count++] = writer->compressed_offset;
+        } else {
+            writer->error = 1;
+        }
+
+        if (slot->failed || !write_all(writer->fd, slot->out, slot->out_len)) {
+            writer->error = 1;
+        }
+        writer->compressed_offset += slot->out_len;
+        writer->crc = crc32_combine(writer->crc, slot->crc, (z_off_t)slot->in_len);
+        writer->total_in += slot->in_len;
+
+        pthread_mutex_lock(&writer->lock);
+        slot->state = SLOT_FREE;
+        writer->write_seq++;
+    }
+}
+
+// 取得下一个可填充的块，环形队列满时边等待边写出
+static GzipSlot *acquire_slot(TarWriter *writer) {
+    pthread_mutex_lock(&writer->lock);
+    GzipSlot *slot = &writer->slots[writer->filled_seq % writer->slot_count];
+    for (;;) {
+        flush_done_blocks(writer);
+        if (slot->state == SLOT_FREE) break;
+        pthread_cond_wait(&writer->cond, &writer->lock);
+    }
+    pthread_mutex_unlock(&writer->lock);
+
+    slot->in_len = 0;
+    slot->last = 0;
+    return slot;
+}
+
+static void submit_slot(TarWriter *writer, GzipSlot *slot) {
+    pthread_mutex_lock(&writer->lock);
+    slot->state = SLOT_FILLED;
+    writer->filled_seq++;
+    pthread_cond_broadcast(&writer->cond);
+    pthread_mutex_unlock(&writer->lock);
+}
+
+static int init_gzip_writer(TarWriter *writer, int jobs) {
+    // gzip 头：无文件名、mtime 为 0、操作系统为 Unix
+    static const unsigned char header[10] = {0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 3};
+
+    if (jobs < 1) jobs = 1;
+    if (jobs > MAX_JOBS) jobs = MAX_JOBS;
+
+    writer->slot_count = jobs * 2;
+    writer->slots = calloc((size_t)writer->slot_count, sizeof(GzipSlot));
+    if (!writer->slots) return 0;
+
+    size_t out_capacity = compressBound(GZIP_BLOCK_SIZE) + 64;
+    for (int i = 0; i < writer->slot_count; i++) {
+        writer->slots[i].in = malloc(GZIP_BLOCK_SIZE);
+        writer->slots[i].out = malloc(out_capacity);
+        writer->slots[i].out_capacity = out_capacity;
+        if (!writer->slots[i].in || !writer->slots[i].out) return 0;
+    }
+
+    writer->crc = crc32(0L, Z_NULL, 0);
+    pthread_mutex_init(&writer->lock, NULL);
+    pthread_cond_init(&writer->cond, NULL);
+
+    for (int i = 0; i < jobs; i++) {
+        if (pthread_create(&writer->workers[writer->worker_count], NULL, compress_worker, writer) == 0) {
+            writer->worker_count++;
+        }
+    }
+    if (writer->worker_count == 0) return 0;
+
+    writer->compressed_offset = sizeof(header);
+    return write_all(writer->fd, header, sizeof(header));
+}
+
+static void free_writer(TarWriter *writer) {
+    if (writer->slots) {
+        for (int i = 0; i < writer->slot_count; i++) {
+            free(writer->slots[i].in);
+            free(writer->slots[i].out);
+        }
+        free(writer->slots);
+    }
+    free(writer->blocks.offsets);
+    free(writer->buffer);
+    free(writer);
+}
+
+TarWriter *tar_writer_open(const char *path, int compress, int jobs) {
+    TarWriter *writer = calloc(1, sizeof(TarWriter));
+    if (!writer) return NULL;
+
+    writer->compress = compress;
+    writer->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (writer->fd < 0) {
+        free(writer);
+        return NULL;
+    }
+
+    int ok = compress ? init_gzip_writer(writer, jobs)
+                      : (writer->buffer = aligned_buffer(STREAM_BUFFER_SIZE)) != NULL;
+    if (!ok) {
+        if (writer->worker_count > 0) {
+            pthread_mutex_lock(&writer->lock);
+            writer->shutdown = 1;
+            pthread_cond_broadcast(&writer->cond);
+            pthread_mutex_unlock(&writer->lock);
+            for (int i = 0; i < writer->worker_count; i++) pthread_join(writer->workers[i], NULL);
+        }
+        close(writer->fd);
+        free_writer(writer);
+        return NULL;
+    }
+    return writer;
+}
+
+static int flush_buffer(TarWriter *writer) {
+    if (writer->buffer_len > 0 && !write_all(writer->fd, writer->buffer, writer->buffer_len)) {
+        writer->error = 1;
+        return 0;
+    }
+    writer->buffer_len = 0;
+    return 1;
+}
+
+int tar_writer_write(TarWriter *writer, const void *data, size_t len) {
+    const unsigned char *p = (const unsigned char *)data;
+
+    writer->offset += len;
+    if (!writer->compress) {
+        while (len > 0) {
+            size_t n = STREAM_BUFFER_SIZE - writer->buffer_len;
+            if (n > len) n = len;
+            memcpy(writer->buffer + writer->buffer_len, p, n);
+            writer->buffer_len += n;
+            p += n;
+            len -= n;
+            if (writer->buffer_len == STREAM_BUFFER_SIZE && !flush_buffer(writer)) return 0;
+        }
+        return !writer->error;
+    }
+
+    while (len > 0) {
+        if (!writer->current) writer->current = acquire_slot(writer);
+        GzipSlot *slot = writer->current;
+
+        size_t n = GZIP_BLOCK_SIZE - slot->in_len;
+        if (n > len) n = len;
+        memcpy(slot->in + slot->in_len, p, n);
+        slot->in_len += n;
+        p += n;
+        len -= n;
+
+        if (slot->in_len == GZIP_BLOCK_SIZE) {
+            submit_slot(writer, slot);
+            writer->current = NULL;
+        }
+    }
+    return !writer->error;
+}
+
+// 内核内复制，归档文件和源文件的偏移都由内核推进
+static uint64_t kernel_copy(TarWriter *writer, int fd, uint64_t size) {
+    uint64_t done = 0;
+    int use_sendfile = 0;
+
+    while (done < size) {
+        size_t chunk = size - done > (1U << 30) ? (1U << 30) : (size_t)(size - done);
+        ssize_t n = use_sendfile ? sendfile(writer->fd, fd, NULL, chunk)
+                                 : copy_file_range(fd, NULL, writer->fd, NULL, chunk, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && !use_sendfile && done == 0 &&
+            (errno == EXDEV || errno == EINVAL || errno == ENOSYS || errno == EOPNOTSUPP)) {
+            use_sendfile = 1;
+            continue;
+        }
+        if (n < 0) {
+            // 写入端的错误无法恢复，读取端的错误交给普通读取再试一次
+            if (errno == ENOSPC || errno == EDQUOT || errno == EIO) writer->error = 1;
+            break;
+        }
+        if (n == 0) break;
+        done += (uint64_t)n;
+    }
+    return done;
+}
+
+uint64_t tar_writer_copy_fd(TarWriter *writer, int fd, uint64_t size) {
+    uint64_t done = 0;
+
+    if (!writer->compress && size >= STREAM_BUFFER_SIZE) {
+        if (!flush_buffer(writer)) return 0;
+        done = kernel_copy(writer, fd, size);
+    }
+
+    // 直接读入输出缓冲区（压缩模式下就是待压缩的块），省去一次复制
+    while (done < size && !writer->error) {
+        unsigned char *dest;
+        size_t room;
+
+        if (writer->compress) {
+            if (!writer->current) writer->current = acquire_slot(writer);
+            dest = writer->current->in + writer->current->in_len;
+            room = GZIP_BLOCK_SIZE - writer->current->in_len;
+        } else {
+            dest = writer->buffer + writer->buffer_len;
+            room = STREAM_BUFFER_SIZE - writer->buffer_len;
+        }
+        if (room > size - done) room = (size_t)(size - done);
+
+        ssize_t n = read(fd, dest, room);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        done += (uint64_t)n;
+
+        if (writer->compress) {
+            writer->current->in_len += (size_t)n;
+            if (writer->current->in_len == GZIP_BLOCK_SIZE) {
+                submit_slot(writer, writer->current);
+                writer->current = NULL;
+            }
+        } else {
+            writer->buffer_len += (size_t)n;
+            if (writer->buffer_len == STREAM_BUFFER_SIZE) flush_buffer(writer);
+        }
+    }
+    writer->offset += done;
+    return done;
+}
+
+int tar_writer_ok(const TarWriter *writer) {
+    return !writer->error;
+}
+
+uint64_t tar_writer_offset(const TarWriter *writer) {
+    return writer->offset;
+}
+
+int tar_writer_close(TarWriter *writer, BlockTable *blocks) {
+    int ok = 1;
+
+    if (!writer->compress) {
+        if (!flush_buffer(writer) || writer->error) ok = 0;
+    } else {
+        // 最后一块（可能为空）带结束标记
+        if (!writer->current) writer->current = acquire_slot(writer);
+        writer->current->last = 1;
+        submit_slot(writer, writer->current);
+        writer->current = NULL;
+
+        pthread_mutex_lock(&writer->lock);
+        for (;;) {
+            flush_done_blocks(writer);
+            if (writer->write_seq == writer->filled_seq) break;
+            pthread_cond_wait(&writer->cond, &writer->lock);
+        }
+        writer->shutdown = 1;
+        pthread_cond_broadcast(&writer->cond);
+        pthread_mutex_unlock(&writer->lock);
+
+        for (int i = 0; i < writer->worker_count; i++) {
+            pthread_join(writer->workers[i], NULL);
+        }
+        pthread_mutex_destroy(&writer->lock);
+        pthread_cond_destroy(&writer->cond);
+
+        // gzip 尾部：CRC32 和未压缩长度（小端）
+        unsigned char trailer[8];
+        for (int i = 0; i < 4; i++) {
+            trailer[i] = (unsigned char)(writer->crc >> (8 * i));
+            trailer[4 + i] = (unsigned char)(writer->total_in >> (8 * i));
+        }
+        if (writer->error || !write_all(writer->fd, trailer, sizeof(trailer))) ok = 0;
+    }
+
+    if (close(writer->fd) != 0) ok = 0;
+    if (blocks) {
+        *blocks = writer->blocks;
+        writer->blocks.offsets = NULL;
+    }
+    free_writer(writer);
+    return ok;
+}
+
+// ---- 读取 ----
+
+static ssize_t fill_input(TarReader *reader) {
+    ssize_t n;
+    do {
+        n = read(reader->fd, reader->in, STREAM_BUFFER_SIZE);
+    } while (n < 0 && errno == EINTR);
+
+    if (n < 0) {
+        reader->error = 1;
+        return -1;
+    }
+    reader->in_len = (size_t)n;
+    reader->in_pos = 0;
+    return n;
+}
+
+static TarReader *open_reader(const char *path, int compress, int raw, uint64_t offset) {
+    TarReader *reader = calloc(1, sizeof(TarReader));
+    if (!reader) return NULL;
+
+    reader->fd = open(path, O_RDONLY | O_CLOEXEC);
+    reader->in = aligned_buffer(STREAM_BUFFER_SIZE);
+    if (reader->fd < 0 || !reader->in ||
+        (offset > 0 && lseek(reader->fd, (off_t)offset, SEEK_SET) < 0) || fill_input(reader) < 0) {
+        if (reader->fd >= 0) close(reader->fd);
+        free(reader->in);
+        free(reader);
+        return NULL;
+    }
+
+    reader->gzip = compress || (reader->in_len >= 2 && reader->in[0] == 0x1f && reader->in[1] == 0x8b);
+    if (reader->gzip) {
+        // 15 + 16：只接受 gzip 格式；从块起点读取时没有 gzip 头
+        reader->raw = raw;
+        if (inflateInit2(&reader->zs, raw ? -MAX_WBITS : MAX_WBITS + 16) != Z_OK) {
+            close(reader->fd);
+            free(reader->in);
+            free(reader);
+            return NULL;
+        }
+        reader->zs.next_in = reader->in;
+        reader->zs.avail_in = (uInt)reader->in_len;
+        reader->member_open = 1;
+    }
+    return reader;
+}
+
+TarReader *tar_reader_open(const char *path, int compress) {
+    return open_reader(path, compress, 0, 0);
+}
+
+TarReader *tar_reader_open_at(const char *path, int compress, uint64_t offset) {
+    return open_reader(path, compress, compress, offset);
+}
+
+static ssize_t read_plain(TarReader *reader, unsigned char *buf, size_t len) {
+    size_t done = 0;
+
+    while (done < len) {
+        if (reader->in_pos == reader->in_len) {
+            // 大块读取直接读入调用者的缓冲区
+            if (len - done >= STREAM_BUFFER_SIZE) {
+                ssize_t n = read(reader->fd, buf + done, len - done);
+                if (n < 0 && errno == EINTR) continue;
+                if (n < 0) return -1;
+                if (n == 0) break;
+                done += (size_t)n;
+                continue;
+            }
+            ssize_t n = fill_input(reader);
+            if (n < 0) return -1;
+            if (n == 0) break;
+        }
+
+        size_t n = reader->in_len - reader->in_pos;
+        if (n > len - done) n = len - done;
+        memcpy(buf + done, reader->in + reader->in_pos, n);
+        reader->in_pos += n;
+        done += n;
+    }
+    return (ssize_t)done;
+}
+
+static ssize_t read_gzip(TarReader *reader, unsigned char *buf, size_t len) {
+    z_stream *zs = &reader->zs;
+
+    zs->next_out = buf;
+    zs->avail_out = (uInt)len;
+
+    while (zs->avail_out > 0 && !reader->finished) {
+        if (zs->avail_in == 0) {
+            ssize_t n = fill_input(reader);
+            if (n < 0) return -1;
+            if (n == 0) {
+                // 成员中途结束说明文件被截断
+                if (reader->member_open) return -1;
+                reader->finished = 1;
+                break;
+            }
+            zs->next_in = reader->in;
+            zs->avail_in = (uInt)n;
+        }
+
+        if (!reader->member_open) {
+            // 上一个成员之后还有数据：只有 gzip 魔数才继续，其余视为尾部填充
+            if (zs->next_in[0] != 0x1f) {
+                reader->finished = 1;
+                break;
+            }
+            inflateReset(zs);
+            reader->member_open = 1;
+        }
+
+        int ret = inflate(zs, Z_NO_FLUSH);
+        if (ret == Z_STREAM_END) {
+            reader->member_open = 0;
+            // 原始 deflate 在最后一块结束，之后是 gzip 尾部
+            if (reader->raw) reader->finished = 1;
+        } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+            return -1;
+        }
+    }
+    return (ssize_t)(len - zs->avail_out);
+}
+
+ssize_t tar_reader_read(TarReader *reader, void *buf, size_t len) {
+    if (reader->error) return -1;
+
+    // zlib 的 avail_out 是 32 位，大请求分段处理
+    size_t done = 0;
+    while (done < len) {
+        size_t chunk = len - done;
+        if (chunk > (1U << 30)) chunk = 1U << 30;
+
+        ssize_t n = reader->gzip ? read_gzip(reader, (unsigned char *)buf + done, chunk)
+                                 : read_plain(reader, (unsigned char *)buf + done, chunk);
+        if (n < 0) {
+            reader->error = 1;
+            return -1;
+        }
+        done += (size_t)n;
+        if ((size_t)n < chunk) break;
+    }
+    reader->offset += done;
+    return (ssize_t)done;
+}
+
+int tar_reader_skip(TarReader *reader, uint64_t len) {
+    if (!reader->gzip) {
+        size_t buffered = reader->in_len - reader->in_pos;
+        if (len <= buffered) {
+            reader->in_pos += (size_t)len;
+            reader->offset += len;
+            return 1;
+        }
+        // 可定位的文件直接跳过，管道等则读取丢弃
+        if (lseek(reader->fd, (off_t)(len - buffered), SEEK_CUR) >= 0) {
+            reader->in_pos = reader->in_len = 0;
+            reader->offset += len;
+            return 1;
+        }
+    }
+
+    unsigned char scratch[64 * 1024];
+    while (len > 0) {
+        size_t chunk = len > sizeof(scratch) ? sizeof(scratch) : (size_t)len;
+        ssize_t n = tar_reader_read(reader, scratch, chunk);
+        if (n <= 0) return 0;
+        len -= (uint64_t)n;
+    }
+    return 1;
+}
+
+uint64_t tar_reader_offset(const TarReader *reader) {
+    return reader->offset;
+}
+
+int tar_reader_compressed(const TarReader *reader) {
+    return reader->gzip;
+}
+
+void tar_reader_close(TarReader *reader) {
+    if (reader->gzip) inflateEnd(&reader->zs);
+    close(reader->fd);
+    free(reader->in);
+    free(reader);
+}
@@ -0,0 +1,55 @@
+#ifndef PTAR_STREAM_H
+#define PTAR_STREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#define STREAM_BUFFER_SIZE (1024 * 1024)   // 读写缓冲区大小
+#define GZIP_BLOCK_SIZE (1024 * 1024)      // 并行压缩时每个独立块的大小
+#define MAX_JOBS 64
+
+// 压缩块表：第 i 块从未压缩偏移 i * GZIP_BLOCK_SIZE 开始，offsets[i] 是它在
+// gzip 文件中的偏移。每块都是独立的 deflate 数据，可以从块起点直接解压
+typedef struct {
+    uint64_t *offsets;
+    size_t count;
+} BlockTable;
+
+// 归档输出流：未压缩时经缓冲区直接写文件；压缩时把输入切成 GZIP_BLOCK_SIZE
+// 的块，由工作线程各自独立 deflate，再按顺序拼接成一个 gzip 成员（与 pigz 相同）
+typedef struct TarWriter TarWriter;
+
+// 归档输入流：gzip 数据按流式 inflate，支持多个成员拼接
+typedef struct TarReader TarReader;
+
+// 成功返回流对象，失败返回 NULL。jobs 为压缩线程数
+TarWriter *tar_writer_open(const char *path, int compress, int jobs);
+int tar_writer_write(TarWriter *writer, const void *data, size_t len);
+// 把文件 fd 的 size 字节写入归档：未压缩的大文件用 copy_file_range/sendfile
+// 在内核中复制，其余直接读入输出缓冲区。返回实际写入的字节数，文件变短时小于 size
+uint64_t tar_writer_copy_fd(TarWriter *writer, int fd, uint64_t size);
+// 写入出错后返回 0
+int tar_writer_ok(const TarWriter *writer);
+// 已写入的未压缩字节数
+uint64_t tar_writer_offset(const TarWriter *writer);
+// 写出剩余数据和 gzip 尾部并关闭文件，成功返回 1。
+// blocks 不为 NULL 时返回压缩块表（未压缩模式为空表），由调用者释放 offsets
+int tar_writer_close(TarWriter *writer, BlockTable *blocks);
+
+// compress 为 0 时根据文件头自动识别 gzip
+TarReader *tar_reader_open(const char *path, int compress);
+// 从归档文件的 offset 处开始读取：未压缩归档直接定位；
+// 压缩归档的 offset 必须是块起点，从这里开始原始 inflate
+TarReader *tar_reader_open_at(const char *path, int compress, uint64_t offset);
+// 读满 len 字节，只有到达结尾时才会返回更少。出错返回 -1
+ssize_t tar_reader_read(TarReader *reader, void *buf, size_t len);
+// 跳过 len 字节，成功返回 1
+int tar_reader_skip(TarReader *reader, uint64_t len);
+// 已读取（或跳过）的未压缩字节数，从打开位置算起
+uint64_t tar_reader_offset(const TarReader *reader);
+// 输入是否为 gzip（包括自动识别的情况）
+int tar_reader_compressed(const TarReader *reader);
+void tar_reader_close(TarReader *reader);
+
+#endif // PTAR_STREAM_H
@@ -5,35 +5,7 @@
 #include <getopt.h>
 #include <errno.h>
 #include <ctype.h>
-
-// 颜色定义
-#define COLOR_RED     "\033[31m"
-#define COLOR_GREEN   "\033[32m"
-#define COLOR_YELLOW  "\033[33m"
-#define COLOR_BLUE    "\033[34m"
-#define COLOR_MAGENTA "\033[35m"
-#define COLOR_CYAN    "\033[36m"
-#define COLOR_WHITE   "\033[37m"
-#define COLOR_RESET   "\033[0m"
-#define COLOR_BOLD    "\033[1m"
-
-#define MAX_LINE_LENGTH 4096
-
-// 全局选项
-struct options {
-    int count;
-    int repeated;
-    int unique;
-    int all_repeated;
-    int ignore_case;
-    int skip_fields;
-    int skip_chars;
-    int color;
-    int show_stats;
-    int show_progress;
-    int verbose;
-    char *separator;
-};
+#include "puniq.h"
 
 // 初始化选项
 void init_options(struct options *opts) {
@@ -49,6 +21,33 @@ void init_options(struct options *opts) {
     opts->show_progress = 0;
     opts->verbose = 0;
     opts->separator = "==>";
+    opts->global = 0;
+    opts->memory_limit = DEFAULT_MEMORY_LIMIT;
+    opts->top = 0;
+    opts->approx = 0;
+    opts->count_distinct = 0;
+    opts->precision = 0;
+    opts->fields_spec = NULL;
+    opts->save_file = NULL;
+    opts->merge_files = NULL;
+    opts->merge_count = 0;
+}
+
+// 解析带 K/M/G 后缀的大小。成功返回 0
+static int parse_size(const char *text, size_t *bytes) {
+    char *end;
+    long long value = strtoll(text, &end, 10);
+    if (end == text || value <= 0) return -1;
+
+    switch (*end) {
+        case '\0': break;
+        case 'k': case 'K': value <<= 10; break;
+        case 'm': case 'M': value <<= 20; break;
+        case 'g': case 'G': value <<= 30; break;
+        default: return -1;
+    }
+    *bytes = (size_t)value;
+    return (*end && end[1] && !((end[1] == 'B' || end[1] == 'b') && !end[2])) ? -1 : 0;
 }
 
 // 打印帮助信息
@@ -70,6 +69,14 @@ void print_help() {
     printf("  --progress              显示进度条\n");
     printf("  --verbose               详细输出\n");
     printf("  --separator=STR         设置文件分隔符 (默认: '==>')\n");
+    printf("  -g, --global            对整个输入去重，不要求输入已排序\n");
+    printf("  --memory=SIZE           --global 的内存上限，超出后借助临时文件 (默认: 1G)\n");
+    printf("  --top=N                 只显示出现次数最多的 N 行，不要求输入已排序\n");
+    printf("  --approx                与 --top 一起使用，近似统计，内存只和 N 有关\n");
+    printf("  --count-distinct        估计不同的行数，较少时给出精确值；此时 -f 1,3 分别估计第 1、3 个字段\n");
+    printf("  --precision=P           --count-distinct 的精度 4-18 (默认: 12，约 1.6%% 误差)\n");
+    printf("  --save-sketch=FILE      把 --count-distinct 的草图保存到文件\n");
+    printf("  --merge=FILE            合并之前保存的草图，可以重复指定\n");
     printf("  -h, --help              显示此帮助信息\n");
     printf("  -V, --version           显示版本信息\n\n");
     printf("示例:\n");
@@ -79,6 +86,10 @@ void print_help() {
     printf("  puniq -u file.txt                 # 只显示唯一行\n");
     printf("  puniq -i file.txt                 # 忽略大小写\n");
     printf("  puniq --stats file.txt            # 显示统计信息\n");
+    printf("  puniq -g -c access.log            # 不排序直接统计每行出现的次数\n");
+    printf("  puniq --top=10 --approx -f 1 access.log  # 最常见的 10 个请求\n");
+    printf("  puniq --count-distinct -f 1 --save-sketch=host1.hll access.log\n");
+    printf("  puniq --count-distinct --merge=host1.hll --merge=host2.hll  # 合并各主机的统计\n");
 }
 
 // 打印版本信息
@@ -180,6 +191,23 @@ void highlight_line(const char *line, int is_duplicate, int count) {
     }
 }
 
+// 输出一个结果行，--global 等模式在知道次数后调用
+void print_counted_line(const char *line, uint64_t count, const struct options *opts) {
+    if (opts->count) {
+        if (opts->color) {
+            printf("%s%7llu %s", COLOR_CYAN, (unsigned long long)count, COLOR_RESET);
+        } else {
+            printf("%7llu ", (unsigned long long)count);
+        }
+    }
+    if (opts->color) {
+        highlight_line(line, count > 1, (int)count);
+    } else {
+        fputs(line, stdout);
+    }
+    putchar('\n');
+}
+
 // 处理文件
 int process_file(const char *filename, const struct options *opts) {
     FILE *file;
@@ -348,6 +376,14 @@ int main(int argc, char *argv[]) {
         {"progress", no_argument, 0, 4},
         {"verbose", no_argument, 0, 5},
         {"separator", required_argument, 0, 6},
+        {"global", no_argument, 0, 'g'},
+        {"memory", required_argument, 0, 7},
+        {"top", required_argument, 0, 8},
+        {"approx", no_argument, 0, 9},
+        {"count-distinct", no_argument, 0, 10},
+        {"precision", required_argument, 0, 11},
+        {"save-sketch", required_argument, 0, 12},
+        {"merge", required_argument, 0, 13},
         {"help", no_argument, 0, 'h'},
         {"version", no_argument, 0, 'V'},
         {0, 0, 0, 0}
@@ -356,7 +392,7 @@ int main(int argc, char *argv[]) {
     int opt;
     int option_index = 0;
     
-    while ((opt = getopt_long(argc, argv, "cduDif:shV", long_options, &option_index)) != -1) {
+    while ((opt = getopt_long(argc, argv, "cduDif:s:hVg", long_options, &option_index)) != -1) {
         switch (opt) {
             case 'c':
                 opts.count = 1;
@@ -375,6 +411,7 @@ int main(int argc, char *argv[]) {
                 break;
             case 'f':
                 opts.skip_fields = atoi(optarg);
+                opts.fields_spec = optarg;
                 break;
             case 's':
                 opts.skip_chars = atoi(optarg);
@@ -397,6 +434,48 @@ int main(int argc, char *argv[]) {
             case 6: // --separator
                 opts.separator = optarg;
                 break;
+            case 'g':
+                opts.global = 1;
+                break;
+            case 7: // --memory
+                if (parse_size(optarg, &opts.memory_limit) != 0) {
+                    fprintf(stderr, "%s错误: 无效的内存大小 '%s'%s\n", COLOR_RED, optarg, COLOR_RESET);
+                    return 1;
+                }
+                break;
+            case 8: // --top
+                opts.top = (size_t)strtoull(optarg, NULL, 10);
+                if (opts.top == 0) {
+                    fprintf(stderr, "%s错误: 无效的数量 '%s'%s\n", COLOR_RED, optarg, COLOR_RESET);
+                    return 1;
+                }
+                break;
+            case 9: // --approx
+                opts.approx = 1;
+                break;
+            case 10: // --count-distinct
+                opts.count_distinct = 1;
+                break;
+            case 11: // --precision
+                opts.precision = atoi(optarg);
+                if (opts.precision < 4 || opts.precision > 18) {
+                    fprintf(stderr, "%s错误: 精度必须在 4 到 18 之间%s\n", COLOR_RED, COLOR_RESET);
+                    return 1;
+                }
+                break;
+            case 12: // --save-sketch
+                opts.save_file = optarg;
+                break;
+            case 13: { // --merge
+                char **grown = realloc(opts.merge_files, (size_t)(opts.merge_count + 1) * sizeof(char *));
+                if (!grown) {
+                    fprintf(stderr, "%s错误: 内存不足%s\n", COLOR_RED, COLOR_RESET);
+                    return 1;
+                }
+                opts.merge_files = grown;
+                opts.merge_files[opts.merge_count++] = optarg;
+                break;
+            }
             case 'h':
                 print_help();
                 return 0;
@@ -411,6 +490,31 @@ int main(int argc, char *argv[]) {
         }
     }
     
+    if (opts.count_distinct) {
+        int result = process_count_distinct(argv + optind, argc - optind, &opts);
+        free(opts.merge_files);
+        return result;
+    }
+    if (opts.approx && opts.top == 0) {
+        fprintf(stderr, "%s错误: --approx 需要与 --top 一起使用%s\n", COLOR_RED, COLOR_RESET);
+        return 1;
+    }
+    if (opts.top > 0) {
+        // 输出格式与 sort | uniq -c | sort -rn | head 相同
+        opts.count = 1;
+        if (opts.approx) {
+            return process_top_approx(argv + optind, argc - optind, &opts);
+        }
+        opts.global = 1;
+    }
+    if (opts.global) {
+        if (opts.all_repeated) {
+            fprintf(stderr, "%s错误: --global 不支持 -D%s\n", COLOR_RED, COLOR_RESET);
+            return 1;
+        }
+        return process_global(argv + optind, argc - optind, &opts);
+    }
+    
     // 处理剩余参数（文件名）
     if (optind >= argc) {
         // 没有文件名，从标准输入读取
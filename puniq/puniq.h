@@ -0,0 +1,152 @@
+#ifndef PUNIQ_H
+#define PUNIQ_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// 颜色定义
+#define COLOR_RED     "\033[31m"
+#define COLOR_GREEN   "\033[32m"
+#define COLOR_YELLOW  "\033[33m"
+#define COLOR_BLUE    "\033[34m"
+#define COLOR_MAGENTA "\033[35m"
+#define COLOR_CYAN    "\033[36m"
+#define COLOR_WHITE   "\033[37m"
+#define COLOR_RESET   "\033[0m"
+#define COLOR_BOLD    "\033[1m"
+
+#define MAX_LINE_LENGTH 4096
+#define DEFAULT_MEMORY_LIMIT (1024UL * 1024 * 1024)    // --global 默认的内存上限
+#define DEFAULT_HLL_PRECISION 12                        // 4096 个寄存器，标准误差约 1.6%
+#define MAX_DISTINCT_FIELDS 16
+
+// 全局选项
+struct options {
+    int count;
+    int repeated;
+    int unique;
+    int all_repeated;
+    int ignore_case;
+    int skip_fields;
+    int skip_chars;
+    int color;
+    int show_stats;
+    int show_progress;
+    int verbose;
+    char *separator;
+    int global;             // 用哈希表对整个输入去重，不要求输入有序
+    size_t memory_limit;    // 哈希表和行数据的内存上限，超出后按哈希分区写到临时文件
+    size_t top;             // 只输出出现次数最多的前 N 行，0 表示不限
+    int approx;             // --top 使用 Space-Saving 近似统计，内存只和 N 成正比
+    int count_distinct;     // 用 HyperLogLog 估计不同的行数
+    int precision;          // HyperLogLog 的精度，0 表示默认
+    char *fields_spec;      // --count-distinct 时 -f 的参数，按逗号分隔的字段列表
+    char *save_file;        // 把草图保存到文件
+    char **merge_files;     // 合并这些草图文件
+    int merge_count;
+};
+
+// 按块读取输入并切分成行，行的长度不设上限
+typedef struct {
+    int fd;
+    char *buffer;
+    size_t capacity;
+    size_t start;           // 下一行的起点
+    size_t end;             // 缓冲区中有效数据的末尾
+    int eof;
+} LineReader;
+
+// 打开文件，"-" 表示标准输入。成功返回 0
+int line_reader_open(LineReader *reader, const char *filename);
+// 从已经打开的描述符读取，关闭读取器时一并关闭
+int line_reader_init(LineReader *reader, int fd);
+// 读取下一行，line 不含换行符，到下次调用前有效。返回 1 表示读到一行，0 表示结束，-1 表示出错
+int line_reader_next(LineReader *reader, const char **line, size_t *length);
+void line_reader_close(LineReader *reader);
+
+// 按 -f/-s 跳过字段和字符后比较键的起点，与相邻去重的比较规则一致
+size_t line_key_offset(const char *line, size_t length, const struct options *opts);
+// 比较键的 64 位哈希，seed 不同得到互相独立的哈希
+uint64_t key_hash(const char *key, size_t length, int ignore_case, uint64_t seed);
+int keys_equal(const char *key1, size_t length1, const char *key2, size_t length2, int ignore_case);
+
+// 计数表中的一个不同的行，行内容（以 NUL 结尾）紧跟在结构后面
+typedef struct {
+    uint64_t count;
+    uint32_t length;
+    uint32_t key_offset;
+} CountRecord;
+
+static inline const char *record_text(const CountRecord *record) {
+    return (const char *)(record + 1);
+}
+
+typedef struct ArenaChunk ArenaChunk;
+
+typedef struct {
+    uint64_t hash;
+    CountRecord *record;    // NULL 表示空槽
+} CountSlot;
+
+// 开放寻址的计数表，记录按第一次出现的顺序存放在 arena 中
+typedef struct {
+    CountSlot *slots;
+    size_t mask;
+    size_t count;
+    ArenaChunk *head;
+    ArenaChunk *tail;
+    size_t memory;          // 槽位和 arena 占用的内存
+    size_t limit;
+    int full;               // 达到内存上限后不再插入新的行
+    int ignore_case;
+} CountTable;
+
+typedef struct {
+    const ArenaChunk *chunk;
+    size_t offset;
+} CountCursor;
+
+int count_table_init(CountTable *table, size_t limit, int ignore_case);
+void count_table_free(CountTable *table);
+// 给一行计数，返回它的记录。表中没有这一行且已满（或内存不足）时返回 NULL，
+// 之后不会再插入任何新行，保证同一个键不会一部分在表中、一部分在表外
+CountRecord *count_table_add(CountTable *table, const char *line, size_t length, size_t key_offset,
+                             uint64_t hash);
+// 按第一次出现的顺序遍历所有记录
+void count_cursor_init(const CountTable *table, CountCursor *cursor);
+const CountRecord *count_cursor_next(CountCursor *cursor);
+
+// 高亮行内容
+void highlight_line(const char *line, int is_duplicate, int count);
+// 输出一个结果行（不含换行符，以 NUL 结尾），按选项显示次数和颜色
+void print_counted_line(const char *line, uint64_t count, const struct options *opts);
+
+// --top 的一个结果
+typedef struct {
+    char *line;
+    uint64_t count;
+    uint64_t error;         // 近似统计时 count 最多高估的次数
+} TopItem;
+
+// 容量为 N 的小顶堆，只保留次数最大的 N 行
+typedef struct {
+    TopItem *items;
+    size_t size;
+    size_t capacity;
+} TopHeap;
+
+int top_heap_init(TopHeap *heap, size_t capacity);
+void top_heap_free(TopHeap *heap);
+// 复制一行放进堆中。内存不足返回 -1
+int top_heap_offer(TopHeap *heap, const char *line, size_t length, uint64_t count);
+// 按次数从大到小输出
+void top_heap_print(TopHeap *heap, const struct options *opts);
+
+// --global：对所有输入文件整体去重，指定 --top 时只输出次数最多的 N 行。成功返回 0
+int process_global(char **files, int file_count, const struct options *opts);
+// --top N --approx：Space-Saving 近似统计。成功返回 0
+int process_top_approx(char **files, int file_count, const struct options *opts);
+// --count-distinct：HyperLogLog 估计不同的行数或每个字段的不同值个数。成功返回 0
+int process_count_distinct(char **files, int file_count, const struct options *opts);
+
+#endif // PUNIQ_H
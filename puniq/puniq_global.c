@@ -0,0 +1,212 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include "puniq.h"
+
+// --global：一遍扫描整个输入，用计数表去重，不需要先排序。
+// 表达到内存上限后不再插入新的行：已经在表中的行继续计数，其余的行按哈希的高位分到
+// 临时文件中。同一个键要么全在表中、要么全在同一个分区里，所以每个分区可以单独去重，
+// 分区仍然放不下时换一个哈希种子继续分区。--top 时结果不直接输出，而是放进前 N 名的堆
+
+#define SPILL_PARTITIONS 16
+#define MAX_SPILL_DEPTH 6
+
+typedef struct {
+    const struct options *opts;
+    int depth;                  // 分区的层数，也作为哈希种子
+    int streaming;              // 不需要次数时第一次见到就输出
+    TopHeap *top;               // 不为 NULL 时结果放进堆中
+    CountTable table;
+    FILE *partitions[SPILL_PARTITIONS];
+} GlobalPass;
+
+typedef struct {
+    unsigned long long lines;
+    unsigned long long distinct;
+    unsigned long long duplicated;  // 出现不止一次的行
+    unsigned long long spilled;     // 写到临时文件的行
+} GlobalStats;
+
+static int init_pass(GlobalPass *pass, const struct options *opts, int depth, TopHeap *top) {
+    memset(pass, 0, sizeof(*pass));
+    pass->opts = opts;
+    pass->depth = depth;
+    pass->top = top;
+    pass->streaming = !top && !opts->count && !opts->repeated && !opts->unique;
+    // 分区层数用完后不再限制内存
+    size_t limit = depth < MAX_SPILL_DEPTH ? opts->memory_limit : (size_t)-1;
+    return count_table_init(&pass->table, limit, opts->ignore_case);
+}
+
+static int spill_line(GlobalPass *pass, const char *line, size_t length, uint64_t hash) {
+    // 表中的槽位用哈希的低位，分区用高位
+    int index = (int)(hash >> 60) % SPILL_PARTITIONS;
+    if (!pass->partitions[index]) {
+        if (pass->opts->verbose && pass->depth == 0) {
+            int used = 0;
+            for (int i = 0; i < SPILL_PARTITIONS; i++) used += pass->partitions[i] != NULL;
+            if (used == 0) {
+                fprintf(stderr, "%s达到内存上限，新出现的行按哈希写到临时文件%s\n", COLOR_YELLOW, COLOR_RESET);
+            }
+        }
+        pass->partitions[index] = tmpfile();
+        if (!pass->partitions[index]) return -1;
+    }
+    FILE *file = pass->partitions[index];
+    if (fwrite(line, 1, length, file) != length || putc('\n', file) == EOF) return -1;
+    return 0;
+}
+
+static int add_line(GlobalPass *pass, const char *line, size_t length, GlobalStats *stats) {
+    size_t key_offset = line_key_offset(line, length, pass->opts);
+    uint64_t hash = key_hash(line + key_offset, length - key_offset, pass->opts->ignore_case, (uint64_t)pass->depth);
+    stats->lines++;
+
+    CountRecord *record = count_table_add(&pass->table, line, length, key_offset, hash);
+    if (!record) {
+        stats->spilled++;
+        return spill_line(pass, line, length, hash);
+    }
+    if (pass->streaming && record->count == 1) {
+        print_counted_line(record_text(record), 1, pass->opts);
+    }
+    return 0;
+}
+
+// 读入一个文件的所有行，出错时显示原因。成功返回 0
+static int add_lines(GlobalPass *pass, LineReader *reader, const char *name, GlobalStats *stats) {
+    const char *line;
+    size_t length;
+    int ret;
+    while ((ret = line_reader_next(reader, &line, &length)) == 1) {
+        if (add_line(pass, line, length, stats) != 0) {
+            fprintf(stderr, "%s错误: 无法写入临时文件: %s%s\n", COLOR_RED, strerror(errno), COLOR_RESET);
+            return -1;
+        }
+    }
+    if (ret < 0) {
+        fprintf(stderr, "%s错误: 读取 '%s' 失败: %s%s\n", COLOR_RED, name, strerror(errno), COLOR_RESET);
+    }
+    return ret;
+}
+
+// 输出表中的结果，释放表后依次处理每个分区
+static int finish_pass(GlobalPass *pass, GlobalStats *stats) {
+    const struct options *opts = pass->opts;
+    CountCursor cursor;
+    const CountRecord *record;
+    int ret = 0;
+    count_cursor_init(&pass->table, &cursor);
+    while ((record = count_cursor_next(&cursor)) != NULL) {
+        stats->distinct++;
+        if (record->count > 1) stats->duplicated++;
+        if (pass->streaming) continue;
+        if (opts->repeated && record->count == 1) continue;
+        if (opts->unique && record->count > 1) continue;
+        if (!pass->top) {
+            print_counted_line(record_text(record), record->count, opts);
+        } else if (ret == 0) {
+            ret = top_heap_offer(pass->top, record_text(record), record->length, record->count);
+        }
+    }
+    count_table_free(&pass->table);
+
+    for (int i = 0; i < SPILL_PARTITIONS; i++) {
+        FILE *file = pass->partitions[i];
+        if (!file) continue;
+        pass->partitions[i] = NULL;
+        if (ret != 0) {
+            fclose(file);
+            continue;
+        }
+
+        GlobalPass sub;
+        LineReader reader;
+        // 分区中的行已经计入总行数
+        GlobalStats ignored = {0, 0, 0, 0};
+        if (fflush(file) != 0 || lseek(fileno(file), 0, SEEK_SET) != 0 ||
+            init_pass(&sub, opts, pass->depth + 1, pass->top) != 0) {
+            ret = -1;
+        } else if (line_reader_init(&reader, dup(fileno(file))) != 0) {
+            count_table_free(&sub.table);
+            ret = -1;
+        } else {
+            ret = add_lines(&sub, &reader, "临时文件", &ignored);
+            line_reader_close(&reader);
+            stats->spilled += ignored.spilled;
+            if (ret == 0) {
+                ret = finish_pass(&sub, stats);
+            } else {
+                for (int k = 0; k < SPILL_PARTITIONS; k++) {
+                    if (sub.partitions[k]) fclose(sub.partitions[k]);
+                }
+                count_table_free(&sub.table);
+            }
+        }
+        fclose(file);
+    }
+    return ret;
+}
+
+int process_global(char **files, int file_count, const struct options *opts) {
+    GlobalPass pass;
+    GlobalStats stats = {0, 0, 0, 0};
+    TopHeap heap;
+    if (opts->top > 0 && top_heap_init(&heap, opts->top) != 0) {
+        fprintf(stderr, "%s错误: 内存不足%s\n", COLOR_RED, COLOR_RESET);
+        return 1;
+    }
+    if (init_pass(&pass, opts, 0, opts->top > 0 ? &heap : NULL) != 0) {
+        if (opts->top > 0) top_heap_free(&heap);
+        fprintf(stderr, "%s错误: 内存不足%s\n", COLOR_RED, COLOR_RESET);
+        return 1;
+    }
+
+    char *stdin_name = "-";
+    if (file_count == 0) {
+        files = &stdin_name;
+        file_count = 1;
+    }
+
+    int result = 0;
+    for (int i = 0; i < file_count; i++) {
+        LineReader reader;
+        if (line_reader_open(&reader, files[i]) != 0) {
+            fprintf(stderr, "%s错误: 无法打开文件 '%s': %s%s\n",
+                    COLOR_RED, files[i], strerror(errno), COLOR_RESET);
+            result = 1;
+            continue;
+        }
+        if (opts->verbose) {
+            printf("%s%s %s%s\n", COLOR_MAGENTA, opts->separator,
+                   strcmp(files[i], "-") == 0 ? "标准输入" : files[i], COLOR_RESET);
+        }
+        if (add_lines(&pass, &reader, files[i], &stats) != 0) result = 1;
+        line_reader_close(&reader);
+    }
+
+    if (finish_pass(&pass, &stats) != 0) {
+        fprintf(stderr, "%s错误: 处理临时文件失败: %s%s\n", COLOR_RED, strerror(errno), COLOR_RESET);
+        result = 1;
+    }
+    if (opts->top > 0) {
+        top_heap_print(&heap, opts);
+        top_heap_free(&heap);
+    }
+
+    if (opts->show_stats) {
+        printf("%s统计信息:%s\n", COLOR_CYAN, COLOR_RESET);
+        printf("  总行数: %llu\n", stats.lines);
+        printf("  不同的行: %llu\n", stats.distinct);
+        printf("  重复出现的行: %llu\n", stats.duplicated);
+        if (stats.lines > 0) {
+            printf("  重复率: %.1f%%\n", (double)(stats.lines - stats.distinct) / stats.lines * 100);
+        }
+        if (stats.spilled > 0) {
+            printf("  写到临时文件的行: %llu\n", stats.spilled);
+        }
+    }
+    return result;
+}
@@ -0,0 +1,426 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include "puniq.h"
+
+// --count-distinct：用 HyperLogLog 估计不同的行（或字段）的个数，不保存任何行。
+// 64 位哈希的高 p 位选寄存器，其余位的前导零个数加一作为秩，寄存器保存最大的秩。
+// 估计使用 Ertl 的改进估计量（"New cardinality estimation algorithms for HyperLogLog
+// sketches"），从很小到很大的基数都无偏，不需要 HLL++ 的经验偏差表和线性计数切换。
+// 草图可以保存到文件并按寄存器取最大值合并，文件依赖 key_hash 的结果保持不变。
+// 不同的值较少时另外保存它们的哈希值（类似 HLL++ 的稀疏表示），结果是精确的；
+// 超过寄存器个数的 1/8 后丢弃哈希表，只用寄存器估计
+
+#define HLL_MAGIC "PHLL"
+#define HLL_VERSION 2
+#define HLL_OVERFLOWED 0xffffffffU      // 文件中表示哈希表已经丢弃
+#define HLL_HASH_SEED 0x68796c6cULL
+#define MIN_HLL_PRECISION 4
+#define MAX_HLL_PRECISION 18
+
+// 少量不同值的精确集合：开放寻址的哈希表，0 表示空槽。slots 为 NULL 表示已经丢弃
+typedef struct {
+    uint64_t *slots;
+    size_t count;
+} ExactSet;
+
+// 一组草图：整行一个，或者 -f 指定的每个字段一个，寄存器连续存放
+typedef struct {
+    int precision;
+    int count;
+    int fields[MAX_DISTINCT_FIELDS];    // 0 表示整行
+    uint8_t *registers;
+    ExactSet exact[MAX_DISTINCT_FIELDS];
+} SketchSet;
+
+static size_t register_count(const SketchSet *set) {
+    return (size_t)1 << set->precision;
+}
+
+// 精确集合最多保存的哈希值个数，哈希表的槽数是它的两倍
+static size_t exact_limit(const SketchSet *set) {
+    return register_count(set) / 8;
+}
+
+static void sketch_set_free(SketchSet *set) {
+    free(set->registers);
+    set->registers = NULL;
+    for (int i = 0; i < MAX_DISTINCT_FIELDS; i++) {
+        free(set->exact[i].slots);
+        set->exact[i].slots = NULL;
+    }
+}
+
+static int sketch_set_alloc(SketchSet *set) {
+    set->registers = calloc((size_t)set->count, register_count(set));
+    for (int i = 0; set->registers && i < set->count; i++) {
+        set->exact[i].count = 0;
+        set->exact[i].slots = calloc(exact_limit(set) * 2, sizeof(uint64_t));
+        if (!set->exact[i].slots) {
+            sketch_set_free(set);
+            return -1;
+        }
+    }
+    return set->registers ? 0 : -1;
+}
+
+// 把哈希值加入精确集合，超过上限时丢弃整个集合
+static void exact_add(ExactSet *exact, size_t limit, uint64_t hash) {
+    if (!exact->slots) return;
+    if (hash == 0) hash = 1;
+    size_t mask = limit * 2 - 1;
+    size_t i = (size_t)hash & mask;
+    while (exact->slots[i] != 0) {
+        if (exact->slots[i] == hash) return;
+        i = (i + 1) & mask;
+    }
+    if (exact->count == limit) {
+        free(exact->slots);
+        exact->slots = NULL;
+        return;
+    }
+    exact->slots[i] = hash;
+    exact->count++;
+}
+
+// 寄存器总是更新，丢弃精确集合时不需要再转换
+static inline void sketch_add(SketchSet *set, int sketch, uint64_t hash) {
+    uint8_t *registers = set->registers + (size_t)sketch * register_count(set);
+    int precision = set->precision;
+    size_t index = (size_t)(hash >> (64 - precision));
+    // 最低的保护位保证秩不超过 64 - p + 1
+    uint64_t rest = (hash << precision) | ((uint64_t)1 << (precision - 1));
+    uint8_t rank = (uint8_t)(__builtin_clzll(rest) + 1);
+    if (registers[index] < rank) registers[index] = rank;
+    exact_add(&set->exact[sketch], exact_limit(set), hash);
+}
+
+static double sigma(double x) {
+    if (x == 1.0) return INFINITY;
+    double y = 1.0, z = x, previous;
+    do {
+        x *= x;
+        previous = z;
+        z += x * y;
+        y += y;
+    } while (z != previous);
+    return z;
+}
+
+static double tau(double x) {
+    if (x == 0.0 || x == 1.0) return 0.0;
+    double y = 1.0, z = 1.0 - x, previous;
+    do {
+        x = sqrt(x);
+        previous = z;
+        y *= 0.5;
+        z -= (1.0 - x) * (1.0 - x) * y;
+    } while (z != previous);
+    return z / 3.0;
+}
+
+static double sketch_estimate(const uint8_t *registers, int precision) {
+    int q = 64 - precision;
+    size_t m = (size_t)1 << precision;
+    double histogram[66] = {0};
+    for (size_t i = 0; i < m; i++) histogram[registers[i]] += 1.0;
+
+    double z = (double)m * tau(1.0 - histogram[q + 1] / (double)m);
+    for (int k = q; k >= 1; k--) {
+        z = 0.5 * (z + histogram[k]);
+    }
+    z += (double)m * sigma(histogram[0] / (double)m);
+    return (double)m * (double)m / (2.0 * log(2.0)) / z;
+}
+
+// ---- 草图文件：魔数、版本、精度、草图个数，然后每个草图的字段号、寄存器、
+// 精确集合的大小（HLL_OVERFLOWED 表示已丢弃）和其中的哈希值 ----
+
+static void put32(unsigned char *p, uint32_t value) {
+    p[0] = (unsigned char)value;
+    p[1] = (unsigned char)(value >> 8);
+    p[2] = (unsigned char)(value >> 16);
+    p[3] = (unsigned char)(value >> 24);
+}
+
+static uint32_t get32(const unsigned char *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static int save_exact(FILE *file, const ExactSet *exact, size_t limit) {
+    unsigned char buffer[8];
+    put32(buffer, exact->slots ? (uint32_t)exact->count : HLL_OVERFLOWED);
+    if (fwrite(buffer, 1, 4, file) != 4) return -1;
+    for (size_t i = 0; exact->slots && i < limit * 2; i++) {
+        if (exact->slots[i] == 0) continue;
+        put32(buffer, (uint32_t)exact->slots[i]);
+        put32(buffer + 4, (uint32_t)(exact->slots[i] >> 32));
+        if (fwrite(buffer, 1, 8, file) != 8) return -1;
+    }
+    return 0;
+}
+
+static int load_exact(FILE *file, ExactSet *exact, size_t limit) {
+    unsigned char buffer[8];
+    if (fread(buffer, 1, 4, file) != 4) return -1;
+    uint32_t count = get32(buffer);
+    if (count == HLL_OVERFLOWED) {
+        free(exact->slots);
+        exact->slots = NULL;
+        return 0;
+    }
+    if (count > limit) return -1;
+    for (uint32_t i = 0; i < count; i++) {
+        if (fread(buffer, 1, 8, file) != 8) return -1;
+        exact_add(exact, limit, (uint64_t)get32(buffer) | (uint64_t)get32(buffer + 4) << 32);
+    }
+    return exact->count == count ? 0 : -1;
+}
+
+static int save_sketches(const char *path, const SketchSet *set) {
+    FILE *file = fopen(path, "wb");
+    if (!file) return -1;
+    unsigned char header[8];
+    memcpy(header, HLL_MAGIC, 4);
+    header[4] = HLL_VERSION;
+    header[5] = (unsigned char)set->precision;
+    header[6] = (unsigned char)set->count;
+    header[7] = 0;
+    int ok = fwrite(header, 1, sizeof(header), file) == sizeof(header);
+    for (int i = 0; ok && i < set->count; i++) {
+        unsigned char field[4];
+        put32(field, (uint32_t)set->fields[i]);
+        ok = fwrite(field, 1, 4, file) == 4 &&
+             fwrite(set->registers + (size_t)i * register_count(set), 1, register_count(set), file) ==
+                 register_count(set) &&
+             save_exact(file, &set->exact[i], exact_limit(set)) == 0;
+    }
+    if (fclose(file) != 0) ok = 0;
+    return ok ? 0 : -1;
+}
+
+// 读入草图文件，成功返回 0，格式错误时 errno 为 EINVAL
+static int load_sketches(const char *path, SketchSet *set) {
+    memset(set, 0, sizeof(*set));
+    FILE *file = fopen(path, "rb");
+    if (!file) return -1;
+
+    unsigned char header[8];
+    int ok = fread(header, 1, sizeof(header), file) == sizeof(header) &&
+             memcmp(header, HLL_MAGIC, 4) == 0 && header[4] == HLL_VERSION &&
+             header[5] >= MIN_HLL_PRECISION && header[5] <= MAX_HLL_PRECISION &&
+             header[6] >= 1 && header[6] <= MAX_DISTINCT_FIELDS;
+    if (ok) {
+        set->precision = header[5];
+        set->count = header[6];
+        ok = sketch_set_alloc(set) == 0;
+    }
+    for (int i = 0; ok && i < set->count; i++) {
+        unsigned char field[4];
+        uint8_t *registers = set->registers + (size_t)i * register_count(set);
+        ok = fread(field, 1, 4, file) == 4 &&
+             fread(registers, 1, register_count(set), file) == register_count(set);
+        set->fields[i] = ok ? (int)get32(field) : 0;
+        for (size_t r = 0; ok && r < register_count(set); r++) {
+            ok = registers[r] <= 64 - set->precision + 1;
+        }
+        if (ok) ok = load_exact(file, &set->exact[i], exact_limit(set)) == 0;
+    }
+    fclose(file);
+    if (!ok) {
+        sketch_set_free(set);
+        errno = EINVAL;
+        return -1;
+    }
+    return 0;
+}
+
+// 按寄存器取最大值、精确集合取并集合并，两组草图的精度和字段必须相同
+static int merge_sketches(SketchSet *into, const SketchSet *from) {
+    if (into->precision != from->precision || into->count != from->count ||
+        memcmp(into->fields, from->fields, (size_t)into->count * sizeof(int)) != 0) {
+        return -1;
+    }
+    size_t total = (size_t)into->count * register_count(into);
+    for (size_t i = 0; i < total; i++) {
+        if (into->registers[i] < from->registers[i]) into->registers[i] = from->registers[i];
+    }
+    size_t limit = exact_limit(into);
+    for (int i = 0; i < into->count; i++) {
+        ExactSet *exact = &into->exact[i];
+        if (!from->exact[i].slots) {
+            free(exact->slots);
+            exact->slots = NULL;
+        }
+        for (size_t k = 0; exact->slots && k < limit * 2; k++) {
+            if (from->exact[i].slots[k] != 0) exact_add(exact, limit, from->exact[i].slots[k]);
+        }
+    }
+    return 0;
+}
+
+// ---- 输入 ----
+
+// 解析 "1,3" 这样的字段列表（从 1 开始）。成功返回字段个数
+static int parse_fields(const char *spec, int *fields) {
+    int count = 0;
+    const char *p = spec;
+    while (*p) {
+        char *end;
+        long field = strtol(p, &end, 10);
+        if (end == p || field < 1 || field > 65535 || count == MAX_DISTINCT_FIELDS) return -1;
+        fields[count++] = (int)field;
+        if (*end == ',') end++; else if (*end) return -1;
+        p = end;
+    }
+    return count;
+}
+
+// 按空白切分字段，把选中的字段分别加入对应的草图
+static void add_fields(SketchSet *set, const char *line, size_t length, int ignore_case) {
+    int field = 0;
+    size_t p = 0;
+    while (p < length) {
+        while (p < length && (line[p] == ' ' || line[p] == '\t')) p++;
+        if (p == length) break;
+        size_t start = p;
+        while (p < length && line[p] != ' ' && line[p] != '\t') p++;
+        field++;
+        for (int i = 0; i < set->count; i++) {
+            if (set->fields[i] == field) {
+                uint64_t hash = key_hash(line + start, p - start, ignore_case, HLL_HASH_SEED);
+                sketch_add(set, i, hash);
+            }
+        }
+    }
+}
+
+static int add_input(SketchSet *set, const char *filename, const struct options *opts,
+                     unsigned long long *lines) {
+    LineReader reader;
+    if (line_reader_open(&reader, filename) != 0) {
+        fprintf(stderr, "%s错误: 无法打开文件 '%s': %s%s\n", COLOR_RED, filename, strerror(errno), COLOR_RESET);
+        return -1;
+    }
+    const char *line;
+    size_t length;
+    int ret;
+    int whole_line = set->fields[0] == 0;
+    while ((ret = line_reader_next(&reader, &line, &length)) == 1) {
+        (*lines)++;
+        if (whole_line) {
+            size_t key_offset = line_key_offset(line, length, opts);
+            uint64_t hash = key_hash(line + key_offset, length - key_offset, opts->ignore_case, HLL_HASH_SEED);
+            sketch_add(set, 0, hash);
+        } else {
+            add_fields(set, line, length, opts->ignore_case);
+        }
+    }
+    if (ret < 0) {
+        fprintf(stderr, "%s错误: 读取 '%s' 失败: %s%s\n", COLOR_RED, filename, strerror(errno), COLOR_RESET);
+    }
+    line_reader_close(&reader);
+    return ret;
+}
+
+int process_count_distinct(char **files, int file_count, const struct options *opts) {
+    SketchSet set;
+    memset(&set, 0, sizeof(set));
+    set.precision = opts->precision;
+    if (opts->fields_spec) {
+        set.count = parse_fields(opts->fields_spec, set.fields);
+        if (set.count <= 0) {
+            fprintf(stderr, "%s错误: 无效的字段列表 '%s'%s\n", COLOR_RED, opts->fields_spec, COLOR_RESET);
+            return 1;
+        }
+    } else {
+        set.count = 1;
+        set.fields[0] = 0;
+    }
+
+    // 没有指定精度时沿用第一个草图文件的精度；只合并草图文件时还沿用它的字段
+    int merged = 0;
+    for (int i = 0; i < opts->merge_count; i++) {
+        SketchSet loaded;
+        if (load_sketches(opts->merge_files[i], &loaded) != 0) {
+            fprintf(stderr, "%s错误: 无法读取草图文件 '%s': %s%s\n",
+                    COLOR_RED, opts->merge_files[i], strerror(errno), COLOR_RESET);
+            sketch_set_free(&set);
+            return 1;
+        }
+        if (!set.registers) {
+            if (set.precision == 0) set.precision = loaded.precision;
+            if (!opts->fields_spec && file_count == 0) {
+                set.count = loaded.count;
+                memcpy(set.fields, loaded.fields, sizeof(set.fields));
+            }
+            if (sketch_set_alloc(&set) != 0) {
+                sketch_set_free(&loaded);
+                fprintf(stderr, "%s错误: 内存不足%s\n", COLOR_RED, COLOR_RESET);
+                return 1;
+            }
+        }
+        int ret = merge_sketches(&set, &loaded);
+        sketch_set_free(&loaded);
+        if (ret != 0) {
+            fprintf(stderr, "%s错误: 草图文件 '%s' 的精度或字段与当前统计不一致%s\n",
+                    COLOR_RED, opts->merge_files[i], COLOR_RESET);
+            sketch_set_free(&set);
+            return 1;
+        }
+        merged++;
+    }
+    if (!set.registers) {
+        if (set.precision == 0) set.precision = DEFAULT_HLL_PRECISION;
+        if (sketch_set_alloc(&set) != 0) {
+            fprintf(stderr, "%s错误: 内存不足%s\n", COLOR_RED, COLOR_RESET);
+            return 1;
+        }
+    }
+
+    // 只合并草图文件时不读标准输入
+    int result = 0;
+    unsigned long long lines = 0;
+    if (file_count == 0 && merged == 0) {
+        if (add_input(&set, "-", opts, &lines) != 0) result = 1;
+    }
+    for (int i = 0; i < file_count; i++) {
+        if (add_input(&set, files[i], opts, &lines) != 0) result = 1;
+    }
+
+    if (opts->save_file && save_sketches(opts->save_file, &set) != 0) {
+        fprintf(stderr, "%s错误: 无法保存草图文件 '%s': %s%s\n",
+                COLOR_RED, opts->save_file, strerror(errno), COLOR_RESET);
+        result = 1;
+    }
+
+    // 标准误差约为 1.04 / sqrt(m)
+    double error = 1.04 / sqrt((double)register_count(&set)) * 100;
+    for (int i = 0; i < set.count; i++) {
+        // 精确集合还在时直接给出它的大小
+        const ExactSet *exact = &set.exact[i];
+        double estimate = exact->slots ? (double)exact->count
+                                       : sketch_estimate(set.registers + (size_t)i * register_count(&set),
+                                                         set.precision);
+        if (set.fields[i] == 0) {
+            printf("%s不同的行:%s %.0f", opts->color ? COLOR_CYAN : "", opts->color ? COLOR_RESET : "", estimate);
+        } else {
+            printf("%s字段 %d:%s %.0f", opts->color ? COLOR_CYAN : "", set.fields[i],
+                   opts->color ? COLOR_RESET : "", estimate);
+        }
+        if (exact->slots) printf(" (精确)\n"); else printf(" (±%.2f%%)\n", error);
+    }
+
+    if (opts->show_stats) {
+        printf("%s统计信息:%s\n", COLOR_CYAN, COLOR_RESET);
+        printf("  总行数: %llu\n", lines);
+        printf("  精度: %d (%zu 个寄存器，%zu 字节)\n", set.precision, register_count(&set),
+               register_count(&set) * (size_t)set.count);
+        if (merged > 0) printf("  合并的草图文件: %d\n", merged);
+    }
+
+    sketch_set_free(&set);
+    return result;
+}
@@ -0,0 +1,140 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <ctype.h>
+#include "puniq.h"
+
+// 输入的读取和比较键：按 1MB 的块读取，用 memchr 找换行符，行直接指向读缓冲区
+
+#define READ_CHUNK (1024 * 1024)
+
+int line_reader_init(LineReader *reader, int fd) {
+    memset(reader, 0, sizeof(*reader));
+    reader->fd = fd;
+    reader->capacity = READ_CHUNK;
+    reader->buffer = malloc(reader->capacity);
+    return reader->buffer ? 0 : -1;
+}
+
+int line_reader_open(LineReader *reader, const char *filename) {
+    int fd = strcmp(filename, "-") == 0 ? dup(STDIN_FILENO) : open(filename, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    if (line_reader_init(reader, fd) != 0) {
+        close(fd);
+        return -1;
+    }
+    return 0;
+}
+
+void line_reader_close(LineReader *reader) {
+    if (reader->fd >= 0) close(reader->fd);
+    free(reader->buffer);
+    memset(reader, 0, sizeof(*reader));
+    reader->fd = -1;
+}
+
+int line_reader_next(LineReader *reader, const char **line, size_t *length) {
+    size_t scanned = reader->start;
+    for (;;) {
+        char *newline = memchr(reader->buffer + scanned, '\n', reader->end - scanned);
+        if (newline) {
+            *line = reader->buffer + reader->start;
+            *length = (size_t)(newline - *line);
+            reader->start = (size_t)(newline - reader->buffer) + 1;
+            return 1;
+        }
+        if (reader->eof) {
+            // 最后一行没有换行符
+            if (reader->start == reader->end) return 0;
+            *line = reader->buffer + reader->start;
+            *length = reader->end - reader->start;
+            reader->start = reader->end;
+            return 1;
+        }
+
+        // 把未完成的行移到开头，行比缓冲区还长时扩大缓冲区
+        size_t pending = reader->end - reader->start;
+        if (reader->start > 0) {
+            memmove(reader->buffer, reader->buffer + reader->start, pending);
+            reader->start = 0;
+            reader->end = pending;
+        }
+        if (reader->capacity - reader->end < READ_CHUNK / 2) {
+            char *grown = realloc(reader->buffer, reader->capacity * 2);
+            if (!grown) return -1;
+            reader->buffer = grown;
+            reader->capacity *= 2;
+        }
+        scanned = reader->end;
+
+        ssize_t n = read(reader->fd, reader->buffer + reader->end, reader->capacity - reader->end);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return -1;
+        if (n == 0) reader->eof = 1;
+        reader->end += (size_t)n;
+    }
+}
+
+size_t line_key_offset(const char *line, size_t length, const struct options *opts) {
+    size_t p = 0;
+
+    // 跳过指定数量的字段
+    int fields_skipped = 0;
+    while (p < length && fields_skipped < opts->skip_fields) {
+        if (line[p] == ' ' || line[p] == '\t') {
+            fields_skipped++;
+            while (p < length && (line[p] == ' ' || line[p] == '\t')) p++;
+        } else {
+            p++;
+        }
+    }
+
+    // 跳过指定数量的字符
+    size_t skip = opts->skip_chars > 0 ? (size_t)opts->skip_chars : 0;
+    return length - p < skip ? length : p + skip;
+}
+
+#define HASH_MULTIPLIER 0x9e3779b97f4a7c15ULL
+
+static uint64_t mix_hash(uint64_t h) {
+    h ^= h >> 32;
+    h *= HASH_MULTIPLIER;
+    h ^= h >> 29;
+    h *= HASH_MULTIPLIER;
+    h ^= h >> 32;
+    return h;
+}
+
+// 每次处理 8 字节，忽略大小写时逐字节转换
+uint64_t key_hash(const char *key, size_t length, int ignore_case, uint64_t seed) {
+    const unsigned char *p = (const unsigned char *)key;
+    uint64_t h = (length + seed) * HASH_MULTIPLIER ^ seed;
+
+    if (ignore_case) {
+        for (size_t i = 0; i < length; i++) {
+            h = (h ^ (uint64_t)tolower(p[i])) * HASH_MULTIPLIER;
+        }
+        return mix_hash(h);
+    }
+
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        uint64_t word;
+        memcpy(&word, p + i, 8);
+        h = (h ^ word) * HASH_MULTIPLIER;
+        h ^= h >> 31;
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, p + i, length - i);
+    h = (h ^ tail) * HASH_MULTIPLIER;
+    return mix_hash(h);
+}
+
+int keys_equal(const char *key1, size_t length1, const char *key2, size_t length2, int ignore_case) {
+    if (length1 != length2) return 0;
+    if (ignore_case) return strncasecmp(key1, key2, length1) == 0;
+    return memcmp(key1, key2, length1) == 0;
+}
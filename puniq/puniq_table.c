@@ -0,0 +1,152 @@
+#include <stdlib.h>
+#include <string.h>
+#include "puniq.h"
+
+// 计数表：槽位只存哈希和记录指针，行内容连续存放在 arena 的大块内存中，
+// 不为每一行单独 malloc。arena 按插入顺序遍历即得到第一次出现的顺序
+
+#define ARENA_MIN_CHUNK (64 * 1024)             // 块从小到大翻倍，内存上限很小时也能用上
+#define ARENA_MAX_CHUNK (4 * 1024 * 1024)
+#define INITIAL_SLOTS 1024
+
+struct ArenaChunk {
+    ArenaChunk *next;
+    size_t used;
+    size_t size;
+    char data[];
+};
+
+int count_table_init(CountTable *table, size_t limit, int ignore_case) {
+    memset(table, 0, sizeof(*table));
+    table->slots = calloc(INITIAL_SLOTS, sizeof(CountSlot));
+    if (!table->slots) return -1;
+    table->mask = INITIAL_SLOTS - 1;
+    table->memory = INITIAL_SLOTS * sizeof(CountSlot);
+    table->limit = limit;
+    table->ignore_case = ignore_case;
+    return 0;
+}
+
+void count_table_free(CountTable *table) {
+    ArenaChunk *chunk = table->head;
+    while (chunk) {
+        ArenaChunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    free(table->slots);
+    memset(table, 0, sizeof(*table));
+}
+
+// 记录按 8 字节对齐
+static size_t record_size(size_t length) {
+    return (sizeof(CountRecord) + length + 1 + 7) & ~(size_t)7;
+}
+
+static CountRecord *arena_alloc(CountTable *table, size_t size) {
+    ArenaChunk *tail = table->tail;
+    if (!tail || tail->size - tail->used < size) {
+        size_t chunk_size = tail ? tail->size * 2 : ARENA_MIN_CHUNK;
+        if (chunk_size > ARENA_MAX_CHUNK) chunk_size = ARENA_MAX_CHUNK;
+        if (chunk_size < size) chunk_size = size;
+        if (table->memory + sizeof(ArenaChunk) + chunk_size > table->limit) return NULL;
+        ArenaChunk *chunk = malloc(sizeof(ArenaChunk) + chunk_size);
+        if (!chunk) return NULL;
+        chunk->next = NULL;
+        chunk->used = 0;
+        chunk->size = chunk_size;
+        if (tail) tail->next = chunk; else table->head = chunk;
+        table->tail = tail = chunk;
+        table->memory += sizeof(ArenaChunk) + chunk_size;
+    }
+    CountRecord *record = (CountRecord *)(tail->data + tail->used);
+    tail->used += size;
+    return record;
+}
+
+// 负载因子超过 3/4 时扩容为两倍
+static int grow_slots(CountTable *table) {
+    size_t capacity = (table->mask + 1) * 2;
+    size_t added = capacity * sizeof(CountSlot) - (table->mask + 1) * sizeof(CountSlot);
+    if (table->memory + added > table->limit) return -1;
+    CountSlot *slots = calloc(capacity, sizeof(CountSlot));
+    if (!slots) return -1;
+
+    size_t mask = capacity - 1;
+    for (size_t i = 0; i <= table->mask; i++) {
+        if (!table->slots[i].record) continue;
+        size_t pos = (size_t)table->slots[i].hash & mask;
+        while (slots[pos].record) pos = (pos + 1) & mask;
+        slots[pos] = table->slots[i];
+    }
+    free(table->slots);
+    table->slots = slots;
+    table->mask = mask;
+    table->memory += added;
+    return 0;
+}
+
+CountRecord *count_table_add(CountTable *table, const char *line, size_t length, size_t key_offset,
+                             uint64_t hash) {
+    const char *key = line + key_offset;
+    size_t key_length = length - key_offset;
+    size_t pos = (size_t)hash & table->mask;
+    for (;;) {
+        CountSlot *slot = &table->slots[pos];
+        if (!slot->record) break;
+        if (slot->hash == hash) {
+            CountRecord *record = slot->record;
+            if (keys_equal(record_text(record) + record->key_offset, record->length - record->key_offset,
+                           key, key_length, table->ignore_case)) {
+                record->count++;
+                return record;
+            }
+        }
+        pos = (pos + 1) & table->mask;
+    }
+
+    if (table->full || length > UINT32_MAX) {
+        table->full = 1;
+        return NULL;
+    }
+    if ((table->count + 1) * 4 > (table->mask + 1) * 3) {
+        if (grow_slots(table) != 0) {
+            table->full = 1;
+            return NULL;
+        }
+        pos = (size_t)hash & table->mask;
+        while (table->slots[pos].record) pos = (pos + 1) & table->mask;
+    }
+
+    CountRecord *record = arena_alloc(table, record_size(length));
+    if (!record) {
+        table->full = 1;
+        return NULL;
+    }
+    record->count = 1;
+    record->length = (uint32_t)length;
+    record->key_offset = (uint32_t)key_offset;
+    memcpy((char *)(record + 1), line, length);
+    ((char *)(record + 1))[length] = '\0';
+
+    table->slots[pos].hash = hash;
+    table->slots[pos].record = record;
+    table->count++;
+    return record;
+}
+
+void count_cursor_init(const CountTable *table, CountCursor *cursor) {
+    cursor->chunk = table->head;
+    cursor->offset = 0;
+}
+
+const CountRecord *count_cursor_next(CountCursor *cursor) {
+    while (cursor->chunk && cursor->offset >= cursor->chunk->used) {
+        cursor->chunk = cursor->chunk->next;
+        cursor->offset = 0;
+    }
+    if (!cursor->chunk) return NULL;
+    const CountRecord *record = (const CountRecord *)(cursor->chunk->data + cursor->offset);
+    cursor->offset += record_size(record->length);
+    return record;
+}
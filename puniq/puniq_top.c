@@ -0,0 +1,326 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "puniq.h"
+
+// --top N：取出现次数最多的 N 行。
+// 精确模式由 --global 的计数表统计，表中（以及每个分区）的记录依次放进容量为 N 的小顶堆，
+// 只保留次数最大的 N 个，最后对这 N 个排序，不需要对所有行排序。
+// --approx 使用 Space-Saving 算法：只保留 k 个计数器，新的行替换次数最少的计数器并继承
+// 它的次数作为误差。任何出现次数超过 总行数/k 的行都一定在结果中，每个计数最多高估 误差 次
+
+#define APPROX_COUNTERS_PER_ITEM 8      // 每个要求的结果分配的计数器个数
+#define MIN_APPROX_COUNTERS 1024
+
+// ---- 精确模式的小顶堆 ----
+
+static int item_less(const TopItem *a, const TopItem *b) {
+    return a->count < b->count;
+}
+
+static void swap_items(TopItem *a, TopItem *b) {
+    TopItem t = *a;
+    *a = *b;
+    *b = t;
+}
+
+int top_heap_init(TopHeap *heap, size_t capacity) {
+    heap->items = malloc(capacity * sizeof(TopItem));
+    heap->size = 0;
+    heap->capacity = capacity;
+    return heap->items ? 0 : -1;
+}
+
+void top_heap_free(TopHeap *heap) {
+    for (size_t i = 0; i < heap->size; i++) free(heap->items[i].line);
+    free(heap->items);
+    memset(heap, 0, sizeof(*heap));
+}
+
+static void heap_sift_down(TopItem *items, size_t size, size_t i) {
+    for (;;) {
+        size_t smallest = i, left = 2 * i + 1, right = left + 1;
+        if (left < size && item_less(&items[left], &items[smallest])) smallest = left;
+        if (right < size && item_less(&items[right], &items[smallest])) smallest = right;
+        if (smallest == i) return;
+        swap_items(&items[i], &items[smallest]);
+        i = smallest;
+    }
+}
+
+int top_heap_offer(TopHeap *heap, const char *line, size_t length, uint64_t count) {
+    if (heap->capacity == 0) return 0;
+    // 堆满且不比最小的大时直接丢弃，次数相同时保留先出现的
+    if (heap->size == heap->capacity && count <= heap->items[0].count) return 0;
+
+    char *copy = malloc(length + 1);
+    if (!copy) return -1;
+    memcpy(copy, line, length);
+    copy[length] = '\0';
+
+    if (heap->size == heap->capacity) {
+        free(heap->items[0].line);
+        heap->items[0].line = copy;
+        heap->items[0].count = count;
+        heap->items[0].error = 0;
+        heap_sift_down(heap->items, heap->size, 0);
+        return 0;
+    }
+
+    size_t i = heap->size++;
+    heap->items[i].line = copy;
+    heap->items[i].count = count;
+    heap->items[i].error = 0;
+    while (i > 0 && item_less(&heap->items[i], &heap->items[(i - 1) / 2])) {
+        swap_items(&heap->items[i], &heap->items[(i - 1) / 2]);
+        i = (i - 1) / 2;
+    }
+    return 0;
+}
+
+// 次数从大到小，次数相同时按内容排序，保证输出稳定
+static int compare_items_desc(const void *a, const void *b) {
+    const TopItem *x = (const TopItem *)a;
+    const TopItem *y = (const TopItem *)b;
+    if (x->count != y->count) return x->count < y->count ? 1 : -1;
+    return strcmp(x->line, y->line);
+}
+
+void top_heap_print(TopHeap *heap, const struct options *opts) {
+    qsort(heap->items, heap->size, sizeof(TopItem), compare_items_desc);
+    for (size_t i = 0; i < heap->size; i++) {
+        print_counted_line(heap->items[i].line, heap->items[i].count, opts);
+        if (opts->verbose && heap->items[i].error > 0) {
+            printf("%s        (误差 ≤ %llu)%s\n", COLOR_YELLOW,
+                   (unsigned long long)heap->items[i].error, COLOR_RESET);
+        }
+    }
+}
+
+// ---- Space-Saving ----
+
+typedef struct {
+    uint64_t hash;
+    uint64_t count;
+    uint64_t error;             // 替换时继承的次数，真实次数不小于 count - error
+    char *line;
+    uint32_t length;
+    uint32_t key_offset;
+    size_t line_capacity;       // 替换时能放下新行就复用 line 的内存
+    size_t slot;                // 在哈希表中的位置
+} Counter;
+
+// 计数器按次数组成小顶堆，哈希表记录每一行对应的计数器在堆中的下标
+typedef struct {
+    Counter *counters;
+    size_t size;
+    size_t capacity;
+    long *slots;                // -1 表示空槽
+    size_t mask;
+    int ignore_case;
+} SpaceSaving;
+
+static int space_saving_init(SpaceSaving *ss, size_t capacity, int ignore_case) {
+    size_t slot_count = 16;
+    while (slot_count < capacity * 2) slot_count <<= 1;
+    ss->counters = calloc(capacity, sizeof(Counter));
+    ss->slots = malloc(slot_count * sizeof(long));
+    ss->size = 0;
+    ss->capacity = capacity;
+    ss->mask = slot_count - 1;
+    ss->ignore_case = ignore_case;
+    if (!ss->counters || !ss->slots) {
+        free(ss->counters);
+        free(ss->slots);
+        return -1;
+    }
+    for (size_t i = 0; i < slot_count; i++) ss->slots[i] = -1;
+    return 0;
+}
+
+static void space_saving_free(SpaceSaving *ss) {
+    for (size_t i = 0; i < ss->size; i++) free(ss->counters[i].line);
+    free(ss->counters);
+    free(ss->slots);
+}
+
+static void swap_counters(SpaceSaving *ss, size_t i, size_t j) {
+    Counter t = ss->counters[i];
+    ss->counters[i] = ss->counters[j];
+    ss->counters[j] = t;
+    ss->slots[ss->counters[i].slot] = (long)i;
+    ss->slots[ss->counters[j].slot] = (long)j;
+}
+
+static void counter_sift_down(SpaceSaving *ss, size_t i) {
+    for (;;) {
+        size_t smallest = i, left = 2 * i + 1, right = left + 1;
+        if (left < ss->size && ss->counters[left].count < ss->counters[smallest].count) smallest = left;
+        if (right < ss->size && ss->counters[right].count < ss->counters[smallest].count) smallest = right;
+        if (smallest == i) return;
+        swap_counters(ss, i, smallest);
+        i = smallest;
+    }
+}
+
+// 线性探测的删除：把后面同一探测链上的槽位往前移，不留墓碑
+static void remove_slot(SpaceSaving *ss, size_t slot) {
+    size_t hole = slot;
+    size_t pos = (slot + 1) & ss->mask;
+    while (ss->slots[pos] >= 0) {
+        size_t home = (size_t)ss->counters[ss->slots[pos]].hash & ss->mask;
+        // home 不在 (hole, pos] 之间时可以移到 hole
+        if (((pos - home) & ss->mask) >= ((pos - hole) & ss->mask)) {
+            ss->slots[hole] = ss->slots[pos];
+            ss->counters[ss->slots[hole]].slot = hole;
+            hole = pos;
+        }
+        pos = (pos + 1) & ss->mask;
+    }
+    ss->slots[hole] = -1;
+}
+
+static int space_saving_add(SpaceSaving *ss, const char *line, size_t length, size_t key_offset, uint64_t hash) {
+    size_t pos = (size_t)hash & ss->mask;
+    for (; ss->slots[pos] >= 0; pos = (pos + 1) & ss->mask) {
+        Counter *counter = &ss->counters[ss->slots[pos]];
+        if (counter->hash == hash &&
+            keys_equal(counter->line + counter->key_offset, counter->length - counter->key_offset,
+                       line + key_offset, length - key_offset, ss->ignore_case)) {
+            counter->count++;
+            counter_sift_down(ss, (size_t)ss->slots[pos]);
+            return 0;
+        }
+    }
+
+    size_t index;
+    uint64_t base = 0;
+    if (ss->size < ss->capacity) {
+        index = ss->size;
+    } else {
+        // 替换次数最少的计数器
+        index = 0;
+        base = ss->counters[0].count;
+    }
+
+    Counter *counter = &ss->counters[index];
+    if (counter->line_capacity < length + 1) {
+        char *grown = realloc(counter->line, length + 1);
+        if (!grown) return -1;
+        counter->line = grown;
+        counter->line_capacity = length + 1;
+    }
+    if (base > 0) {
+        remove_slot(ss, counter->slot);
+        pos = (size_t)hash & ss->mask;
+        while (ss->slots[pos] >= 0) pos = (pos + 1) & ss->mask;
+    } else {
+        ss->size++;
+    }
+    memcpy(counter->line, line, length);
+    counter->line[length] = '\0';
+    counter->hash = hash;
+    counter->count = base + 1;
+    counter->error = base;
+    counter->length = (uint32_t)length;
+    counter->key_offset = (uint32_t)key_offset;
+    counter->slot = pos;
+    ss->slots[pos] = (long)index;
+    if (base == 0) {
+        // 新计数器放在堆尾，次数是 1，往上移
+        while (index > 0 && ss->counters[(index - 1) / 2].count > ss->counters[index].count) {
+            swap_counters(ss, index, (index - 1) / 2);
+            index = (index - 1) / 2;
+        }
+    } else {
+        counter_sift_down(ss, index);
+    }
+    return 0;
+}
+
+int process_top_approx(char **files, int file_count, const struct options *opts) {
+    size_t capacity = opts->top * APPROX_COUNTERS_PER_ITEM;
+    if (capacity < MIN_APPROX_COUNTERS) capacity = MIN_APPROX_COUNTERS;
+
+    SpaceSaving ss;
+    if (space_saving_init(&ss, capacity, opts->ignore_case) != 0) {
+        fprintf(stderr, "%s错误: 内存不足%s\n", COLOR_RED, COLOR_RESET);
+        return 1;
+    }
+
+    char *stdin_name = "-";
+    if (file_count == 0) {
+        files = &stdin_name;
+        file_count = 1;
+    }
+
+    int result = 0;
+    unsigned long long lines = 0;
+    for (int i = 0; i < file_count; i++) {
+        LineReader reader;
+        if (line_reader_open(&reader, files[i]) != 0) {
+            fprintf(stderr, "%s错误: 无法打开文件 '%s': %s%s\n",
+                    COLOR_RED, files[i], strerror(errno), COLOR_RESET);
+            result = 1;
+            continue;
+        }
+        const char *line;
+        size_t length;
+        int ret;
+        while ((ret = line_reader_next(&reader, &line, &length)) == 1) {
+            size_t key_offset = line_key_offset(line, length, opts);
+            uint64_t hash = key_hash(line + key_offset, length - key_offset, opts->ignore_case, 0);
+            if (length > UINT32_MAX || space_saving_add(&ss, line, length, key_offset, hash) != 0) {
+                ret = -1;
+                break;
+            }
+            lines++;
+        }
+        if (ret < 0) {
+            fprintf(stderr, "%s错误: 处理 '%s' 失败: %s%s\n", COLOR_RED, files[i], strerror(errno), COLOR_RESET);
+            result = 1;
+        }
+        line_reader_close(&reader);
+    }
+
+    // 计数器已经很少，直接排序取前 N 个
+    TopHeap heap;
+    heap.size = ss.size < opts->top ? ss.size : opts->top;
+    heap.capacity = ss.size;
+    heap.items = malloc((ss.size + 1) * sizeof(TopItem));
+    if (!heap.items) {
+        space_saving_free(&ss);
+        fprintf(stderr, "%s错误: 内存不足%s\n", COLOR_RED, COLOR_RESET);
+        return 1;
+    }
+    for (size_t i = 0; i < ss.size; i++) {
+        heap.items[i].line = ss.counters[i].line;
+        heap.items[i].count = ss.counters[i].count;
+        heap.items[i].error = ss.counters[i].error;
+    }
+    qsort(heap.items, ss.size, sizeof(TopItem), compare_items_desc);
+
+    // 排在第 N+1 位的估计次数：结果中真实次数的下界超过它的行一定属于前 N 名
+    uint64_t next_count = ss.size > heap.size ? heap.items[heap.size].count : 0;
+    size_t guaranteed = 0;
+    uint64_t max_error = 0;
+    for (size_t i = 0; i < heap.size; i++) {
+        if (heap.items[i].count - heap.items[i].error >= next_count) guaranteed++;
+        if (heap.items[i].error > max_error) max_error = heap.items[i].error;
+    }
+    top_heap_print(&heap, opts);
+
+    if (opts->show_stats) {
+        printf("%s统计信息:%s\n", COLOR_CYAN, COLOR_RESET);
+        printf("  总行数: %llu\n", lines);
+        printf("  计数器: %zu\n", capacity);
+        printf("  最大误差: %llu (总行数/计数器 = %llu)\n", (unsigned long long)max_error,
+               lines / capacity);
+        printf("  确定属于前 %zu 名: %zu\n", opts->top, guaranteed);
+    }
+
+    free(heap.items);
+    space_saving_free(&ss);
+    return result;
+}
@@ -0,0 +1,137 @@
+#ifndef PZIP_H
+#define PZIP_H
+
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+
+#define MAX_FILENAME 256
+#define BUFFER_SIZE (256 * 1024)
+#define COMPRESSION_LEVEL 6
+#define MAX_JOBS 64
+#define FAST_AUTO_THROUGHPUT 100   // --fast-auto 默认的目标吞吐量 (MB/s)
+
+#define ZIP_LOCAL_SIGNATURE   0x04034b50
+#define ZIP_CENTRAL_SIGNATURE 0x02014b50
+#define ZIP_END_SIGNATURE     0x06054b50
+#define ZIP64_END_SIGNATURE   0x06064b50
+#define ZIP64_LOCATOR_SIGNATURE 0x07064b50
+#define ZIP64_EXTRA_ID        0x0001
+#define ZIP64_LIMIT           0xffffffffULL  // 32 位字段达到此值时改用 ZIP64 扩展字段
+#define ZIP64_ENTRY_LIMIT     0xffff
+#define ZIP_METHOD_STORE      0
+#define ZIP_METHOD_DEFLATE    8
+#define ZIP_VERSION           20        // 需要的最低版本 2.0（deflate、目录）
+#define ZIP64_VERSION         45        // 使用 ZIP64 扩展时需要 4.5
+#define ZIP_MADE_BY_UNIX      (3 << 8)  // 高字节为 3 表示外部属性是 Unix 权限
+
+// 操作类型枚举
+typedef enum {
+    OP_COMPRESS,    // 压缩
+    OP_DECOMPRESS,  // 解压
+    OP_LIST,        // 列出内容
+    OP_TEST         // 测试
+} OperationType;
+
+// 压缩配置结构
+typedef struct {
+    char archive_name[MAX_FILENAME];
+    char **files;
+    int file_count;
+    OperationType operation;
+    int compression_level;
+    int verbose;
+    int force;
+    int recursive;
+    int preserve_paths;
+    int jobs;               // 并行压缩的工作线程数
+    int target_throughput;  // --fast-auto 的目标吞吐量 (MB/s)，0 表示使用固定的压缩级别
+} ZipConfig;
+
+// ZIP本地文件头（小端，紧凑排列）
+typedef struct __attribute__((packed)) {
+    uint32_t signature;
+    uint16_t version;
+    uint16_t flags;
+    uint16_t compression;
+    uint16_t mod_time;
+    uint16_t mod_date;
+    uint32_t crc32;
+    uint32_t compressed_size;
+    uint32_t uncompressed_size;
+    uint16_t filename_length;
+    uint16_t extra_field_length;
+} ZipLocalFileHeader;
+
+// 中央目录中的文件头
+typedef struct __attribute__((packed)) {
+    uint32_t signature;
+    uint16_t version_made_by;
+    uint16_t version;
+    uint16_t flags;
+    uint16_t compression;
+    uint16_t mod_time;
+    uint16_t mod_date;
+    uint32_t crc32;
+    uint32_t compressed_size;
+    uint32_t uncompressed_size;
+    uint16_t filename_length;
+    uint16_t extra_field_length;
+    uint16_t comment_length;
+    uint16_t disk_start;
+    uint16_t internal_attributes;
+    uint32_t external_attributes;
+    uint32_t local_header_offset;
+} ZipCentralFileHeader;
+
+// 中央目录结束记录
+typedef struct __attribute__((packed)) {
+    uint32_t signature;
+    uint16_t disk_number;
+    uint16_t central_disk;
+    uint16_t disk_entries;
+    uint16_t total_entries;
+    uint32_t central_size;
+    uint32_t central_offset;
+    uint16_t comment_length;
+} ZipEndOfCentralDir;
+
+// ZIP64 中央目录结束记录
+typedef struct __attribute__((packed)) {
+    uint32_t signature;
+    uint64_t record_size;       // 本记录除去前 12 字节的大小
+    uint16_t version_made_by;
+    uint16_t version;
+    uint32_t disk_number;
+    uint32_t central_disk;
+    uint64_t disk_entries;
+    uint64_t total_entries;
+    uint64_t central_size;
+    uint64_t central_offset;
+} Zip64EndOfCentralDir;
+
+// ZIP64 结束记录定位器，紧挨在普通结束记录之前
+typedef struct __attribute__((packed)) {
+    uint32_t signature;
+    uint32_t end_disk;
+    uint64_t end_offset;
+    uint32_t total_disks;
+} Zip64EndLocator;
+
+// 显示进度条
+void show_progress(off_t current, off_t total, const char *operation);
+
+// 把时间转换成 ZIP 使用的 MS-DOS 日期和时间（本地时间，2 秒精度）
+void dos_datetime(time_t t, uint16_t *dos_time, uint16_t *dos_date);
+
+// 创建ZIP文件：工作线程并行压缩各个条目，主线程按原来的顺序写出，最后写中央目录。
+// 成功返回 0
+int create_zip(const ZipConfig *config);
+
+// 解压ZIP文件：读取中央目录后由多个线程并行解压各个文件条目。成功返回 0
+int extract_zip(const ZipConfig *config);
+
+// 条目是否被命令行选中：没有指定成员时全部选中，指定目录时包含其下的所有条目
+int member_selected(const ZipConfig *config, const char *name);
+
+#endif // PZIP_H
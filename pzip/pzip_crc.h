@@ -0,0 +1,15 @@
+#ifndef PZIP_CRC_H
+#define PZIP_CRC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ZIP 使用的 CRC-32（多项式 0xEDB88320，结果与 zlib 的 crc32() 相同）。
+// CPU 支持 PCLMULQDQ 时用无进位乘法折叠，一次处理 64 字节；否则使用 zlib。
+// crc 为前一段数据的结果，第一段传 0
+uint32_t fast_crc32(uint32_t crc, const void *data, size_t len);
+
+// 当前使用的实现名称，用于 -v 输出
+const char *fast_crc32_impl(void);
+
+#endif // PZIP_CRC_H
@@ -0,0 +1,716 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <math.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <zlib.h>
+#include "../include/common.h"
+#include "pzip.h"
+#include "pzip_crc.h"
+
+#define ENTRY_MEMORY_LIMIT (8 * 1024 * 1024)   // 单个条目的压缩结果超过此大小时写入临时文件
+#define ENTRY_WINDOW_PER_JOB 4                 // 每个线程最多领先写出位置的条目数
+#define ENTROPY_SAMPLE_SIZE (64 * 1024)        // 估计熵时采样的字节数
+#define ENTROPY_MIN_SAMPLE 512                 // 样本太小时熵估计偏低，不做判断
+#define ENTROPY_STORE_BITS 7.5                 // 每字节熵高于此值时 deflate 收益不到 6%，直接存储
+#define THROUGHPUT_WINDOW (8 * 1024 * 1024)    // --fast-auto 每压缩这么多字节调整一次级别
+
+typedef enum {
+    ENTRY_PENDING,
+    ENTRY_RUNNING,
+    ENTRY_DONE,
+    ENTRY_FAILED
+} EntryState;
+
+// 一个待压缩的条目和它的压缩结果
+typedef struct {
+    char *path;                 // 磁盘上的路径
+    char *name;                 // 归档中的名字，目录以 '/' 结尾
+    int is_directory;
+    mode_t mode;
+    time_t mtime;
+
+    EntryState state;
+    uint16_t method;
+    uint32_t crc;
+    uint64_t uncompressed_size;
+    uint64_t compressed_size;
+    unsigned char *data;        // 内存中的压缩数据
+    size_t data_len;
+    size_t data_capacity;
+    FILE *spill;                // 压缩数据过大时的临时文件
+    uint64_t local_header_offset;
+} ZipEntry;
+
+typedef struct {
+    const ZipConfig *config;
+    ZipEntry *entries;
+    size_t count;
+    size_t capacity;
+
+    pthread_mutex_t lock;
+    pthread_cond_t entry_done;      // 有条目压缩完成
+    pthread_cond_t window_moved;    // 写出位置前进
+    size_t next_entry;              // 下一个待领取的条目
+    size_t written;                 // 已写出的条目数
+    size_t window;
+    int jobs;
+    int auto_level;                 // --fast-auto 当前使用的压缩级别，受 lock 保护
+} CreateContext;
+
+// 工作线程的吞吐量统计，用于 --fast-auto
+typedef struct {
+    uint64_t bytes;
+    struct timespec start;          // 线程 CPU 时间
+} ThroughputMeter;
+
+void dos_datetime(time_t t, uint16_t *dos_time, uint16_t *dos_date) {
+    struct tm tm_info;
+    localtime_r(&t, &tm_info);
+    if (tm_info.tm_year < 80) {
+        // DOS 日期从 1980 年开始
+        *dos_time = 0;
+        *dos_date = (1 << 5) | 1;
+        return;
+    }
+    *dos_time = (uint16_t)((tm_info.tm_hour << 11) | (tm_info.tm_min << 5) | (tm_info.tm_sec / 2));
+    *dos_date = (uint16_t)(((tm_info.tm_year - 80) << 9) | ((tm_info.tm_mon + 1) << 5) | tm_info.tm_mday);
+}
+
+// ---- 收集条目 ----
+
+// 归档中的名字：去掉开头的 '/' 和 "./"
+static const char *entry_name(const char *path) {
+    for (;;) {
+        if (*path == '/') {
+            path++;
+        } else if (path[0] == '.' && path[1] == '/') {
+            path += 2;
+        } else {
+            return path;
+        }
+    }
+}
+
+static int add_entry(CreateContext *ctx, const char *path, const struct stat *st) {
+    const char *name = entry_name(path);
+    size_t name_len = strlen(name);
+    if (name_len == 0 || name_len > 0xfffe) return 1;     // 名字长度字段只有 16 位
+
+    if (ctx->count == ctx->capacity) {
+        size_t capacity = ctx->capacity ? ctx->capacity * 2 : 256;
+        ZipEntry *entries = realloc(ctx->entries, capacity * sizeof(ZipEntry));
+        if (!entries) return 0;
+        ctx->entries = entries;
+        ctx->capacity = capacity;
+    }
+
+    ZipEntry *entry = &ctx->entries[ctx->count];
+    memset(entry, 0, sizeof(*entry));
+    entry->is_directory = S_ISDIR(st->st_mode);
+    entry->mode = st->st_mode;
+    entry->mtime = st->st_mtime;
+    entry->path = strdup(path);
+    entry->name = malloc(name_len + 2);
+    if (!entry->path || !entry->name) {
+        free(entry->path);
+        free(entry->name);
+        return 0;
+    }
+    snprintf(entry->name, name_len + 2, "%s%s",
+             name, entry->is_directory && name[name_len - 1] != '/' ? "/" : "");
+    ctx->count++;
+    return 1;
+}
+
+// 递归收集目录中的条目，目录自身也作为一个条目，这样空目录也能还原。
+// 命令行上给出的路径会跟随符号链接，目录内的符号链接跳过
+static int collect_directory(CreateContext *ctx, const char *dirpath, const struct stat *st) {
+    if (!add_entry(ctx, dirpath, st)) return 0;
+
+    DIR *dir = opendir(dirpath);
+    if (!dir) {
+        print_warning("无法打开目录，跳过");
+        return 1;
+    }
+
+    int ok = 1;
+    struct dirent *entry;
+    while (ok && (entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+
+        size_t len = strlen(dirpath) + strlen(entry->d_name) + 2;
+        char *path = malloc(len);
+        if (!path) {
+            ok = 0;
+            break;
+        }
+        size_t dir_len = strlen(dirpath);
+        snprintf(path, len, "%s%s%s", dirpath, dir_len > 0 && dirpath[dir_len - 1] == '/' ? "" : "/", entry->d_name);
+
+        // 目录内的符号链接不跟随，否则指向上级目录的链接会无限嵌套
+        struct stat child_st;
+        if (lstat(path, &child_st) != 0) {
+            print_warning("无法获取文件信息，跳过");
+        } else if (S_ISLNK(child_st.st_mode)) {
+            print_warning("跳过符号链接");
+        } else if (S_ISDIR(child_st.st_mode)) {
+            ok = collect_directory(ctx, path, &child_st);
+        } else if (S_ISREG(child_st.st_mode)) {
+            ok = add_entry(ctx, path, &child_st);
+        }
+        free(path);
+    }
+    closedir(dir);
+    return ok;
+}
+
+// ---- 压缩（工作线程） ----
+
+// 追加压缩数据：先放在内存中，超过上限后转存到临时文件
+static int append_output(ZipEntry *entry, const unsigned char *data, size_t len) {
+    entry->compressed_size += len;
+    if (entry->spill) {
+        return fwrite(data, 1, len, entry->spill) == len;
+    }
+    if (entry->data_len + len > ENTRY_MEMORY_LIMIT) {
+        if (!(entry->spill = tmpfile())) return 0;
+        int ok = fwrite(entry->data, 1, entry->data_len, entry->spill) == entry->data_len &&
+                 fwrite(data, 1, len, entry->spill) == len;
+        free(entry->data);
+        entry->data = NULL;
+        entry->data_len = entry->data_capacity = 0;
+        return ok;
+    }
+    if (entry->data_len + len > entry->data_capacity) {
+        size_t capacity = entry->data_capacity ? entry->data_capacity : 64 * 1024;
+        while (capacity < entry->data_len + len) capacity *= 2;
+        unsigned char *grown = realloc(entry->data, capacity);
+        if (!grown) return 0;
+        entry->data = grown;
+        entry->data_capacity = capacity;
+    }
+    memcpy(entry->data + entry->data_len, data, len);
+    entry->data_len += len;
+    return 1;
+}
+
+// 已经压缩过的格式再 deflate 基本没有收益。.tar、.bmp、.svg 虽然在列表中，但仍可压缩
+static int compressed_format(const char *name) {
+    const char *ext = strrchr(name, '.');
+    if (!ext || strcasecmp(ext, ".tar") == 0 || strcasecmp(ext, ".bmp") == 0 || strcasecmp(ext, ".svg") == 0) {
+        return 0;
+    }
+    return is_archive(name) || is_image(name) || is_video(name);
+}
+
+// 零阶熵（每字节的比特数）
+static double sample_entropy(const unsigned char *data, size_t len) {
+    size_t counts[256] = {0};
+    for (size_t i = 0; i < len; i++) counts[data[i]]++;
+
+    double entropy = 0.0;
+    for (int i = 0; i < 256; i++) {
+        if (counts[i] == 0) continue;
+        double p = (double)counts[i] / (double)len;
+        entropy -= p * log2(p);
+    }
+    return entropy;
+}
+
+// 根据扩展名和第一块数据决定是否直接存储
+static int should_store(const ZipEntry *entry, const unsigned char *first, size_t len) {
+    if (compressed_format(entry->name)) return 1;
+    if (len < ENTROPY_MIN_SAMPLE) return 0;
+    return sample_entropy(first, len < ENTROPY_SAMPLE_SIZE ? len : ENTROPY_SAMPLE_SIZE) >= ENTROPY_STORE_BITS;
+}
+
+static ssize_t read_chunk(int fd, unsigned char *buffer) {
+    for (;;) {
+        ssize_t n = read(fd, buffer, BUFFER_SIZE);
+        if (n >= 0 || errno != EINTR) return n;
+    }
+}
+
+// 丢弃已经产生的输出，重新开始这个条目
+static void reset_output(ZipEntry *entry) {
+    free(entry->data);
+    entry->data = NULL;
+    entry->data_len = entry->data_capacity = 0;
+    if (entry->spill) {
+        fclose(entry->spill);
+        entry->spill = NULL;
+    }
+    entry->compressed_size = 0;
+    entry->uncompressed_size = 0;
+    entry->crc = 0;
+}
+
+// 原样存储，buffer 中已经有读出的前 n 字节
+static int store_entry(ZipEntry *entry, int fd, unsigned char *buffer, ssize_t n) {
+    entry->method = ZIP_METHOD_STORE;
+    while (n > 0) {
+        entry->crc = fast_crc32(entry->crc, buffer, (size_t)n);
+        entry->uncompressed_size += (uint64_t)n;
+        if (!append_output(entry, buffer, (size_t)n)) return 0;
+        n = read_chunk(fd, buffer);
+    }
+    return n == 0;
+}
+
+static int64_t elapsed_ns(const struct timespec *start, const struct timespec *end) {
+    return (int64_t)(end->tv_sec - start->tv_sec) * 1000000000LL + (end->tv_nsec - start->tv_nsec);
+}
+
+// --fast-auto：按线程 CPU 时间估算总吞吐量，低于目标时降低级别，远高于目标时提高级别。
+// 假设每个线程独占一个核，返回调整后的级别
+static int adjust_auto_level(CreateContext *ctx, ThroughputMeter *meter) {
+    struct timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    int64_t ns = elapsed_ns(&meter->start, &now);
+    double mbps = ns > 0 ? (double)meter->bytes * 1000.0 / (double)ns * ctx->jobs : 0.0;
+    double target = ctx->config->target_throughput;
+
+    pthread_mutex_lock(&ctx->lock);
+    if (mbps > 0.0 && mbps < target && ctx->auto_level > 1) {
+        ctx->auto_level--;
+    } else if (mbps > target * 1.5 && ctx->auto_level < 9) {
+        ctx->auto_level++;
+    }
+    int level = ctx->auto_level;
+    pthread_mutex_unlock(&ctx->lock);
+
+    meter->bytes = 0;
+    meter->start = now;
+    return level;
+}
+
+static int current_level(CreateContext *ctx) {
+    if (!ctx->config->target_throughput) return ctx->config->compression_level;
+    pthread_mutex_lock(&ctx->lock);
+    int level = ctx->auto_level;
+    pthread_mutex_unlock(&ctx->lock);
+    return level;
+}
+
+static int deflate_chunk(z_stream *strm, ZipEntry *entry, int flush, unsigned char *out_buffer) {
+    do {
+        strm->next_out = out_buffer;
+        strm->avail_out = BUFFER_SIZE;
+        if (deflate(strm, flush) == Z_STREAM_ERROR ||
+            !append_output(entry, out_buffer, BUFFER_SIZE - strm->avail_out)) {
+            return 0;
+        }
+    } while (strm->avail_out == 0);
+    return 1;
+}
+
+// deflate 压缩，in_buffer 中已经有读出的前 n 字节。--fast-auto 时在块之间用 deflateParams 切换级别
+static int deflate_entry(CreateContext *ctx, ZipEntry *entry, int fd, unsigned char *in_buffer, ssize_t n,
+                         unsigned char *out_buffer, ThroughputMeter *meter) {
+    entry->method = ZIP_METHOD_DEFLATE;
+    int level = current_level(ctx);
+
+    z_stream strm;
+    memset(&strm, 0, sizeof(strm));
+    if (deflateInit2(&strm, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) return 0;
+
+    int ok = 1;
+    int flush = Z_NO_FLUSH;
+    do {
+        if (n < 0) {
+            ok = 0;
+            break;
+        }
+        flush = n == 0 ? Z_FINISH : Z_NO_FLUSH;
+        entry->crc = fast_crc32(entry->crc, in_buffer, (size_t)n);
+        entry->uncompressed_size += (uint64_t)n;
+        strm.next_in = in_buffer;
+        strm.avail_in = (uInt)n;
+        if (!deflate_chunk(&strm, entry, flush, out_buffer)) {
+            ok = 0;
+            break;
+        }
+
+        if (ctx->config->target_throughput && flush != Z_FINISH) {
+            meter->bytes += (uint64_t)n;
+            if (meter->bytes >= THROUGHPUT_WINDOW) {
+                int next_level = adjust_auto_level(ctx, meter);
+                if (next_level != level) {
+                    // 切换级别会先输出已有数据；输出缓冲不够时 zlib 保持原级别
+                    strm.next_out = out_buffer;
+                    strm.avail_out = BUFFER_SIZE;
+                    if (deflateParams(&strm, next_level, Z_DEFAULT_STRATEGY) == Z_OK) level = next_level;
+                    if (!append_output(entry, out_buffer, BUFFER_SIZE - strm.avail_out)) {
+                        ok = 0;
+                        break;
+                    }
+                }
+            }
+        }
+        if (flush != Z_FINISH) n = read_chunk(fd, in_buffer);
+    } while (flush != Z_FINISH);
+
+    deflateEnd(&strm);
+    return ok;
+}
+
+// 压缩一个文件。CRC32 在送入 deflate 的同一块缓冲区上计算，文件只读一遍。
+// 看起来不可压缩的文件直接存储；deflate 结果不比原文件小时也改为存储
+static int compress_entry(CreateContext *ctx, ZipEntry *entry, unsigned char *in_buffer, unsigned char *out_buffer,
+                          ThroughputMeter *meter) {
+    int fd = open(entry->path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return 0;
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    ssize_t n = read_chunk(fd, in_buffer);
+    int ok;
+    if (n == 0 || (n > 0 && should_store(entry, in_buffer, (size_t)n))) {
+        ok = store_entry(entry, fd, in_buffer, n);
+    } else {
+        ok = deflate_entry(ctx, entry, fd, in_buffer, n, out_buffer, meter);
+        if (ok && entry->uncompressed_size > 0 && entry->compressed_size >= entry->uncompressed_size) {
+            reset_output(entry);
+            ok = lseek(fd, 0, SEEK_SET) == 0 && store_entry(entry, fd, in_buffer, read_chunk(fd, in_buffer));
+        }
+    }
+
+    close(fd);
+    return ok;
+}
+
+static void *compress_worker(void *arg) {
+    CreateContext *ctx = (CreateContext *)arg;
+    unsigned char *in_buffer = malloc(BUFFER_SIZE);
+    unsigned char *out_buffer = malloc(BUFFER_SIZE);
+    ThroughputMeter meter = {0};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &meter.start);
+
+    for (;;) {
+        pthread_mutex_lock(&ctx->lock);
+        // 不要领先写出位置太多，限制内存中待写出的数据量
+        while (ctx->next_entry < ctx->count && ctx->next_entry >= ctx->written + ctx->window) {
+            pthread_cond_wait(&ctx->window_moved, &ctx->lock);
+        }
+        if (ctx->next_entry >= ctx->count) {
+            pthread_mutex_unlock(&ctx->lock);
+            break;
+        }
+        ZipEntry *entry = &ctx->entries[ctx->next_entry++];
+        entry->state = ENTRY_RUNNING;
+        pthread_mutex_unlock(&ctx->lock);
+
+        int ok = entry->is_directory ||
+                 (in_buffer && out_buffer && compress_entry(ctx, entry, in_buffer, out_buffer, &meter));
+
+        pthread_mutex_lock(&ctx->lock);
+        entry->state = ok ? ENTRY_DONE : ENTRY_FAILED;
+        pthread_cond_broadcast(&ctx->entry_done);
+        pthread_mutex_unlock(&ctx->lock);
+    }
+
+    free(in_buffer);
+    free(out_buffer);
+    return NULL;
+}
+
+// ---- 按顺序写出 ----
+
+static int copy_spill(FILE *spill, FILE *output, unsigned char *buffer) {
+    rewind(spill);
+    size_t n;
+    while ((n = fread(buffer, 1, BUFFER_SIZE, spill)) > 0) {
+        if (fwrite(buffer, 1, n, output) != n) return 0;
+    }
+    return !ferror(spill);
+}
+
+static void put64(unsigned char *p, uint64_t value) {
+    for (int i = 0; i < 8; i++) p[i] = (unsigned char)(value >> (8 * i));
+}
+
+// 组装 ZIP64 扩展字段：只包含超出 32 位的字段，顺序固定为原始大小、压缩大小、偏移。
+// 返回扩展字段总长度，不需要时返回 0
+static uint16_t zip64_extra(unsigned char *extra, const uint64_t *values, int count) {
+    uint16_t len = 4;
+    for (int i = 0; i < count; i++) {
+        if (values[i] < ZIP64_LIMIT) continue;
+        put64(extra + len, values[i]);
+        len += 8;
+    }
+    if (len == 4) return 0;
+    extra[0] = ZIP64_EXTRA_ID & 0xff;
+    extra[1] = ZIP64_EXTRA_ID >> 8;
+    extra[2] = (unsigned char)(len - 4);
+    extra[3] = 0;
+    return len;
+}
+
+static uint32_t zip32(uint64_t value) {
+    return value >= ZIP64_LIMIT ? (uint32_t)ZIP64_LIMIT : (uint32_t)value;
+}
+
+static int write_entry(ZipEntry *entry, FILE *output, unsigned char *buffer) {
+    ZipLocalFileHeader header = {0};
+    uint16_t name_len = (uint16_t)strlen(entry->name);
+
+    entry->local_header_offset = (uint64_t)ftello(output);
+    if (entry->is_directory) entry->method = ZIP_METHOD_STORE;
+
+    // 本地头的 ZIP64 扩展字段必须同时包含两个大小
+    unsigned char extra[4 + 16];
+    uint16_t extra_len = 0;
+    if (entry->uncompressed_size >= ZIP64_LIMIT || entry->compressed_size >= ZIP64_LIMIT) {
+        uint64_t sizes[2] = {ZIP64_LIMIT, ZIP64_LIMIT};
+        extra_len = zip64_extra(extra, sizes, 2);
+        put64(extra + 4, entry->uncompressed_size);
+        put64(extra + 12, entry->compressed_size);
+    }
+
+    // 大小和 CRC 在压缩完成后已知，直接写入本地文件头
+    header.signature = ZIP_LOCAL_SIGNATURE;
+    header.version = extra_len ? ZIP64_VERSION : ZIP_VERSION;
+    header.compression = entry->method;
+    uint16_t dos_time, dos_date;
+    dos_datetime(entry->mtime, &dos_time, &dos_date);
+    header.mod_time = dos_time;
+    header.mod_date = dos_date;
+    header.crc32 = entry->crc;
+    header.compressed_size = extra_len ? (uint32_t)ZIP64_LIMIT : (uint32_t)entry->compressed_size;
+    header.uncompressed_size = extra_len ? (uint32_t)ZIP64_LIMIT : (uint32_t)entry->uncompressed_size;
+    header.filename_length = name_len;
+    header.extra_field_length = extra_len;
+
+    if (fwrite(&header, sizeof(header), 1, output) != 1 || fwrite(entry->name, 1, name_len, output) != name_len ||
+        fwrite(extra, 1, extra_len, output) != extra_len) {
+        return 0;
+    }
+    if (entry->spill) return copy_spill(entry->spill, output, buffer);
+    return fwrite(entry->data, 1, entry->data_len, output) == entry->data_len;
+}
+
+// 条目数、中央目录大小或偏移超出普通结束记录的范围时，先写 ZIP64 结束记录和定位器
+static int write_end_records(FILE *output, uint64_t count, uint64_t central_offset, uint64_t central_size) {
+    if (count >= ZIP64_ENTRY_LIMIT || central_offset >= ZIP64_LIMIT || central_size >= ZIP64_LIMIT) {
+        Zip64EndOfCentralDir end64 = {0};
+        end64.signature = ZIP64_END_SIGNATURE;
+        end64.record_size = sizeof(end64) - 12;
+        end64.version_made_by = ZIP_MADE_BY_UNIX | ZIP64_VERSION;
+        end64.version = ZIP64_VERSION;
+        end64.disk_entries = end64.total_entries = count;
+        end64.central_size = central_size;
+        end64.central_offset = central_offset;
+
+        Zip64EndLocator locator = {0};
+        locator.signature = ZIP64_LOCATOR_SIGNATURE;
+        locator.end_offset = central_offset + central_size;
+        locator.total_disks = 1;
+        if (fwrite(&end64, sizeof(end64), 1, output) != 1 || fwrite(&locator, sizeof(locator), 1, output) != 1) {
+            return 0;
+        }
+    }
+
+    ZipEndOfCentralDir end = {0};
+    end.signature = ZIP_END_SIGNATURE;
+    end.disk_entries = end.total_entries = count >= ZIP64_ENTRY_LIMIT ? ZIP64_ENTRY_LIMIT : (uint16_t)count;
+    end.central_size = zip32(central_size);
+    end.central_offset = zip32(central_offset);
+    return fwrite(&end, sizeof(end), 1, output) == 1;
+}
+
+static int write_central_directory(const CreateContext *ctx, FILE *output, size_t *entry_count) {
+    uint64_t central_offset = (uint64_t)ftello(output);
+    size_t count = 0;
+
+    for (size_t i = 0; i < ctx->count; i++) {
+        const ZipEntry *entry = &ctx->entries[i];
+        if (entry->state != ENTRY_DONE) continue;
+
+        unsigned char extra[4 + 24];
+        uint64_t values[3] = {entry->uncompressed_size, entry->compressed_size, entry->local_header_offset};
+        uint16_t extra_len = zip64_extra(extra, values, 3);
+
+        ZipCentralFileHeader header = {0};
+        header.signature = ZIP_CENTRAL_SIGNATURE;
+        header.version = extra_len ? ZIP64_VERSION : ZIP_VERSION;
+        header.version_made_by = ZIP_MADE_BY_UNIX | header.version;
+        header.compression = entry->method;
+        uint16_t dos_time, dos_date;
+        dos_datetime(entry->mtime, &dos_time, &dos_date);
+        header.mod_time = dos_time;
+        header.mod_date = dos_date;
+        header.crc32 = entry->crc;
+        header.compressed_size = zip32(entry->compressed_size);
+        header.uncompressed_size = zip32(entry->uncompressed_size);
+        header.filename_length = (uint16_t)strlen(entry->name);
+        header.extra_field_length = extra_len;
+        // 高 16 位是 Unix 权限，最低位是 MS-DOS 目录属性
+        header.external_attributes = ((uint32_t)entry->mode << 16) | (entry->is_directory ? 0x10 : 0);
+        header.local_header_offset = zip32(entry->local_header_offset);
+
+        if (fwrite(&header, sizeof(header), 1, output) != 1 ||
+            fwrite(entry->name, 1, header.filename_length, output) != header.filename_length ||
+            fwrite(extra, 1, extra_len, output) != extra_len) {
+            return 0;
+        }
+        count++;
+    }
+
+    *entry_count = count;
+    return write_end_records(output, count, central_offset, (uint64_t)ftello(output) - central_offset);
+}
+
+static void free_entry_data(ZipEntry *entry) {
+    free(entry->data);
+    entry->data = NULL;
+    if (entry->spill) {
+        fclose(entry->spill);
+        entry->spill = NULL;
+    }
+}
+
+int create_zip(const ZipConfig *config) {
+    CreateContext ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.config = config;
+
+    for (int i = 0; i < config->file_count; i++) {
+        struct stat st;
+        if (stat(config->files[i], &st) != 0) {
+            print_warning("无法获取文件信息，跳过");
+            continue;
+        }
+        if (S_ISDIR(st.st_mode) && !config->recursive) {
+            printf("%s跳过目录: %s%s\n", COLOR_YELLOW, config->files[i], COLOR_RESET);
+            continue;
+        }
+        if (!(S_ISDIR(st.st_mode) ? collect_directory(&ctx, config->files[i], &st)
+                                  : add_entry(&ctx, config->files[i], &st))) {
+            print_error("内存不足");
+            return 1;
+        }
+    }
+
+    FILE *output = fopen(config->archive_name, "wb");
+    if (!output) {
+        print_error("无法创建压缩文件");
+        return 1;
+    }
+    setvbuf(output, NULL, _IOFBF, BUFFER_SIZE);
+
+    int jobs = config->jobs < 1 ? 1 : (config->jobs > MAX_JOBS ? MAX_JOBS : config->jobs);
+    printf("%s开始压缩文件...%s\n", COLOR_CYAN, COLOR_RESET);
+    printf("%s压缩文件: %s%s\n", COLOR_YELLOW, config->archive_name, COLOR_RESET);
+    printf("%s文件数量: %zu%s\n", COLOR_YELLOW, ctx.count, COLOR_RESET);
+    if (config->target_throughput) {
+        printf("%s压缩级别: 自动 (目标 %d MB/s)%s\n", COLOR_YELLOW, config->target_throughput, COLOR_RESET);
+    } else {
+        printf("%s压缩级别: %d%s\n", COLOR_YELLOW, config->compression_level, COLOR_RESET);
+    }
+    if (config->verbose) {
+        printf("%s线程数: %d, CRC32 实现: %s%s\n", COLOR_YELLOW, jobs, fast_crc32_impl(), COLOR_RESET);
+    }
+
+    pthread_mutex_init(&ctx.lock, NULL);
+    pthread_cond_init(&ctx.entry_done, NULL);
+    pthread_cond_init(&ctx.window_moved, NULL);
+    ctx.window = (size_t)jobs * ENTRY_WINDOW_PER_JOB;
+    ctx.jobs = jobs;
+    ctx.auto_level = config->compression_level;
+
+    pthread_t workers[MAX_JOBS];
+    int worker_count = 0;
+    for (int i = 0; i < jobs; i++) {
+        if (pthread_create(&workers[worker_count], NULL, compress_worker, &ctx) == 0) worker_count++;
+    }
+
+    unsigned char *buffer = malloc(BUFFER_SIZE);
+    off_t total_size = 0;
+    off_t compressed_size = 0;
+    int ok = worker_count > 0 && buffer != NULL;
+
+    // 主线程按原来的顺序等待每个条目压缩完成并写出
+    for (size_t i = 0; ok && i < ctx.count; i++) {
+        ZipEntry *entry = &ctx.entries[i];
+        pthread_mutex_lock(&ctx.lock);
+        while (entry->state != ENTRY_DONE && entry->state != ENTRY_FAILED) {
+            pthread_cond_wait(&ctx.entry_done, &ctx.lock);
+        }
+        pthread_mutex_unlock(&ctx.lock);
+
+        if (entry->state == ENTRY_FAILED) {
+            print_warning("压缩失败，跳过");
+        } else if (!write_entry(entry, output, buffer)) {
+            print_error("写入压缩文件失败");
+            ok = 0;
+        } else if (!entry->is_directory) {
+            total_size += (off_t)entry->uncompressed_size;
+            compressed_size += (off_t)entry->compressed_size;
+            if (config->verbose) {
+                printf("%s%s: %s (%s -> ", COLOR_GREEN, entry->method == ZIP_METHOD_STORE ? "存储" : "压缩",
+                       entry->name, format_size((off_t)entry->uncompressed_size));
+                printf("%s)%s\n", format_size((off_t)entry->compressed_size), COLOR_RESET);
+                show_progress((off_t)(i + 1), (off_t)ctx.count, "压缩进度");
+            }
+        }
+        free_entry_data(entry);
+
+        pthread_mutex_lock(&ctx.lock);
+        ctx.written = i + 1;
+        pthread_cond_broadcast(&ctx.window_moved);
+        pthread_mutex_unlock(&ctx.lock);
+    }
+
+    if (config->verbose) {
+        printf("\n");
+    }
+
+    // 出错时让工作线程尽快退出
+    pthread_mutex_lock(&ctx.lock);
+    if (!ok) ctx.next_entry = ctx.count;
+    ctx.written = ctx.count;
+    pthread_cond_broadcast(&ctx.window_moved);
+    pthread_mutex_unlock(&ctx.lock);
+    for (int i = 0; i < worker_count; i++) {
+        pthread_join(workers[i], NULL);
+    }
+
+    size_t entry_count = 0;
+    if (ok && !write_central_directory(&ctx, output, &entry_count)) {
+        print_error("写入中央目录失败");
+        ok = 0;
+    }
+    if (fclose(output) != 0) ok = 0;
+
+    for (size_t i = 0; i < ctx.count; i++) {
+        free_entry_data(&ctx.entries[i]);
+        free(ctx.entries[i].path);
+        free(ctx.entries[i].name);
+    }
+    free(ctx.entries);
+    free(buffer);
+    pthread_cond_destroy(&ctx.window_moved);
+    pthread_cond_destroy(&ctx.entry_done);
+    pthread_mutex_destroy(&ctx.lock);
+
+    if (!ok) return 1;
+
+    printf("%s压缩完成！%s\n", COLOR_GREEN, COLOR_RESET);
+    printf("%s条目数量: %zu%s\n", COLOR_CYAN, entry_count, COLOR_RESET);
+    printf("%s原始大小: %s%s\n", COLOR_CYAN, format_size(total_size), COLOR_RESET);
+    printf("%s压缩大小: %s%s\n", COLOR_CYAN, format_size(compressed_size), COLOR_RESET);
+
+    if (total_size > 0) {
+        int ratio = (int)((compressed_size * 100) / total_size);
+        printf("%s压缩率: %d%%%s\n", COLOR_CYAN, ratio, COLOR_RESET);
+    }
+
+    return 0;
+}
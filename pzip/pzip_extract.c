@@ -0,0 +1,221 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include "../include/common.h"
+#include "pzip.h"
+#include "pzip_read.h"
+
+// 并行解压：主线程先建好目录并按大小从大到小排好文件条目，
+// 工作线程各自持有一个 z_stream，领取条目后预分配输出文件、解压并 pwrite，边写边校验 CRC32
+
+typedef struct {
+    const ZipConfig *config;
+    const ZipArchive *archive;
+    const ZipDirEntry **files;      // 待解压的文件条目，大的在前
+    size_t count;
+
+    pthread_mutex_t lock;
+    size_t next;
+    int extracted;
+    int failed;
+} ExtractContext;
+
+// 创建路径中缺少的父目录
+static void make_parent_dirs(const char *path) {
+    char *copy = strdup(path);
+    if (!copy) return;
+
+    for (char *p = copy + 1; *p; p++) {
+        if (*p != '/') continue;
+        *p = '\0';
+        mkdir(copy, 0755);
+        *p = '/';
+    }
+    free(copy);
+}
+
+// 拒绝绝对路径和包含 ".." 的名字，防止写到解压目录之外
+static int safe_entry_name(const char *name) {
+    if (name[0] == '/' || name[0] == '\0') return 0;
+    for (const char *p = name; *p; ) {
+        const char *slash = strchr(p, '/');
+        size_t len = slash ? (size_t)(slash - p) : strlen(p);
+        if (len == 2 && p[0] == '.' && p[1] == '.') return 0;
+        if (!slash) break;
+        p = slash + 1;
+    }
+    return 1;
+}
+
+// 解压一个文件条目，并还原权限和修改时间
+static int extract_file(const ZipArchive *archive, const ZipDirEntry *entry, ZipInflater *inflater) {
+    int fd = open(entry->name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return 0;
+
+    // 一次分配好空间，减少碎片；文件系统不支持时忽略
+    if (entry->uncompressed_size > 0) {
+        fallocate(fd, 0, 0, (off_t)entry->uncompressed_size);
+    }
+
+    int ok = zip_extract_to_fd(archive, entry, fd, inflater);
+    mode_t mode = zip_entry_mode(entry);
+    if (ok && mode) fchmod(fd, mode);
+    if (ok) {
+        time_t mtime = zip_entry_mtime(entry);
+        struct timespec times[2] = {{mtime, 0}, {mtime, 0}};
+        futimens(fd, times);
+    }
+    if (close(fd) != 0) ok = 0;
+    if (!ok) unlink(entry->name);
+    return ok;
+}
+
+static void *extract_worker(void *arg) {
+    ExtractContext *ctx = (ExtractContext *)arg;
+    ZipInflater inflater;
+    int ready = zip_inflater_init(&inflater);
+
+    for (;;) {
+        pthread_mutex_lock(&ctx->lock);
+        if (ctx->next >= ctx->count) {
+            pthread_mutex_unlock(&ctx->lock);
+            break;
+        }
+        const ZipDirEntry *entry = ctx->files[ctx->next++];
+        pthread_mutex_unlock(&ctx->lock);
+
+        int ok = ready && extract_file(ctx->archive, entry, &inflater);
+
+        pthread_mutex_lock(&ctx->lock);
+        if (ok) {
+            ctx->extracted++;
+            printf("%s解压: %s%s\n", COLOR_GREEN, entry->name, COLOR_RESET);
+        } else {
+            ctx->failed++;
+            printf("%s解压失败: %s%s\n", COLOR_RED, entry->name, COLOR_RESET);
+        }
+        pthread_mutex_unlock(&ctx->lock);
+    }
+
+    if (ready) zip_inflater_free(&inflater);
+    return NULL;
+}
+
+// 按名字排序，名字相同时保持归档中的顺序，用于去掉重复条目
+static int compare_name(const void *a, const void *b) {
+    const ZipDirEntry *x = *(const ZipDirEntry * const *)a;
+    const ZipDirEntry *y = *(const ZipDirEntry * const *)b;
+    int cmp = strcmp(x->name, y->name);
+    if (cmp != 0) return cmp;
+    return x < y ? -1 : (x > y);
+}
+
+// 大文件先解压，避免最后只剩一个线程在处理大文件
+static int compare_size_desc(const void *a, const void *b) {
+    const ZipDirEntry *x = *(const ZipDirEntry * const *)a;
+    const ZipDirEntry *y = *(const ZipDirEntry * const *)b;
+    if (x->uncompressed_size != y->uncompressed_size) {
+        return x->uncompressed_size < y->uncompressed_size ? 1 : -1;
+    }
+    return x < y ? -1 : (x > y);
+}
+
+// 目录权限在文件写完之后再设置，否则只读目录会挡住其中文件的创建
+static void apply_directory_modes(const ZipArchive *archive, const ZipConfig *config) {
+    for (size_t i = archive->count; i-- > 0; ) {
+        const ZipDirEntry *entry = &archive->entries[i];
+        mode_t mode = zip_entry_mode(entry);
+        if (!mode || !zip_entry_is_directory(entry) || !safe_entry_name(entry->name) ||
+            !member_selected(config, entry->name)) {
+            continue;
+        }
+        chmod(entry->name, mode);
+    }
+}
+
+// 解压ZIP文件：按中央目录定位条目，指定成员时直接跳到对应的本地文件头
+int extract_zip(const ZipConfig *config) {
+    ZipArchive *archive = zip_open(config->archive_name);
+    if (!archive) {
+        print_error("无法打开压缩文件或中央目录损坏");
+        return 1;
+    }
+
+    ExtractContext ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.config = config;
+    ctx.archive = archive;
+    ctx.files = malloc((archive->count ? archive->count : 1) * sizeof(*ctx.files));
+    if (!ctx.files) {
+        zip_close(archive);
+        print_error("内存不足");
+        return 1;
+    }
+
+    int jobs = config->jobs < 1 ? 1 : (config->jobs > MAX_JOBS ? MAX_JOBS : config->jobs);
+    printf("%s开始解压文件...%s\n", COLOR_CYAN, COLOR_RESET);
+    printf("%s压缩文件: %s%s\n", COLOR_YELLOW, config->archive_name, COLOR_RESET);
+    if (config->verbose) {
+        printf("%s线程数: %d%s\n", COLOR_YELLOW, jobs, COLOR_RESET);
+    }
+
+    // 目录在主线程中按顺序创建，工作线程只创建文件
+    int matched = 0;
+    for (size_t i = 0; i < archive->count; i++) {
+        const ZipDirEntry *entry = &archive->entries[i];
+        if (!member_selected(config, entry->name)) continue;
+        matched++;
+
+        if (!safe_entry_name(entry->name)) {
+            printf("%s跳过不安全的路径: %s%s\n", COLOR_YELLOW, entry->name, COLOR_RESET);
+            continue;
+        }
+        make_parent_dirs(entry->name);
+        if (zip_entry_is_directory(entry)) continue;
+        ctx.files[ctx.count++] = entry;
+    }
+
+    // 同名条目只保留归档中最后一个，避免两个线程同时写一个文件
+    qsort(ctx.files, ctx.count, sizeof(*ctx.files), compare_name);
+    size_t unique = 0;
+    for (size_t i = 0; i < ctx.count; i++) {
+        if (i + 1 < ctx.count && strcmp(ctx.files[i]->name, ctx.files[i + 1]->name) == 0) continue;
+        ctx.files[unique++] = ctx.files[i];
+    }
+    ctx.count = unique;
+    qsort(ctx.files, ctx.count, sizeof(*ctx.files), compare_size_desc);
+
+    if ((size_t)jobs > ctx.count) jobs = ctx.count > 0 ? (int)ctx.count : 1;
+    pthread_mutex_init(&ctx.lock, NULL);
+    pthread_t workers[MAX_JOBS];
+    int worker_count = 0;
+    for (int i = 0; i < jobs; i++) {
+        if (pthread_create(&workers[worker_count], NULL, extract_worker, &ctx) == 0) worker_count++;
+    }
+    // 线程创建失败时由主线程自己完成
+    if (worker_count == 0) extract_worker(&ctx);
+    for (int i = 0; i < worker_count; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    pthread_mutex_destroy(&ctx.lock);
+
+    apply_directory_modes(archive, config);
+
+    free(ctx.files);
+    zip_close(archive);
+
+    if (config->file_count > 0 && matched == 0) {
+        print_error("压缩文件中没有指定的成员");
+        return 1;
+    }
+
+    printf("%s解压完成！%s\n", COLOR_GREEN, COLOR_RESET);
+    printf("%s解压了 %d 个文件%s\n", COLOR_CYAN, ctx.extracted, COLOR_RESET);
+
+    return ctx.failed ? 1 : 0;
+}
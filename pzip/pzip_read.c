@@ -0,0 +1,329 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include "pzip.h"
+#include "pzip_crc.h"
+#include "pzip_read.h"
+
+#define END_SEARCH_SIZE (sizeof(ZipEndOfCentralDir) + 0xffff)  // 结束记录加上最长的注释
+
+static int pread_full(int fd, void *buf, size_t len, uint64_t offset) {
+    unsigned char *p = (unsigned char *)buf;
+    while (len > 0) {
+        ssize_t n = pread(fd, p, len, (off_t)offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return 0;
+        p += n;
+        len -= (size_t)n;
+        offset += (uint64_t)n;
+    }
+    return 1;
+}
+
+static int pwrite_full(int fd, const void *buf, size_t len, uint64_t offset) {
+    const unsigned char *p = (const unsigned char *)buf;
+    while (len > 0) {
+        ssize_t n = pwrite(fd, p, len, (off_t)offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return 0;
+        p += n;
+        len -= (size_t)n;
+        offset += (uint64_t)n;
+    }
+    return 1;
+}
+
+static uint16_t get16(const unsigned char *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint64_t get64(const unsigned char *p) {
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; i--) value = (value << 8) | p[i];
+    return value;
+}
+
+// 找到结束记录，得到中央目录的位置和条目数。成功返回 1
+static int read_end_record(ZipArchive *archive, uint64_t *central_offset, uint64_t *central_size,
+                           uint64_t *entry_count) {
+    size_t tail_len = archive->size < END_SEARCH_SIZE ? (size_t)archive->size : END_SEARCH_SIZE;
+    if (tail_len < sizeof(ZipEndOfCentralDir)) return 0;
+
+    unsigned char *tail = malloc(tail_len);
+    uint64_t tail_offset = archive->size - tail_len;
+    if (!tail || !pread_full(archive->fd, tail, tail_len, tail_offset)) {
+        free(tail);
+        return 0;
+    }
+
+    // 从后往前找签名，注释长度必须正好延伸到文件结尾
+    ZipEndOfCentralDir end;
+    size_t pos = tail_len - sizeof(end) + 1;
+    int found = 0;
+    while (pos-- > 0) {
+        memcpy(&end, tail + pos, sizeof(end));
+        if (end.signature == ZIP_END_SIGNATURE && pos + sizeof(end) + end.comment_length == tail_len) {
+            found = 1;
+            break;
+        }
+    }
+    free(tail);
+    if (!found) return 0;
+
+    *central_offset = end.central_offset;
+    *central_size = end.central_size;
+    *entry_count = end.total_entries;
+
+    // 有 ZIP64 定位器时以 ZIP64 结束记录为准
+    uint64_t end_offset = tail_offset + pos;
+    Zip64EndLocator locator;
+    Zip64EndOfCentralDir end64;
+    if (end_offset >= sizeof(locator) &&
+        pread_full(archive->fd, &locator, sizeof(locator), end_offset - sizeof(locator)) &&
+        locator.signature == ZIP64_LOCATOR_SIGNATURE) {
+        if (!pread_full(archive->fd, &end64, sizeof(end64), locator.end_offset) ||
+            end64.signature != ZIP64_END_SIGNATURE) {
+            return 0;
+        }
+        *central_offset = end64.central_offset;
+        *central_size = end64.central_size;
+        *entry_count = end64.total_entries;
+    }
+    return *central_offset + *central_size <= archive->size;
+}
+
+// 用 ZIP64 扩展字段替换取值为 0xffffffff 的字段，顺序固定：原始大小、压缩大小、偏移
+static int apply_zip64_extra(ZipDirEntry *entry, const unsigned char *extra, size_t len) {
+    while (len >= 4) {
+        uint16_t id = get16(extra);
+        uint16_t size = get16(extra + 2);
+        if ((size_t)size + 4 > len) return 0;
+
+        if (id == ZIP64_EXTRA_ID) {
+            const unsigned char *p = extra + 4;
+            const unsigned char *end = p + size;
+            uint64_t *fields[] = {&entry->uncompressed_size, &entry->compressed_size, &entry->local_header_offset};
+            for (int i = 0; i < 3; i++) {
+                if (*fields[i] != ZIP64_LIMIT) continue;
+                if (p + 8 > end) return 0;
+                *fields[i] = get64(p);
+                p += 8;
+            }
+            return 1;
+        }
+        extra += 4 + size;
+        len -= 4 + (size_t)size;
+    }
+    return 1;
+}
+
+static int parse_central_directory(ZipArchive *archive, const unsigned char *data, size_t len, uint64_t count) {
+    // 每条至少 46 字节，防止损坏的条目数导致分配过大
+    if (count > len / sizeof(ZipCentralFileHeader)) return 0;
+    archive->entries = calloc(count ? count : 1, sizeof(ZipDirEntry));
+    if (!archive->entries) return 0;
+
+    size_t pos = 0;
+    for (uint64_t i = 0; i < count; i++) {
+        ZipCentralFileHeader header;
+        if (pos + sizeof(header) > len) return 0;
+        memcpy(&header, data + pos, sizeof(header));
+        if (header.signature != ZIP_CENTRAL_SIGNATURE) return 0;
+
+        size_t var_len = (size_t)header.filename_length + header.extra_field_length + header.comment_length;
+        if (pos + sizeof(header) + var_len > len) return 0;
+        const unsigned char *name = data + pos + sizeof(header);
+
+        ZipDirEntry *entry = &archive->entries[archive->count];
+        entry->name = malloc((size_t)header.filename_length + 1);
+        if (!entry->name) return 0;
+        memcpy(entry->name, name, header.filename_length);
+        entry->name[header.filename_length] = '\0';
+        archive->count++;
+
+        entry->version_made_by = header.version_made_by;
+        entry->flags = header.flags;
+        entry->method = header.compression;
+        entry->mod_time = header.mod_time;
+        entry->mod_date = header.mod_date;
+        entry->crc32 = header.crc32;
+        entry->external_attributes = header.external_attributes;
+        entry->compressed_size = header.compressed_size;
+        entry->uncompressed_size = header.uncompressed_size;
+        entry->local_header_offset = header.local_header_offset;
+        if (!apply_zip64_extra(entry, name + header.filename_length, header.extra_field_length)) return 0;
+
+        pos += sizeof(header) + var_len;
+    }
+    return 1;
+}
+
+ZipArchive *zip_open(const char *path) {
+    ZipArchive *archive = calloc(1, sizeof(ZipArchive));
+    if (!archive) return NULL;
+
+    struct stat st;
+    archive->fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (archive->fd < 0 || fstat(archive->fd, &st) != 0) {
+        zip_close(archive);
+        return NULL;
+    }
+    archive->size = (uint64_t)st.st_size;
+
+    uint64_t central_offset, central_size, count;
+    if (!read_end_record(archive, &central_offset, &central_size, &count) || central_size > SIZE_MAX) {
+        zip_close(archive);
+        return NULL;
+    }
+
+    // 中央目录一次读入
+    unsigned char *data = malloc(central_size ? (size_t)central_size : 1);
+    int ok = data && pread_full(archive->fd, data, (size_t)central_size, central_offset) &&
+             parse_central_directory(archive, data, (size_t)central_size, count);
+    free(data);
+    if (!ok) {
+        zip_close(archive);
+        return NULL;
+    }
+    return archive;
+}
+
+void zip_close(ZipArchive *archive) {
+    if (!archive) return;
+    for (size_t i = 0; i < archive->count; i++) {
+        free(archive->entries[i].name);
+    }
+    free(archive->entries);
+    if (archive->fd >= 0) close(archive->fd);
+    free(archive);
+}
+
+int zip_entry_is_directory(const ZipDirEntry *entry) {
+    size_t len = strlen(entry->name);
+    return (len > 0 && entry->name[len - 1] == '/') || (entry->external_attributes & 0x10);
+}
+
+mode_t zip_entry_mode(const ZipDirEntry *entry) {
+    if ((entry->version_made_by >> 8) != (ZIP_MADE_BY_UNIX >> 8)) return 0;
+    return (mode_t)(entry->external_attributes >> 16) & 07777;
+}
+
+time_t zip_entry_mtime(const ZipDirEntry *entry) {
+    struct tm tm_info;
+    memset(&tm_info, 0, sizeof(tm_info));
+    tm_info.tm_year = ((entry->mod_date >> 9) & 0x7f) + 80;
+    tm_info.tm_mon = ((entry->mod_date >> 5) & 0x0f) - 1;
+    tm_info.tm_mday = entry->mod_date & 0x1f;
+    tm_info.tm_hour = (entry->mod_time >> 11) & 0x1f;
+    tm_info.tm_min = (entry->mod_time >> 5) & 0x3f;
+    tm_info.tm_sec = (entry->mod_time & 0x1f) * 2;
+    tm_info.tm_isdst = -1;
+    return mktime(&tm_info);
+}
+
+int zip_data_offset(const ZipArchive *archive, const ZipDirEntry *entry, uint64_t *offset) {
+    ZipLocalFileHeader header;
+    if (!pread_full(archive->fd, &header, sizeof(header), entry->local_header_offset) ||
+        header.signature != ZIP_LOCAL_SIGNATURE) {
+        return 0;
+    }
+    // 本地头的扩展字段长度可能与中央目录不同，必须以本地头为准
+    *offset = entry->local_header_offset + sizeof(header) + header.filename_length + header.extra_field_length;
+    return *offset + entry->compressed_size <= archive->size;
+}
+
+int zip_inflater_init(ZipInflater *inflater) {
+    memset(inflater, 0, sizeof(*inflater));
+    inflater->in_buf = malloc(BUFFER_SIZE);
+    inflater->out_buf = malloc(BUFFER_SIZE);
+    if (!inflater->in_buf || !inflater->out_buf) {
+        zip_inflater_free(inflater);
+        return 0;
+    }
+    return 1;
+}
+
+void zip_inflater_free(ZipInflater *inflater) {
+    if (inflater->strm_ready) inflateEnd(&inflater->strm);
+    free(inflater->in_buf);
+    free(inflater->out_buf);
+    memset(inflater, 0, sizeof(*inflater));
+}
+
+int zip_extract_to_fd(const ZipArchive *archive, const ZipDirEntry *entry, int out_fd, ZipInflater *inflater) {
+    uint64_t offset;
+    if (!zip_data_offset(archive, entry, &offset)) return 0;
+    if (entry->method != ZIP_METHOD_STORE && entry->method != ZIP_METHOD_DEFLATE) return 0;
+    if (entry->flags & 0x1) return 0;     // 不支持加密
+
+    unsigned char *in_buf = inflater->in_buf;
+    unsigned char *out_buf = inflater->out_buf;
+    z_stream *strm = &inflater->strm;
+    uint64_t remaining = entry->compressed_size;
+    uint64_t written = 0;
+    uint32_t crc = 0;
+    int ok = 1;
+
+    int deflated = entry->method == ZIP_METHOD_DEFLATE;
+    if (deflated) {
+        if (!inflater->strm_ready) {
+            if (inflateInit2(strm, -MAX_WBITS) != Z_OK) return 0;
+            inflater->strm_ready = 1;
+        } else if (inflateReset(strm) != Z_OK) {
+            return 0;
+        }
+    }
+
+    int finished = 0;
+    while (ok && !finished) {
+        size_t chunk = remaining > BUFFER_SIZE ? BUFFER_SIZE : (size_t)remaining;
+        if (chunk > 0 && !pread_full(archive->fd, in_buf, chunk, offset)) {
+            ok = 0;
+            break;
+        }
+        offset += chunk;
+        remaining -= chunk;
+
+        if (!deflated) {
+            crc = fast_crc32(crc, in_buf, chunk);
+            ok = pwrite_full(out_fd, in_buf, chunk, written);
+            written += chunk;
+            finished = remaining == 0;
+            continue;
+        }
+
+        strm->next_in = in_buf;
+        strm->avail_in = (uInt)chunk;
+        do {
+            strm->next_out = out_buf;
+            strm->avail_out = BUFFER_SIZE;
+            int ret = inflate(strm, Z_NO_FLUSH);
+            if (ret != Z_OK && ret != Z_STREAM_END && !(ret == Z_BUF_ERROR && chunk == 0)) {
+                ok = 0;
+                break;
+            }
+            size_t have = BUFFER_SIZE - strm->avail_out;
+            crc = fast_crc32(crc, out_buf, have);
+            if (have > 0 && !pwrite_full(out_fd, out_buf, have, written)) {
+                ok = 0;
+                break;
+            }
+            written += have;
+            if (ret == Z_STREAM_END) {
+                finished = 1;
+                break;
+            }
+            // 数据已读完但 deflate 流没有结束
+            if (chunk == 0 && have == 0) {
+                ok = 0;
+                break;
+            }
+        } while (strm->avail_out == 0 || strm->avail_in > 0);
+    }
+
+    return ok && written == entry->uncompressed_size && crc == entry->crc32;
+}
@@ -0,0 +1,60 @@
+#ifndef PZIP_READ_H
+#define PZIP_READ_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+#include <zlib.h>
+
+// 中央目录中的一个条目，ZIP64 扩展字段已经合并
+typedef struct {
+    char *name;
+    uint16_t version_made_by;
+    uint16_t flags;
+    uint16_t method;
+    uint16_t mod_time;
+    uint16_t mod_date;
+    uint32_t crc32;
+    uint32_t external_attributes;
+    uint64_t compressed_size;
+    uint64_t uncompressed_size;
+    uint64_t local_header_offset;
+} ZipDirEntry;
+
+// 打开的压缩文件：只读取末尾的结束记录和中央目录，不扫描条目数据
+typedef struct {
+    int fd;
+    uint64_t size;
+    ZipDirEntry *entries;
+    size_t count;
+} ZipArchive;
+
+// 失败返回 NULL（不是 ZIP 文件或中央目录损坏）
+ZipArchive *zip_open(const char *path);
+void zip_close(ZipArchive *archive);
+
+int zip_entry_is_directory(const ZipDirEntry *entry);
+// 条目的 Unix 权限，没有记录时返回 0
+mode_t zip_entry_mode(const ZipDirEntry *entry);
+time_t zip_entry_mtime(const ZipDirEntry *entry);
+
+// 读取本地文件头，得到条目数据在压缩文件中的偏移。成功返回 1
+int zip_data_offset(const ZipArchive *archive, const ZipDirEntry *entry, uint64_t *offset);
+
+// 解压用的状态，每个线程一个，z_stream 在条目之间重置后复用
+typedef struct {
+    z_stream strm;
+    int strm_ready;
+    unsigned char *in_buf;      // BUFFER_SIZE 字节
+    unsigned char *out_buf;
+} ZipInflater;
+
+// 成功返回 1
+int zip_inflater_init(ZipInflater *inflater);
+void zip_inflater_free(ZipInflater *inflater);
+
+// 解压条目并从偏移 0 开始 pwrite 到 out_fd，同时校验 CRC32 和大小。成功返回 1
+int zip_extract_to_fd(const ZipArchive *archive, const ZipDirEntry *entry, int out_fd, ZipInflater *inflater);
+
+#endif // PZIP_READ_H
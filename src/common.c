@@ -90,8 +90,9 @@ int is_code_file(const char *filename) {
     return 0;
 }
 
+// 每个线程使用自己的缓冲区，工作线程中也可以调用
 char* format_size(off_t size) {
-    static char buffer[32];
+    static __thread char buffer[32];
     const char *units[] = {"B", "KB", "MB", "GB", "TB"};
     int unit = 0;
     double fsize = size;
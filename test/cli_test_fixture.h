@@ -0,0 +1,70 @@
+#ifndef CLI_TEST_FIXTURE_H
+#define CLI_TEST_FIXTURE_H
+
+#include <gtest/gtest.h>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/wait.h>
+
+// 直接运行编译出的命令的测试共用的夹具：每个测试有自己的临时目录，
+// 命令都在这个目录中执行。被测程序的路径由 test/CMakeLists.txt 以宏的形式传入
+class CliTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        char pattern[] = "/tmp/cli_test_XXXXXX";
+        ASSERT_NE(mkdtemp(pattern), nullptr);
+        dir = pattern;
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(dir);
+    }
+
+    // 临时目录中的路径
+    std::filesystem::path path(const std::string &name) const {
+        return std::filesystem::path(dir) / name;
+    }
+
+    // 执行命令并丢弃输出，返回退出码。命令自身的重定向不受影响
+    int run(const std::string &command) {
+        std::string full = "cd '" + dir + "' && (" + command + ") >/dev/null 2>&1";
+        int status = system(full.c_str());
+        return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    }
+
+    // 执行命令，返回标准输出
+    std::string output(const std::string &command) {
+        std::string full = "cd '" + dir + "' && (" + command + ") 2>/dev/null";
+        std::string result;
+        FILE *pipe = popen(full.c_str(), "r");
+        if (!pipe) return result;
+        char buffer[4096];
+        size_t n;
+        while ((n = fread(buffer, 1, sizeof(buffer), pipe)) > 0) result.append(buffer, n);
+        pclose(pipe);
+        return result;
+    }
+
+    // 写文件，缺少的上级目录自动创建
+    void write_file(const std::string &name, const std::string &content) {
+        std::filesystem::create_directories(path(name).parent_path());
+        std::ofstream file(path(name), std::ios::binary);
+        file << content;
+    }
+
+    std::string read_file(const std::string &name) {
+        std::ifstream file(path(name), std::ios::binary);
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        return buffer.str();
+    }
+
+    std::string dir;
+};
+
+#endif // CLI_TEST_FIXTURE_H
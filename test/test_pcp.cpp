@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <filesystem>
+#include <random>
+#include <sys/stat.h>
+#include "cli_test_fixture.h"
+
+// pcp 的稀疏文件复制和 --delta 原地更新
+class PcpTest : public CliTest {
+protected:
+    // 确定性的伪随机数据，块之间互不相同
+    std::string random_data(size_t size, unsigned seed) {
+        std::string data(size, '\0');
+        std::mt19937 generator(seed);
+        for (char &c : data) c = (char)(generator() & 0xff);
+        return data;
+    }
+
+    // 用 --delta 把 source 更新到已存在的 dest，返回 pcp 的输出
+    std::string delta_update(const std::string &source, const std::string &dest) {
+        write_file("source", source);
+        write_file("dest", dest);
+        return output(pcp + " -v --delta source dest | sed 's/\\x1b\\[[0-9;]*m//g'");
+    }
+
+    std::string pcp = PCP_PATH;
+};
+
+// 中间和末尾有大空洞的文件，复制后空洞保持为空洞
+TEST_F(PcpTest, TestSparseCopy) {
+    ASSERT_EQ(0, run("printf start > sparse && truncate -s 64M sparse && printf middle >> sparse && "
+                     "truncate -s 128M sparse"));
+    struct stat source;
+    ASSERT_EQ(0, stat(path("sparse").c_str(), &source));
+    if ((off_t)source.st_blocks * 512 >= source.st_size) {
+        GTEST_SKIP() << "临时目录所在的文件系统不支持空洞";
+    }
+
+    ASSERT_EQ(0, run(pcp + " sparse copy"));
+    struct stat copy;
+    ASSERT_EQ(0, stat(path("copy").c_str(), &copy));
+    EXPECT_EQ(source.st_size, copy.st_size);
+    EXPECT_LT((off_t)copy.st_blocks * 512, 1024 * 1024);
+    EXPECT_EQ(0, run("cmp sparse copy"));
+
+    // 递归复制走工作线程，同样保留空洞
+    std::filesystem::create_directories(path("tree"));
+    std::filesystem::rename(path("sparse"), path("tree/sparse"));
+    ASSERT_EQ(0, run(pcp + " -r tree out"));
+    ASSERT_EQ(0, stat(path("out/sparse").c_str(), &copy));
+    EXPECT_LT((off_t)copy.st_blocks * 512, 1024 * 1024);
+    EXPECT_EQ(0, run("cmp tree/sparse out/sparse"));
+}
+
+TEST_F(PcpTest, TestDeltaPartiallyDifferent) {
+    std::string source = random_data(4 * 1024 * 1024, 1);
+    std::string dest = source;
+    dest.replace(2000000, 4, "XXXX");
+    dest.replace(3500000, 10000, random_data(10000, 2));
+
+    std::string result = delta_update(source, dest);
+    EXPECT_NE(std::string::npos, result.find("增量更新")) << result;
+    // 4 字节落在一个块内，10000 字节跨三个块
+    EXPECT_NE(std::string::npos, result.find("未变化 1020 块, 变化 4 块")) << result;
+    EXPECT_EQ(0, run("cmp source dest"));
+}
+
+TEST_F(PcpTest, TestDeltaDestinationLonger) {
+    std::string source = random_data(1024 * 1024 + 123, 3);
+    std::string dest = source + random_data(500000, 4);
+    delta_update(source, dest);
+    EXPECT_EQ(0, run("cmp source dest"));
+}
+
+TEST_F(PcpTest, TestDeltaDestinationShorter) {
+    std::string source = random_data(1024 * 1024 + 123, 5);
+    for (size_t length : {(size_t)0, (size_t)1000, (size_t)700000}) {
+        std::string dest = source.substr(0, length);
+        if (length > 0) dest[length / 2] ^= 1;
+        delta_update(source, dest);
+        EXPECT_EQ(0, run("cmp source dest")) << length;
+    }
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
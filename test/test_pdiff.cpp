@@ -0,0 +1,139 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <random>
+#include <filesystem>
+#include "cli_test_fixture.h"
+
+// pdiff -u 的输出交给 patch 应用后必须还原出第二个文件
+class PdiffTest : public CliTest {
+protected:
+    // 用 -u 输出修补 old 的副本，检查结果与 new 相同
+    void expect_patch_applies(const std::string &old_text, const std::string &new_text,
+                              const std::string &options = "") {
+        // 相同的文件没有差异块，patch 会把空输入当作错误
+        if (old_text == new_text) return;
+        write_file("old", old_text);
+        write_file("new", new_text);
+        write_file("work", old_text);
+        write_file("d", output(pdiff + " -u " + options + " old new | sed 's/\\x1b\\[[0-9;]*m//g'"));
+        EXPECT_EQ(0, run("patch -s work d")) << "old: [" << old_text << "] new: [" << new_text << "]";
+        EXPECT_EQ(0, run("cmp work new")) << "old: [" << old_text << "] new: [" << new_text << "]";
+    }
+
+    std::string pdiff = PDIFF_PATH;
+};
+
+TEST_F(PdiffTest, TestMissingFinalNewline) {
+    write_file("a", "a\nb\n");
+    write_file("b", "a\nb");
+    std::string result = output(pdiff + " -u a b");
+    EXPECT_EQ(std::string::npos, result.find("文件完全相同"));
+    EXPECT_NE(std::string::npos, result.find("\\ No newline at end of file"));
+}
+
+TEST_F(PdiffTest, TestFinalNewlineCombinations) {
+    const char *texts[] = {"a\nb\nc\n", "a\nb\nc", "a\nB\nc", "a\nB\nc\n", "x", "", "a\nb\nc\nd"};
+    for (const char *old_text : texts) {
+        for (const char *new_text : texts) {
+            expect_patch_applies(old_text, new_text);
+        }
+    }
+}
+
+// 随机修改一个较大的文件，三种算法的输出都能被 patch 应用
+TEST_F(PdiffTest, TestRandomEdits) {
+    std::mt19937 generator(7);
+    std::vector<std::string> lines;
+    for (int i = 0; i < 2000; i++) lines.push_back("line " + std::to_string(generator() % 300));
+
+    for (const char *algorithm : {"myers", "patience", "histogram"}) {
+        std::vector<std::string> edited = lines;
+        for (int k = 0; k < 60; k++) {
+            size_t pos = generator() % edited.size();
+            switch (generator() % 3) {
+                case 0: edited.erase(edited.begin() + (long)pos); break;
+                case 1: edited.insert(edited.begin() + (long)pos, "new " + std::to_string(k)); break;
+                default: edited[pos] = "changed " + std::to_string(k); break;
+            }
+        }
+        std::string old_text, new_text;
+        for (const std::string &line : lines) old_text += line + "\n";
+        for (const std::string &line : edited) new_text += line + "\n";
+        expect_patch_applies(old_text, new_text, std::string("--algorithm=") + algorithm);
+        expect_patch_applies(old_text, new_text, std::string("-c 0 --algorithm=") + algorithm);
+    }
+}
+
+// 目录比较用的一对目录，每种差异各一处
+class PdiffDirTest : public PdiffTest {
+protected:
+    void SetUp() override {
+        PdiffTest::SetUp();
+        write_file("l/eq", "same\n");
+        write_file("r/eq", "same\n");
+        write_file("l/only_left", "x\n");
+        write_file("r/only_right", "y\n");
+        write_file("l/only_dir/child", "c\n");
+        write_file("l/t/inside", "t\n");
+        write_file("r/t", "t\n");
+        write_file("l/txt", "text\n");
+        write_file("r/txt", "text2\n");
+        write_file("l/bin", std::string("\x00\x01\x02", 3));
+        write_file("r/bin", std::string("\x00\x01\x03", 3));
+        // 大小和修改时间都相同、只有内容不同的文件，只有 --content 才能发现
+        write_file("l/sub/stealth", "aaaa\n");
+        write_file("r/sub/stealth", "bbbb\n");
+        std::filesystem::create_symlink("a", path("l/ln"));
+        std::filesystem::create_symlink("b", path("r/ln"));
+        std::filesystem::create_symlink("same", path("l/ln_same"));
+        std::filesystem::create_symlink("same", path("r/ln_same"));
+        ASSERT_EQ(0, run("touch -d '2020-01-01 00:00:00' l/eq r/eq l/sub/stealth r/sub/stealth && "
+                         "touch -d '2020-01-01 00:00:00' l/bin && touch -d '2021-01-01 00:00:00' r/bin"));
+    }
+
+    std::string diff_dirs(const std::string &options) {
+        return output(pdiff + " -r " + options + " l r | sed 's/\\x1b\\[[0-9;]*m//g'");
+    }
+
+    static bool contains(const std::string &text, const std::string &part) {
+        return text.find(part) != std::string::npos;
+    }
+};
+
+TEST_F(PdiffDirTest, TestReportsEachKind) {
+    std::string result = diff_dirs("");
+    EXPECT_TRUE(contains(result, "只在 l 中存在: only_left\n")) << result;
+    EXPECT_TRUE(contains(result, "只在 r 中存在: only_right\n")) << result;
+    EXPECT_TRUE(contains(result, "只在 l 中存在: only_dir/\n")) << result;
+    EXPECT_FALSE(contains(result, "child")) << result;
+    EXPECT_TRUE(contains(result, "l/t 是目录而 r/t 是普通文件")) << result;
+    EXPECT_TRUE(contains(result, "符号链接 l/ln 和 r/ln 不同")) << result;
+    EXPECT_FALSE(contains(result, "ln_same")) << result;
+    EXPECT_TRUE(contains(result, "二进制文件 l/bin 和 r/bin 不同")) << result;
+    EXPECT_TRUE(contains(result, "--- l/txt\n+++ r/txt\n")) << result;
+    EXPECT_TRUE(contains(result, "-text\n+text2\n")) << result;
+    EXPECT_FALSE(contains(result, "stealth")) << result;
+    EXPECT_FALSE(contains(result, "l/eq")) << result;
+    EXPECT_TRUE(contains(result, "目录比较: 3 个文件相同，4 个不同，3 个只在一侧存在")) << result;
+}
+
+TEST_F(PdiffDirTest, TestContentFindsSameSizeAndTime) {
+    for (const char *jobs : {"1", "4"}) {
+        std::string result = diff_dirs(std::string("--content -j ") + jobs);
+        EXPECT_TRUE(contains(result, "--- l/sub/stealth\n+++ r/sub/stealth\n")) << jobs << result;
+        EXPECT_TRUE(contains(result, "二进制文件 l/bin 和 r/bin 不同")) << jobs << result;
+        EXPECT_FALSE(contains(result, "l/eq")) << jobs << result;
+    }
+}
+
+TEST_F(PdiffDirTest, TestIdenticalTrees) {
+    ASSERT_EQ(0, run("cp -a l copy"));
+    std::string result = output(pdiff + " -r --content l copy | sed 's/\\x1b\\[[0-9;]*m//g'");
+    EXPECT_EQ("\n目录比较: 9 个文件相同，0 个不同，0 个只在一侧存在\n", result);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <filesystem>
+#include "cli_test_fixture.h"
+
+// pdu 的快照保存、增量扫描和快照对比。大小按文件的字节数累计，选用 KB 的整数倍便于比较输出
+class PduTest : public CliTest {
+protected:
+    void SetUp() override {
+        CliTest::SetUp();
+        write_file("t/a/f", std::string(102400, 'a'));
+        write_file("t/b/g", std::string(5120, 'b'));
+        write_file("t/c/h", std::string(10240, 'c'));
+    }
+
+    // 去掉颜色后的输出
+    std::string pdu_output(const std::string &arguments) {
+        return output(pdu + " " + arguments + " | sed 's/\\x1b\\[[0-9;]*m//g'");
+    }
+
+    std::string pdu = PDU_PATH;
+};
+
+TEST_F(PduTest, TestSnapshotReload) {
+    std::string full = pdu_output("--snapshot snap t");
+    EXPECT_NE(std::string::npos, full.find("总大小: 115.0 KB"));
+    ASSERT_TRUE(std::filesystem::exists(path("snap")));
+    EXPECT_FALSE(std::filesystem::exists(path("snap.tmp")));
+
+    // 没有变化时全部复用快照中的目录
+    std::string again = pdu_output("--snapshot snap --incremental t");
+    EXPECT_NE(std::string::npos, again.find("重新枚举目录: 0, 复用目录: 4"));
+    EXPECT_NE(std::string::npos, again.find("总大小: 115.0 KB"));
+}
+
+TEST_F(PduTest, TestIncrementalAfterAdding) {
+    ASSERT_EQ(0, run(pdu + " --snapshot snap t"));
+    write_file("t/b/new", std::string(307200, 'n'));
+
+    std::string result = pdu_output("--snapshot snap --incremental t");
+    EXPECT_NE(std::string::npos, result.find("重新枚举目录: 1, 复用目录: 3"));
+    EXPECT_NE(std::string::npos, result.find("t/b 305.0 KB"));
+    EXPECT_NE(std::string::npos, result.find("总大小: 415.0 KB"));
+
+    // 与不借助旧快照的全量扫描结果一致
+    std::string full = pdu_output("--snapshot full t");
+    EXPECT_NE(std::string::npos, full.find("总大小: 415.0 KB"));
+}
+
+TEST_F(PduTest, TestCorruptSnapshot) {
+    ASSERT_EQ(0, run(pdu + " --snapshot snap t"));
+    ASSERT_EQ(0, run("head -c 20 snap > bad"));
+    std::string result = pdu_output("--snapshot bad --incremental t");
+    EXPECT_NE(std::string::npos, result.find("执行全量扫描"));
+    EXPECT_NE(std::string::npos, result.find("总大小: 115.0 KB"));
+}
+
+TEST_F(PduTest, TestDiffFastestGrowing) {
+    ASSERT_EQ(0, run(pdu + " --snapshot old t"));
+    ASSERT_EQ(0, run("cp old new"));
+    std::filesystem::remove(path("t/a/f"));
+    write_file("t/b/new", std::string(307200, 'n'));
+    write_file("t/c/more", std::string(10240, 'm'));
+    ASSERT_EQ(0, run(pdu + " --snapshot new --incremental t"));
+
+    std::string result = pdu_output("--diff old new");
+    EXPECT_NE(std::string::npos, result.find("总大小变化: +210.0 KB"));
+    size_t list = result.find("增长最快的子树:");
+    ASSERT_NE(std::string::npos, list);
+    std::string first = result.substr(list, result.find('\n', result.find('\n', list) + 1) - list);
+    EXPECT_NE(std::string::npos, first.find("t/b +300.0 KB")) << result;
+    EXPECT_NE(std::string::npos, result.find("t/c +10.0 KB"));
+    // 变小的子树不算增长
+    EXPECT_EQ(std::string::npos, result.find("t/a"));
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
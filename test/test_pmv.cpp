@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <filesystem>
+#include <cstdlib>
+#include <sys/stat.h>
+#include "cli_test_fixture.h"
+
+// pmv 跨文件系统移动：源放在构建目录中，目标放在 /dev/shm（tmpfs）中
+class PmvTest : public CliTest {
+protected:
+    void SetUp() override {
+        CliTest::SetUp();
+
+        std::string source_pattern = (std::filesystem::current_path() / "pmv_test_XXXXXX").string();
+        char dest_pattern[] = "/dev/shm/pmv_test_XXXXXX";
+        ASSERT_NE(mkdtemp(source_pattern.data()), nullptr);
+        source = source_pattern;
+        if (!mkdtemp(dest_pattern)) {
+            GTEST_SKIP() << "/dev/shm 不可用";
+        }
+        dest = dest_pattern;
+
+        struct stat source_st, dest_st;
+        ASSERT_EQ(0, stat(source.c_str(), &source_st));
+        ASSERT_EQ(0, stat(dest.c_str(), &dest_st));
+        if (source_st.st_dev == dest_st.st_dev) {
+            GTEST_SKIP() << "构建目录与 /dev/shm 在同一个文件系统上";
+        }
+    }
+
+    void TearDown() override {
+        if (!source.empty()) std::filesystem::remove_all(source);
+        if (!dest.empty()) std::filesystem::remove_all(dest);
+        CliTest::TearDown();
+    }
+
+    // 在源目录中生成一个目录树，并在临时目录中留一份副本用于比较
+    void make_tree() {
+        std::string big;
+        for (int i = 0; i < 100000; i++) big += std::to_string(i) + "\n";
+        write_file("ref/big", big);
+        write_file("ref/sub/a", "a\n");
+        write_file("ref/sub/deep/b", "b\n");
+        std::filesystem::create_symlink("sub/a", path("ref/link"));
+        ASSERT_EQ(0, run("chmod 640 ref/sub/a && touch -d '2020-01-02 03:04:05.123456789' ref/sub/a"));
+        ASSERT_EQ(0, run("cp -a ref '" + source + "/tree'"));
+    }
+
+    std::string pmv = PMV_PATH;
+    std::string source;
+    std::string dest;
+};
+
+TEST_F(PmvTest, TestMoveFile) {
+    std::string file = source + "/file";
+    write_file("expected", std::string(3 * 1024 * 1024, 'x') + "end\n");
+    ASSERT_EQ(0, run("cp expected '" + file + "' && chmod 604 '" + file + "' && "
+                     "touch -d '2021-05-06 07:08:09.987654321' '" + file + "'"));
+    struct stat before;
+    ASSERT_EQ(0, stat(file.c_str(), &before));
+
+    ASSERT_EQ(0, run(pmv + " '" + file + "' '" + dest + "/moved'"));
+    EXPECT_FALSE(std::filesystem::exists(file));
+    EXPECT_EQ(0, run("cmp expected '" + dest + "/moved'"));
+
+    struct stat after;
+    ASSERT_EQ(0, stat((dest + "/moved").c_str(), &after));
+    EXPECT_EQ(before.st_mode, after.st_mode);
+    EXPECT_EQ(before.st_mtim.tv_sec, after.st_mtim.tv_sec);
+    EXPECT_EQ(before.st_mtim.tv_nsec, after.st_mtim.tv_nsec);
+}
+
+TEST_F(PmvTest, TestMoveTree) {
+    make_tree();
+    ASSERT_EQ(0, run(pmv + " -r -j 4 '" + source + "/tree' '" + dest + "/'"));
+    EXPECT_FALSE(std::filesystem::exists(source + "/tree"));
+    EXPECT_EQ(0, run("diff -r --no-dereference ref '" + dest + "/tree'"));
+
+    struct stat expected, moved;
+    ASSERT_EQ(0, stat(path("ref/sub/a").c_str(), &expected));
+    ASSERT_EQ(0, stat((dest + "/tree/sub/a").c_str(), &moved));
+    EXPECT_EQ(expected.st_mode, moved.st_mode);
+    EXPECT_EQ(expected.st_mtim.tv_sec, moved.st_mtim.tv_sec);
+    EXPECT_EQ(expected.st_mtim.tv_nsec, moved.st_mtim.tv_nsec);
+}
+
+// 模拟中断：一个文件已经提交，另一个只留下了过期的 .pmv-part 临时文件
+TEST_F(PmvTest, TestResumeWithStalePart) {
+    make_tree();
+    ASSERT_EQ(0, run("mkdir -p '" + dest + "/tree/sub' && cp -a ref/sub/a '" + dest + "/tree/sub/a' && "
+                     "head -c 1000 /dev/urandom > '" + dest + "/tree/.pmv-part.big'"));
+
+    EXPECT_NE(0, run(pmv + " -r '" + source + "/tree' '" + dest + "/'"));
+    EXPECT_TRUE(std::filesystem::exists(source + "/tree/big"));
+
+    ASSERT_EQ(0, run(pmv + " -r --resume '" + source + "/tree' '" + dest + "/'"));
+    EXPECT_FALSE(std::filesystem::exists(source + "/tree"));
+    EXPECT_FALSE(std::filesystem::exists(dest + "/tree/.pmv-part.big"));
+    EXPECT_EQ(0, run("diff -r --no-dereference ref '" + dest + "/tree'"));
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
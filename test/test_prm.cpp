@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <sstream>
+#include <filesystem>
+#include "cli_test_fixture.h"
+
+// prm 的回收站：用 PRM_TRASH_DIR 把主回收站放到临时目录中，测试不会写入 /tmp/trash
+class PrmTest : public CliTest {
+protected:
+    void SetUp() override {
+        CliTest::SetUp();
+        std::filesystem::create_directories(path("w"));
+    }
+
+    // 在工作目录 w 中执行 prm，返回去掉颜色后的输出
+    std::string prm(const std::string &arguments) {
+        return output("cd w && PRM_TRASH_DIR='" + dir + "/trash' " + PRM_PATH + " " + arguments +
+                      " | sed 's/\\x1b\\[[0-9;]*m//g'");
+    }
+
+    // 把原路径以 /name 结尾的条目的删除时间改为 when，模拟较早删除的条目
+    void set_deleted_time(const std::string &name, long when) {
+        ASSERT_EQ(0, run("sed -i -E 's|^A\\t[0-9]+(\\t.*/" + name + ")$|A\\t" + std::to_string(when) +
+                         "\\1|' trash/index"));
+    }
+
+    // 回收站中除索引和登记表以外的条目数
+    long trash_entries() {
+        long count = 0;
+        for (const auto &entry : std::filesystem::directory_iterator(path("trash"))) {
+            std::string name = entry.path().filename().string();
+            if (name != "index" && name != "trashdirs") count++;
+        }
+        return count;
+    }
+
+    long index_lines() {
+        std::istringstream stream(read_file("trash/index"));
+        std::string line;
+        long count = 0;
+        while (std::getline(stream, line)) count++;
+        return count;
+    }
+};
+
+TEST_F(PrmTest, TestTrashListRestore) {
+    write_file("w/a", "one\n");
+    write_file("w/b", "two\n");
+    write_file("w/d/big", std::string(200000, 'x'));
+    prm("-t a b");
+    prm("-r -t d");
+    EXPECT_FALSE(std::filesystem::exists(path("w/a")));
+    EXPECT_FALSE(std::filesystem::exists(path("w/d")));
+    EXPECT_EQ(3, trash_entries());
+
+    // 目录的大小在第一次列出时计算
+    std::string listing = prm("--list-trash");
+    EXPECT_NE(std::string::npos, listing.find(dir + "/w/a"));
+    EXPECT_NE(std::string::npos, listing.find(dir + "/w/d"));
+    EXPECT_NE(std::string::npos, listing.find("共 3 项"));
+    EXPECT_NE(std::string::npos, listing.find("195.3 KB"));
+
+    prm("--restore " + dir + "/w/a");
+    prm("--restore " + dir + "/w/d");
+    EXPECT_EQ("one\n", read_file("w/a"));
+    EXPECT_EQ(std::string(200000, 'x'), read_file("w/d/big"));
+    listing = prm("--list-trash");
+    EXPECT_EQ(std::string::npos, listing.find(dir + "/w/a"));
+    EXPECT_NE(std::string::npos, listing.find("共 1 项"));
+
+    // 主回收站没有被用到
+    EXPECT_EQ(std::string::npos, output("cat /tmp/trash/index").find(dir));
+}
+
+TEST_F(PrmTest, TestPurgeOlderThan) {
+    write_file("w/old", "old\n");
+    write_file("w/new", "new\n");
+    prm("-t old new");
+    prm("--restore " + dir + "/w/new");
+    prm("-t new");
+    set_deleted_time("old", 1000000000);
+
+    prm("--purge --older-than=1d");
+    EXPECT_EQ(1, trash_entries());
+    std::string listing = prm("--list-trash");
+    EXPECT_EQ(std::string::npos, listing.find(dir + "/w/old"));
+    EXPECT_NE(std::string::npos, listing.find(dir + "/w/new"));
+
+    // 清理后索引只保留仍在回收站中的条目，恢复和删除留下的记录都被压缩掉
+    EXPECT_EQ(1, index_lines());
+}
+
+TEST_F(PrmTest, TestPurgeMaxSize) {
+    write_file("w/x", std::string(100 * 1024, 'x'));
+    write_file("w/y", std::string(10 * 1024, 'y'));
+    write_file("w/z", std::string(10 * 1024, 'z'));
+    prm("-t x y z");
+    set_deleted_time("x", 1000000000);
+    set_deleted_time("y", 1000000100);
+    set_deleted_time("z", 1000000200);
+
+    // 从最旧的开始删除，直到不超过上限
+    prm("--purge --max-size=25K");
+    std::string listing = prm("--list-trash");
+    EXPECT_EQ(std::string::npos, listing.find(dir + "/w/x"));
+    EXPECT_NE(std::string::npos, listing.find(dir + "/w/y"));
+    EXPECT_NE(std::string::npos, listing.find(dir + "/w/z"));
+    EXPECT_EQ(2, trash_entries());
+
+    prm("--purge --max-size=15K");
+    listing = prm("--list-trash");
+    EXPECT_EQ(std::string::npos, listing.find(dir + "/w/y"));
+    EXPECT_NE(std::string::npos, listing.find(dir + "/w/z"));
+}
+
+TEST_F(PrmTest, TestEmptyTrash) {
+    write_file("w/a", "a\n");
+    write_file("w/d/f", "f\n");
+    prm("-t a");
+    prm("-r -t d");
+    prm("--empty-trash");
+    EXPECT_EQ(0, trash_entries());
+    EXPECT_NE(std::string::npos, prm("--list-trash").find("共 0 项"));
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
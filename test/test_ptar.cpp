@@ -0,0 +1,175 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <filesystem>
+#include "cli_test_fixture.h"
+
+// ptar 的创建/提取往返测试
+class PtarTest : public CliTest {
+protected:
+    // 生成一个包含普通文件、空目录、长路径和符号链接的目录树
+    void make_tree() {
+        write_file("src/a.txt", "hello\n");
+        write_file("src/sub/b.bin", std::string(300000, 'x') + "tail");
+        write_file("src/" + std::string(120, 'd') + "/" + std::string(80, 'f'), "long name\n");
+        std::filesystem::create_directories(path("src/empty"));
+        std::filesystem::create_symlink("a.txt", path("src/link"));
+        std::filesystem::create_symlink("..", path("src/sub/up"));
+    }
+
+    std::string ptar = PTAR_PATH;
+};
+
+TEST_F(PtarTest, TestRoundTrip) {
+    make_tree();
+    ASSERT_EQ(0, run(ptar + " -cf a.tar src"));
+    for (const char *jobs : {"1", "4"}) {
+        std::string out = std::string("out") + jobs;
+        std::filesystem::create_directories(path(out));
+        ASSERT_EQ(0, run("cd " + out + " && " + ptar + " --jobs " + jobs + " -xf ../a.tar"));
+        EXPECT_EQ(0, run("diff -r --no-dereference src " + out + "/src"));
+        EXPECT_TRUE(std::filesystem::is_symlink(path(out + "/src/sub/up")));
+        EXPECT_EQ("a.txt", std::filesystem::read_symlink(path(out + "/src/link")).string());
+    }
+}
+
+TEST_F(PtarTest, TestGzipRoundTrip) {
+    make_tree();
+    ASSERT_EQ(0, run(ptar + " -czf a.tar.gz src"));
+    std::filesystem::create_directories(path("out"));
+    ASSERT_EQ(0, run("cd out && " + ptar + " -xf ../a.tar.gz"));
+    EXPECT_EQ(0, run("diff -r --no-dereference src out/src"));
+}
+
+TEST_F(PtarTest, TestReadableByTar) {
+    make_tree();
+    ASSERT_EQ(0, run(ptar + " -cf a.tar src"));
+    std::filesystem::create_directories(path("out"));
+    ASSERT_EQ(0, run("tar -xf a.tar -C out"));
+    EXPECT_EQ(0, run("diff -r --no-dereference src out/src"));
+}
+
+// 成员经过归档中的符号链接时不能写到提取目录之外
+TEST_F(PtarTest, TestSymlinkEscape) {
+    std::filesystem::create_directories(path("victim"));
+    std::filesystem::create_directories(path("s1"));
+    std::filesystem::create_symlink("../victim", path("s1/evil"));
+    write_file("s2/evil/x", "escaped\n");
+    ASSERT_EQ(0, run("tar -cf evil.tar -C s1 evil -C ../s2 evil/x"));
+
+    std::filesystem::create_directories(path("out"));
+    EXPECT_NE(0, run("cd out && " + ptar + " -xf ../evil.tar"));
+    EXPECT_TRUE(std::filesystem::is_empty(path("victim")));
+}
+
+// 同名成员按归档顺序提取，后面的覆盖前面的，包括先出现的符号链接
+TEST_F(PtarTest, TestDuplicateMembers) {
+    write_file("v1/dup", "first\n");
+    write_file("v2/dup", "second\n");
+    std::filesystem::create_directories(path("v3"));
+    std::filesystem::create_symlink("/etc/passwd", path("v3/s"));
+    write_file("v4/s", "file wins\n");
+    ASSERT_EQ(0, run("tar -cf dup.tar -C v1 dup -C ../v2 dup -C ../v3 s -C ../v4 s"));
+
+    std::filesystem::create_directories(path("out"));
+    ASSERT_EQ(0, run("cd out && " + ptar + " --jobs 4 -xf ../dup.tar"));
+    EXPECT_EQ("second\n", read_file("out/dup"));
+    EXPECT_FALSE(std::filesystem::is_symlink(path("out/s")));
+    EXPECT_EQ("file wins\n", read_file("out/s"));
+}
+
+TEST_F(PtarTest, TestStripParentComponents) {
+    write_file("upfile", "up\n");
+    std::filesystem::create_directories(path("work"));
+    ASSERT_EQ(0, run("cd work && " + ptar + " -cf ../a.tar ../upfile"));
+    std::filesystem::create_directories(path("out"));
+    ASSERT_EQ(0, run("cd out && " + ptar + " -xf ../a.tar"));
+    EXPECT_EQ("up\n", read_file("out/upfile"));
+}
+
+// 按顺序恢复 0、1、2 级增量归档，得到最后的目录树，删除和改名都要体现出来
+TEST_F(PtarTest, TestIncrementalChain) {
+    write_file("src/a.txt", "a0\n");
+    write_file("src/b.txt", "b0\n");
+    write_file("src/sub/c.txt", "c0\n");
+    write_file("src/sub/deep/d.txt", "d0\n");
+    write_file("src/gone/e.txt", "e0\n");
+    std::filesystem::create_symlink("a.txt", path("src/link"));
+    ASSERT_EQ(0, run(ptar + " -cf l0.tar --listed-incremental snap src"));
+
+    // 修改、删除、改名、删除整个目录、新增
+    write_file("src/a.txt", "a1 longer\n");
+    std::filesystem::remove(path("src/b.txt"));
+    std::filesystem::rename(path("src/sub/c.txt"), path("src/sub/c2.txt"));
+    std::filesystem::remove_all(path("src/gone"));
+    write_file("src/new/f.txt", "f1\n");
+    std::filesystem::permissions(path("src/sub/deep/d.txt"), std::filesystem::perms::owner_read |
+                                 std::filesystem::perms::owner_write);
+    ASSERT_EQ(0, run(ptar + " -cf l1.tar --listed-incremental snap src"));
+
+    // 文件变成目录、目录改名、删除符号链接
+    std::filesystem::remove(path("src/a.txt"));
+    write_file("src/a.txt/inner", "inner\n");
+    std::filesystem::rename(path("src/sub/deep"), path("src/sub/deeper"));
+    std::filesystem::remove(path("src/link"));
+    ASSERT_EQ(0, run(ptar + " -cf l2.tar --listed-incremental snap src"));
+
+    std::filesystem::create_directories(path("out"));
+    for (const char *level : {"l0.tar", "l1.tar", "l2.tar"}) {
+        ASSERT_EQ(0, run("cd out && " + ptar + " -xf ../" + level + " --listed-incremental /dev/null")) << level;
+    }
+    EXPECT_EQ(0, run("diff -r --no-dereference src out/src"));
+    EXPECT_FALSE(std::filesystem::exists(path("out/src/b.txt")));
+    EXPECT_FALSE(std::filesystem::exists(path("out/src/gone")));
+    EXPECT_FALSE(std::filesystem::exists(path("out/src/sub/c.txt")));
+    EXPECT_FALSE(std::filesystem::exists(path("out/src/sub/deep")));
+    EXPECT_FALSE(std::filesystem::exists(std::filesystem::symlink_status(path("out/src/link"))));
+    EXPECT_EQ(std::filesystem::status(path("src/sub/deeper/d.txt")).permissions(),
+              std::filesystem::status(path("out/src/sub/deeper/d.txt")).permissions());
+}
+
+// 借助索引列出归档并提取单个成员，普通归档和 -z 分块压缩的归档都要覆盖
+TEST_F(PtarTest, TestIndexedMemberExtraction) {
+    make_tree();
+    std::string big;
+    for (int i = 0; i < 200000; i++) big += std::to_string(i) + "\n";
+    write_file("src/sub/big.txt", big);
+
+    for (const char *archive : {"a.tar", "a.tar.gz"}) {
+        std::string create = std::string(archive) == "a.tar" ? " -cf " : " -czf ";
+        ASSERT_EQ(0, run(ptar + create + archive + " --index src")) << archive;
+        ASSERT_TRUE(std::filesystem::exists(path(std::string(archive) + ".idx"))) << archive;
+
+        std::string listing = output(ptar + " -tf " + archive);
+        EXPECT_NE(std::string::npos, listing.find("(索引)")) << archive;
+        EXPECT_NE(std::string::npos, listing.find("src/sub/big.txt")) << archive;
+
+        std::string out = std::string("out-") + archive;
+        std::filesystem::create_directories(path(out));
+        ASSERT_EQ(0, run("cd " + out + " && " + ptar + " -xf ../" + archive + " src/sub/big.txt")) << archive;
+        EXPECT_EQ(0, run("cmp src/sub/big.txt " + out + "/src/sub/big.txt")) << archive;
+        EXPECT_FALSE(std::filesystem::exists(path(out + "/src/a.txt"))) << archive;
+    }
+}
+
+// 为外部工具生成的归档补建索引；归档被改动后旧索引不再使用
+TEST_F(PtarTest, TestIndexExistingArchive) {
+    make_tree();
+    ASSERT_EQ(0, run("tar -cf a.tar src"));
+    ASSERT_EQ(0, run(ptar + " -f a.tar --index"));
+    EXPECT_NE(std::string::npos, output(ptar + " -tf a.tar").find("(索引)"));
+
+    std::filesystem::create_directories(path("out"));
+    ASSERT_EQ(0, run("cd out && " + ptar + " -xf ../a.tar src/sub/b.bin"));
+    EXPECT_EQ(0, run("cmp src/sub/b.bin out/src/sub/b.bin"));
+
+    write_file("src/a.txt", "changed\n");
+    ASSERT_EQ(0, run("tar -cf a.tar src"));
+    EXPECT_EQ(std::string::npos, output(ptar + " -tf a.tar").find("(索引)"));
+    ASSERT_EQ(0, run("cd out && " + ptar + " -xf ../a.tar src/a.txt"));
+    EXPECT_EQ("changed\n", read_file("out/src/a.txt"));
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,310 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <sstream>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <random>
+#include "cli_test_fixture.h"
+
+// puniq --global 的测试，用很小的 --memory 迫使它借助临时文件
+class PuniqTest : public CliTest {
+protected:
+    void SetUp() override {
+        CliTest::SetUp();
+
+        // 乱序输入：约 7500 个不同的键，出现次数各不相同。
+        // prefixed 中每行前面加一个随机字段，chars 中加 6 个随机字符，去掉后与 input 的键相同
+        std::mt19937 generator(3);
+        std::ofstream input(path("input"), std::ios::binary);
+        std::ofstream prefixed(path("prefixed"), std::ios::binary);
+        std::ofstream chars(path("chars"), std::ios::binary);
+        for (int i = 0; i < 200000; i++) {
+            std::string key = "key-" + std::to_string(generator() % 5000 * (generator() % 2 + 1));
+            std::string noise = std::to_string(100000 + generator() % 900000);
+            input << key << "\n";
+            prefixed << "n" << noise << " " << key << "\n";
+            chars << noise << key << "\n";
+            expected[key]++;
+        }
+    }
+
+    // 解析 -c 的输出：行首是计数，空格之后是行内容，key 从行内容中取出比较用的键
+    std::map<std::string, long> parse_counts(const std::string &text,
+                                             const std::function<std::string(const std::string &)> &key) {
+        std::map<std::string, long> counts;
+        std::istringstream stream(text);
+        long count;
+        std::string line;
+        while (stream >> count && std::getline(stream, line)) {
+            counts[key(line.substr(1))] += count;
+        }
+        return counts;
+    }
+
+    std::map<std::string, long> parse_counts(const std::string &text) {
+        return parse_counts(text, [](const std::string &line) { return line; });
+    }
+
+    std::string puniq = PUNIQ_PATH;
+    std::map<std::string, long> expected;
+};
+
+TEST_F(PuniqTest, TestGlobalInMemory) {
+    std::map<std::string, long> counts = parse_counts(output(puniq + " --no-color -c --global input"));
+    EXPECT_EQ(expected, counts);
+}
+
+TEST_F(PuniqTest, TestGlobalSpill) {
+    std::map<std::string, long> counts = parse_counts(output(puniq + " --no-color -c --global --memory=64K input"));
+    EXPECT_EQ(expected, counts);
+
+    std::istringstream stream(output(puniq + " --no-color --global --memory=64K input"));
+    std::map<std::string, long> seen;
+    std::string line;
+    while (std::getline(stream, line)) seen[line]++;
+    EXPECT_EQ(expected.size(), seen.size());
+    for (const auto &item : seen) {
+        EXPECT_EQ(1, item.second) << item.first;
+        EXPECT_TRUE(expected.count(item.first)) << item.first;
+    }
+}
+
+TEST_F(PuniqTest, TestGlobalSpillRepeated) {
+    std::istringstream stream(output(puniq + " --no-color -d --global --memory=64K input"));
+    std::map<std::string, long> seen;
+    std::string line;
+    while (std::getline(stream, line)) seen[line]++;
+
+    long repeated = 0;
+    for (const auto &item : expected) {
+        if (item.second > 1) {
+            repeated++;
+            EXPECT_EQ(1, seen[item.first]) << item.first;
+        }
+    }
+    EXPECT_EQ(repeated, (long)seen.size());
+}
+
+// -f 和 -s 决定比较用的键，输出的是每个键第一次出现的整行
+TEST_F(PuniqTest, TestGlobalSkipFieldsAndChars) {
+    auto last_field = [](const std::string &line) { return line.substr(line.rfind(' ') + 1); };
+    auto skip_chars = [](const std::string &line) { return line.substr(6); };
+    for (const char *memory : {"", " --memory=64K"}) {
+        EXPECT_EQ(expected, parse_counts(output(puniq + " --no-color -c --global -f 1" + memory + " prefixed"), last_field))
+            << memory;
+        EXPECT_EQ(expected, parse_counts(output(puniq + " --no-color -c --global -s 6" + memory + " chars"), skip_chars))
+            << memory;
+        EXPECT_EQ(expected, parse_counts(output(puniq + " --no-color -c -g --skip-chars=6" + memory + " chars"), skip_chars))
+            << memory;
+    }
+}
+
+// --top 的测试：前 20 个键的次数各不相同，其余是大量只出现一到三次的键
+class PuniqTopTest : public CliTest {
+protected:
+    void SetUp() override {
+        CliTest::SetUp();
+
+        std::vector<std::string> lines;
+        for (int i = 0; i < 20; i++) {
+            for (int k = 0; k < 3000 - 120 * i; k++) lines.push_back("hot-" + std::to_string(i));
+        }
+        std::mt19937 generator(11);
+        for (int i = 0; i < 30000; i++) {
+            int repeat = (int)(generator() % 3) + 1;
+            for (int k = 0; k < repeat; k++) lines.push_back("cold-" + std::to_string(i));
+        }
+        std::shuffle(lines.begin(), lines.end(), generator);
+
+        std::ofstream input(path("skewed"), std::ios::binary);
+        for (const std::string &line : lines) {
+            input << line << "\n";
+            truth[line]++;
+        }
+
+        // warmed 开头先是 5000 个各出现两次的键，占满计数器后热点行才出现，
+        // 近似模式下热点行会继承被替换计数器的次数，误差不为 0
+        std::ofstream warmed(path("warmed"), std::ios::binary);
+        for (int i = 0; i < 10000; i++) {
+            std::string line = "warm-" + std::to_string(i / 2);
+            warmed << line << "\n";
+            warmed_truth[line]++;
+        }
+        for (const std::string &line : lines) {
+            warmed << line << "\n";
+            warmed_truth[line]++;
+        }
+    }
+
+    // 解析 "次数 行" 形式的输出，按出现顺序返回
+    std::vector<std::pair<long, std::string>> parse_top(const std::string &text) {
+        std::vector<std::pair<long, std::string>> items;
+        std::istringstream stream(text);
+        std::string line;
+        while (std::getline(stream, line)) {
+            std::istringstream fields(line);
+            long count;
+            std::string key;
+            if (fields >> count >> key) items.emplace_back(count, key);
+        }
+        return items;
+    }
+
+    std::string puniq = PUNIQ_PATH;
+    std::map<std::string, long> truth;
+    std::map<std::string, long> warmed_truth;
+};
+
+TEST_F(PuniqTopTest, TestExactMatchesSort) {
+    auto expected = parse_top(output("sort skewed | uniq -c | sort -rn | head -10"));
+    ASSERT_EQ(10u, expected.size());
+    for (const char *memory : {"", " --memory=64K"}) {
+        EXPECT_EQ(expected, parse_top(output(puniq + " --no-color --top=10" + memory + " skewed"))) << memory;
+    }
+}
+
+// Space-Saving 的计数只会高估：count - 误差 <= 真实次数 <= count，而且热点行都能找到
+TEST_F(PuniqTopTest, TestApproxGuaranteedCounts) {
+    std::istringstream stream(output(puniq + " --no-color --verbose --top=10 --approx warmed"));
+    std::vector<std::pair<long, std::string>> items;
+    std::vector<long> errors;
+    std::string line;
+    while (std::getline(stream, line)) {
+        size_t bound = line.find("(误差 ≤ ");
+        if (bound != std::string::npos && !errors.empty()) {
+            errors.back() = std::stol(line.substr(bound + strlen("(误差 ≤ ")));
+            continue;
+        }
+        std::istringstream fields(line);
+        long count;
+        std::string key, rest;
+        if (fields >> count >> key && !(fields >> rest) && warmed_truth.count(key)) {
+            items.emplace_back(count, key);
+            errors.push_back(0);
+        }
+    }
+
+    ASSERT_EQ(10u, items.size());
+    for (size_t i = 0; i < items.size(); i++) {
+        const auto &[count, key] = items[i];
+        EXPECT_LE(count - errors[i], warmed_truth[key]) << key;
+        EXPECT_GE(count, warmed_truth[key]) << key;
+        EXPECT_EQ(0u, key.rfind("hot-", 0)) << key;
+    }
+    EXPECT_GT(*std::max_element(errors.begin(), errors.end()), 0);
+}
+
+// --count-distinct：不同的值较少时结果精确，较多时是 HyperLogLog 估计
+class PuniqDistinctTest : public CliTest {
+protected:
+    // 写入 distinct 个不同的键，每个键出现一到三次，顺序打乱。每行两个字段，第二个字段只有 10 种
+    void write_keys(const std::string &name, int first, int distinct, unsigned seed) {
+        std::vector<std::string> lines;
+        std::mt19937 generator(seed);
+        for (int i = first; i < first + distinct; i++) {
+            int repeat = (int)(generator() % 3) + 1;
+            for (int k = 0; k < repeat; k++) {
+                lines.push_back("key-" + std::to_string(i) + " group-" + std::to_string(i % 10));
+            }
+        }
+        std::shuffle(lines.begin(), lines.end(), generator);
+        std::ofstream file(path(name), std::ios::binary);
+        for (const std::string &line : lines) file << line << "\n";
+    }
+
+    // 去掉颜色后的输出
+    std::string distinct(const std::string &arguments) {
+        return output(puniq + " --count-distinct " + arguments + " | sed 's/\\x1b\\[[0-9;]*m//g'");
+    }
+
+    // 取出 "不同的行: N" 或 "字段 F: N" 中的 N
+    long estimate(const std::string &text, const std::string &label = "不同的行:") {
+        size_t position = text.find(label);
+        if (position == std::string::npos) return -1;
+        return std::stol(text.substr(position + label.size()));
+    }
+
+    std::string puniq = PUNIQ_PATH;
+};
+
+TEST_F(PuniqDistinctTest, TestExactForSmallSets) {
+    for (int count : {0, 1, 7, 100, 500}) {
+        write_keys("small", 0, count, (unsigned)count);
+        std::string result = distinct("small");
+        EXPECT_EQ(count, estimate(result)) << result;
+        EXPECT_NE(std::string::npos, result.find("(精确)")) << result;
+    }
+
+    write_keys("small", 0, 300, 1);
+    std::string result = distinct("-f 1,2 small");
+    EXPECT_EQ(300, estimate(result, "字段 1:")) << result;
+    EXPECT_EQ(10, estimate(result, "字段 2:")) << result;
+}
+
+TEST_F(PuniqDistinctTest, TestErrorBoundForManyKeys) {
+    write_keys("many", 0, 100000, 1);
+    std::string result = distinct("many");
+    EXPECT_NEAR(100000, estimate(result), 5000) << result;
+    EXPECT_EQ(std::string::npos, result.find("(精确)")) << result;
+}
+
+// 两半分别保存草图再合并，与一次处理拼接后的输入结果相同
+TEST_F(PuniqDistinctTest, TestSaveMergeRoundTrip) {
+    // 两半的精确集合合并后仍然精确
+    write_keys("first", 0, 200, 1);
+    write_keys("second", 100, 200, 2);
+    ASSERT_EQ(0, run(puniq + " --count-distinct --save-sketch=first.hll first"));
+    ASSERT_EQ(0, run(puniq + " --count-distinct --save-sketch=second.hll second"));
+    std::string small = distinct("--merge=first.hll --merge=second.hll");
+    EXPECT_EQ(300, estimate(small)) << small;
+    EXPECT_NE(std::string::npos, small.find("(精确)")) << small;
+
+    for (int distinct_keys : {200, 100000}) {
+        write_keys("first", 0, distinct_keys, 1);
+        write_keys("second", distinct_keys / 2, distinct_keys, 2);
+        ASSERT_EQ(0, run("cat first second > both"));
+
+        for (const char *fields : {"", "-f 1,2 "}) {
+            ASSERT_EQ(0, run(puniq + " --count-distinct " + fields + "--save-sketch=first.hll first"));
+            ASSERT_EQ(0, run(puniq + " --count-distinct " + fields + "--save-sketch=second.hll second"));
+            std::string merged = distinct("--merge=first.hll --merge=second.hll");
+            EXPECT_EQ(distinct(std::string(fields) + "both"), merged) << distinct_keys << " " << fields;
+
+            // 合并的同时还可以处理新的输入
+            EXPECT_EQ(distinct(std::string(fields) + "both"),
+                      distinct(std::string(fields) + "--merge=first.hll second")) << distinct_keys << " " << fields;
+        }
+    }
+
+    std::string merged = distinct("--merge=first.hll --merge=second.hll");
+    EXPECT_NEAR(150000, estimate(merged, "字段 1:"), 7500) << merged;
+}
+
+TEST_F(PuniqDistinctTest, TestMergeMismatchRefused) {
+    write_keys("input", 0, 1000, 1);
+    ASSERT_EQ(0, run(puniq + " --count-distinct --save-sketch=p12.hll input"));
+    ASSERT_EQ(0, run(puniq + " --count-distinct --precision=10 --save-sketch=p10.hll input"));
+    ASSERT_EQ(0, run(puniq + " --count-distinct -f 1 --save-sketch=f1.hll input"));
+    ASSERT_EQ(0, run(puniq + " --count-distinct -f 1,2 --save-sketch=f12.hll input"));
+
+    // 精度不同
+    EXPECT_NE(0, run(puniq + " --count-distinct --merge=p12.hll --merge=p10.hll"));
+    EXPECT_NE(0, run(puniq + " --count-distinct --precision=10 --merge=p12.hll input"));
+    // 字段列表不同
+    EXPECT_NE(0, run(puniq + " --count-distinct --merge=f1.hll --merge=f12.hll"));
+    EXPECT_NE(0, run(puniq + " --count-distinct -f 2 --merge=f1.hll input"));
+    EXPECT_NE(0, run(puniq + " --count-distinct --merge=f1.hll input"));
+    // 不是草图文件
+    EXPECT_NE(0, run(puniq + " --count-distinct --merge=input"));
+
+    EXPECT_EQ(0, run(puniq + " --count-distinct -f 1 --merge=f1.hll input"));
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,70 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <filesystem>
+#include <random>
+#include "cli_test_fixture.h"
+
+// pzip 的压缩/解压往返测试
+class PzipTest : public CliTest {
+protected:
+    // 可压缩的文本、随机数据（直接存储）、空文件和空目录
+    void make_tree() {
+        std::string text;
+        for (int i = 0; i < 20000; i++) text += "line " + std::to_string(i) + "\n";
+        std::string random(500000, '\0');
+        std::mt19937 generator(42);
+        for (char &c : random) c = (char)(generator() & 0xff);
+
+        write_file("src/a.txt", text);
+        write_file("src/sub/random.bin", random);
+        write_file("src/sub/empty", "");
+        std::filesystem::create_directories(path("src/emptydir"));
+    }
+
+    std::string pzip = PZIP_PATH;
+};
+
+TEST_F(PzipTest, TestRoundTrip) {
+    make_tree();
+    ASSERT_EQ(0, run(pzip + " -c -r -p a.zip src"));
+    for (const char *jobs : {"1", "4"}) {
+        std::string out = std::string("out") + jobs;
+        std::filesystem::create_directories(path(out));
+        ASSERT_EQ(0, run("cd " + out + " && " + pzip + " -j " + jobs + " -x ../a.zip"));
+        EXPECT_EQ(0, run("diff -r src " + out + "/src"));
+    }
+}
+
+TEST_F(PzipTest, TestReadableByUnzip) {
+    make_tree();
+    ASSERT_EQ(0, run(pzip + " -c -r -p -9 a.zip src"));
+    EXPECT_EQ(0, run("unzip -tq a.zip"));
+    ASSERT_EQ(0, run("unzip -q a.zip -d out"));
+    EXPECT_EQ(0, run("diff -r src out/src"));
+}
+
+TEST_F(PzipTest, TestExtractZipFromZip) {
+    make_tree();
+    ASSERT_EQ(0, run("cd src && zip -qr ../a.zip ."));
+    std::filesystem::create_directories(path("out"));
+    ASSERT_EQ(0, run("cd out && " + pzip + " -x ../a.zip"));
+    EXPECT_EQ(0, run("diff -r src out"));
+}
+
+// 目录中的符号链接不跟随，指向上级目录的链接不会无限嵌套
+TEST_F(PzipTest, TestSymlinkLoop) {
+    write_file("loop/d/f", "hi\n");
+    std::filesystem::create_symlink("..", path("loop/d/up"));
+    ASSERT_EQ(0, run(pzip + " -c -r -p a.zip loop"));
+    EXPECT_EQ(0, run("test \"$(unzip -Z1 a.zip | wc -l)\" -eq 3"));
+
+    std::filesystem::create_directories(path("out"));
+    ASSERT_EQ(0, run("cd out && " + pzip + " -x ../a.zip"));
+    EXPECT_FALSE(std::filesystem::exists(path("out/loop/d/up")));
+    EXPECT_EQ(0, run("cmp loop/d/f out/loop/d/f"));
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}